@@ -0,0 +1,38 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "runtime/interpreter.h"
+
+// Calls into a script loaded once through the embedding API, as a service
+// using ints as a rules engine would, against loading it for every call.
+static const std::string RULES = WORKLOAD_DIR "/rules.ints";
+
+static void BM_Call(benchmark::State& state, Engine engine) {
+    InterpretOptions options;
+    options.engine = engine;
+    Script script(RULES, options);
+    std::vector<int> order = {12, 700, 49};
+    for (auto _ : state) {
+        auto points = script.callInts("score", {ArrayView{order.data(), 3}});
+        benchmark::DoNotOptimize(points.data());
+    }
+}
+
+static void BM_LoadAndCall(benchmark::State& state) {
+    std::vector<int> order = {12, 700, 49};
+    for (auto _ : state) {
+        Script script(RULES);
+        auto points = script.callInts("score", {ArrayView{order.data(), 3}});
+        benchmark::DoNotOptimize(points.data());
+    }
+}
+
+BENCHMARK_CAPTURE(BM_Call, walker, Engine::TREE_WALKER);
+BENCHMARK_CAPTURE(BM_Call, vm, Engine::VM);
+BENCHMARK(BM_LoadAndCall);
+
+BENCHMARK_MAIN();
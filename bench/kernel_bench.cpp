@@ -0,0 +1,118 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "runtime/algorithms.h"
+#include "runtime/kernels.h"
+
+// Operands avoid zero and -1 so that DIV and MOD measure the vector path.
+static std::vector<int> operand(size_t size, int seed) {
+    std::vector<int> result(size);
+    for (size_t i = 0; i < size; i++)
+        result[i] = static_cast<int>((i * 2654435761u + seed) % 1000) + 1;
+    return result;
+}
+
+static void BM_Arithmetic(benchmark::State& state, ArithmeticKernel kernel) {
+    size_t size = static_cast<size_t>(state.range(0));
+    auto left = operand(size, 7);
+    auto right = operand(size, 13);
+    std::vector<int> out(size);
+    for (auto _ : state) {
+        applyArithmetic(kernel, left.data(), right.data(), out.data(), size);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetLabel(kernelInstructionSet());
+}
+
+// Equal operands make every comparison scan the whole array, except for the
+// strict ones, which fail on the first block.
+static void BM_Compare(benchmark::State& state, CompareKernel kernel) {
+    size_t size = static_cast<size_t>(state.range(0));
+    auto left = operand(size, 7);
+    auto right = left;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(
+            compareAll(kernel, left.data(), right.data(), size));
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetLabel(kernelInstructionSet());
+}
+
+static void BM_Reduce(benchmark::State& state, ReductionKernel kernel) {
+    size_t size = static_cast<size_t>(state.range(0));
+    auto data = operand(size, 7);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(applyReduction(kernel, data.data(), size));
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetLabel(kernelInstructionSet());
+}
+
+static void BM_Find(benchmark::State& state) {
+    size_t size = static_cast<size_t>(state.range(0));
+    auto data = operand(size, 7);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(findFirst(data.data(), size, 0));
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetLabel(kernelInstructionSet());
+}
+
+// std::sort is the baseline that sortInts falls back to on one thread.
+static void BM_Sort(benchmark::State& state, bool library) {
+    size_t size = static_cast<size_t>(state.range(0));
+    auto source = operand(size, 7);
+    std::vector<int> data(size);
+    for (auto _ : state) {
+        std::copy(source.begin(), source.end(), data.begin());
+        if (library)
+            std::sort(data.begin(), data.end());
+        else
+            sortInts(data.data(), size);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_Scan(benchmark::State& state) {
+    size_t size = static_cast<size_t>(state.range(0));
+    auto data = operand(size, 7);
+    std::vector<int> out(size);
+    for (auto _ : state) {
+        prefixSum(data.data(), out.data(), size);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+#define KERNEL_SIZES RangeMultiplier(32)->Range(16, 1 << 20)
+
+BENCHMARK_CAPTURE(BM_Arithmetic, add, ArithmeticKernel::ADD)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, sub, ArithmeticKernel::SUB)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, mul, ArithmeticKernel::MUL)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, div, ArithmeticKernel::DIV)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, mod, ArithmeticKernel::MOD)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, and, ArithmeticKernel::AND)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, shl, ArithmeticKernel::SHL)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Arithmetic, shr, ArithmeticKernel::SHR)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Compare, eq, CompareKernel::EQ)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Compare, ne, CompareKernel::NE)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Compare, lt, CompareKernel::LT)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Compare, le, CompareKernel::LE)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Compare, gt, CompareKernel::GT)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Compare, ge, CompareKernel::GE)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Reduce, sum, ReductionKernel::SUM)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Reduce, min, ReductionKernel::MIN)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Reduce, max, ReductionKernel::MAX)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Reduce, prod, ReductionKernel::PRODUCT)->KERNEL_SIZES;
+
+BENCHMARK(BM_Find)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Sort, std_sort, true)->KERNEL_SIZES;
+BENCHMARK_CAPTURE(BM_Sort, sort_ints, false)->KERNEL_SIZES;
+BENCHMARK(BM_Scan)->KERNEL_SIZES;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,66 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+#include "lexer/tokenize.h"
+
+// A function with every token kind, renamed on each repeat so identifiers
+// don't all share one spelling.
+static std::string generateSource(size_t bytes) {
+    std::string source;
+    source.reserve(bytes + 256);
+    for (size_t n = 0; source.size() < bytes; n++) {
+        std::string id = std::to_string(n);
+        source += "fn step_" + id + "(values: [+], count: [1]) -> [+] {\n";
+        source += "    let total: [1] = [0];\n";
+        source += "    for value: values {\n";
+        source += "        if value >= [-" + id + "] {\n";
+        source += "            total = total + value * [3] / [2];\n";
+        source += "        }\n";
+        source += "    }\n";
+        source += "    let name: [+] = \"step\\t" + id + "\\n\";\n";
+        source += "    return values[1:count].append(total).sort();\n";
+        source += "}\n";
+    }
+    return source;
+}
+
+static void BM_Tokenize(benchmark::State& state) {
+    std::string source = generateSource(static_cast<size_t>(state.range(0)));
+    size_t tokens = 0;
+    for (auto _ : state) {
+        auto result = tokenize(source);
+        tokens = result.size();
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["tokens"] = static_cast<double>(tokens);
+}
+
+// Reads the source a chunk at a time the way the interpreter loads files,
+// releasing each token once the next has been lexed.
+static void BM_TokenStream(benchmark::State& state) {
+    std::string source = generateSource(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        std::istringstream input(source);
+        TokenStream tokens(input);
+        size_t i = 0;
+        for (; tokens.has(i); i++) {
+            benchmark::DoNotOptimize(tokens[i].getValue().data());
+            tokens.release(i);
+        }
+        state.counters["tokens"] = static_cast<double>(i);
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+
+#define LEXER_SIZES RangeMultiplier(8)->Range(1 << 14, 1 << 23)
+
+BENCHMARK(BM_Tokenize)->LEXER_SIZES;
+BENCHMARK(BM_TokenStream)->LEXER_SIZES;
+
+BENCHMARK_MAIN();
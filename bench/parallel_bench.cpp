@@ -0,0 +1,73 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "runtime/kernels.h"
+#include "runtime/parallel.h"
+
+// Each benchmark drives its own pool of state.range(1) threads; the shared
+// pool is kept out of the way so that the kernels run inline in each chunk.
+
+static constexpr size_t GRAIN = 1 << 14;
+
+static void keepKernelsInline() { configureParallelism(1, SIZE_MAX); }
+
+static void BM_ParallelAdd(benchmark::State& state) {
+    keepKernelsInline();
+    size_t size = static_cast<size_t>(state.range(0));
+    ThreadPool pool(static_cast<size_t>(state.range(1)));
+    std::vector<int> left(size, 3), right(size, 4), out(size);
+    for (auto _ : state) {
+        pool.parallelFor(size, GRAIN, [&](size_t begin, size_t end) {
+            applyArithmetic(ArithmeticKernel::ADD, left.data() + begin,
+                            right.data() + begin, out.data() + begin,
+                            end - begin);
+        });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_ParallelSqrt(benchmark::State& state) {
+    keepKernelsInline();
+    size_t size = static_cast<size_t>(state.range(0));
+    ThreadPool pool(static_cast<size_t>(state.range(1)));
+    std::vector<int> source(size, 1000), out(size);
+    for (auto _ : state) {
+        pool.parallelFor(size, GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) out[i] = sqrt(source[i]);
+        });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_ParallelRange(benchmark::State& state) {
+    keepKernelsInline();
+    size_t size = static_cast<size_t>(state.range(0));
+    ThreadPool pool(static_cast<size_t>(state.range(1)));
+    std::vector<int> out(size);
+    for (auto _ : state) {
+        pool.parallelFor(size, GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) out[i] = i;
+        });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+#define SCALING                                                   \
+    ArgsProduct({{1 << 20, 1 << 24}, {1, 2, 4, 8, 16}})           \
+        ->ArgNames({"size", "threads"})                           \
+        ->UseRealTime()
+
+BENCHMARK(BM_ParallelAdd)->SCALING;
+BENCHMARK(BM_ParallelSqrt)->SCALING;
+BENCHMARK(BM_ParallelRange)->SCALING;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,88 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "lexer/tokenize.h"
+#include "parser/module.h"
+#include "parser/parse.h"
+
+static void parse(benchmark::State& state, const std::string& source) {
+    for (auto _ : state) {
+        TokenStream tokens{std::string_view(source)};
+        auto root = RootNode::parse(tokens);
+        benchmark::DoNotOptimize(root.getValues().data());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+
+// `a + a * a - a / a ...`, one long chain mixing both precedences.
+static void BM_ParseChain(benchmark::State& state) {
+    static const char* operators[] = {" + ", " * ", " - ", " / "};
+    std::string source = "fn f(a: [1]) -> [1] {\n    return a";
+    for (int64_t n = 0; n < state.range(0); n++)
+        source += std::string(operators[n % 4]) + "a";
+    source += ";\n}\n";
+    parse(state, source);
+}
+
+// `((((a + a) * a) + a) ...)`, nested `range(0)` parentheses deep.
+static void BM_ParseNested(benchmark::State& state) {
+    std::string source = "fn f(a: [1]) -> [1] {\n    return ";
+    source += std::string(state.range(0), '(') + "a";
+    for (int64_t n = 0; n < state.range(0); n++)
+        source += n % 2 == 0 ? " + a)" : " * a)";
+    source += ";\n}\n";
+    parse(state, source);
+}
+
+// One global array literal with `range(0)` elements.
+static void BM_ParseLiteral(benchmark::State& state) {
+    std::string source = "let data: [+] = [";
+    for (int64_t n = 0; n < state.range(0); n++) {
+        if (n > 0) source += ", ";
+        source += std::to_string(n * 7919 % 100000 - 50000);
+    }
+    source += "];\n";
+    parse(state, source);
+}
+
+// A library of `range(0)` small functions, parsed from source or read back
+// from the module cache.
+static void BM_LoadModule(benchmark::State& state, bool cached) {
+    auto directory = std::filesystem::temp_directory_path() / "ints_bench";
+    std::filesystem::create_directories(directory);
+    setenv("INTS_CACHE_DIR", (directory / "cache").c_str(), 1);
+    std::string filename = (directory / "library.ints").string();
+    std::string source;
+    for (int64_t n = 0; n < state.range(0); n++)
+        source += "fn f" + std::to_string(n) +
+                  "(a: [+], b: [1]) -> [+] {\n"
+                  "    let r: [+] = a * b + [1, 2, 3] - a[1:2].size();\n"
+                  "    if b < [" + std::to_string(n) + "] {\n"
+                  "        return r.append([1, 2, 3]);\n"
+                  "    }\n"
+                  "    return r;\n"
+                  "}\n";
+    std::ofstream(filename, std::ios::binary) << source;
+    if (cached) loadModule(filename, true);
+    for (auto _ : state) {
+        auto root = loadModule(filename, cached);
+        benchmark::DoNotOptimize(root.getValues().data());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+
+BENCHMARK(BM_ParseChain)->RangeMultiplier(8)->Range(8, 1 << 12);
+BENCHMARK(BM_ParseNested)->RangeMultiplier(8)->Range(8, 1 << 9);
+BENCHMARK(BM_ParseLiteral)->RangeMultiplier(8)->Range(8, 1 << 18);
+BENCHMARK_CAPTURE(BM_LoadModule, source, false)->Range(8, 1 << 12);
+BENCHMARK_CAPTURE(BM_LoadModule, cache, true)->Range(8, 1 << 12);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,55 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "runtime/interpreter.h"
+
+// How long a script takes to get going: loading hello.ints and running its
+// main, which prints one line, and handing main argument lists of growing
+// length. What it prints is dropped, so only the interpreter is timed.
+// workload_bench times the same script as a whole process.
+static const std::string HELLO = WORKLOAD_DIR "/hello.ints";
+
+static InterpretOptions quiet(Engine engine) {
+    InterpretOptions options;
+    options.engine = engine;
+    options.output = [](std::string_view) {};
+    return options;
+}
+
+static void BM_Hello(benchmark::State& state, Engine engine) {
+    InterpretOptions options = quiet(engine);
+    for (auto _ : state) {
+        Script script(HELLO, options);
+        script.callMain({});
+    }
+}
+
+// Arguments about as long as file names.
+static void BM_Arguments(benchmark::State& state, Engine engine) {
+    Script script(HELLO, quiet(engine));
+    std::vector<std::string> args;
+    for (int64_t i = 0; i < state.range(0); i++)
+        args.push_back("input/file" + std::to_string(i) + ".txt");
+    for (auto _ : state) {
+        script.reset();
+        script.callMain(args);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_CAPTURE(BM_Hello, walker, Engine::TREE_WALKER);
+BENCHMARK_CAPTURE(BM_Hello, vm, Engine::VM);
+BENCHMARK_CAPTURE(BM_Arguments, walker, Engine::TREE_WALKER)
+    ->RangeMultiplier(100)
+    ->Range(1, 100000);
+BENCHMARK_CAPTURE(BM_Arguments, vm, Engine::VM)
+    ->RangeMultiplier(100)
+    ->Range(1, 100000);
+
+BENCHMARK_MAIN();
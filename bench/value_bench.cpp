@@ -0,0 +1,172 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "lexer/tokenize.h"
+#include "parser/parse.h"
+#include "runtime/parallel.h"
+#include "runtime/value.h"
+
+static std::vector<int> elements(size_t size) {
+    std::vector<int> result(size);
+    for (size_t i = 0; i < size; i++)
+        result[i] = static_cast<int>((i * 2654435761u) % 1000) + 1;
+    return result;
+}
+
+// A fixed-size value, as arithmetic and builtins return.
+static Value fixed(size_t size) {
+    auto source = elements(size);
+    DynamicArray array(size);
+    std::copy(source.begin(), source.end(), array.data);
+    return Value(std::move(array), size);
+}
+
+// A `[+]` value, as growable variables hold.
+static Value growable(size_t size) {
+    auto source = elements(size);
+    return Value(DynamicArray::copyOf({source.data(), size}, true), 0);
+}
+
+static void BM_CopyFixed(benchmark::State& state) {
+    Value value = fixed(state.range(0));
+    for (auto _ : state) {
+        Value copy(value);
+        benchmark::DoNotOptimize(copy.getData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_CopyGrowable(benchmark::State& state) {
+    Value value = growable(state.range(0));
+    for (auto _ : state) {
+        Value copy(value);
+        benchmark::DoNotOptimize(copy.getData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_Add(benchmark::State& state) {
+    Value left = fixed(state.range(0));
+    Value right = growable(state.range(0));
+    for (auto _ : state) {
+        Value sum = left + right;
+        benchmark::DoNotOptimize(sum.getData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_Broadcast(benchmark::State& state) {
+    Value left = growable(state.range(0));
+    Value scalar = fixed(1);
+    for (auto _ : state) {
+        Value product = left * scalar;
+        benchmark::DoNotOptimize(product.getData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_Equal(benchmark::State& state) {
+    Value left = fixed(state.range(0));
+    Value right = growable(state.range(0));
+    for (auto _ : state) benchmark::DoNotOptimize(left == right);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Slices share their source unless they fit inline.
+static void BM_Slice(benchmark::State& state) {
+    auto source = std::make_shared<const Value>(growable(1 << 16));
+    size_t size = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        Value slice = Value::slice(source, 1, 1 + size);
+        benchmark::DoNotOptimize(slice.getData());
+    }
+}
+
+// `let x: [N] = ...` and `let x: [+] = ...` taking over a temporary.
+static void BM_Declare(benchmark::State& state, bool canGrow) {
+    size_t size = static_cast<size_t>(state.range(0));
+    std::string source =
+        canGrow ? std::string("[+]") : "[" + std::to_string(size) + "]";
+    TokenStream tokens{std::string_view(source)};
+    size_t position = 0;
+    ArrayDescriptor descriptor = ArrayDescriptor::parse(tokens, position);
+    Value value = fixed(size);
+    for (auto _ : state) {
+        Value declared = Value::fromDescriptor(descriptor, Value(value));
+        benchmark::DoNotOptimize(declared.getData());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+// `x = y` into an existing variable of the same size.
+static void BM_Assign(benchmark::State& state) {
+    Value target = fixed(state.range(0));
+    Value source = growable(state.range(0));
+    for (auto _ : state) {
+        target = source;
+        benchmark::DoNotOptimize(target.getData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Bytes moved making a large result and filling it across the pool: two
+// operands read and one result written. The pages of each result are new
+// unless a freed one is reused, so on hosts with several NUMA nodes this
+// shows whether they land near the workers that write them.
+static void BM_ResultBandwidth(benchmark::State& state) {
+    Value left = fixed(state.range(0));
+    Value right = fixed(state.range(0));
+    for (auto _ : state) {
+        Value sum = left + right;
+        benchmark::DoNotOptimize(sum.getData());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * 3 *
+                            sizeof(int));
+}
+
+// A zeroed buffer, as `let x: [N];` declares, against one a result
+// overwrites in full.
+static void BM_Buffer(benchmark::State& state, bool zeroed) {
+    size_t size = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        DynamicArray array =
+            zeroed ? DynamicArray(size) : DynamicArray::uninitialized(size);
+        int* data = array.data;
+        parallelFor(size, [data](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) data[i] = static_cast<int>(i);
+        });
+        benchmark::DoNotOptimize(array.data);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) *
+                            sizeof(int));
+}
+
+BENCHMARK(BM_CopyFixed)->Arg(4)->Arg(64)->Arg(1 << 16);
+BENCHMARK(BM_CopyGrowable)->Arg(4)->Arg(64)->Arg(1 << 16);
+BENCHMARK(BM_Add)->Arg(4)->Arg(64)->Arg(1 << 16);
+BENCHMARK(BM_Broadcast)->Arg(4)->Arg(64)->Arg(1 << 16);
+BENCHMARK(BM_Equal)->Arg(4)->Arg(64)->Arg(1 << 16);
+BENCHMARK(BM_Slice)->Arg(4)->Arg(1 << 12);
+BENCHMARK_CAPTURE(BM_Declare, fixed, false)->Arg(4)->Arg(1 << 16);
+BENCHMARK_CAPTURE(BM_Declare, growable, true)->Arg(4)->Arg(1 << 16);
+BENCHMARK(BM_Assign)->Arg(4)->Arg(64)->Arg(1 << 16);
+BENCHMARK(BM_ResultBandwidth)->Arg(1 << 20)->Arg(1 << 24)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Buffer, zeroed, true)
+    ->Arg(1 << 20)
+    ->Arg(1 << 24)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_Buffer, uninitialized, false)
+    ->Arg(1 << 20)
+    ->Arg(1 << 24)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
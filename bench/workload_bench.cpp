@@ -0,0 +1,57 @@
+// Copyright 2025 Caden Crowson
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Times every .ints workload in WORKLOAD_DIR end to end on both engines by
+// running the interpreter on it, INTS_BINARY unless another binary is given
+// as the first argument, so two builds can be compared on the same files.
+// Every workload gets the same command line, which args.ints parses.
+static const char* WORKLOAD_ARGS = " alpha 12345 beta 678";
+
+#ifdef _WIN32
+static const char* DISCARD_OUTPUT = " > NUL";
+#else
+static const char* DISCARD_OUTPUT = " > /dev/null";
+#endif
+
+static void runWorkload(benchmark::State& state, const std::string& command) {
+    for (auto _ : state) {
+        int status = std::system(command.c_str());
+        if (status != 0) {
+            state.SkipWithError(("exited with status " +
+                                 std::to_string(status)).c_str());
+            break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    std::string binary = argc > 1 ? argv[1] : INTS_BINARY;
+    std::vector<std::filesystem::path> workloads;
+    for (auto& entry : std::filesystem::directory_iterator(WORKLOAD_DIR))
+        if (entry.path().extension() == ".ints")
+            workloads.push_back(entry.path());
+    std::sort(workloads.begin(), workloads.end());
+    for (auto& workload : workloads) {
+        for (std::string engine : {"walker", "vm"}) {
+            std::string name = workload.stem().string() + "/" + engine;
+            std::string command = "\"" + binary + "\" --engine=" + engine +
+                                  " \"" + workload.string() + "\"" +
+                                  WORKLOAD_ARGS + DISCARD_OUTPUT;
+            benchmark::RegisterBenchmark(name.c_str(), runWorkload, command)
+                ->Unit(benchmark::kMillisecond)
+                ->UseRealTime()
+                ->Iterations(3);
+        }
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "parser/parse.h"
+#include "runtime/builtins.h"
+#include "runtime/value.h"
+
+// Every instruction names up to three operands. Registers are indices into
+// the frame of the executing function; the meaning of each operand is listed
+// next to its opcode.
+enum class OpCode : uint8_t {
+    LOAD_CONST,     // a = constants[b]
+    LOAD_GLOBAL,    // a = global names[b]
+    STORE_GLOBAL,   // global names[b] = a
+    MOVE,           // a = b
+    DECLARE,        // a = descriptors[b] initialized from c (or NO_REGISTER)
+    DECLARE_IF,     // flag = c fits descriptors[b]; if so a = c
+    ADD,            // a = b + c
+    SUB,            // a = b - c
+    MUL,            // a = b * c
+    DIV,            // a = b / c
+    MOD,            // a = b % c
+    AND,            // a = b & c
+    OR,             // a = b | c
+    XOR,            // a = b ^ c
+    SHL,            // a = b << c
+    SHR,            // a = b >> c
+    SLICE,          // a = b[slices[c]]
+    CALL,           // a = functions[b](registerLists[c])
+    TAIL_CALL,      // return functions[b](registerLists[c]) in this frame
+    CALL_METHOD,    // a = registerLists[c][0].method b(registerLists[c][1:])
+    SPAWN,          // a = task running functions[b](registerLists[c])
+    JUMP,           // pc = a
+    JUMP_IF_FALSE,  // if !flag: pc = a
+    FOR_INIT,       // a = [0]
+    FOR_NEXT,       // flag = c < b.size; if so a = [b[c]], c += 1
+                    // a two-element c instead counts: flag = c[0] < c[1];
+                    // if so a = [c[0]], c[0] += 1
+    // flag = functions[b] is the builtin range; if so a = [its size for
+    // registerLists[c]], and otherwise a = functions[b](registerLists[c])
+    FOR_RANGE,
+    FOR_COUNT,      // a = [start, end] of b's range([b])[slices[c]], or of
+                    // the whole range when c is NO_REGISTER
+    // Registers holding expressions hoisted out of a loop (parser/hoist.h)
+    // are forgotten as it starts and filled the first time it reaches them.
+    FORGET,          // a is not filled
+    JUMP_IF_FILLED,  // if b is filled: pc = a
+    FILL,            // a = b, and a is filled
+    // if !(b op c): pc = a. Single elements compare as plain ints.
+    JUMP_UNLESS_EQ,
+    JUMP_UNLESS_NE,
+    JUMP_UNLESS_LT,
+    JUMP_UNLESS_LE,
+    JUMP_UNLESS_GT,
+    JUMP_UNLESS_GE,
+    RETURN,         // return a
+    RETURN_EMPTY,   // return []
+};
+
+constexpr uint32_t NO_REGISTER = std::numeric_limits<uint32_t>::max();
+
+struct Instruction {
+    OpCode op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+struct SliceBound {
+    enum Kind : uint8_t { NONE, CONSTANT, REGISTER };
+    Kind kind;
+    size_t value;
+};
+
+struct Slice {
+    SliceBound start;
+    SliceBound end;
+};
+
+struct Chunk {
+    std::string name;
+    std::vector<ArrayDescriptor> params;
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<ArrayDescriptor> descriptors;
+    std::vector<std::string> names;
+    std::vector<Slice> slices;
+    // Operand lists for calls, stored as [count, register...].
+    std::vector<uint32_t> registerLists;
+    uint32_t numRegisters = 0;
+    // The cache of a memo fn, which calls to it look in first.
+    MemoCache* memo = nullptr;
+};
+
+struct FunctionSlot {
+    std::string name;
+    std::optional<size_t> chunk;
+    std::optional<BuiltinFunction> builtin;
+};
+
+class Program {
+ public:
+    uint32_t functionSlot(const std::string& name);
+    void define(Chunk chunk);
+    void link();
+    const Chunk& getChunk(size_t index) const;
+    const FunctionSlot& getFunction(uint32_t slot) const;
+    std::optional<uint32_t> findFunction(const std::string& name) const;
+
+ private:
+    std::vector<Chunk> chunks;
+    std::vector<FunctionSlot> functions;
+    std::unordered_map<std::string, uint32_t> functionIndices;
+};
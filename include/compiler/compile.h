@@ -0,0 +1,11 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <memory>
+
+#include "compiler/bytecode.h"
+#include "parser/parse.h"
+
+void compileFunction(const std::shared_ptr<FunctionDefinitionNode>& function,
+                     Program& program);
@@ -0,0 +1,13 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+// Translates a script, together with every file it uses, into one C++
+// translation unit that runs it on the runtime's values and builtins
+// through compiler/native.h, with the script's main called the way
+// `interpret` calls it. Throws for the few programs it can't translate,
+// such as ones that use <graphics>.
+void emitCpp(const std::string& filename, std::ostream& out);
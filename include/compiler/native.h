@@ -0,0 +1,146 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parser/parse.h"
+#include "runtime/builtins.h"
+#include "runtime/memo.h"
+#include "runtime/parallel.h"
+#include "runtime/value.h"
+
+// Runtime support for the C++ that --emit-cpp generates (compiler/emit.h).
+// Each helper does what the tree walker does at the same point in a
+// script, down to its error messages, so a compiled script behaves like
+// the interpreted one.
+
+Value nativeLiteral(std::initializer_list<int> elements);
+// What a for loop binds its element variable to.
+Value nativeElement(int element);
+// What a function returns when it ends without a return.
+Value nativeNothing();
+// Returns nothing; declared to return a Value so that it can stand in for
+// an expression.
+[[noreturn]] Value nativeError(const std::string& message);
+
+// Globals are empty until their declaration runs.
+const Value& nativeGlobal(const std::optional<Value>& global,
+                          const char* name);
+void nativeCheckDefined(const std::optional<Value>& global, const char* name);
+
+// Slice bounds: `bound` is an expression's value, which must be one
+// non-negative element.
+size_t nativeBound(const Value& bound);
+Value nativeSlice(const Value& source, size_t start, size_t end);
+void nativeSliceInPlace(Value& value, size_t start, size_t end);
+
+// Loops over a call to range count through it: the size range would give,
+// and the check a slice of it makes.
+template <typename... Arguments>
+size_t nativeRangeSize(Arguments&&... arguments) {
+    std::vector<Value> values;
+    values.reserve(sizeof...(arguments));
+    (values.push_back(std::forward<Arguments>(arguments)), ...);
+    return rangeSize(values);
+}
+void nativeCheckSlice(size_t start, size_t end, size_t size);
+
+// Whether an `if` declaration's value fits its descriptor.
+bool nativeFits(std::optional<size_t> size, bool canGrow, const Value& value);
+
+// Fail when the name isn't a builtin, which the walker only reports once
+// the call is made.
+BuiltinFunction nativeBuiltinFunction(const char* name);
+BuiltinMethod nativeBuiltinMethod(const char* name);
+
+template <typename... Arguments>
+Value nativeCall(BuiltinFunction function, Arguments&&... arguments) {
+    std::vector<Value> values;
+    values.reserve(sizeof...(arguments));
+    (values.push_back(std::forward<Arguments>(arguments)), ...);
+    return callBuiltinFunction(function, values);
+}
+
+template <typename... Arguments>
+Value nativeMethod(BuiltinMethod method, const Value& value,
+                   Arguments&&... arguments) {
+    std::vector<Value> values;
+    values.reserve(sizeof...(arguments));
+    (values.push_back(std::forward<Arguments>(arguments)), ...);
+    return callBuiltinMethod(method, value, values);
+}
+
+template <typename... Arguments>
+void nativeMethodInPlace(BuiltinMethod method, Value& value,
+                         Arguments&&... arguments) {
+    std::vector<Value> values;
+    values.reserve(sizeof...(arguments));
+    (values.push_back(std::forward<Arguments>(arguments)), ...);
+    callBuiltinMethodInPlace(method, value, values);
+}
+
+// pfor reductions: every task starts its copy of a reduced variable from
+// the identity, and the copies are merged back in iteration order.
+size_t nativeParallelTasks(size_t iterations);
+Value nativeReductionIdentity(ReductionNode::Type type, const Value& value);
+void nativeMergeReduction(ReductionNode::Type type, Value& target,
+                          Value partial);
+
+// Tail calls from one function to another, which the walker runs without
+// growing the stack: the callee is left here for the nearest enclosing call
+// to run once the caller has returned.
+using NativeFunction = Value (*)(std::vector<Value>& arguments);
+struct NativeTailCall {
+    NativeFunction function = nullptr;
+    std::vector<Value> arguments;
+};
+extern thread_local NativeTailCall nativeTailCall;
+
+template <typename... Arguments>
+Value nativeTail(NativeFunction function, Arguments&&... arguments) {
+    nativeTailCall.function = function;
+    nativeTailCall.arguments.clear();
+    (nativeTailCall.arguments.push_back(std::forward<Arguments>(arguments)),
+     ...);
+    return nativeNothing();
+}
+
+// Runs the tail calls left by the call that returned `result`.
+Value nativeFinish(Value result);
+
+// spawn(f, ...): `function` runs f with the arguments as a task.
+template <typename... Arguments>
+Value nativeSpawn(NativeFunction function, Arguments&&... arguments) {
+    std::vector<Value> values;
+    values.reserve(sizeof...(arguments));
+    (values.push_back(std::forward<Arguments>(arguments)), ...);
+    return spawnTask([function, values = std::move(values)]() mutable {
+        return function(values);
+    });
+}
+// Globals can't be assigned to while spawned tasks are running.
+void nativeCheckAssign(const char* name);
+
+// A call to a memo fn, whose body is `function`, through its cache.
+template <typename... Arguments>
+Value nativeMemo(MemoCache& cache, Value (*function)(Arguments...),
+                 Arguments... arguments) {
+    MemoKey key;
+    (key.add(arguments), ...);
+    if (auto cached = cache.find(key)) return std::move(cached.value());
+    Value result = nativeFinish(function(std::move(arguments)...));
+    cache.store(std::move(key), result);
+    return result;
+}
+
+// The generated program's entry point: runs the script's top level, then
+// calls its main, if it has one, with argc and args as `interpret` passes
+// them. Errors are reported the way the interpreter reports them.
+int nativeMain(int argc, char* argv[], void (*initialize)(),
+               Value (*main)(Value, Value));
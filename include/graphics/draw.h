@@ -0,0 +1,35 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One drawing operation, passed from the interpreter to the GUI thread.
+// Positions and sizes are in window pixels; colors are packed as ImGui
+// expects them.
+struct DrawCommand {
+    enum class Type {
+        RECT,
+        TEXT,
+        PIXELS,
+        // Shows everything drawn since the last PRESENT as the new frame.
+        PRESENT
+    };
+    Type type = Type::PRESENT;
+    float x = 0;
+    float y = 0;
+    float width = 0;
+    float height = 0;
+    uint32_t color = 0;
+    std::string text;
+    // PIXELS: `pixels` holds rows of `columns` colors, stretched over the
+    // command's rectangle.
+    size_t columns = 0;
+    std::vector<uint32_t> pixels;
+};
+
+// Registers rect, text, pixels, framebuffer and present, the builtins
+// scripts draw into the `use <graphics>` window with.
+void registerDrawingBuiltins();
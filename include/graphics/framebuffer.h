@@ -0,0 +1,65 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+struct ImDrawList;
+
+// Whole frames computed by a script, shown stretched over the window behind
+// everything else it draws.
+struct Frame {
+    size_t width = 0;
+    size_t height = 0;
+    // RGBA, one byte per channel, row by row from the top.
+    std::vector<unsigned char> pixels;
+};
+
+// Hands frames from one producer thread to one consumer thread without
+// either waiting: the producer always has a buffer to fill, and the
+// consumer only ever sees the newest finished frame, so frames the GUI
+// never got around to are skipped rather than queued.
+class FrameMailbox {
+ public:
+    // Producer only. Swaps `frame` with a free buffer, so the caller gets
+    // an old allocation back to fill next time.
+    void publish(Frame& frame);
+    // Consumer only. The newest frame published since the last call, or
+    // null when there is none.
+    Frame* take();
+
+ private:
+    static constexpr unsigned FRESH = 4;
+    Frame frames[3];
+    std::atomic<unsigned> latest{0};
+    unsigned back = 1;
+    unsigned front = 2;
+};
+
+// The texture frames are shown from, owned by the GUI thread and used only
+// while its GL context is current. Frames are copied into one of two pixel
+// buffer objects, and the texture is updated from it on the following
+// frame while the next copy goes into the other one, so the transfer to
+// the GPU runs in the background rather than stalling a frame.
+class FrameTexture {
+ public:
+    // False when the GL context lacks what the upload needs.
+    bool create();
+    void destroy();
+    void update(FrameMailbox& mailbox);
+    // Draws the latest uploaded frame over [0, 0] to [width, height].
+    void draw(ImDrawList& list, float width, float height) const;
+
+ private:
+    unsigned texture = 0;
+    unsigned buffers[2] = {0, 0};
+    size_t bufferWidth[2] = {0, 0};
+    size_t bufferHeight[2] = {0, 0};
+    // The buffer holding a frame the texture hasn't taken yet, if any.
+    int pending = -1;
+    int filled = 0;
+    size_t textureWidth = 0;
+    size_t textureHeight = 0;
+};
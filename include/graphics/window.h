@@ -0,0 +1,27 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include "graphics/draw.h"
+#include "graphics/framebuffer.h"
+
+// The window `use <graphics>` opens, drawn with GLFW, OpenGL and ImGui. Only
+// part of builds configured with INTS_GRAPHICS; headless builds leave it
+// out along with every GUI dependency.
+
+// Opens a width x height window on a thread of its own and returns as soon
+// as it is on screen. Throws if it can't be opened.
+void openWindow(int width, int height);
+// True from the moment the window is shown until it is closed.
+bool isWindowOpen();
+// Presents anything drawn since the last present, then returns once the
+// window, if one was opened, has been closed.
+void waitForWindow();
+// Hands a command to the GUI thread without ever waiting for it, from the
+// thread that opened the window. Commands that find the queue full are kept
+// in order and sent with the next ones; once the window is closed they are
+// dropped. Moves from `command`.
+void submitDrawCommand(DrawCommand& command);
+// Replaces the frame shown behind the drawing, from the same thread and
+// without waiting either. Swaps `frame` with a buffer to reuse.
+void submitFrame(Frame& frame);
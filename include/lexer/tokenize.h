@@ -2,22 +2,112 @@
 
 #pragma once
 
+#include <cstdint>
+#include <istream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class TokenType { IDENTIFIER, INT_LIT, STRING_LIT, SYMBOL };
+// One per character of the symbol set; NONE for tokens that are not symbols.
+enum class Symbol : uint8_t {
+    NONE,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
+    MINUS,
+    GREATER,
+    LESS,
+    LEFT_BRACE,
+    RIGHT_BRACE,
+    COLON,
+    PLUS,
+    BANG,
+    EQUALS,
+    STAR,
+    SLASH,
+    PERCENT,
+    SEMICOLON,
+    LEFT_PARENTHESIS,
+    RIGHT_PARENTHESIS,
+    DOT,
+    COMMA,
+    AMPERSAND,
+    PIPE,
+    CARET
+};
+
 class Token {
  public:
-    Token(TokenType type, std::string value);
-    operator std::string();
+    Token(TokenType type, std::string_view value);
+    operator std::string() const;
     bool operator==(const Token& other) const;
     const TokenType& getType() const;
-    const std::string& getValue() const;
+    // A view of the source the token came from, or of interned storage for
+    // string literals with escapes. Tokens from a TokenStream are only valid
+    // until they are released.
+    std::string_view getValue() const;
+    Symbol getSymbol() const;
 
  private:
     TokenType type;
-    std::string value;
+    Symbol symbol;
+    std::string_view value;
+};
+
+// Lexes tokens as the parser asks for them. Positions count from the first
+// token like vector indices, but only tokens from the last release() on are
+// kept, and an input stream is read a chunk at a time as tokens are needed,
+// so neither the whole source nor all of its tokens are ever resident.
+class TokenStream {
+ public:
+    explicit TokenStream(std::istream& input);
+    // Streams over source already in memory, which must outlive the stream.
+    explicit TokenStream(std::string_view code);
+    // True when there is a token at position i.
+    bool has(size_t i);
+    // Throws past the last token and for positions already released. The
+    // reference is only valid until the stream next lexes.
+    const Token& operator[](size_t i);
+    // Drops every token before position i.
+    void release(size_t i);
+    // Source line the token at position i starts on, counting from 1.
+    size_t lineOf(size_t i);
+
+ private:
+    friend std::vector<Token> tokenize(const std::string& code);
+
+    struct Entry {
+        Token token;
+        // Absolute offset of the token in the source.
+        size_t offset;
+        size_t line;
+        bool interned;
+    };
+
+    Entry& entry(size_t i);
+    template <typename Emit>
+    bool lex(Emit emit);
+    [[noreturn]] void unexpectedCharacter(size_t start) const;
+    [[noreturn]] void unterminatedString(size_t start) const;
+    bool fill();
+
+    std::istream* input = nullptr;
+    bool exhausted = false;
+    std::string buffer;
+    // The resident part of the source, starting at absolute offset `base`.
+    std::string_view source;
+    size_t base = 0;
+    // Absolute offset of the next character to lex.
+    size_t position = 0;
+    size_t line = 1;
+    size_t lineStart = 0;
+    // Entries before `head` have been released but not yet dropped.
+    std::vector<Entry> window;
+    size_t head = 0;
+    // Position of the token at `head`.
+    size_t first = 0;
 };
 
 std::vector<Token> tokenize(const std::string& code);
 std::string tokenTypeToString(const TokenType& type);
+Symbol symbolFromChar(char c);
@@ -0,0 +1,13 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include "parser/parse.h"
+
+// Replaces the parts of an expression that evaluate to the same array every
+// time, such as arithmetic on literals, slices of them with constant bounds
+// and their .size(), with that array, and gives each literal left in it the
+// shared value it evaluates to. Expects the expressions inside it to have
+// been folded already. Anything that would fail is left for the run to
+// report when it gets there.
+void foldExpression(ExpressionNode& expression);
@@ -0,0 +1,17 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include "parser/parse.h"
+
+// Finds the expressions in while and for loops that give the same array on
+// every pass: those that read only literals and locals the loop never
+// writes, and call nothing but pure builtin methods. Each one gets a frame
+// slot past the function's variables, recorded on the outermost loop it
+// doesn't change in. Engines empty the slots whenever that loop starts,
+// evaluate the expression the first time the loop reaches it, as they
+// always would have, and read the slot from then on, so errors are still
+// reported where they happen. pfor bodies run in parallel and are left
+// alone, apart from loops nested inside them. Expects the function to have
+// been resolved and its shapes inferred.
+void hoistInvariants(FunctionDefinitionNode& function);
@@ -0,0 +1,46 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "parser/parse.h"
+#include "runtime/parallel.h"
+
+// Loads the files of one program ahead of whoever runs its top level. When
+// the shared pool has threads to spare, each file loaded starts loading
+// every file it uses by a literal path on the pool, and those the files
+// they use, so they are parsed and resolved (parser/resolve.h) by the time
+// their `use` is reached, or are being. Only the loading runs out of order:
+// errors in a file are thrown when it is taken, and a file changed since
+// its background load, by the top level that runs before its `use`, is
+// loaded again.
+class ModuleLoader {
+ public:
+    // Used files are read through the module cache when `cached`.
+    explicit ModuleLoader(bool cached);
+    // Waits for the loads still running.
+    ~ModuleLoader();
+    ModuleLoader(const ModuleLoader&) = delete;
+    ModuleLoader& operator=(const ModuleLoader&) = delete;
+
+    // The file the program starts with, which is never cached.
+    RootNode loadMain(const std::string& filename);
+    // A file `use`d by path.
+    RootNode loadUsed(const std::string& filename);
+
+ private:
+    struct Pending;
+
+    RootNode load(const std::string& filename, bool cachedHere);
+    void prefetchUses(const RootNode& root);
+
+    bool cached;
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Pending>> pending;
+    std::vector<ThreadPool::Job> jobs;
+};
@@ -0,0 +1,15 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <string>
+
+#include "parser/parse.h"
+
+// Parses a source file. With `cached`, the tree is first looked up in an
+// on-disk cache of serialized modules keyed by the file's absolute path,
+// size and modification time, and stored there after a miss, so an
+// unchanged file is read back without being lexed or parsed. Caching is
+// best effort: an unusable cache falls back to parsing. The cache lives in
+// $INTS_CACHE_DIR, else $XDG_CACHE_HOME/ints, else $HOME/.cache/ints.
+RootNode loadModule(const std::string& filename, bool cached);
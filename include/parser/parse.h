@@ -2,19 +2,38 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 #include "lexer/tokenize.h"
+#include "runtime/builtin_ids.h"
 
 class ExpressionNode;
+class FunctionDefinitionNode;
+// Compiled form of a hot function (runtime/scalar.h).
+struct ScalarFunction;
+// Results a `memo fn` has returned (runtime/memo.h).
+class MemoCache;
+class Value;
+// Rebuilds nodes from the module cache (parser/module.h).
+class ModuleReader;
+
+// Location of a function-local variable in its function's frame. Variables
+// declared in nested blocks get their own slots in the same frame.
+struct VariableSlot {
+    size_t index;
+};
 
 class ArrayRangeNode {
  public:
-    static ArrayRangeNode parse(std::vector<Token> &tokens, size_t &i);
+    static ArrayRangeNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>> &
     getStart() const;
@@ -22,6 +41,7 @@ class ArrayRangeNode {
     getEnd() const;
 
  private:
+    friend class ModuleReader;
     ArrayRangeNode(
         std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>
             start,
@@ -39,11 +59,21 @@ class ArithmeticNode {
         TYPE_SUBTRACTION,
         TYPE_MULTIPLICATION,
         TYPE_DIVISION,
+        TYPE_MODULO,
+        TYPE_AND,
+        TYPE_OR,
+        TYPE_XOR,
+        TYPE_SHIFT_LEFT,
+        TYPE_SHIFT_RIGHT,
     };
+    // Loosest first, in C's order.
     enum Precedence {
-        LEFT_PARENTHESIS = 0,
-        ADD_SUB = 1,
-        MULT_DIV = 2,
+        BIT_OR = 1,
+        BIT_XOR = 2,
+        BIT_AND = 3,
+        SHIFT = 4,
+        ADD_SUB = 5,
+        MULT_DIV = 6,
     };
     ArithmeticNode(std::shared_ptr<ExpressionNode> left,
                    std::shared_ptr<ExpressionNode> right, Type type);
@@ -51,6 +81,8 @@ class ArithmeticNode {
     std::shared_ptr<ExpressionNode> left;
     std::shared_ptr<ExpressionNode> right;
     Type type;
+    // Set by inferShapes() when both operands are always single elements.
+    bool scalar = false;
 
  private:
 };
@@ -59,28 +91,49 @@ class MethodNode {
  public:
     MethodNode(std::string identifier,
                std::vector<std::shared_ptr<ExpressionNode>> parameters);
-    static MethodNode parse(std::vector<Token> &tokens, size_t &i);
+    static MethodNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::string &getIdentifier() const;
     const std::vector<std::shared_ptr<ExpressionNode>> &getParameters() const;
+    const std::optional<BuiltinMethod> &getBuiltin() const;
+    void setBuiltin(BuiltinMethod builtin);
 
  private:
     std::string identifier;
     std::vector<std::shared_ptr<ExpressionNode>> parameters;
+    std::optional<BuiltinMethod> builtin;
+};
+
+// The user function a call site last resolved to, trusted while the
+// interpreter's function bindings are still at `version`. A null function
+// means the name was not bound and the call goes to a builtin. Version 0 is
+// never current, and copies start out empty.
+struct CallSiteCache {
+    CallSiteCache() = default;
+    CallSiteCache(const CallSiteCache &) {}
+    CallSiteCache &operator=(const CallSiteCache &) { return *this; }
+
+    std::atomic<uint64_t> version{0};
+    std::atomic<const FunctionDefinitionNode *> function{nullptr};
 };
 
 class FunctionCallNode {
  public:
     FunctionCallNode(std::string identifier,
                      std::vector<std::shared_ptr<ExpressionNode>> parameters);
-    static FunctionCallNode parse(std::vector<Token> &tokens, size_t &i);
+    static FunctionCallNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::string &getIdentifier() const;
     const std::vector<std::shared_ptr<ExpressionNode>> &getParameters() const;
+    const std::optional<BuiltinFunction> &getBuiltin() const;
+    void setBuiltin(BuiltinFunction builtin);
+    CallSiteCache &getCache() const;
 
  private:
     std::string identifier;
     std::vector<std::shared_ptr<ExpressionNode>> parameters;
+    std::optional<BuiltinFunction> builtin;
+    mutable CallSiteCache cache;
 };
 
 class ArrayNode {
@@ -88,17 +141,25 @@ class ArrayNode {
     explicit ArrayNode(std::variant<std::vector<int>, std::string,
                                     std::shared_ptr<FunctionCallNode>>
                            value);
-    static ArrayNode parse(std::vector<Token> &tokens, size_t &i);
-    static std::vector<int> stringToInts(const std::string &string);
+    static ArrayNode parse(TokenStream &tokens, size_t &i);
+    static std::vector<int> stringToInts(std::string_view string);
     operator std::string() const;
     const std::variant<std::vector<int>, std::string,
                        std::shared_ptr<FunctionCallNode>> &
     getValue() const;
+    const std::optional<VariableSlot> &getSlot() const;
+    void setSlot(VariableSlot slot);
+    // A literal's value, made once by resolveVariables() and shared by
+    // every evaluation of it.
+    const std::shared_ptr<const Value> &getLiteral() const;
+    void setLiteral(std::shared_ptr<const Value> literal);
 
  private:
     std::variant<std::vector<int>, std::string,
                  std::shared_ptr<FunctionCallNode>>
         value;
+    std::optional<VariableSlot> slot;
+    std::shared_ptr<const Value> literal;
 };
 
 class ArrayPostFixNode {
@@ -107,13 +168,14 @@ class ArrayPostFixNode {
         std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
                                  std::shared_ptr<MethodNode>>>
             values);
-    static ArrayPostFixNode parse(std::vector<Token> &tokens, size_t &i);
+    static ArrayPostFixNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
                                    std::shared_ptr<MethodNode>>> &
     getValues() const;
 
  private:
+    friend class ExpressionNode;
     std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
                              std::shared_ptr<MethodNode>>>
         values;
@@ -126,27 +188,36 @@ class ExpressionNode {
                        primary,
                    ArrayPostFixNode postfix);
     explicit ExpressionNode(std::vector<int> values);
-    static ExpressionNode parse(std::vector<Token> &tokens, size_t &i);
+    static ExpressionNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::variant<std::shared_ptr<ArithmeticNode>,
                        std::shared_ptr<ArrayNode>> &
     getPrimary() const;
     const ArrayPostFixNode &getPostfix() const;
+    // Replaces the primary and the first `steps` of the postfix chain with
+    // the literal they always evaluate to.
+    void fold(std::vector<int> values, size_t steps);
+    // The frame slot its value is kept in while the loop it doesn't change
+    // in is running (parser/hoist.h).
+    const std::optional<VariableSlot> &getHoistedSlot() const;
+    void setHoistedSlot(VariableSlot slot);
 
  private:
     std::variant<std::shared_ptr<ArithmeticNode>, std::shared_ptr<ArrayNode>>
         primary;
     ArrayPostFixNode postfix;
+    std::optional<VariableSlot> hoistedSlot;
 };
 
 class ArrayDescriptor {
  public:
-    static ArrayDescriptor parse(std::vector<Token> &tokens, size_t &i);
+    static ArrayDescriptor parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::optional<size_t> &getSize() const;
     const bool &getCanGrow() const;
 
  private:
+    friend class ModuleReader;
     ArrayDescriptor(std::optional<size_t> size, bool canGrow);
     std::optional<size_t> size;
     bool canGrow;
@@ -154,33 +225,41 @@ class ArrayDescriptor {
 
 class VariableAssignmentNode {
  public:
-    static VariableAssignmentNode parse(std::vector<Token> &tokens, size_t &i);
+    static VariableAssignmentNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::string &getLeft() const;
     const std::shared_ptr<ExpressionNode> &getRight() const;
+    const std::optional<VariableSlot> &getSlot() const;
+    void setSlot(VariableSlot slot);
 
  private:
+    friend class ModuleReader;
     VariableAssignmentNode(std::string left,
                            std::shared_ptr<ExpressionNode> right);
     std::string left;
     std::shared_ptr<ExpressionNode> right;
+    std::optional<VariableSlot> slot;
 };
 
 class VariableDeclarationNode {
  public:
-    static VariableDeclarationNode parse(std::vector<Token> &tokens, size_t &i);
+    static VariableDeclarationNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::string &getIdentifier() const;
     const ArrayDescriptor &getDescriptor() const;
     const std::optional<std::shared_ptr<ExpressionNode>> &getValue() const;
+    const std::optional<VariableSlot> &getSlot() const;
+    void setSlot(VariableSlot slot);
 
  private:
+    friend class ModuleReader;
     VariableDeclarationNode(
         std::string identifier, ArrayDescriptor descriptor,
         std::optional<std::shared_ptr<ExpressionNode>> value);
     std::string identifier;
     ArrayDescriptor descriptor;
     std::optional<std::shared_ptr<ExpressionNode>> value;
+    std::optional<VariableSlot> slot;
 };
 
 class VariableBindingNode {
@@ -189,7 +268,7 @@ class VariableBindingNode {
         std::variant<std::shared_ptr<VariableDeclarationNode>,
                      std::shared_ptr<VariableAssignmentNode>>
             value);
-    static VariableBindingNode parse(std::vector<Token> &tokens, size_t &i);
+    static VariableBindingNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::variant<std::shared_ptr<VariableDeclarationNode>,
                        std::shared_ptr<VariableAssignmentNode>> &
@@ -205,11 +284,15 @@ class StatementNode;
 
 class ReturnNode {
  public:
-    static ReturnNode parse(std::vector<Token> &tokens, size_t &i);
+    static ReturnNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::shared_ptr<ExpressionNode> &getValue() const;
+    // The call when the whole returned expression is one, which can then
+    // reuse the returning function's frame.
+    const FunctionCallNode* getTailCall() const;
 
  private:
+    friend class ModuleReader;
     explicit ReturnNode(std::shared_ptr<ExpressionNode> value);
     std::shared_ptr<ExpressionNode> value;
 };
@@ -217,7 +300,7 @@ class ReturnNode {
 class BodyNode {
  public:
     explicit BodyNode(std::vector<std::shared_ptr<StatementNode>> statements);
-    static std::shared_ptr<BodyNode> parse(std::vector<Token> &tokens,
+    static std::shared_ptr<BodyNode> parse(TokenStream &tokens,
                                            size_t &i);
     std::string toStringIndented(size_t indent) const;
     const std::vector<std::shared_ptr<StatementNode>> &getStatements() const;
@@ -229,13 +312,16 @@ class BodyNode {
 class IfCompareNode {
  public:
     enum Type { EQ, NE, LT, LE, GT, GE };
-    static IfCompareNode parse(std::vector<Token> &tokens, size_t &i);
+    static IfCompareNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const Type &getType() const;
     const std::shared_ptr<ExpressionNode> &getLeft() const;
     const std::shared_ptr<ExpressionNode> &getRight() const;
+    // Set by inferShapes() when both sides are always single elements.
+    bool scalar = false;
 
  private:
+    friend class ModuleReader;
     IfCompareNode(Type type, std::shared_ptr<ExpressionNode> left,
                   std::shared_ptr<ExpressionNode> right);
     Type type;
@@ -245,12 +331,13 @@ class IfCompareNode {
 
 class IfDeclarationNode {
  public:
-    static IfDeclarationNode parse(std::vector<Token> &tokens, size_t &i);
+    static IfDeclarationNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::shared_ptr<VariableDeclarationNode> &getVariableDeclaration()
         const;
 
  private:
+    friend class ModuleReader;
     explicit IfDeclarationNode(
         std::shared_ptr<VariableDeclarationNode> variableDeclaration);
     std::shared_ptr<VariableDeclarationNode> variableDeclaration;
@@ -264,7 +351,7 @@ class IfNode {
            std::shared_ptr<BodyNode> body,
            std::optional<std::shared_ptr<IfNode>> elseIfBranches,
            std::optional<std::shared_ptr<BodyNode>> elseBody);
-    static IfNode parse(std::vector<Token> &tokens, size_t &i);
+    static IfNode parse(TokenStream &tokens, size_t &i);
     std::string toStringIndented(size_t indent) const;
     const std::variant<std::shared_ptr<IfCompareNode>,
                        std::shared_ptr<IfDeclarationNode>> &
@@ -288,34 +375,80 @@ class WhileNode {
                            std::shared_ptr<IfDeclarationNode>>
                   condition,
               std::shared_ptr<BodyNode> body);
-    static WhileNode parse(std::vector<Token> &tokens, size_t &i);
+    static WhileNode parse(TokenStream &tokens, size_t &i);
     std::string toStringIndented(size_t indent) const;
     const std::variant<std::shared_ptr<IfCompareNode>,
                        std::shared_ptr<IfDeclarationNode>> &
     getCondition() const;
     const std::shared_ptr<BodyNode> &getBody() const;
+    // Slots of the expressions hoisted out of the loop, emptied each time it
+    // starts.
+    const std::vector<size_t> &getHoistedSlots() const;
+    void setHoistedSlots(std::vector<size_t> slots);
 
  private:
     std::variant<std::shared_ptr<IfCompareNode>,
                  std::shared_ptr<IfDeclarationNode>>
         condition;
     std::shared_ptr<BodyNode> body;
+    std::vector<size_t> hoistedSlots;
+};
+
+// One `reduce <variable> <op>` clause of a pfor. Every task accumulates into
+// a private copy of the variable starting from the operation's identity, and
+// the copies are merged back into the variable in iteration order.
+class ReductionNode {
+ public:
+    enum Type { TYPE_ADD, TYPE_MULTIPLY, TYPE_APPEND };
+    static ReductionNode parse(TokenStream &tokens, size_t &i);
+    operator std::string() const;
+    const std::string &getVariable() const;
+    Type getType() const;
+    size_t getSlot() const;
+    void setSlot(size_t slot);
+
+ private:
+    friend class ModuleReader;
+    ReductionNode(std::string variable, Type type);
+    std::string variable;
+    Type type;
+    size_t slot = 0;
 };
 
 class ForLoopNode {
  public:
-    static ForLoopNode parse(std::vector<Token> &tokens, size_t &i);
+    static ForLoopNode parse(TokenStream &tokens, size_t &i);
     std::string toStringIndented(size_t indent) const;
     const std::string &getElement() const;
     const std::shared_ptr<ExpressionNode> &getIterable() const;
     const std::shared_ptr<BodyNode> &getBody() const;
+    size_t getElementSlot() const;
+    void setElementSlot(size_t elementSlot);
+    // `pfor` loops run their iterations across the thread pool.
+    bool isParallel() const;
+    const std::vector<std::shared_ptr<ReductionNode>> &getReductions() const;
+    // The call when the iterable is one to the builtin range, possibly
+    // followed by a single slice, in which case engines can count through
+    // the elements instead of building them. A user function named range
+    // still shadows it, which only the engines can tell.
+    const FunctionCallNode *getRangeCall() const;
+    const ArrayRangeNode *getRangeSlice() const;
+    // As for WhileNode.
+    const std::vector<size_t> &getHoistedSlots() const;
+    void setHoistedSlots(std::vector<size_t> slots);
 
  private:
+    friend class ModuleReader;
     ForLoopNode(std::string element, std::shared_ptr<ExpressionNode> iterable,
-                std::shared_ptr<BodyNode> body);
+                std::shared_ptr<BodyNode> body, bool parallel,
+                std::vector<std::shared_ptr<ReductionNode>> reductions);
     std::string element;
     std::shared_ptr<ExpressionNode> iterable;
     std::shared_ptr<BodyNode> body;
+    size_t elementSlot = 0;
+    bool parallel;
+    std::vector<std::shared_ptr<ReductionNode>> reductions;
+    std::vector<size_t> hoistedSlots;
 };
 
 class StatementNode {
@@ -326,7 +459,7 @@ class StatementNode {
             std::shared_ptr<IfNode>, std::shared_ptr<WhileNode>,
             std::shared_ptr<FunctionCallNode>, std::shared_ptr<ReturnNode>>
             value);
-    static std::shared_ptr<StatementNode> parse(std::vector<Token> &tokens,
+    static std::shared_ptr<StatementNode> parse(TokenStream &tokens,
                                                 size_t &i);
     std::string toStringIndented(size_t indent) const;
     const std::variant<
@@ -334,6 +467,9 @@ class StatementNode {
         std::shared_ptr<IfNode>, std::shared_ptr<WhileNode>,
         std::shared_ptr<FunctionCallNode>, std::shared_ptr<ReturnNode>> &
     getValue() const;
+    // Source line the statement starts on.
+    size_t getLine() const;
+    void setLine(size_t line);
 
  private:
     std::variant<std::shared_ptr<VariableBindingNode>,
@@ -341,51 +477,98 @@ class StatementNode {
                  std::shared_ptr<WhileNode>, std::shared_ptr<FunctionCallNode>,
                  std::shared_ptr<ReturnNode>>
         value;
+    size_t line = 0;
 };
 
 class FunctionParameterNode {
  public:
-    static FunctionParameterNode parse(std::vector<Token> &tokens, size_t &i);
+    static FunctionParameterNode parse(TokenStream &tokens, size_t &i);
     operator std::string() const;
     const std::string &getIdentifier() const;
     const ArrayDescriptor &getDescriptor() const;
 
  private:
+    friend class ModuleReader;
     FunctionParameterNode(std::string identifier, ArrayDescriptor descriptor);
     std::string identifier;
     ArrayDescriptor descriptor;
 };
 
+// How often the walker has called a function, and what the scalar tier
+// made of it once it got hot. Like CallSiteCache it is only trusted while
+// the function bindings are still at `version`, since compiled code has its
+// callees built in, and copies start out empty.
+struct TierState {
+    TierState() = default;
+    TierState(const TierState &) {}
+    TierState &operator=(const TierState &) { return *this; }
+
+    std::atomic<uint64_t> version{0};
+    std::atomic<uint32_t> calls{0};
+    std::atomic<const ScalarFunction *> compiled{nullptr};
+    // Set when the function can't be compiled, or its compiled code had to
+    // give up, so it isn't tried again.
+    std::atomic<bool> rejected{false};
+};
+
+// The cache of a `memo fn`, made on its first call. Copies start out empty.
+struct MemoState {
+    MemoState() = default;
+    MemoState(const MemoState &) {}
+    MemoState &operator=(const MemoState &) { return *this; }
+
+    std::once_flag created;
+    std::shared_ptr<MemoCache> cache;
+};
+
 class FunctionDefinitionNode {
  public:
-    static FunctionDefinitionNode parse(std::vector<Token> &tokens, size_t &i);
+    static FunctionDefinitionNode parse(TokenStream &tokens, size_t &i);
     std::string toStringIndented(size_t indent) const;
     const std::string &getIdentifier() const;
     const std::vector<std::shared_ptr<FunctionParameterNode>> &getParams()
         const;
     const ArrayDescriptor &getOutput() const;
     const std::shared_ptr<BodyNode> &getBody() const;
+    size_t getFrameSize() const;
+    void setFrameSize(size_t frameSize);
+    // Source line of the `fn` keyword.
+    size_t getLine() const;
+    void setLine(size_t line);
+    TierState &getTier() const;
+    // Declared `memo fn`: calls with arguments it has seen before return the
+    // result it gave them then, without running it again.
+    bool isMemoized() const;
+    MemoState &getMemo() const;
 
  private:
+    friend class ModuleReader;
     FunctionDefinitionNode(
         std::string identifier,
         std::vector<std::shared_ptr<FunctionParameterNode>> input,
-        ArrayDescriptor output, std::shared_ptr<BodyNode> body);
+        ArrayDescriptor output, std::shared_ptr<BodyNode> body,
+        bool memoized);
     std::string identifier;
     std::vector<std::shared_ptr<FunctionParameterNode>> params;
     ArrayDescriptor output;
     std::shared_ptr<BodyNode> body;
+    size_t frameSize = 0;
+    size_t line = 0;
+    bool memoized;
+    mutable TierState tier;
+    mutable MemoState memo;
 };
 
 class UseNode {
  public:
     enum Type { PATH, STANDARD_HEADER };
-    static UseNode parse(std::vector<Token> &tokens, size_t &i);
+    static UseNode parse(TokenStream &tokens, size_t &i);
     const std::shared_ptr<ArrayNode> &getValue() const;
     const Type &getType() const;
     std::string toStringIndented(size_t indent) const;
 
  private:
+    friend class ModuleReader;
     UseNode(std::shared_ptr<ArrayNode> value, Type type);
     std::shared_ptr<ArrayNode> value;
     Type type;
@@ -393,7 +576,7 @@ class UseNode {
 
 class RootNode {
  public:
-    static RootNode parse(std::vector<Token> &tokens);
+    static RootNode parse(TokenStream &tokens);
     operator std::string() const;
     const std::vector<std::variant<
         std::shared_ptr<VariableBindingNode>, std::shared_ptr<FunctionCallNode>,
@@ -401,6 +584,7 @@ class RootNode {
     getValues() const;
 
  private:
+    friend class ModuleReader;
     explicit RootNode(
         std::vector<std::variant<std::shared_ptr<VariableBindingNode>,
                                  std::shared_ptr<FunctionCallNode>,
@@ -0,0 +1,13 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include "parser/parse.h"
+
+// Assigns a frame slot to every variable declared inside a function, including
+// those in nested blocks, and annotates each reference to it, so the
+// interpreter can find locals by index instead of by name and blocks never
+// need a scope of their own. Names that are not locals are left for global
+// lookup. Calls to builtin functions and methods, in globals too, are tagged
+// with the builtin's ID so they never look it up by name at run time.
+void resolveVariables(const RootNode& root);
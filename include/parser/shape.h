@@ -0,0 +1,14 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include "parser/parse.h"
+
+// Works out the sizes a function's values are certain to have, from its
+// literals and the fixed sizes its declarations and parameters give, and
+// marks the arithmetic whose operands are always single elements so that
+// the walker can skip the kernels for it. Throws for arithmetic on arrays
+// that are certain to differ in size and for declarations given a value
+// that can never fit, wherever they are in the function. Expects the
+// function to have been resolved.
+void inferShapes(const FunctionDefinitionNode& function);
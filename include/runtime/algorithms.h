@@ -0,0 +1,12 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+
+// Sorts ascending. Arrays past the parallel threshold are split into runs
+// that are sorted on separate threads and then merged pairwise, also in
+// parallel.
+void sortInts(int* data, size_t size);
+// Inclusive prefix sum, wrapping on overflow; `out` may be `data`.
+void prefixSum(const int* data, int* out, size_t size);
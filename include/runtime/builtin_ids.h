@@ -0,0 +1,55 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstdint>
+
+// Indices into the builtin registries. The named values are the builtins the
+// language ships with; registered builtins take the indices after them.
+enum class BuiltinFunction : uint32_t {
+    PRINT,
+    READ,
+    GETCHAR,
+    CLEAR,
+    RANGE,
+    EXIT,
+    ALLOCATIONS,
+    OPEN,
+    READCHUNK,
+    CLOSE,
+    WRITE,
+    APPENDFILE,
+    FLUSH,
+    SAVE,
+    LOAD,
+    POLLCHAR,
+    CURSOR,
+    SCREEN,
+    MAP,
+    SPAWN,
+    AWAIT,
+    CHAN,
+    SEND,
+    RECV
+};
+enum class BuiltinMethod : uint32_t {
+    APPEND,
+    SQRT,
+    SIZE,
+    SUM,
+    MIN,
+    MAX,
+    PROD,
+    SORT,
+    FIND,
+    BSEARCH,
+    SCAN,
+    REVERSE,
+    GET,
+    PUT,
+    HAS,
+    SPLIT,
+    INDEXOF,
+    TOINT,
+    FROMINT
+};
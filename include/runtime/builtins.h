@@ -0,0 +1,79 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "runtime/builtin_ids.h"
+#include "runtime/value.h"
+
+using BuiltinFunctionHandler = std::function<Value(std::vector<Value>&)>;
+using BuiltinMethodHandler =
+    std::function<Value(const Value&, std::vector<Value>&)>;
+// Updates a receiver the caller owns and returns true, or returns false to
+// have the copying handler's result replace it instead.
+using BuiltinMethodInPlaceHandler =
+    std::function<bool(Value&, std::vector<Value>&)>;
+
+// Names are looked up once, when a program is resolved; calls then index
+// straight into the registry. Registering an existing name replaces its
+// handlers and keeps its ID. Register builtins before loading a program.
+BuiltinFunction registerBuiltinFunction(const std::string& name,
+                                        BuiltinFunctionHandler handler);
+BuiltinMethod registerBuiltinMethod(
+    const std::string& name, BuiltinMethodHandler handler,
+    BuiltinMethodInPlaceHandler inPlace = nullptr);
+
+std::optional<BuiltinFunction> builtinFunctionFromName(const std::string& name);
+std::optional<BuiltinMethod> builtinMethodFromName(const std::string& name);
+
+Value callBuiltinFunction(BuiltinFunction function, std::vector<Value>& args);
+Value callBuiltinMethod(BuiltinMethod method, const Value& value,
+                        std::vector<Value>& args);
+void callBuiltinMethodInPlace(BuiltinMethod method, Value& value,
+                              std::vector<Value>& args);
+
+std::string valueToString(const Value& value);
+
+class FunctionCallNode;
+
+// spawn(f, args...) runs a call to the user function f in the background,
+// on the shared pool, and gives a handle that await(handle) trades for what
+// f returned. Each engine makes the call itself, in `call`, and hands it
+// here, which returns the handle. Tasks run in the context that spawned
+// them, and globals can't be assigned to while any of them is running.
+Value spawnTask(std::function<Value()> call);
+// Waits for every task the current context spawned and hasn't awaited, then
+// throws the first error or ScriptExit any of them threw.
+void finishTasks();
+// The same for a run that is already failing with an error of its own,
+// which is the one reported: what the tasks threw is dropped.
+void abandonTasks();
+// The name of the function a call to spawn starts: its first argument,
+// which must be a bare name, or null when it isn't one.
+const std::string* spawnedName(const FunctionCallNode& call);
+
+// The number of elements `range` returns for these arguments, checked the
+// way range checks them. Loops over a call to range count with it instead of
+// building the array, which they may only do while `function` is range and
+// its handler hasn't been replaced.
+size_t rangeSize(const std::vector<Value>& args);
+bool countsAsRange(BuiltinFunction function);
+// Whether calling `method` does nothing but compute its result from the
+// receiver and arguments, as the methods the language ships with do until
+// their handlers are replaced. Loops may then keep the result of such a call
+// instead of making it again (parser/hoist.h).
+bool isPureMethod(BuiltinMethod method);
+// The same for builtin functions, of which only range and map qualify: the
+// rest do input or output, or look at the state of the program.
+bool isPureFunction(BuiltinFunction function);
+
+// Buffer size for the current context's output (runtime/context.h) and for
+// the files it writes by path; 0 restores the default. Output is written out
+// when a buffer fills, on flush() and exit, and before anything reads input
+// or files.
+void setOutputBufferSize(size_t size);
+void flushOutput();
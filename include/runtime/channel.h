@@ -0,0 +1,40 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include "runtime/value.h"
+
+// A bounded queue of values that any number of threads send to and receive
+// from at once, without a lock: a ring of `capacity` cells, each with a
+// sequence number that says whether it is waiting to be filled or emptied
+// on the current lap. Values are moved through it, so sending a large array
+// hands over its buffer rather than copying it.
+class Channel {
+ public:
+    explicit Channel(size_t capacity);
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    // False, leaving `value` alone, when the channel is full.
+    bool trySend(Value& value);
+    // Nullopt when the channel is empty.
+    std::optional<Value> tryReceive();
+
+ private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<Value> value;
+    };
+
+    size_t capacity;
+    std::unique_ptr<Cell[]> cells;
+    // Senders and receivers each claim positions from their own counter,
+    // kept on separate cache lines.
+    alignas(64) std::atomic<size_t> sendPosition{0};
+    alignas(64) std::atomic<size_t> receivePosition{0};
+};
@@ -0,0 +1,99 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "util/file.h"
+#include "util/terminal.h"
+
+// A call started with spawn (runtime/builtins.h).
+struct SpawnedTask;
+class Channel;
+
+// Receives a script's output a block at a time, in order.
+using OutputSink = std::function<void(std::string_view bytes)>;
+
+// Everything one run of a script keeps to itself, so that scripts can run on
+// several threads of one process at once: where its output goes, the files
+// and streams it has open, and the settings it was loaded with. The thread
+// pool, the builtins and the memo limit stay shared by the whole process.
+struct Context {
+    // Writes to stdout.
+    Context();
+    explicit Context(OutputSink sink);
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    size_t outputCapacity = BufferedOutput::DEFAULT_CAPACITY;
+    BufferedOutput standardOutput;
+    // Files written to by path, which stay open for the appends that follow.
+    std::mutex outputsMutex;
+    std::vector<std::pair<std::string, std::unique_ptr<BufferedOutput>>>
+        outputs;
+    // Streams opened with `open`, indexed by handle.
+    std::mutex streamsMutex;
+    std::vector<std::shared_ptr<ChunkReader>> streams;
+    std::mutex screenMutex;
+    TerminalScreen screen;
+    // Tasks started with spawn, indexed by handle, and how many of them are
+    // still running.
+    std::mutex tasksMutex;
+    std::vector<std::shared_ptr<SpawnedTask>> tasks;
+    std::atomic<size_t> runningTasks{0};
+    // Channels made with `chan`, indexed by handle.
+    std::mutex channelsMutex;
+    std::vector<std::shared_ptr<Channel>> channels;
+
+    // Calls that may be active at once; 0 picks the engine's default.
+    size_t maxCallDepth = 0;
+    bool moduleCache = true;
+    bool tiering = true;
+};
+
+// Makes a context current on this thread for as long as it lives. Parallel
+// loops run their chunks in the context of the thread that started them.
+class ContextGuard {
+ public:
+    explicit ContextGuard(Context* context) : previous(active) {
+        active = context;
+    }
+    ~ContextGuard() { active = previous; }
+    ContextGuard(const ContextGuard&) = delete;
+    ContextGuard& operator=(const ContextGuard&) = delete;
+
+    // Null outside any guard.
+    static Context* current() { return active; }
+
+ private:
+    static inline thread_local Context* active = nullptr;
+    Context* previous;
+};
+
+// The process's own context, writing to stdout, for threads that aren't in
+// any other.
+Context& processContext();
+
+inline Context& currentContext() {
+    Context* context = ContextGuard::current();
+    return context != nullptr ? *context : processContext();
+}
+
+// Thrown by `exit` to unwind the script back to whatever is running it,
+// which decides what the code means: the command line exits with it.
+class ScriptExit {
+ public:
+    explicit ScriptExit(int code) : exitCode(code) {}
+    int code() const { return exitCode; }
+
+ private:
+    int exitCode;
+};
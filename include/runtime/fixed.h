@@ -0,0 +1,155 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "runtime/kernels.h"
+
+// Kernels for arrays whose size N is a compile-time constant, for the small
+// sizes that geometry and vector math use. Each one unrolls into N
+// straight-line operations, with no loop, no instruction-set dispatch and no
+// trip through the thread pool. They compute exactly what the general
+// kernels in runtime/kernels.h do.
+template <size_t N>
+struct FixedArray {
+    // `left op right` for operands of N elements, either of which may
+    // instead be a single element broadcast across the other.
+    static void arithmetic(ArithmeticKernel kernel, const int* left,
+                           size_t leftSize, const int* right,
+                           size_t rightSize, int* out) {
+        if (leftSize == rightSize)
+            unrolled<false, false>(kernel, left, right, out);
+        else if (leftSize == 1)
+            unrolled<true, false>(kernel, left, right, out);
+        else
+            unrolled<false, true>(kernel, left, right, out);
+    }
+
+    static bool compare(CompareKernel kernel, const int* left,
+                        const int* right) {
+        switch (kernel) {
+            case CompareKernel::EQ:
+                return all(left, right, std::equal_to<int>(), Indices());
+            case CompareKernel::NE:
+                return all(left, right, std::not_equal_to<int>(), Indices());
+            case CompareKernel::LT:
+                return all(left, right, std::less<int>(), Indices());
+            case CompareKernel::LE:
+                return all(left, right, std::less_equal<int>(), Indices());
+            case CompareKernel::GT:
+                return all(left, right, std::greater<int>(), Indices());
+            case CompareKernel::GE:
+                return all(left, right, std::greater_equal<int>(), Indices());
+        }
+        return false;
+    }
+
+ private:
+    using Indices = std::make_index_sequence<N>;
+
+    template <bool broadcastLeft, bool broadcastRight>
+    static void unrolled(ArithmeticKernel kernel, const int* left,
+                         const int* right, int* out) {
+        switch (kernel) {
+            case ArithmeticKernel::ADD:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, std::plus<int>(), Indices());
+            case ArithmeticKernel::SUB:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, std::minus<int>(), Indices());
+            case ArithmeticKernel::MUL:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, std::multiplies<int>(), Indices());
+            case ArithmeticKernel::DIV:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, Divide(), Indices());
+            case ArithmeticKernel::MOD:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, Remainder(), Indices());
+            case ArithmeticKernel::AND:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, std::bit_and<int>(), Indices());
+            case ArithmeticKernel::OR:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, std::bit_or<int>(), Indices());
+            case ArithmeticKernel::XOR:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, std::bit_xor<int>(), Indices());
+            case ArithmeticKernel::SHL:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, ShiftLeft(), Indices());
+            case ArithmeticKernel::SHR:
+                return apply<broadcastLeft, broadcastRight>(
+                    left, right, out, ShiftRight(), Indices());
+        }
+    }
+
+    template <bool broadcastLeft, bool broadcastRight, typename Operation,
+              size_t... I>
+    static void apply(const int* left, const int* right, int* out,
+                      Operation operation, std::index_sequence<I...>) {
+        ((out[I] = operation(left[broadcastLeft ? 0 : I],
+                             right[broadcastRight ? 0 : I])),
+         ...);
+    }
+
+    template <typename Operation, size_t... I>
+    static bool all(const int* left, const int* right, Operation operation,
+                    std::index_sequence<I...>) {
+        return (operation(left[I], right[I]) && ...);
+    }
+};
+
+// The largest size with a FixedArray kernel.
+constexpr size_t FIXED_ARRAY_LIMIT = 4;
+
+// Writes `left op right` to `out` with the kernel for `size`, the size
+// broadcastSize gave for the operands, and returns false when `size` is
+// too large to have one.
+inline bool fixedArithmetic(ArithmeticKernel kernel, const int* left,
+                            size_t leftSize, const int* right,
+                            size_t rightSize, int* out, size_t size) {
+    switch (size) {
+        case 1:
+            FixedArray<1>::arithmetic(kernel, left, leftSize, right,
+                                       rightSize, out);
+            return true;
+        case 2:
+            FixedArray<2>::arithmetic(kernel, left, leftSize, right,
+                                       rightSize, out);
+            return true;
+        case 3:
+            FixedArray<3>::arithmetic(kernel, left, leftSize, right,
+                                       rightSize, out);
+            return true;
+        case 4:
+            FixedArray<4>::arithmetic(kernel, left, leftSize, right,
+                                       rightSize, out);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// compareAll for two buffers of `size` elements, through the FixedArray
+// kernel when there is one.
+inline bool fixedCompare(CompareKernel kernel, const int* left,
+                         const int* right, size_t size) {
+    switch (size) {
+        case 0:
+            return true;
+        case 1:
+            return FixedArray<1>::compare(kernel, left, right);
+        case 2:
+            return FixedArray<2>::compare(kernel, left, right);
+        case 3:
+            return FixedArray<3>::compare(kernel, left, right);
+        case 4:
+            return FixedArray<4>::compare(kernel, left, right);
+        default:
+            return compareAll(kernel, left, right, size);
+    }
+}
@@ -0,0 +1,45 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "runtime/kernels.h"
+#include "runtime/value.h"
+
+// Evaluates a tree of elementwise arithmetic in a single pass. Operands and
+// operations are pushed in postfix order; evaluate() then runs the whole tree
+// one tile of elements at a time, so intermediate results only ever occupy a
+// few cache-sized buffers instead of whole arrays.
+class FusedArithmetic {
+ public:
+    static constexpr size_t TILE_SIZE = 1024;
+
+    void pushOperand(std::shared_ptr<const Value> operand);
+    // Sizes are checked here, as each operation is pushed, so errors surface
+    // in the same order as when evaluating node by node.
+    void pushOperation(ArithmeticKernel kernel);
+    Value evaluate() const;
+
+ private:
+    // Trees at most this deep with small results skip the tiled loop.
+    static constexpr size_t SMALL_DEPTH = 8;
+
+    struct Step {
+        std::optional<ArithmeticKernel> kernel;
+        size_t operand;
+    };
+    struct Term {
+        const int* data;
+        bool broadcast;
+    };
+
+    void evaluateSmall(int* out, size_t size) const;
+
+    std::vector<std::shared_ptr<const Value>> operands;
+    std::vector<Step> steps;
+    std::vector<size_t> pending;
+    size_t depth = 0;
+};
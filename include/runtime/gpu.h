@@ -0,0 +1,45 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "runtime/kernels.h"
+
+// Elementwise arithmetic, sqrt and reductions on the GPU, through an OpenGL
+// 4.3 compute context of the runtime's own that needs no window. Only builds
+// configured with INTS_GPU have it; in others, and wherever a context can't
+// be made, every call here declines and the caller runs its CPU kernels.
+//
+// Each call uploads its operands once, runs everything it was given in one
+// dispatch, and downloads only the result, so the intermediate values of a
+// fused tree never leave the device. Division and remainder stay on the CPU,
+// where a zero divisor faults as it always has.
+
+// Element count from which work goes to the GPU, for the whole process; 0,
+// the default, keeps everything on the CPU.
+void configureGpu(size_t threshold);
+bool gpuEnabled(size_t size);
+
+// One step of a postfix tree: the operation on the two terms before it, or
+// else the operand at `operand`.
+struct GpuStep {
+    std::optional<ArithmeticKernel> kernel;
+    size_t operand;
+};
+// An operand of one element is broadcast across the others.
+struct GpuOperand {
+    const int* data;
+    size_t size;
+};
+
+// Each of these returns false, leaving `out` untouched, when the work stays
+// on the CPU.
+bool gpuArithmetic(const std::vector<GpuStep>& steps,
+                   const std::vector<GpuOperand>& operands, int* out,
+                   size_t size);
+bool gpuSquareRoots(const int* source, int* out, size_t size);
+std::optional<int> gpuReduction(ReductionKernel kernel, const int* data,
+                                size_t size);
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -11,11 +12,28 @@
 #include <vector>
 
 #include "parser/parse.h"
+#include "runtime/context.h"
 #include "runtime/value.h"
+#include "util/pool.h"
+
+// Values shared by reference, kept in pool memory since they rarely outlive
+// the call that made them.
+using SharedValues =
+    std::vector<std::shared_ptr<Value>, PoolAllocator<std::shared_ptr<Value>>>;
+
+// A `return f(...)` waiting for the function call that made the frame to
+// run it in place of itself, with its arguments already evaluated.
+struct TailCall {
+    const FunctionDefinitionNode* function;
+    SharedValues arguments;
+};
 
 class Scope {
  public:
-    explicit Scope(std::weak_ptr<Scope> parent = std::weak_ptr<Scope>());
+    explicit Scope(std::weak_ptr<Scope> parent = std::weak_ptr<Scope>(),
+                   size_t frameSize = 0);
+    const std::weak_ptr<Scope>& getParent() const;
+    std::shared_ptr<Value>& slot(const VariableSlot& slot);
     bool has(const std::string& name) const;
     bool hasRecursive(const std::string& name) const;
     const std::variant<std::shared_ptr<Value>,
@@ -29,15 +47,122 @@ class Scope {
         const std::string& name,
         const std::variant<std::shared_ptr<Value>,
                            std::shared_ptr<FunctionDefinitionNode>>& value);
+    void setTailCall(TailCall tailCall);
+    std::optional<TailCall> takeTailCall();
+    // The names bound in this scope itself, not its parents.
+    const std::unordered_map<
+        std::string, std::variant<std::shared_ptr<Value>,
+                                  std::shared_ptr<FunctionDefinitionNode>>>&
+    getVariables() const;
 
  private:
     std::weak_ptr<Scope> parent;
+    SharedValues frame;
+    std::optional<TailCall> tailCall;
     std::unordered_map<std::string,
                        std::variant<std::shared_ptr<Value>,
                                     std::shared_ptr<FunctionDefinitionNode>>>
         variables;
 };
 
-bool isGuiRunning();
-void interpret(const std::string& filename, int argc,
-               std::vector<std::string> args);
+enum class Engine { TREE_WALKER, VM };
+
+// threads, parallelThreshold, gpuThreshold and memoLimit are shared by the
+// whole process: the first Script settles them, and constructing a later one
+// that asks for different values throws. The rest belong to each Script.
+struct InterpretOptions {
+    Engine engine = Engine::TREE_WALKER;
+    // Worker threads for large elementwise operations; 0 uses every core.
+    size_t threads = 0;
+    // Element count from which an operation is split across threads.
+    size_t parallelThreshold = 1 << 20;
+    // Element count from which arithmetic, sqrt and reductions run on the GPU
+    // (runtime/gpu.h) in builds that have it; 0 keeps them on the CPU.
+    size_t gpuThreshold = 0;
+    // Calls that may be active at once; 0 picks the engine's default. Tail
+    // calls replace their caller and don't count.
+    size_t maxCallDepth = 0;
+    // Read `use`d files through the on-disk cache of parsed modules.
+    bool moduleCache = true;
+    // Let the tree walker move hot functions over single elements onto its
+    // scalar tier (runtime/scalar.h).
+    bool tiering = true;
+    // Bytes of output collected before they are written out; 0 keeps the
+    // default.
+    size_t outputBuffer = 0;
+    // Results each memo fn keeps before the least recently used make room;
+    // 0 keeps the default.
+    size_t memoLimit = 0;
+    // Where the tree walker writes a profile of the run (runtime/profile.h);
+    // empty turns profiling off.
+    std::string profile;
+    // Where a Script's output goes; empty writes it to stdout.
+    OutputSink output;
+};
+
+class Program;
+class VirtualMachine;
+
+// A script loaded once and then called into any number of times, for
+// programs that embed ints through libints. Loading reads and resolves the
+// script and everything it uses and runs its top-level bindings, but not
+// main; errors in either are thrown as std::runtime_error, and a call to
+// `exit` as ScriptExit. Each Script runs in a context of its own
+// (runtime/context.h), so different Scripts may run on different threads at
+// once, but a Script is called from one thread at a time.
+class Script {
+ public:
+    explicit Script(const std::string& filename,
+                    const InterpretOptions& options = InterpretOptions());
+    ~Script();
+    Script(const Script&) = delete;
+    Script& operator=(const Script&) = delete;
+
+    bool has(const std::string& function) const;
+    bool uses(const std::string& standardHeader) const;
+    // The files it `use`s, directly or not, as they were named.
+    const std::vector<std::string>& getFiles() const;
+    // Calls a function of the script with the given arguments, bound to its
+    // parameters as any call's are, and returns what it returned. An error
+    // in the call, dividing by zero among them, is thrown as
+    // std::runtime_error and leaves the Script ready for the next call.
+    Value call(const std::string& function,
+               std::vector<Value> arguments = {});
+    // The same for arguments and a result given as plain ints. It is named
+    // apart so that `call("f", {})` has only the one overload to match.
+    std::vector<int> callInts(const std::string& function,
+                              const std::vector<ArrayView>& arguments);
+    // Calls main with the argc and args the command line gives it, if the
+    // script has a main.
+    void callMain(const std::vector<std::string>& args);
+    // Puts every top-level binding back the way loading left it, so that
+    // the next call runs as it would on a freshly loaded script. What memo
+    // fns remember is kept.
+    void reset();
+
+ private:
+    // Opens the window of a script that uses <graphics> before main runs.
+    friend void interpret(const std::string& filename,
+                          std::vector<std::string> args,
+                          const InterpretOptions& options);
+
+    Value run(const std::string& function, std::vector<Value> arguments);
+
+    std::unique_ptr<Context> context;
+    std::shared_ptr<Scope> scope;
+    // The top-level bindings once loaded, for reset().
+    std::vector<std::pair<
+        std::string, std::variant<std::shared_ptr<Value>,
+                                  std::shared_ptr<FunctionDefinitionNode>>>>
+        loaded;
+    std::vector<std::string> standardHeaders;
+    std::vector<std::string> files;
+    std::unique_ptr<Program> program;
+    std::unique_ptr<VirtualMachine> vm;
+};
+
+// Returns once the window a script opened with `use <graphics>` is closed,
+// straight away when there is none.
+void waitForGui();
+void interpret(const std::string& filename, std::vector<std::string> args,
+               const InterpretOptions& options = InterpretOptions());
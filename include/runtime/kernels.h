@@ -0,0 +1,70 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+
+enum class ArithmeticKernel { ADD, SUB, MUL, DIV, MOD, AND, OR, XOR, SHL, SHR };
+enum class CompareKernel { EQ, NE, LT, LE, GT, GE };
+enum class ReductionKernel { SUM, MIN, MAX, PRODUCT };
+
+// Shifts take their count modulo 32, as x86 does, and >> keeps the sign.
+struct ShiftLeft {
+    int operator()(int left, int right) const {
+        return static_cast<int>(static_cast<unsigned>(left) << (right & 31));
+    }
+};
+
+struct ShiftRight {
+    int operator()(int left, int right) const { return left >> (right & 31); }
+};
+
+// Throws the std::runtime_error a zero divisor raises.
+[[noreturn]] void divisionByZero();
+
+// Division by zero throws instead of faulting, and INT_MIN / -1 wraps to
+// INT_MIN, leaving no remainder, like the other operators overflow.
+struct Divide {
+    int operator()(int left, int right) const {
+        if (right == 0) divisionByZero();
+        if (right == -1)
+            return static_cast<int>(0u - static_cast<unsigned>(left));
+        return left / right;
+    }
+};
+
+struct Remainder {
+    int operator()(int left, int right) const {
+        if (right == 0) divisionByZero();
+        if (right == -1) return 0;
+        return left % right;
+    }
+};
+
+// Element-wise kernels over int buffers. Each call runs the widest
+// implementation the CPU supports (AVX2, SSE4.1 or NEON, falling back to a
+// scalar loop), chosen once on first use.
+void applyArithmetic(ArithmeticKernel kernel, const int* left,
+                     const int* right, int* out, size_t size);
+// The same kernels with one operand a single value applied to every element
+// of the other, so broadcasting never materializes a full-size operand.
+void applyArithmeticScalarLeft(ArithmeticKernel kernel, int left,
+                               const int* right, int* out, size_t size);
+void applyArithmeticScalarRight(ArithmeticKernel kernel, const int* left,
+                                int right, int* out, size_t size);
+// True when the comparison holds for every pair of elements; stops at the
+// first block that fails.
+bool compareAll(CompareKernel kernel, const int* left, const int* right,
+                size_t size);
+// Folds a buffer into one value. Sums and products wrap around on overflow;
+// an empty buffer gives the identity (0, INT_MAX, INT_MIN or 1).
+int applyReduction(ReductionKernel kernel, const int* data, size_t size);
+// Index of the first element equal to `value`, or `size` when there is none.
+size_t findFirst(const int* data, size_t size, int value);
+const char* kernelInstructionSet();
+
+// What an error says the kernel was doing, as in "Cannot add arrays".
+const char* arithmeticVerb(ArithmeticKernel kernel);
+// Size of `left op right`: equal sizes pair up and a one-element side is
+// broadcast across the other. Throws for any other combination.
+size_t broadcastSize(ArithmeticKernel kernel, size_t left, size_t right);
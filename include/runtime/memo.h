@@ -0,0 +1,63 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parser/parse.h"
+#include "runtime/value.h"
+
+// The arguments of a call to a `memo fn`: each one's size followed by its
+// elements, so that no two lists of arguments give the same key.
+class MemoKey {
+ public:
+    void add(const Value& argument);
+    size_t hash() const { return hashed; }
+    bool operator==(const MemoKey& other) const {
+        return elements == other.elements;
+    }
+
+ private:
+    std::vector<int> elements;
+    size_t hashed = 14695981039346656037ull;
+};
+
+// The results a `memo fn` returned, for the most recent memoLimit() lists of
+// arguments; the one used longest ago makes room for a new one. Calls may
+// share it from several threads.
+class MemoCache {
+ public:
+    // Counts a hit or a miss for --stats.
+    std::optional<Value> find(const MemoKey& key);
+    void store(MemoKey key, const Value& result);
+
+ private:
+    using Entry = std::pair<MemoKey, Value>;
+    struct Hash {
+        size_t operator()(const MemoKey* key) const { return key->hash(); }
+    };
+    struct Equal {
+        bool operator()(const MemoKey* left, const MemoKey* right) const {
+            return *left == *right;
+        }
+    };
+
+    std::mutex mutex;
+    // Most recently used first. The index points at the keys in here.
+    std::list<Entry> entries;
+    std::unordered_map<const MemoKey*, std::list<Entry>::iterator, Hash,
+                       Equal>
+        index;
+};
+
+MemoCache& memoCache(const FunctionDefinitionNode& function);
+
+// Results each memo fn keeps; 0 restores the default.
+void setMemoLimit(size_t entries);
+size_t memoLimit();
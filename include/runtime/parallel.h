@@ -0,0 +1,120 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for data-parallel loops. Each worker owns a deque of
+// chunks, taking from its back and stealing from the front of the others'
+// when it runs dry. The thread that starts a loop helps out until every chunk
+// has run, so loops may be started from inside other loops.
+class ThreadPool {
+ public:
+    using Body = std::function<void(size_t begin, size_t end)>;
+    struct Loop;
+    // Work started with spawn(), which lives until it has run and nothing
+    // refers to it.
+    using Job = std::shared_ptr<Loop>;
+
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads taking part in a loop, counting the caller.
+    size_t size() const;
+    // Runs body over [0, count) in chunks of at least `grain` elements.
+    void parallelFor(size_t count, size_t grain, const Body& body);
+    // Starts `body` in the background, as one chunk that any thread may take.
+    Job spawn(std::function<void()> body);
+    // Returns once `job` has run, rethrowing what it threw. Other work is
+    // run in the meantime, so jobs may wait for the jobs they started.
+    void wait(const Job& job);
+    // Retries `attempt` until it succeeds, for a thread that can do nothing
+    // until another makes progress, sleeping until progressed() is called
+    // between tries. The work still queued may be what it is waiting for, so
+    // a spare thread is started to run that work in its place.
+    void block(const std::function<bool()>& attempt);
+    // Wakes the threads in block() to try again, after a change that may let
+    // their attempts succeed.
+    void progressed();
+
+ private:
+    struct Chunk {
+        Loop* loop;
+        size_t begin;
+        size_t end;
+        // Keeps a spawned job's loop alive until it has run.
+        Job owner;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+    };
+
+    // A thread started by spawn without workers, or for a blocked thread,
+    // that runs until nothing is left queued.
+    struct Spare {
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    bool runOne(size_t first);
+    void run(const Chunk& chunk);
+    void work(size_t index);
+    void startSpare(std::optional<Chunk> first);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> nextWorker{0};
+    bool stopping = false;
+    std::mutex sparesMutex;
+    std::vector<std::unique_ptr<Spare>> spares;
+    std::atomic<size_t> activeSpares{0};
+    std::atomic<size_t> blocked{0};
+    // Counts calls to progressed(), which blocked threads sleep until.
+    std::atomic<size_t> generation{0};
+    std::mutex progressMutex;
+    std::condition_variable progress;
+};
+
+// Sets the threads used by the shared pool (0 picks one per core) and the
+// element count below which loops stay on the calling thread, for the whole
+// process. The thread count takes effect only before the first parallel
+// loop.
+void configureParallelism(size_t threads, size_t threshold);
+size_t parallelThreads();
+size_t parallelThreshold();
+void runParallel(size_t count, const ThreadPool::Body& body);
+// Runs task(0) through task(count - 1) across the shared pool regardless of
+// the threshold, for work that is coarse-grained already.
+void parallelEach(size_t count, const std::function<void(size_t)>& task);
+// ThreadPool::spawn, wait and block on the shared pool.
+ThreadPool::Job spawnJob(std::function<void()> body);
+void waitForJob(const ThreadPool::Job& job);
+void blockUntil(const std::function<bool()>& attempt);
+// ThreadPool::progressed on the shared pool.
+void wakeBlocked();
+
+// Runs body over [0, count), spread across the shared pool when count reaches
+// the configured threshold. Small loops call body directly, without wrapping
+// it in a std::function.
+template <typename Body>
+void parallelFor(size_t count, const Body& body) {
+    if (count < parallelThreshold())
+        body(size_t{0}, count);
+    else
+        runParallel(count, body);
+}
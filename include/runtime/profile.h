@@ -0,0 +1,85 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "parser/parse.h"
+
+// Sampling profiler for the tree walker. A background thread ticks once per
+// INTERVAL, and the interpreter charges the ticks that have passed to the
+// function and line it is in whenever it starts a statement or enters or
+// leaves a function, so a statement's time includes the builtins it calls.
+// Calls and statement executions are counted exactly. Only the thread that
+// owns the profiler may report to it.
+class Profiler {
+ public:
+    static constexpr std::chrono::microseconds INTERVAL{1000};
+
+    // Writes the flat report to `path` and folded stacks, one line per
+    // distinct call stack as flamegraph.pl expects, to `path`.folded.
+    explicit Profiler(std::string path);
+    ~Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Names the file a function was loaded from, for the report.
+    void define(const FunctionDefinitionNode& function,
+                const std::string& file);
+    void enter(const FunctionDefinitionNode& function);
+    // Replaces the running function, as a tail call does.
+    void replace(const FunctionDefinitionNode& function);
+    void leave();
+    void statement(size_t line);
+    // Stops sampling and writes the reports. Later calls do nothing.
+    void finish();
+
+ private:
+    struct Line {
+        uint64_t executions = 0;
+        uint64_t samples = 0;
+    };
+    struct Function {
+        std::string name;
+        std::string file;
+        size_t line = 0;
+        uint64_t calls = 0;
+        uint64_t self = 0;
+        uint64_t total = 0;
+        // The sample that last added to `total`, so recursion counts once.
+        uint64_t charged = 0;
+        std::unordered_map<size_t, Line> lines;
+    };
+    struct Frame {
+        Function* function;
+        size_t line;
+    };
+
+    Function& lookup(const FunctionDefinitionNode& function);
+    void sample();
+    void writeReport(double secondsPerSample) const;
+    void writeFolded() const;
+
+    std::string path;
+    std::unordered_map<const FunctionDefinitionNode*, Function> functions;
+    std::vector<Frame> stack;
+    std::unordered_map<std::string, uint64_t> folded;
+    std::atomic<uint64_t> ticks{0};
+    uint64_t seen = 0;
+    uint64_t samples = 0;
+    std::chrono::steady_clock::time_point start;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool finished = false;
+    std::thread sampler;
+};
@@ -0,0 +1,91 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "parser/parse.h"
+
+// The tree walker's second tier. Once a function has been called often
+// enough, it is compiled to register code over plain ints, provided it and
+// every user function it calls only ever hold single elements: `[1]`
+// locals, literals and arguments, arithmetic, comparisons, loops, and calls
+// to functions of the same kind that aren't memo fns. Everything else stays
+// in the walker.
+//
+// Such functions touch nothing but their own frame, so whenever compiled
+// code meets something it doesn't handle itself, such as a division by
+// zero or running off the end of a function, it gives up and the walker
+// reruns the whole call, reaching the same result or error it always did.
+
+enum class ScalarOp : uint8_t {
+    LOAD,  // a = immediate b
+    MOVE,  // a = b
+    ADD,   // a = b + c, and so on
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    AND,
+    OR,
+    XOR,
+    SHL,
+    SHR,
+    JUMP,  // to a
+    // Jump to a when b compares to c this way.
+    JUMP_EQ,
+    JUMP_NE,
+    JUMP_LT,
+    JUMP_LE,
+    JUMP_GT,
+    JUMP_GE,
+    // a = callees[b](arguments[c], ...)
+    CALL,
+    // Replaces this frame with callees[b](arguments[c], ...).
+    TAIL_CALL,
+    RETURN,  // a
+    // The end of the function was reached without a return.
+    GIVE_UP,
+};
+
+struct ScalarInstruction {
+    ScalarOp op;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+struct ScalarFunction {
+    const FunctionDefinitionNode* definition;
+    // The function's frame slots, parameters first, then temporaries.
+    size_t registers;
+    std::vector<ScalarInstruction> code;
+    std::vector<const ScalarFunction*> callees;
+    // Argument registers of every call, one run per call.
+    std::vector<int32_t> arguments;
+};
+
+constexpr size_t SCALAR_MAX_PARAMETERS = 16;
+
+// Looks up the user function a call names, or null when it names a builtin.
+using ScalarResolver =
+    std::function<const FunctionDefinitionNode*(const FunctionCallNode&)>;
+
+// Counts a call to `function` and returns its compiled code once it is hot,
+// compiling it on the call that makes it so. Null while it is still cold or
+// when it can't be compiled. `version` is the interpreter's current function
+// bindings, which `resolve` looks callees up in.
+const ScalarFunction* scalarTier(const FunctionDefinitionNode& function,
+                                 uint64_t version,
+                                 const ScalarResolver& resolve);
+
+// Runs `function` on `arguments`, one int per parameter, inside a call stack
+// already `depth` calls deep that may grow to `maxDepth`. Nullopt when the
+// code gave up, after which the function is left to the walker for good.
+std::optional<int> runScalar(const ScalarFunction& function,
+                             const int* arguments, size_t depth,
+                             size_t maxDepth);
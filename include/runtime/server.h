@@ -0,0 +1,33 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "runtime/interpreter.h"
+
+// Runs scripts for clients that connect to a Unix socket, so that a run
+// costs neither starting a process nor loading the script. A connection
+// asks for one run: the script's path, then the arguments main gets. Paths,
+// including the ones scripts `use`, are the server's, relative to its
+// working directory. Scripts stay loaded between runs, one copy for each run
+// in progress, and are loaded again once any of their files changes.
+//
+// Each string of a request is its length as a little-endian uint32 followed
+// by its bytes, after the count of strings in the same form. The reply is a
+// series of frames, a kind byte and a little-endian uint32 length before
+// the payload: 'o' for output as it is written, 'e' for the message of an
+// error that ended the run, and last 'x' for the status the run exits with,
+// as a little-endian int32.
+//
+// Listens at `path` until the process is killed, running up to `workers`
+// requests at once (0 picks one per core) with `options`.
+void serve(const std::string& path, size_t workers,
+           const InterpretOptions& options);
+
+// Asks the server at `path` to run `filename` with `args`, copying the output
+// to stdout and errors to stderr, and returns the status to exit with.
+int runOnServer(const std::string& path, const std::string& filename,
+                const std::vector<std::string>& args);
@@ -0,0 +1,58 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Counters for the work the interpreter does behind a script's back, shown
+// by --stats. They are only updated once enableStats() has been called, so
+// until then each counting site costs one untaken branch.
+struct RuntimeStats {
+    std::atomic<uint64_t> elementCopies{0};
+    std::atomic<uint64_t> scopes{0};
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> maxCallDepth{0};
+    std::atomic<uint64_t> memoHits{0};
+    std::atomic<uint64_t> memoMisses{0};
+};
+
+extern bool statsEnabled;
+extern RuntimeStats runtimeStats;
+
+// Also starts counting the bytes the heap hands out (util/pool.h).
+void enableStats();
+// Writes every counter, one per line.
+void printStats(std::ostream& out);
+
+inline void countElementCopies(size_t elements) {
+    if (statsEnabled)
+        runtimeStats.elementCopies.fetch_add(elements,
+                                             std::memory_order_relaxed);
+}
+
+inline void countScope() {
+    if (statsEnabled)
+        runtimeStats.scopes.fetch_add(1, std::memory_order_relaxed);
+}
+
+// A call to a user function that reached `depth` active calls.
+inline void countCall(size_t depth) {
+    if (!statsEnabled) return;
+    runtimeStats.calls.fetch_add(1, std::memory_order_relaxed);
+    uint64_t deepest =
+        runtimeStats.maxCallDepth.load(std::memory_order_relaxed);
+    while (depth > deepest &&
+           !runtimeStats.maxCallDepth.compare_exchange_weak(
+               deepest, depth, std::memory_order_relaxed)) {
+    }
+}
+
+// A memo fn call that found its result in the cache, or had to run.
+inline void countMemoLookup(bool hit) {
+    if (!statsEnabled) return;
+    (hit ? runtimeStats.memoHits : runtimeStats.memoMisses)
+        .fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+
+// Hash maps from ints to ints, kept in a flat array of ints so that a map is
+// an ordinary value: the capacity, a power of two, and the number of entries,
+// followed by `capacity` slots of [used, key, value]. Keys are found by
+// linear probing from their hash. A slot's three ints sit next to each other
+// and the table is never more than 3/4 full, so a lookup usually reads one
+// cache line.
+constexpr size_t TABLE_HEADER = 2;
+constexpr size_t TABLE_SLOT = 3;
+constexpr size_t TABLE_MIN_CAPACITY = 8;
+
+// Ints a table of `capacity` slots takes.
+constexpr size_t tableSize(size_t capacity) {
+    return TABLE_HEADER + capacity * TABLE_SLOT;
+}
+
+// Whether `size` ints starting at `data` hold a table.
+bool isTable(const int* data, size_t size);
+// Writes an empty table of `capacity` slots over tableSize(capacity) ints.
+void initTable(int* data, size_t capacity);
+// The slot `key` is in, or the empty slot it would go in, or the capacity
+// when there is neither.
+size_t findSlot(const int* table, int key);
+// Where the value of `key` is, or nullptr when the table doesn't have it.
+const int* tableValue(const int* table, int key);
+// Whether setting `key` calls for a larger table.
+bool tableFull(const int* table, int key);
+// Sets the value of `key`, adding it if it's new, in a table that isn't
+// full.
+void tableInsert(int* table, int key, int value);
+// Copies every entry of `from` into `to`, an empty table.
+void rehashTable(const int* from, int* to);
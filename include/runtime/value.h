@@ -4,19 +4,62 @@
 
 #include <memory>
 #include <string>
+#include <variant>
 
 #include "parser/parse.h"
 
 class Value;
 
+// Non-owning view of an array's elements. It is invalidated by anything that
+// resizes or replaces the array it was taken from.
+struct ArrayView {
+    const int* data;
+    size_t size;
+
+    const int* begin() const;
+    const int* end() const;
+    const int& operator[](size_t i) const;
+};
+
+// The one buffer behind every value that owns its elements, fixed or
+// growable. Arrays of up to INLINE_CAPACITY elements live inside the
+// DynamicArray itself; only longer arrays allocate. `data` points at
+// whichever is in use. Long arrays may instead be backed by a copy-on-write
+// file mapping, which is unmapped with the array. A growable array, as `[+]`
+// variables hold, keeps spare capacity so that appending to it only copies
+// when the capacity runs out.
 struct DynamicArray {
-    std::unique_ptr<int[]> data;
+    static constexpr size_t INLINE_CAPACITY = 4;
+
+    int* data;
     size_t size;
+    // Assignments may change the length.
+    bool canGrow = false;
 
     DynamicArray(const DynamicArray& dynamicArray);
+    DynamicArray(DynamicArray&& dynamicArray) noexcept;
+    DynamicArray& operator=(const DynamicArray& dynamicArray) = delete;
+    DynamicArray& operator=(DynamicArray&& dynamicArray) noexcept;
+    // Zeros, on pages the system backs with memory only once written.
     explicit DynamicArray(size_t n);
     DynamicArray(std::unique_ptr<int[]> data, size_t size);
+    // Elements that hold anything, for a result the caller writes in full.
+    static DynamicArray uninitialized(size_t n);
+    // An empty growable array with room for `capacity` elements.
+    static DynamicArray growable(size_t capacity = 0);
+    static DynamicArray copyOf(ArrayView elements, bool canGrow = false);
+    // Takes over `size` elements inside a mapping of `mapped` bytes made by
+    // mapFile (util/file.h).
+    static DynamicArray fromMapping(int* data, size_t size, size_t mapped);
     static DynamicArray fromValue(const Value& value);
+    bool isMapped() const;
+    ArrayView view() const;
+    // Elements that fit before the array has to move.
+    size_t capacity() const;
+    void reserve(size_t capacity);
+    // These may read from the array's own elements.
+    void assign(const int* elements, size_t count);
+    void append(const int* elements, size_t count);
     int& at(size_t i);
     const int& at(size_t i) const;
     operator std::string() const;
@@ -26,34 +69,97 @@ struct DynamicArray {
     DynamicArray operator-(const DynamicArray& other);
     DynamicArray operator*(const DynamicArray& other);
     DynamicArray operator/(const DynamicArray& other);
+    DynamicArray operator%(const DynamicArray& other);
+    DynamicArray operator&(const DynamicArray& other);
+    DynamicArray operator|(const DynamicArray& other);
+    DynamicArray operator^(const DynamicArray& other);
+    DynamicArray operator<<(const DynamicArray& other);
+    DynamicArray operator>>(const DynamicArray& other);
     bool operator==(const DynamicArray& other) const;
     bool operator!=(const DynamicArray& other) const;
     bool operator<(const DynamicArray& other) const;
     bool operator<=(const DynamicArray& other) const;
     bool operator>(const DynamicArray& other) const;
     bool operator>=(const DynamicArray& other) const;
+
+ private:
+    // Frees elements that came from new[], from allocateElements
+    // (util/pool.h) as a block of `bytes`, or from a mapping of `bytes`.
+    struct Storage {
+        enum class Kind { ARRAY, ELEMENTS, MAPPING };
+        Storage() : kind(Kind::ARRAY), bytes(0) {}
+        Storage(Kind kind, size_t bytes) : kind(kind), bytes(bytes) {}
+        void operator()(int* data) const;
+        Kind kind;
+        size_t bytes;
+    };
+
+    void allocate(bool zeroed);
+    void adopt(int* elements, size_t capacity);
+
+    std::unique_ptr<int[], Storage> heap;
+    int inlineData[INLINE_CAPACITY] = {};
 };
 
+// A window onto another value's elements, produced by slicing. The source
+// is shared rather than copied, so it must not be mutated while any slice of
+// it is alive; the slice is copied out whenever it needs storage of its own.
+struct ArraySlice {
+    std::shared_ptr<const Value> source;
+    size_t offset;
+    size_t size;
+
+    ArrayView view() const;
+};
+
+// `minimum` is the length a growable value may not shrink below, and the
+// length of a fixed one. Growable values normally hold a DynamicArray that
+// can grow; one holding a fixed DynamicArray longer than its minimum, such
+// as a mapped file bound to a `[+]` variable, becomes growable when it is
+// next assigned to.
 class Value {
  public:
     Value(const Value& value);
-    Value(std::variant<std::vector<int>, DynamicArray> value, size_t minimum);
+    Value(Value&& value) noexcept;
+    Value(std::variant<DynamicArray, ArraySlice> value, size_t minimum);
     static Value fromDescriptor(const ArrayDescriptor& descriptor,
                                 std::optional<Value> value);
+    // The same for a descriptor given by its parts, as generated code has.
+    static Value fromDescriptor(std::optional<size_t> size, bool canGrow,
+                                std::optional<Value> value);
+    static Value slice(const std::shared_ptr<const Value>& source,
+                       size_t start, size_t end);
+    void sliceInPlace(size_t start, size_t end);
+    // A copy that shares this value's elements instead of copying them. A
+    // value longer than the inline capacity first moves its elements into a
+    // buffer of their own, which it and the copy then both slice; whichever
+    // is written to next copies them out, as writes to slices always do.
+    Value share();
+    void replace(const Value& other);
+    void replace(Value&& other);
     bool sameSize(const Value& other) const;
     size_t getSize() const;
+    const int* getData() const;
+    ArrayView view() const;
     operator std::string() const;
     Value& operator=(const Value& other);
-    Value operator+(const Value& other);
-    Value operator-(const Value& other);
-    Value operator*(const Value& other);
-    Value operator/(const Value& other);
+    Value& operator=(Value&& other);
+    Value operator+(const Value& other) const;
+    Value operator-(const Value& other) const;
+    Value operator*(const Value& other) const;
+    Value operator/(const Value& other) const;
+    Value operator%(const Value& other) const;
+    Value operator&(const Value& other) const;
+    Value operator|(const Value& other) const;
+    Value operator^(const Value& other) const;
+    Value operator<<(const Value& other) const;
+    Value operator>>(const Value& other) const;
     bool operator==(const Value& other) const;
     bool operator!=(const Value& other) const;
     bool operator<(const Value& other) const;
     bool operator<=(const Value& other) const;
     bool operator>(const Value& other) const;
     bool operator>=(const Value& other) const;
-    std::variant<std::vector<int>, DynamicArray> value;
+    std::variant<DynamicArray, ArraySlice> value;
     size_t minimum;
 };
@@ -0,0 +1,54 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compiler/bytecode.h"
+#include "runtime/interpreter.h"
+#include "runtime/memo.h"
+#include "runtime/value.h"
+
+// Calls between compiled functions push frames onto a call stack on the
+// heap rather than recursing, so recursion depth is bounded by `maxDepth`
+// instead of the native stack.
+class VirtualMachine {
+ public:
+    static constexpr size_t DEFAULT_MAX_DEPTH = 1000000;
+
+    VirtualMachine(const Program& program, std::shared_ptr<Scope> globals,
+                   size_t maxDepth = DEFAULT_MAX_DEPTH);
+    Value call(const std::string& name, std::vector<Value> args);
+
+ private:
+    struct Frame {
+        const Chunk* chunk = nullptr;
+        std::vector<Value> registers;
+        // Which registers FILL has written since their last FORGET.
+        std::vector<bool> filled;
+        size_t pc = 0;
+        bool flag = false;
+        // Caller register that receives the return value.
+        uint32_t result = NO_REGISTER;
+        // Where the value returned goes when the call was to a memo fn, and
+        // the key for its arguments.
+        MemoCache* memo = nullptr;
+        MemoKey memoKey;
+    };
+
+    void enter(Frame& frame, const Chunk& chunk, std::vector<Value>& args);
+    void push(const Chunk& chunk, std::vector<Value>& args, uint32_t result);
+    Value run();
+
+    const Program& program;
+    std::shared_ptr<Scope> globals;
+    size_t maxDepth;
+    // Only the first `depth` frames are active. Returning keeps a frame and
+    // its register storage for the next call at that depth, and arguments
+    // are gathered into one reused vector, so warm calls don't allocate.
+    std::vector<Frame> frames;
+    size_t depth = 0;
+    std::vector<Value> arguments;
+};
@@ -0,0 +1,54 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that are made together and live about as long
+// as each other. Nothing is freed until the arena itself is destroyed.
+class Arena {
+ public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+
+ private:
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* cursor = nullptr;
+    char* end = nullptr;
+};
+
+// Every allocation shares ownership of the arena, so objects made with
+// allocate_shared keep it alive for as long as any of them is.
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    explicit ArenaAllocator(std::shared_ptr<Arena> arena)
+        : arena(std::move(arena)) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)  // NOLINT(runtime/explicit)
+        : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+
+    std::shared_ptr<Arena> arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena != b.arena;
+}
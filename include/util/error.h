@@ -4,13 +4,14 @@
 
 #include <exception>
 #include <string>
+#include <string_view>
 
 class UnexpectedTokenError : public std::exception {
     std::string message;
 
  public:
     UnexpectedTokenError(const std::string& source,
-                         const std::string& unexpected,
+                         std::string_view unexpected,
                          const std::string& expected);
     const char* what() const noexcept override;
 };
@@ -2,6 +2,120 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <vector>
 
-std::string readCode(const std::string& path);
+// Read-only contents of a whole file. Where the platform allows, the file is
+// memory-mapped, so pages are only read in as they are touched and belong to
+// the page cache rather than the process; elsewhere it is read into memory.
+class MappedFile {
+ public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view contents() const;
+
+ private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::string buffer;
+};
+
+// Sequential reader that keeps up to READ_AHEAD blocks of the file loaded
+// ahead of the consumer on a background thread, so reading overlaps with
+// whatever is done with the previous block.
+class ChunkReader {
+ public:
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+    static constexpr size_t READ_AHEAD = 2;
+
+    explicit ChunkReader(const std::string& path);
+    ~ChunkReader();
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    // Up to `limit` of the next bytes, valid until the next call; empty at
+    // the end of the file.
+    std::string_view next(size_t limit);
+
+ private:
+    void readAhead();
+
+    std::string path;
+    std::ifstream file;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> ready;
+    std::vector<std::string> spare;
+    std::string current;
+    size_t offset = 0;
+    bool finished = false;
+    bool failed = false;
+    bool stopping = false;
+    std::thread thread;
+};
+
+// Collects output in memory and hands it to the file in writes of up to
+// `capacity` bytes. Safe to write to from several threads; each write lands
+// in one piece.
+class BufferedOutput {
+ public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    // Opens `path` for writing, truncating it or appending to it.
+    static std::unique_ptr<BufferedOutput> open(const std::string& path,
+                                                bool append, size_t capacity);
+    // Writes to a stream it doesn't own, such as stdout. `lineBuffered`
+    // also writes out every write that contains a newline, as suits a
+    // terminal.
+    BufferedOutput(std::FILE* file, size_t capacity, bool lineBuffered);
+    // Hands each block to `sink` instead, in order and one at a time.
+    BufferedOutput(std::function<void(std::string_view)> sink,
+                   size_t capacity);
+    ~BufferedOutput();
+    BufferedOutput(const BufferedOutput&) = delete;
+    BufferedOutput& operator=(const BufferedOutput&) = delete;
+
+    // Writes the low byte of each value.
+    void write(const int* values, size_t size);
+    void write(std::string_view bytes);
+    void flush();
+    void setCapacity(size_t capacity);
+
+ private:
+    BufferedOutput(std::FILE* file, bool owned, size_t capacity,
+                   bool lineBuffered);
+    template <typename Element>
+    void append(const Element* values, size_t size);
+    void drain();
+
+    std::FILE* file;
+    std::function<void(std::string_view)> sink;
+    bool owned;
+    bool lineBuffered;
+    std::mutex mutex;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+// Maps the whole of `path` copy-on-write, so the pages can be written to
+// without touching the file, and sets `size` to its length. Returns null
+// where mapping isn't possible (empty or special files, or platforms
+// without mmap), in which case the caller reads the file instead.
+char* mapFile(const std::string& path, size_t& size);
+// Releases a mapping of `mapped` bytes made by mapFile given any address in
+// its first page.
+void unmapFile(void* address, size_t mapped);
@@ -0,0 +1,70 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Small blocks are carved out of large chunks and recycled through free
+// lists kept per thread and per size, so objects that live for one call,
+// such as frames and their values, stop reaching the heap once the first
+// calls have returned. Chunks are never handed back; a block freed on a
+// different thread joins that thread's lists instead.
+void* poolAllocate(size_t size);
+void poolDeallocate(void* block, size_t size);
+// Times the interpreter has asked the heap for memory so far, on every
+// thread: the pool's chunks and the blocks too large for it, and the
+// elements of long arrays. Allocations made any other way, such as those of
+// a program embedding libints, are not counted.
+size_t heapAllocations();
+// Bytes of those requests since countHeapBytes() was first called.
+// Counting them is off by default to keep each request to one atomic add.
+void countHeapBytes();
+size_t heapBytes();
+// Storage for the elements of long arrays, counted as above. A
+// `zeroed` block reads as zeros; any other holds whatever was there before,
+// for results that are written in full straight away. Blocks of at least
+// LARGE_BLOCK bytes are mapped on their own and never touched here, so each
+// page lands on the NUMA node of the thread that first writes it, which for
+// the parallel kernels is the worker that goes on to use it. Those that
+// aren't zeroed ask for transparent huge pages, and on hosts with one node a
+// few freed ones are kept for the next block of the same size, so a loop
+// that makes large results stops faulting in fresh pages. Blocks are freed
+// with the size they were allocated with.
+constexpr size_t LARGE_BLOCK = 2 << 20;
+void* allocateElements(size_t size, bool zeroed);
+void freeElements(void* block, size_t size);
+
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}  // NOLINT(runtime/explicit)
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(poolAllocate(n * sizeof(T)));
+    }
+    void deallocate(T* block, size_t n) {
+        poolDeallocate(block, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return false;
+}
+
+// make_shared with the object and its reference counts in one pool block.
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(),
+                                   std::forward<Args>(args)...);
+}
@@ -0,0 +1,50 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Neither side ever waits on the other: push fails when
+// the queue is full and pop when it is empty. Each side keeps a stale copy
+// of the other's index and only reloads it when the copy says it must, so
+// the shared indices stay on their own cache lines most of the time.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+ public:
+    // Producer only. Moves from `item` only when there was room for it.
+    bool push(T& item) {
+        size_t next = tail.load(std::memory_order_relaxed);
+        if (next - headCache == Capacity) {
+            headCache = head.load(std::memory_order_acquire);
+            if (next - headCache == Capacity) return false;
+        }
+        slots[next & (Capacity - 1)] = std::move(item);
+        tail.store(next + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    bool pop(T& item) {
+        size_t next = head.load(std::memory_order_relaxed);
+        if (next == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (next == tailCache) return false;
+        }
+        item = std::move(slots[next & (Capacity - 1)]);
+        head.store(next + 1, std::memory_order_release);
+        return true;
+    }
+
+ private:
+    alignas(64) std::atomic<size_t> head{0};
+    size_t tailCache = 0;
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t headCache = 0;
+    alignas(64) T slots[Capacity];
+};
@@ -0,0 +1,44 @@
+// Copyright 2025 Caden Crowson
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Keys read from stdin. When stdin is a terminal it is switched to
+// unbuffered, unechoed input the first time a key is read, and stays that
+// way until the program exits or a signal ends it, when the original
+// settings are put back. Keys typed between reads wait in the terminal
+// rather than being echoed, and are read in batches.
+
+// Blocks until a key arrives. -1 at the end of input.
+int readKey();
+// The next key if one has arrived, without blocking.
+std::optional<int> pollKey();
+
+// Full-screen output. These append ANSI escape sequences to `out` for the
+// caller to write to stdout. Windows consoles too old for escapes are
+// driven through the console API instead, which writes `out` first, so
+// stdout must be flushed before the call and `out` written right after.
+void clearScreen(std::string& out);
+// Columns and rows count from 0 at the top left.
+void moveCursor(std::string& out, size_t column, size_t row);
+
+// What the last frame drawn left on screen, so that each new frame only
+// rewrites the cells that changed. A frame of a new size clears the screen
+// and starts over.
+class TerminalScreen {
+ public:
+    // Each cell is one byte, row by row, `width` to a row.
+    void draw(std::string& out, const int* cells, size_t count,
+              size_t width);
+    // The screen has been cleared by other means.
+    void cleared();
+
+ private:
+    std::vector<char> shown;
+    size_t width = 0;
+    bool blank = false;
+};
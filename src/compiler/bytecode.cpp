@@ -0,0 +1,43 @@
+// Copyright 2025 Caden Crowson
+
+#include "compiler/bytecode.h"
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+uint32_t Program::functionSlot(const std::string& name) {
+    auto found = functionIndices.find(name);
+    if (found != functionIndices.end()) return found->second;
+    uint32_t slot = static_cast<uint32_t>(functions.size());
+    functions.push_back(FunctionSlot{name, std::nullopt, std::nullopt});
+    functionIndices.emplace(name, slot);
+    return slot;
+}
+
+void Program::define(Chunk chunk) {
+    uint32_t slot = functionSlot(chunk.name);
+    functions[slot].chunk = chunks.size();
+    chunks.push_back(std::move(chunk));
+}
+
+void Program::link() {
+    for (auto& function : functions)
+        if (!function.chunk.has_value())
+            function.builtin = builtinFunctionFromName(function.name);
+}
+
+const Chunk& Program::getChunk(size_t index) const { return chunks[index]; }
+
+const FunctionSlot& Program::getFunction(uint32_t slot) const {
+    return functions[slot];
+}
+
+std::optional<uint32_t> Program::findFunction(const std::string& name) const {
+    auto found = functionIndices.find(name);
+    if (found == functionIndices.end() ||
+        !functions[found->second].chunk.has_value())
+        return std::nullopt;
+    return found->second;
+}
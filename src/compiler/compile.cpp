@@ -0,0 +1,545 @@
+// Copyright 2025 Caden Crowson
+
+#include "compiler/compile.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "runtime/builtins.h"
+#include "runtime/memo.h"
+
+namespace {
+
+class FunctionCompiler {
+ public:
+    FunctionCompiler(Program& program, Chunk& chunk)
+        : program(program), chunk(chunk) {}
+
+    void compile(const FunctionDefinitionNode& function) {
+        beginBlock();
+        for (auto& param : function.getParams()) {
+            chunk.params.push_back(param->getDescriptor());
+            declare(param->getIdentifier(), allocate());
+        }
+        compileBody(function.getBody());
+        emit(OpCode::RETURN_EMPTY);
+        endBlock();
+    }
+
+ private:
+    uint32_t allocate() {
+        uint32_t reg = top++;
+        if (top > chunk.numRegisters) chunk.numRegisters = top;
+        return reg;
+    }
+
+    size_t emit(OpCode op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) {
+        chunk.code.push_back(Instruction{op, a, b, c});
+        return chunk.code.size() - 1;
+    }
+
+    void patch(size_t jump) {
+        chunk.code[jump].a = static_cast<uint32_t>(chunk.code.size());
+    }
+
+    uint32_t addName(const std::string& name) {
+        chunk.names.push_back(name);
+        return static_cast<uint32_t>(chunk.names.size() - 1);
+    }
+
+    uint32_t addDescriptor(const ArrayDescriptor& descriptor) {
+        chunk.descriptors.push_back(descriptor);
+        return static_cast<uint32_t>(chunk.descriptors.size() - 1);
+    }
+
+    uint32_t addRegisterList(const std::vector<uint32_t>& registers) {
+        uint32_t offset = static_cast<uint32_t>(chunk.registerLists.size());
+        chunk.registerLists.push_back(static_cast<uint32_t>(registers.size()));
+        chunk.registerLists.insert(chunk.registerLists.end(),
+                                   registers.begin(), registers.end());
+        return offset;
+    }
+
+    void beginBlock() { blocks.push_back({{}, top}); }
+
+    void endBlock() {
+        top = blocks.back().mark;
+        blocks.pop_back();
+    }
+
+    void declare(const std::string& name, uint32_t reg) {
+        blocks.back().locals[name] = reg;
+    }
+
+    std::optional<uint32_t> resolve(const std::string& name) const {
+        for (auto block = blocks.rbegin(); block != blocks.rend(); ++block) {
+            auto found = block->locals.find(name);
+            if (found != block->locals.end()) return found->second;
+        }
+        return std::nullopt;
+    }
+
+    // A TAIL_CALL returns, so the register it is given is never written.
+    uint32_t compileFunctionCall(const FunctionCallNode& functionCall,
+                                 OpCode op = OpCode::CALL) {
+        if (functionCall.getBuiltin() == BuiltinFunction::SPAWN) {
+            uint32_t dst = compileSpawn(functionCall);
+            if (op == OpCode::TAIL_CALL) emit(OpCode::RETURN, dst);
+            return dst;
+        }
+        std::vector<uint32_t> arguments;
+        for (auto& parameter : functionCall.getParameters())
+            arguments.push_back(compileExpression(parameter));
+        uint32_t dst = allocate();
+        emit(op, dst,
+             program.functionSlot(functionCall.getIdentifier()),
+             addRegisterList(arguments));
+        return dst;
+    }
+
+    uint32_t compileSpawn(const FunctionCallNode& spawn) {
+        auto& parameters = spawn.getParameters();
+        std::vector<uint32_t> arguments;
+        for (size_t i = 1; i < parameters.size(); i++)
+            arguments.push_back(compileExpression(parameters[i]));
+        uint32_t dst = allocate();
+        emit(OpCode::SPAWN, dst, program.functionSlot(*spawnedName(spawn)),
+             addRegisterList(arguments));
+        return dst;
+    }
+
+    uint32_t compileArray(const ArrayNode& array) {
+        return std::visit(
+            [this, &array](auto&& arg) -> uint32_t {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
+                constexpr bool isString = std::is_same_v<T, std::string>;
+                constexpr bool isFunctionCall =
+                    std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                if constexpr (isVector) {
+                    // Short constants fit inline, so loading them is free of
+                    // allocation, and longer ones share the literal's value.
+                    if (auto& literal = array.getLiteral()) {
+                        chunk.constants.push_back(
+                            Value::slice(literal, 0, arg.size()));
+                    } else {
+                        DynamicArray constant(arg.size());
+                        std::copy(arg.begin(), arg.end(), constant.data);
+                        chunk.constants.emplace_back(std::move(constant),
+                                                     arg.size());
+                    }
+                    uint32_t dst = allocate();
+                    emit(OpCode::LOAD_CONST, dst,
+                         static_cast<uint32_t>(chunk.constants.size() - 1));
+                    return dst;
+                } else if constexpr (isString) {
+                    if (auto local = resolve(arg)) return local.value();
+                    uint32_t dst = allocate();
+                    emit(OpCode::LOAD_GLOBAL, dst, addName(arg));
+                    return dst;
+                } else if constexpr (isFunctionCall) {
+                    return compileFunctionCall(*arg);
+                }
+            },
+            array.getValue());
+    }
+
+    uint32_t compileArithmetic(const ArithmeticNode& arithmetic) {
+        uint32_t left = compileExpression(arithmetic.left);
+        uint32_t right = compileExpression(arithmetic.right);
+        OpCode op;
+        switch (arithmetic.type) {
+            case ArithmeticNode::TYPE_ADDITION:
+                op = OpCode::ADD;
+                break;
+            case ArithmeticNode::TYPE_SUBTRACTION:
+                op = OpCode::SUB;
+                break;
+            case ArithmeticNode::TYPE_MULTIPLICATION:
+                op = OpCode::MUL;
+                break;
+            case ArithmeticNode::TYPE_DIVISION:
+                op = OpCode::DIV;
+                break;
+            case ArithmeticNode::TYPE_MODULO:
+                op = OpCode::MOD;
+                break;
+            case ArithmeticNode::TYPE_AND:
+                op = OpCode::AND;
+                break;
+            case ArithmeticNode::TYPE_OR:
+                op = OpCode::OR;
+                break;
+            case ArithmeticNode::TYPE_XOR:
+                op = OpCode::XOR;
+                break;
+            case ArithmeticNode::TYPE_SHIFT_LEFT:
+                op = OpCode::SHL;
+                break;
+            case ArithmeticNode::TYPE_SHIFT_RIGHT:
+                op = OpCode::SHR;
+                break;
+            default:
+                throw std::runtime_error("Error compiling arithmetic");
+        }
+        uint32_t dst = allocate();
+        emit(op, dst, left, right);
+        return dst;
+    }
+
+    SliceBound compileSliceBound(
+        const std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>&
+            bound) {
+        if (!bound.has_value()) return SliceBound{SliceBound::NONE, 0};
+        return std::visit(
+            [this](auto&& value) -> SliceBound {
+                using T = std::decay_t<decltype(value)>;
+                constexpr bool isSizeT = std::is_same_v<T, size_t>;
+                constexpr bool isExpression =
+                    std::is_same_v<T, std::shared_ptr<ExpressionNode>>;
+                if constexpr (isSizeT) {
+                    return SliceBound{SliceBound::CONSTANT, value};
+                } else if constexpr (isExpression) {
+                    return SliceBound{SliceBound::REGISTER,
+                                      compileExpression(value)};
+                }
+            },
+            bound.value());
+    }
+
+    // Operands are copied out when the instruction runs, so `dst` may be the
+    // receiver itself, in which case the VM updates it in place.
+    uint32_t compileMethod(uint32_t self, const MethodNode& methodNode,
+                           uint32_t dst) {
+        auto& method = methodNode.getBuiltin();
+        if (!method.has_value())
+            throw std::runtime_error("Unknown method " +
+                                     methodNode.getIdentifier());
+        std::vector<uint32_t> operands = {self};
+        for (auto& parameter : methodNode.getParameters())
+            operands.push_back(compileExpression(parameter));
+        emit(OpCode::CALL_METHOD, dst, static_cast<uint32_t>(method.value()),
+             addRegisterList(operands));
+        return dst;
+    }
+
+    uint32_t compilePostfix(uint32_t value, const ArrayPostFixNode& postfix) {
+        for (auto& step : postfix.getValues()) {
+            value = std::visit(
+                [this, value](auto&& arg) -> uint32_t {
+                    using T = std::decay_t<decltype(arg)>;
+                    constexpr bool isArrayRange =
+                        std::is_same_v<T, std::shared_ptr<ArrayRangeNode>>;
+                    constexpr bool isMethod =
+                        std::is_same_v<T, std::shared_ptr<MethodNode>>;
+                    if constexpr (isArrayRange) {
+                        uint32_t slice = compileSlice(*arg);
+                        uint32_t dst = allocate();
+                        emit(OpCode::SLICE, dst, value, slice);
+                        return dst;
+                    } else if constexpr (isMethod) {
+                        return compileMethod(value, *arg, allocate());
+                    }
+                },
+                step);
+        }
+        return value;
+    }
+
+    uint32_t compileExpression(const std::shared_ptr<ExpressionNode>& expression) {
+        if (auto& slot = expression->getHoistedSlot()) {
+            auto cache = hoisted.find(slot->index);
+            if (cache != hoisted.end())
+                return compileHoisted(expression, cache->second);
+        }
+        return compileValue(expression);
+    }
+
+    // An expression hoisted out of a loop is only evaluated while the
+    // register kept for it is empty.
+    uint32_t compileHoisted(const std::shared_ptr<ExpressionNode>& expression,
+                            uint32_t cache) {
+        size_t filled = emit(OpCode::JUMP_IF_FILLED, 0, cache);
+        uint32_t value = compileValue(expression);
+        emit(OpCode::FILL, cache, value);
+        patch(filled);
+        return cache;
+    }
+
+    // Gives each expression hoisted out of a loop a register for the whole
+    // loop, emptied as it starts.
+    void forgetHoisted(const std::vector<size_t>& slots) {
+        for (size_t slot : slots) {
+            uint32_t cache = allocate();
+            hoisted[slot] = cache;
+            emit(OpCode::FORGET, cache);
+        }
+    }
+
+    uint32_t compileValue(const std::shared_ptr<ExpressionNode>& expression) {
+        uint32_t value = std::visit(
+            [this](auto&& arg) -> uint32_t {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isArithmetic =
+                    std::is_same_v<T, std::shared_ptr<ArithmeticNode>>;
+                constexpr bool isArray =
+                    std::is_same_v<T, std::shared_ptr<ArrayNode>>;
+                if constexpr (isArithmetic) {
+                    return compileArithmetic(*arg);
+                } else if constexpr (isArray) {
+                    return compileArray(*arg);
+                }
+            },
+            expression->getPrimary());
+        return compilePostfix(value, expression->getPostfix());
+    }
+
+    void compileVariableDeclaration(
+        const VariableDeclarationNode& declaration,
+        OpCode op = OpCode::DECLARE) {
+        uint32_t local = allocate();
+        uint32_t source = NO_REGISTER;
+        if (declaration.getValue().has_value())
+            source = compileExpression(declaration.getValue().value());
+        emit(op, local, addDescriptor(declaration.getDescriptor()), source);
+        declare(declaration.getIdentifier(), local);
+    }
+
+    // `x = x.method(...)` on a local is compiled to update x in place.
+    bool compileSelfMethod(
+        const VariableAssignmentNode& assignment) {
+        auto local = resolve(assignment.getLeft());
+        auto& right = assignment.getRight();
+        auto& postfix = right->getPostfix().getValues();
+        auto array =
+            std::get_if<std::shared_ptr<ArrayNode>>(&right->getPrimary());
+        if (!local.has_value() || array == nullptr || postfix.size() != 1)
+            return false;
+        auto name = std::get_if<std::string>(&(*array)->getValue());
+        auto method = std::get_if<std::shared_ptr<MethodNode>>(&postfix[0]);
+        if (name == nullptr || method == nullptr || resolve(*name) != local)
+            return false;
+        compileMethod(local.value(), **method, local.value());
+        return true;
+    }
+
+    void compileVariableAssignment(const VariableAssignmentNode& assignment) {
+        if (compileSelfMethod(assignment)) return;
+        uint32_t source = compileExpression(assignment.getRight());
+        if (auto local = resolve(assignment.getLeft())) {
+            if (local.value() != source)
+                emit(OpCode::MOVE, local.value(), source);
+        } else {
+            emit(OpCode::STORE_GLOBAL, source, addName(assignment.getLeft()));
+        }
+    }
+
+    // Emits the condition and the jump taken when it fails, to be patched
+    // once its target is known. Comparisons are one compare-and-branch.
+    size_t compileBranch(
+        const std::variant<std::shared_ptr<IfCompareNode>,
+                           std::shared_ptr<IfDeclarationNode>>& condition) {
+        return std::visit(
+            [this](auto&& arg) -> size_t {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isCompare =
+                    std::is_same_v<T, std::shared_ptr<IfCompareNode>>;
+                constexpr bool isDeclaration =
+                    std::is_same_v<T, std::shared_ptr<IfDeclarationNode>>;
+                if constexpr (isCompare) {
+                    uint32_t left = compileExpression(arg->getLeft());
+                    uint32_t right = compileExpression(arg->getRight());
+                    return emit(branchUnless(arg->getType()), 0, left, right);
+                } else if constexpr (isDeclaration) {
+                    compileVariableDeclaration(*arg->getVariableDeclaration(),
+                                               OpCode::DECLARE_IF);
+                    return emit(OpCode::JUMP_IF_FALSE);
+                }
+            },
+            condition);
+    }
+
+    static OpCode branchUnless(IfCompareNode::Type type) {
+        switch (type) {
+            case IfCompareNode::Type::EQ:
+                return OpCode::JUMP_UNLESS_EQ;
+            case IfCompareNode::Type::NE:
+                return OpCode::JUMP_UNLESS_NE;
+            case IfCompareNode::Type::LT:
+                return OpCode::JUMP_UNLESS_LT;
+            case IfCompareNode::Type::LE:
+                return OpCode::JUMP_UNLESS_LE;
+            case IfCompareNode::Type::GT:
+                return OpCode::JUMP_UNLESS_GT;
+            case IfCompareNode::Type::GE:
+                return OpCode::JUMP_UNLESS_GE;
+        }
+        throw std::runtime_error("Error compiling comparison");
+    }
+
+    void compileIf(const IfNode& ifNode) {
+        beginBlock();
+        size_t skipBody = compileBranch(ifNode.getCondition());
+        compileBody(ifNode.getBody());
+        size_t skipElse = emit(OpCode::JUMP);
+        patch(skipBody);
+        if (ifNode.getElseIfBranches().has_value())
+            compileIf(*ifNode.getElseIfBranches().value());
+        if (ifNode.getElseBody().has_value())
+            compileBody(ifNode.getElseBody().value());
+        patch(skipElse);
+        endBlock();
+    }
+
+    void compileWhile(const WhileNode& whileNode) {
+        beginBlock();
+        forgetHoisted(whileNode.getHoistedSlots());
+        uint32_t loop = static_cast<uint32_t>(chunk.code.size());
+        size_t exit = compileBranch(whileNode.getCondition());
+        compileBody(whileNode.getBody());
+        emit(OpCode::JUMP, loop);
+        patch(exit);
+        endBlock();
+    }
+
+    uint32_t compileSlice(const ArrayRangeNode& range) {
+        chunk.slices.push_back(Slice{compileSliceBound(range.getStart()),
+                                     compileSliceBound(range.getEnd())});
+        return static_cast<uint32_t>(chunk.slices.size() - 1);
+    }
+
+    // Whether `range` is still the builtin is only known once the program is
+    // linked, so FOR_RANGE decides between counting and the array the call
+    // returns. Either way the slice's bounds are evaluated after the call.
+    void compileRangeIterable(const ForLoopNode& forLoop,
+                              const FunctionCallNode& range, uint32_t iterable,
+                              uint32_t counter) {
+        std::vector<uint32_t> arguments;
+        for (auto& parameter : range.getParameters())
+            arguments.push_back(compileExpression(parameter));
+        emit(OpCode::FOR_RANGE, iterable,
+             program.functionSlot(range.getIdentifier()),
+             addRegisterList(arguments));
+        size_t called = emit(OpCode::JUMP_IF_FALSE);
+        const ArrayRangeNode* slice = forLoop.getRangeSlice();
+        emit(OpCode::FOR_COUNT, counter, iterable,
+             slice != nullptr ? compileSlice(*slice) : NO_REGISTER);
+        size_t counting = emit(OpCode::JUMP);
+        patch(called);
+        if (slice != nullptr)
+            emit(OpCode::SLICE, iterable, iterable, compileSlice(*slice));
+        emit(OpCode::FOR_INIT, counter);
+        patch(counting);
+    }
+
+    // A pfor runs here as an ordinary loop: accumulating reductions in place
+    // gives the same result as merging per-task partials.
+    void compileForLoop(const ForLoopNode& forLoop) {
+        beginBlock();
+        uint32_t iterable = allocate();
+        uint32_t counter = allocate();
+        forgetHoisted(forLoop.getHoistedSlots());
+        uint32_t mark = top;
+        if (const FunctionCallNode* range = forLoop.getRangeCall()) {
+            compileRangeIterable(forLoop, *range, iterable, counter);
+        } else {
+            uint32_t source = compileExpression(forLoop.getIterable());
+            emit(OpCode::MOVE, iterable, source);
+            emit(OpCode::FOR_INIT, counter);
+        }
+        top = mark;
+        uint32_t element = allocate();
+        declare(forLoop.getElement(), element);
+        uint32_t loop = static_cast<uint32_t>(chunk.code.size());
+        emit(OpCode::FOR_NEXT, element, iterable, counter);
+        size_t exit = emit(OpCode::JUMP_IF_FALSE);
+        compileBody(forLoop.getBody());
+        emit(OpCode::JUMP, loop);
+        patch(exit);
+        endBlock();
+    }
+
+    void compileStatement(const std::shared_ptr<StatementNode>& statement) {
+        uint32_t mark = top;
+        bool declared = false;
+        std::visit(
+            [this, &declared](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVariableBinding =
+                    std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
+                constexpr bool isForLoop =
+                    std::is_same_v<T, std::shared_ptr<ForLoopNode>>;
+                constexpr bool isWhile =
+                    std::is_same_v<T, std::shared_ptr<WhileNode>>;
+                constexpr bool isIfNode =
+                    std::is_same_v<T, std::shared_ptr<IfNode>>;
+                constexpr bool isFunctionCall =
+                    std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                constexpr bool isReturn =
+                    std::is_same_v<T, std::shared_ptr<ReturnNode>>;
+                if constexpr (isVariableBinding) {
+                    auto& binding = arg->getValue();
+                    if (auto declaration = std::get_if<
+                            std::shared_ptr<VariableDeclarationNode>>(&binding)) {
+                        compileVariableDeclaration(**declaration);
+                        declared = true;
+                    } else {
+                        compileVariableAssignment(
+                            *std::get<std::shared_ptr<VariableAssignmentNode>>(
+                                binding));
+                    }
+                } else if constexpr (isForLoop) {
+                    compileForLoop(*arg);
+                } else if constexpr (isWhile) {
+                    compileWhile(*arg);
+                } else if constexpr (isIfNode) {
+                    compileIf(*arg);
+                } else if constexpr (isFunctionCall) {
+                    compileFunctionCall(*arg);
+                } else if constexpr (isReturn) {
+                    if (auto tailCall = arg->getTailCall())
+                        compileFunctionCall(*tailCall, OpCode::TAIL_CALL);
+                    else
+                        emit(OpCode::RETURN,
+                             compileExpression(arg->getValue()));
+                }
+            },
+            statement->getValue());
+        // A declaration keeps the register it allocated first; everything
+        // above it was a temporary of this statement.
+        top = declared ? mark + 1 : mark;
+    }
+
+    void compileBody(const std::shared_ptr<BodyNode>& body) {
+        for (auto& statement : body->getStatements()) compileStatement(statement);
+    }
+
+    struct Block {
+        std::unordered_map<std::string, uint32_t> locals;
+        uint32_t mark;
+    };
+
+    Program& program;
+    Chunk& chunk;
+    std::vector<Block> blocks;
+    uint32_t top = 0;
+    // Registers of the hoisted expressions, by their slot.
+    std::unordered_map<size_t, uint32_t> hoisted;
+};
+
+}  // namespace
+
+void compileFunction(const std::shared_ptr<FunctionDefinitionNode>& function,
+                     Program& program) {
+    Chunk chunk;
+    chunk.name = function->getIdentifier();
+    if (function->isMemoized()) chunk.memo = &memoCache(*function);
+    FunctionCompiler(program, chunk).compile(*function);
+    program.define(std::move(chunk));
+}
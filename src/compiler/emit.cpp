@@ -0,0 +1,1112 @@
+// Copyright 2025 Caden Crowson
+
+#include "compiler/emit.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "parser/loader.h"
+#include "parser/parse.h"
+#include "runtime/builtins.h"
+
+namespace {
+
+using TopLevel = std::variant<std::shared_ptr<VariableBindingNode>,
+                              std::shared_ptr<FunctionDefinitionNode>>;
+
+// What each name is bound to: the C++ function a function name calls, or
+// membership of the globals holding arrays.
+struct Bindings {
+    std::unordered_map<std::string, std::string> functions;
+    std::unordered_set<std::string> globals;
+};
+
+// The C++ functions: how many parameters each takes, and which of them
+// leave tail calls to other functions for their callers to run.
+struct Functions {
+    std::unordered_map<std::string, size_t> params;
+    std::unordered_set<std::string> tailCalling;
+};
+
+std::string cppName(const std::string& name) {
+    std::string result;
+    for (char c : name)
+        result += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    return result;
+}
+
+std::string quoted(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + '"';
+}
+
+std::string unsupported(const std::string& what) {
+    return "--emit-cpp does not support " + what;
+}
+
+std::string descriptorArguments(const ArrayDescriptor& descriptor) {
+    std::string size = descriptor.getSize().has_value()
+                           ? std::to_string(descriptor.getSize().value())
+                           : "std::nullopt";
+    return size + ", " + (descriptor.getCanGrow() ? "true" : "false");
+}
+
+const char* compareOperator(IfCompareNode::Type type) {
+    switch (type) {
+        case IfCompareNode::Type::EQ:
+            return " == ";
+        case IfCompareNode::Type::NE:
+            return " != ";
+        case IfCompareNode::Type::LT:
+            return " < ";
+        case IfCompareNode::Type::LE:
+            return " <= ";
+        case IfCompareNode::Type::GT:
+            return " > ";
+        case IfCompareNode::Type::GE:
+            return " >= ";
+    }
+    return " == ";
+}
+
+const char* reductionType(ReductionNode::Type type) {
+    switch (type) {
+        case ReductionNode::TYPE_ADD:
+            return "ReductionNode::TYPE_ADD";
+        case ReductionNode::TYPE_MULTIPLY:
+            return "ReductionNode::TYPE_MULTIPLY";
+        case ReductionNode::TYPE_APPEND:
+            return "ReductionNode::TYPE_APPEND";
+    }
+    return "ReductionNode::TYPE_ADD";
+}
+
+// Shared by every function: the literals and builtins the code refers to,
+// each emitted once at namespace scope.
+class Shared {
+ public:
+    std::string literal(const std::vector<int>& elements) {
+        auto found = literals.find(elements);
+        if (found != literals.end()) return found->second;
+        std::string name = "l" + std::to_string(literals.size());
+        std::string list;
+        for (int element : elements) {
+            if (!list.empty()) list += ", ";
+            list += element == INT_MIN ? "INT_MIN" : std::to_string(element);
+        }
+        declarations << "const Value " << name << " = nativeLiteral({" << list
+                     << "});\n";
+        literals.emplace(elements, name);
+        return name;
+    }
+
+    std::string function(const std::string& builtin) {
+        return builtinName("bf_", "BuiltinFunction", "nativeBuiltinFunction",
+                           builtin);
+    }
+
+    std::string method(const std::string& builtin) {
+        return builtinName("bm_", "BuiltinMethod", "nativeBuiltinMethod",
+                           builtin);
+    }
+
+    // What spawn runs `function`, of `params` parameters, through.
+    std::string task(const std::string& function, size_t params) {
+        std::string name = "task_" + function;
+        if (!tasks.insert(name).second) return name;
+        declarations << "Value " << name
+                     << "(std::vector<Value>& arguments) {\n"
+                     << "    return nativeFinish(" << function << "(";
+        for (size_t param = 0; param < params; param++)
+            declarations << (param == 0 ? "" : ", ") << "std::move(arguments["
+                         << param << "])";
+        declarations << "));\n}\n";
+        return name;
+    }
+
+    std::string text() const { return declarations.str(); }
+
+ private:
+    std::string builtinName(const std::string& prefix, const char* type,
+                            const char* lookup, const std::string& builtin) {
+        std::string name = prefix + cppName(builtin);
+        if (builtins.insert(name).second)
+            declarations << "const " << type << " " << name << " = " << lookup
+                         << "(" << quoted(builtin) << ");\n";
+        return name;
+    }
+
+    std::map<std::vector<int>, std::string> literals;
+    std::unordered_set<std::string> builtins;
+    std::unordered_set<std::string> tasks;
+    std::ostringstream declarations;
+};
+
+// A value an emitted expression left behind: a temporary the code owns and
+// may move from, or anything else, such as a variable, that it may only
+// read.
+struct Operand {
+    std::string code;
+    bool owned;
+};
+
+// Emits the statements of one function, or of the top level of the
+// program, which has no frame. Every expression that does any work is
+// evaluated into a temporary of its own, in the order the walker evaluates
+// it, so calls, output and errors all happen in the same order.
+class BodyEmitter {
+ public:
+    BodyEmitter(Shared& shared, const Bindings& bindings,
+                const Functions& functions, std::string self)
+        : shared(shared),
+          bindings(bindings),
+          functions(functions),
+          self(std::move(self)) {}
+
+    std::string function(const FunctionDefinitionNode& function) {
+        auto& params = function.getParams();
+        // A memo fn's name is taken by the call through its cache.
+        std::string signature = std::string("Value ") +
+                                (function.isMemoized() ? "memo_" : "") + self +
+                                "(";
+        scopes.emplace_back();
+        depth = 1;
+        for (size_t i = 0; i < params.size(); i++) {
+            std::string param = "p" + std::to_string(i);
+            signature += (i == 0 ? "Value " : ", Value ") + param;
+            line("Value " + declare(i, params[i]->getIdentifier()) +
+                 " = Value::fromDescriptor(" +
+                 descriptorArguments(params[i]->getDescriptor()) +
+                 ", std::move(" + param + "));");
+        }
+        auto& statements = function.getBody()->getStatements();
+        body(*function.getBody());
+        if (statements.empty() ||
+            !std::holds_alternative<std::shared_ptr<ReturnNode>>(
+                statements.back()->getValue()))
+            line("return nativeNothing();");
+        // A body that ends in a self tail call never reaches its end, which
+        // the compiler can't tell from the jump.
+        if (jumped) line("nativeError(\"Unreachable\");");
+        scopes.pop_back();
+        std::string text = signature + ") {\n";
+        if (tailCalls) text += "start:\n";
+        return text + code.str() + "}\n";
+    }
+
+    // Top-level statements run in order inside initialize().
+    void topLevel(const VariableBindingNode& binding) {
+        depth = 1;
+        this->binding(binding);
+    }
+
+    std::string text() const { return code.str(); }
+
+ private:
+    void line(const std::string& text) {
+        code << std::string(depth * 4, ' ') << text << '\n';
+        jumped = false;
+    }
+
+    void open(const std::string& text) {
+        line(text);
+        depth++;
+    }
+
+    void close(const std::string& text = "}") {
+        depth--;
+        line(text);
+    }
+
+    void reopen(const std::string& text) {
+        close(text);
+        depth++;
+    }
+
+    std::string fresh(const std::string& prefix) {
+        return prefix + std::to_string(next++);
+    }
+
+    std::string declare(size_t slot, const std::string& name) {
+        std::string variable = fresh("v_" + cppName(name) + "_");
+        scopes.back()[slot] = variable;
+        return variable;
+    }
+
+    const std::string* variable(const std::optional<VariableSlot>& slot) {
+        if (!slot.has_value()) return nullptr;
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto found = scope->find(slot->index);
+            if (found != scope->end()) return &found->second;
+        }
+        return nullptr;
+    }
+
+    Operand temporary(const std::string& value) {
+        std::string name = fresh("t");
+        line("Value " + name + " = " + value + ";");
+        return Operand{name, true};
+    }
+
+    Operand error(const std::string& message) {
+        return temporary("nativeError(" + quoted(message) + ")");
+    }
+
+    static std::string take(const Operand& operand) {
+        return operand.owned ? "std::move(" + operand.code + ")"
+                             : operand.code;
+    }
+
+    std::string arguments(
+        const std::vector<std::shared_ptr<ExpressionNode>>& parameters) {
+        std::vector<Operand> values;
+        for (auto& parameter : parameters)
+            values.push_back(expression(*parameter));
+        std::string list;
+        for (auto& value : values) list += ", " + take(value);
+        return list;
+    }
+
+    void body(const BodyNode& body) {
+        for (auto& statement : body.getStatements())
+            this->statement(*statement);
+    }
+
+    void scopedBody(const BodyNode& body) {
+        scopes.emplace_back();
+        this->body(body);
+        scopes.pop_back();
+    }
+
+    void statement(const StatementNode& statement) {
+        std::visit(
+            [this](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVariableBinding =
+                    std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
+                constexpr bool isForLoop =
+                    std::is_same_v<T, std::shared_ptr<ForLoopNode>>;
+                constexpr bool isWhile =
+                    std::is_same_v<T, std::shared_ptr<WhileNode>>;
+                constexpr bool isIfNode =
+                    std::is_same_v<T, std::shared_ptr<IfNode>>;
+                constexpr bool isFunctionCall =
+                    std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                constexpr bool isReturn =
+                    std::is_same_v<T, std::shared_ptr<ReturnNode>>;
+                if constexpr (isVariableBinding) {
+                    binding(*arg);
+                } else if constexpr (isForLoop) {
+                    forLoop(*arg);
+                } else if constexpr (isWhile) {
+                    whileLoop(*arg);
+                } else if constexpr (isIfNode) {
+                    ifChain(*arg);
+                } else if constexpr (isFunctionCall) {
+                    line(call(*arg) + ";");
+                } else if constexpr (isReturn) {
+                    returnStatement(*arg);
+                }
+            },
+            statement.getValue());
+    }
+
+    // A declaration that isn't the first of its slot in the current block
+    // replaces the variable, as it does in the walker.
+    void declaration(const VariableDeclarationNode& declaration,
+                     const std::string& value) {
+        if (!declaration.getSlot().has_value()) {
+            std::string global = "g_" + cppName(declaration.getIdentifier());
+            line(global + ".emplace(" + value + ");");
+            return;
+        }
+        size_t slot = declaration.getSlot()->index;
+        auto found = scopes.back().find(slot);
+        if (found != scopes.back().end())
+            line(found->second + ".replace(" + value + ");");
+        else
+            line("Value " + declare(slot, declaration.getIdentifier()) +
+                 " = " + value + ";");
+    }
+
+    std::string declaredValue(const VariableDeclarationNode& declaration,
+                              const std::optional<Operand>& value) {
+        return "Value::fromDescriptor(" +
+               descriptorArguments(declaration.getDescriptor()) + ", " +
+               (value.has_value() ? take(value.value()) : "std::nullopt") +
+               ")";
+    }
+
+    void binding(const VariableBindingNode& binding) {
+        if (auto declaration =
+                std::get_if<std::shared_ptr<VariableDeclarationNode>>(
+                    &binding.getValue())) {
+            std::optional<Operand> value;
+            if ((*declaration)->getValue().has_value())
+                value = expression(*(*declaration)->getValue().value());
+            this->declaration(**declaration,
+                              declaredValue(**declaration, value));
+            return;
+        }
+        assignment(*std::get<std::shared_ptr<VariableAssignmentNode>>(
+            binding.getValue()));
+    }
+
+    // Matches `x = x.append(...)` or `x = x.put(...)` on a local, like the
+    // walker does.
+    static const MethodNode* selfUpdate(
+        const VariableAssignmentNode& assignment) {
+        auto& right = assignment.getRight();
+        auto& postfix = right->getPostfix().getValues();
+        auto array =
+            std::get_if<std::shared_ptr<ArrayNode>>(&right->getPrimary());
+        if (array == nullptr || postfix.size() != 1) return nullptr;
+        auto& slot = (*array)->getSlot();
+        if (!slot.has_value() || slot->index != assignment.getSlot()->index)
+            return nullptr;
+        auto method = std::get_if<std::shared_ptr<MethodNode>>(&postfix[0]);
+        if (method == nullptr ||
+            ((*method)->getBuiltin() != BuiltinMethod::APPEND &&
+             (*method)->getBuiltin() != BuiltinMethod::PUT))
+            return nullptr;
+        return method->get();
+    }
+
+    void assignment(const VariableAssignmentNode& assignment) {
+        auto& name = assignment.getLeft();
+        auto undefined = quoted(name + " has not been defined");
+        if (assignment.getSlot().has_value()) {
+            const std::string* target = variable(assignment.getSlot());
+            if (target == nullptr) {
+                line("nativeError(" + undefined + ");");
+                return;
+            }
+            std::string variable = *target;
+            if (auto update = selfUpdate(assignment)) {
+                line("nativeMethodInPlace(" +
+                     shared.method(update->getIdentifier()) + ", " + variable +
+                     arguments(update->getParameters()) + ");");
+                return;
+            }
+            Operand value = expression(*assignment.getRight());
+            line(variable + ".replace(" +
+                 (value.owned ? take(value) : "Value(" + value.code + ")") +
+                 ");");
+            return;
+        }
+        if (bindings.functions.count(name) != 0)
+            throw std::runtime_error(
+                unsupported("assigning to " + name + ", a function"));
+        if (bindings.globals.count(name) == 0) {
+            line("nativeError(" + undefined + ");");
+            return;
+        }
+        std::string global = "g_" + cppName(name);
+        line("nativeCheckDefined(" + global + ", " + quoted(name) + ");");
+        Operand value = expression(*assignment.getRight());
+        line("nativeCheckAssign(" + quoted(name) + ");");
+        line(global + "->replace(" +
+             (value.owned ? take(value) : "Value(" + value.code + ")") +
+             ");");
+    }
+
+    // Emits what the condition needs evaluated and returns the test. An
+    // `if` declaration's variable is declared by declareCondition() once
+    // the test has passed.
+    std::string condition(
+        const std::variant<std::shared_ptr<IfCompareNode>,
+                           std::shared_ptr<IfDeclarationNode>>& condition,
+        std::optional<Operand>& declared) {
+        if (auto compare =
+                std::get_if<std::shared_ptr<IfCompareNode>>(&condition)) {
+            Operand left = expression(*(*compare)->getLeft());
+            Operand right = expression(*(*compare)->getRight());
+            return left.code + compareOperator((*compare)->getType()) +
+                   right.code;
+        }
+        auto& declaration =
+            *std::get<std::shared_ptr<IfDeclarationNode>>(condition)
+                 ->getVariableDeclaration();
+        if (!declaration.getValue().has_value()) return "true";
+        declared = expression(*declaration.getValue().value());
+        return "nativeFits(" +
+               descriptorArguments(declaration.getDescriptor()) + ", " +
+               declared->code + ")";
+    }
+
+    void declareCondition(
+        const std::variant<std::shared_ptr<IfCompareNode>,
+                           std::shared_ptr<IfDeclarationNode>>& condition,
+        const std::optional<Operand>& declared) {
+        auto declaration = std::get_if<std::shared_ptr<IfDeclarationNode>>(
+            &condition);
+        if (declaration == nullptr) return;
+        auto& variable = *(*declaration)->getVariableDeclaration();
+        this->declaration(variable, declaredValue(variable, declared));
+    }
+
+    void ifChain(const IfNode& ifNode) {
+        std::optional<Operand> declared;
+        std::string test = condition(ifNode.getCondition(), declared);
+        open("if (" + test + ") {");
+        scopes.emplace_back();
+        declareCondition(ifNode.getCondition(), declared);
+        body(*ifNode.getBody());
+        scopes.pop_back();
+        if (ifNode.getElseIfBranches().has_value()) {
+            reopen("} else {");
+            scopes.emplace_back();
+            ifChain(*ifNode.getElseIfBranches().value());
+            scopes.pop_back();
+        } else if (ifNode.getElseBody().has_value()) {
+            reopen("} else {");
+            scopedBody(*ifNode.getElseBody().value());
+        }
+        close();
+    }
+
+    void whileLoop(const WhileNode& whileNode) {
+        forgetHoisted(whileNode.getHoistedSlots());
+        open("while (true) {");
+        scopes.emplace_back();
+        std::optional<Operand> declared;
+        std::string test = condition(whileNode.getCondition(), declared);
+        line("if (!(" + test + ")) break;");
+        declareCondition(whileNode.getCondition(), declared);
+        body(*whileNode.getBody());
+        scopes.pop_back();
+        close();
+    }
+
+    // Loops over a call to range count from the start of its slice to the
+    // end instead of building the array, unless the script has a range of
+    // its own. Gives the names of the two bounds.
+    std::optional<std::pair<std::string, std::string>> rangeBounds(
+        const ForLoopNode& forLoop) {
+        const FunctionCallNode* range = forLoop.getRangeCall();
+        if (range == nullptr || bindings.functions.count("range") != 0 ||
+            bindings.globals.count("range") != 0)
+            return std::nullopt;
+        std::string values = arguments(range->getParameters());
+        std::string size = fresh("n");
+        line("size_t " + size + " = nativeRangeSize(" +
+             (values.empty() ? "" : values.substr(2)) + ");");
+        const ArrayRangeNode* slice = forLoop.getRangeSlice();
+        if (slice == nullptr) return std::make_pair("size_t{0}", size);
+        std::string start = bound(slice->getStart(), "size_t{0}");
+        std::string end = bound(slice->getEnd(), size);
+        line("nativeCheckSlice(" + start + ", " + end + ", " + size + ");");
+        return std::make_pair(start, end);
+    }
+
+    void forLoop(const ForLoopNode& forLoop) {
+        open("{");
+        forgetHoisted(forLoop.getHoistedSlots());
+        std::string index = fresh("i");
+        if (auto bounds = rangeBounds(forLoop)) {
+            auto [start, end] = bounds.value();
+            auto element = [start = start](const std::string& index) {
+                return "static_cast<int>(" + start + " + " + index + ")";
+            };
+            if (forLoop.isParallel()) {
+                parallelFor(forLoop, end + " - " + start, element);
+            } else {
+                open("for (size_t " + index + " = " + start + "; " + index +
+                     " < " + end + "; " + index + "++) {");
+                loopBody(forLoop, "static_cast<int>(" + index + ")");
+            }
+            close();
+            return;
+        }
+        Operand iterable = expression(*forLoop.getIterable());
+        if (!iterable.owned) iterable = temporary(iterable.code);
+        std::string elements = fresh("elements");
+        line("ArrayView " + elements + " = " + iterable.code + ".view();");
+        auto element = [elements](const std::string& index) {
+            return elements + "[" + index + "]";
+        };
+        if (forLoop.isParallel()) {
+            parallelFor(forLoop, elements + ".size", element);
+        } else {
+            open("for (size_t " + index + " = 0; " + index + " < " +
+                 elements + ".size; " + index + "++) {");
+            loopBody(forLoop, element(index));
+        }
+        close();
+    }
+
+    // Binds the element variable to `element` and emits the body, closing
+    // the loop opened for it.
+    void loopBody(const ForLoopNode& forLoop, const std::string& element) {
+        scopes.emplace_back();
+        line("Value " +
+             declare(forLoop.getElementSlot(), forLoop.getElement()) +
+             " = nativeElement(" + element + ");");
+        body(*forLoop.getBody());
+        scopes.pop_back();
+        close();
+    }
+
+    // Runs the iterations as the walker's pfor does: split into tasks, each
+    // with its own copies of the reduced variables, merged back in order.
+    // The resolver only lets the body assign the variables it reduces, so
+    // everything else is shared with the enclosing frame. `element` gives
+    // the element of an iteration from its index.
+    void parallelFor(
+        const ForLoopNode& forLoop, const std::string& size,
+        const std::function<std::string(const std::string&)>& element) {
+        std::string count = fresh("count");
+        std::string tasks = fresh("tasks");
+        std::string partials = fresh("partials");
+        std::string task = fresh("task");
+        line("size_t " + count + " = " + size + ";");
+        line("size_t " + tasks + " = nativeParallelTasks(" + count + ");");
+        line("std::vector<std::vector<Value>> " + partials + "(" + tasks +
+             ");");
+        open("parallelEach(" + tasks + ", [&](size_t " + task + ") {");
+        auto& reductions = forLoop.getReductions();
+        std::vector<std::string> outer;
+        std::vector<std::string> local;
+        scopes.emplace_back();
+        for (auto& reduction : reductions) {
+            outer.push_back(*variable(VariableSlot{reduction->getSlot()}));
+            local.push_back(declare(reduction->getSlot(),
+                                    reduction->getVariable()));
+            line("Value " + local.back() + " = nativeReductionIdentity(" +
+                 reductionType(reduction->getType()) + ", " + outer.back() +
+                 ");");
+        }
+        std::string index = fresh("i");
+        open("for (size_t " + index + " = " + count + " * " + task + " / " +
+             tasks + "; " + index + " < " + count + " * (" + task +
+             " + 1) / " + tasks + "; " + index + "++) {");
+        parallel++;
+        loopBody(forLoop, element(index));
+        parallel--;
+        for (auto& name : local)
+            line(partials + "[" + task + "].push_back(std::move(" + name +
+                 "));");
+        scopes.pop_back();
+        close("});");
+        std::string partial = fresh("partial");
+        open("for (auto& " + partial + " : " + partials + ") {");
+        for (size_t i = 0; i < reductions.size(); i++)
+            line("nativeMergeReduction(" +
+                 std::string(reductionType(reductions[i]->getType())) + ", " +
+                 outer[i] + ", std::move(" + partial + "[" +
+                 std::to_string(i) + "]));");
+        close();
+    }
+
+    void returnStatement(const ReturnNode& returnNode) {
+        const FunctionCallNode* tailCall = returnNode.getTailCall();
+        const std::string* callee = nullptr;
+        if (tailCall != nullptr) {
+            auto found = bindings.functions.find(tailCall->getIdentifier());
+            if (found != bindings.functions.end()) callee = &found->second;
+        }
+        if (parallel > 0) {
+            // A tail call only gets as far as its arguments before the pfor
+            // sees the return.
+            if (callee != nullptr)
+                arguments(tailCall->getParameters());
+            else
+                expression(*returnNode.getValue());
+            line("nativeError(\"Cannot return from inside pfor\");");
+            return;
+        }
+        bool fits = callee != nullptr && functions.params.at(*callee) ==
+                                             tailCall->getParameters().size();
+        if (fits && *callee == self) {
+            // Calls to itself reuse the frame, so they loop instead.
+            std::vector<Operand> values;
+            for (auto& parameter : tailCall->getParameters()) {
+                Operand value = expression(*parameter);
+                values.push_back(value.owned ? value
+                                             : temporary(value.code));
+            }
+            for (size_t i = 0; i < values.size(); i++)
+                line("p" + std::to_string(i) + ".replace(" + take(values[i]) +
+                     ");");
+            line("goto start;");
+            jumped = true;
+            tailCalls = true;
+            return;
+        }
+        if (fits) {
+            line("return nativeTail(tail_" + *callee +
+                 arguments(tailCall->getParameters()) + ");");
+            return;
+        }
+        line("return " + expression(*returnNode.getValue()).code + ";");
+    }
+
+    // The arguments are evaluated before the task starts, as in the walker.
+    std::string spawn(const FunctionCallNode& spawn) {
+        auto& parameters = spawn.getParameters();
+        std::string values = arguments(
+            std::vector<std::shared_ptr<ExpressionNode>>(
+                parameters.begin() + 1, parameters.end()));
+        auto& name = *spawnedName(spawn);
+        auto found = bindings.functions.find(name);
+        if (found == bindings.functions.end())
+            return "nativeError(" +
+                   quoted(bindings.globals.count(name) != 0
+                              ? name + " must be defined as a function."
+                              : "Undefined function '" + name + "'") +
+                   ")";
+        size_t params = functions.params.at(found->second);
+        if (params != parameters.size() - 1)
+            return "nativeError(" +
+                   quoted("Function " + name + " expected " +
+                          std::to_string(params) +
+                          " argument(s) but received " +
+                          std::to_string(parameters.size() - 1)) +
+                   ")";
+        return "nativeSpawn(" + shared.task(found->second, params) + values +
+               ")";
+    }
+
+    std::string call(const FunctionCallNode& call) {
+        if (call.getBuiltin() == BuiltinFunction::SPAWN) return spawn(call);
+        auto& name = call.getIdentifier();
+        auto found = bindings.functions.find(name);
+        if (found != bindings.functions.end()) {
+            std::string values = arguments(call.getParameters());
+            size_t params = functions.params.at(found->second);
+            if (params != call.getParameters().size())
+                return "nativeError(" +
+                       quoted("Function " + name + " expected " +
+                              std::to_string(params) +
+                              " argument(s) but received " +
+                              std::to_string(call.getParameters().size())) +
+                       ")";
+            std::string result = found->second + "(" +
+                                 (values.empty() ? "" : values.substr(2)) +
+                                 ")";
+            if (functions.tailCalling.count(found->second) != 0)
+                return "nativeFinish(" + result + ")";
+            return result;
+        }
+        if (bindings.globals.count(name) != 0)
+            return "nativeError(" +
+                   quoted(name + " must be defined as a function.") + ")";
+        if (call.getBuiltin().has_value())
+            return "nativeCall(" + shared.function(name) +
+                   arguments(call.getParameters()) + ")";
+        return "nativeError(" + quoted("Undefined function '" + name + "'") +
+               ")";
+    }
+
+    Operand array(const ArrayNode& array) {
+        return std::visit(
+            [this, &array](auto&& arg) -> Operand {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
+                constexpr bool isString = std::is_same_v<T, std::string>;
+                if constexpr (isVector) {
+                    return Operand{shared.literal(arg), false};
+                } else if constexpr (isString) {
+                    if (array.getSlot().has_value()) {
+                        if (auto local = variable(array.getSlot()))
+                            return Operand{*local, false};
+                        return error("Undefined variable: " + arg);
+                    }
+                    if (bindings.globals.count(arg) != 0)
+                        return Operand{"nativeGlobal(g_" + cppName(arg) +
+                                           ", " + quoted(arg) + ")",
+                                       false};
+                    if (bindings.functions.count(arg) != 0)
+                        return error("Cannot use " + arg +
+                                     " as an array, as it is defined as a "
+                                     "function");
+                    return error("Undefined variable: " + arg);
+                } else {
+                    return temporary(call(*arg));
+                }
+            },
+            array.getValue());
+    }
+
+    std::string bound(
+        const std::optional<std::variant<size_t,
+                                         std::shared_ptr<ExpressionNode>>>&
+            bound,
+        const std::string& otherwise) {
+        if (!bound.has_value()) return otherwise;
+        if (auto index = std::get_if<size_t>(&bound.value()))
+            return "size_t{" + std::to_string(*index) + "}";
+        Operand value = expression(
+            *std::get<std::shared_ptr<ExpressionNode>>(bound.value()));
+        std::string name = fresh("b");
+        line("size_t " + name + " = nativeBound(" + value.code + ");");
+        return name;
+    }
+
+    // An expression hoisted out of a loop (parser/hoist.h) is evaluated into
+    // an optional declared as the loop starts, the first time it's empty.
+    Operand expression(const ExpressionNode& expression) {
+        if (auto& slot = expression.getHoistedSlot()) {
+            auto cache = hoisted.find(slot->index);
+            if (cache != hoisted.end()) {
+                open("if (!" + cache->second + ") {");
+                Operand value = evaluate(expression);
+                line(cache->second + ".emplace(" + take(value) + ");");
+                close();
+                return Operand{"(*" + cache->second + ")", false};
+            }
+        }
+        return evaluate(expression);
+    }
+
+    void forgetHoisted(const std::vector<size_t>& slots) {
+        for (size_t slot : slots) {
+            std::string name = fresh("h");
+            line("std::optional<Value> " + name + ";");
+            hoisted[slot] = name;
+        }
+    }
+
+    Operand evaluate(const ExpressionNode& expression) {
+        Operand value{"", false};
+        if (auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+                &expression.getPrimary())) {
+            Operand left = this->expression(*(*arithmetic)->left);
+            Operand right = this->expression(*(*arithmetic)->right);
+            const char* op = nullptr;
+            switch ((*arithmetic)->type) {
+                case ArithmeticNode::TYPE_ADDITION:
+                    op = " + ";
+                    break;
+                case ArithmeticNode::TYPE_SUBTRACTION:
+                    op = " - ";
+                    break;
+                case ArithmeticNode::TYPE_MULTIPLICATION:
+                    op = " * ";
+                    break;
+                case ArithmeticNode::TYPE_DIVISION:
+                    op = " / ";
+                    break;
+                case ArithmeticNode::TYPE_MODULO:
+                    op = " % ";
+                    break;
+                case ArithmeticNode::TYPE_AND:
+                    op = " & ";
+                    break;
+                case ArithmeticNode::TYPE_OR:
+                    op = " | ";
+                    break;
+                case ArithmeticNode::TYPE_XOR:
+                    op = " ^ ";
+                    break;
+                case ArithmeticNode::TYPE_SHIFT_LEFT:
+                    op = " << ";
+                    break;
+                case ArithmeticNode::TYPE_SHIFT_RIGHT:
+                    op = " >> ";
+                    break;
+                default:
+                    throw std::runtime_error(
+                        "Error interpreting arithmetic");
+            }
+            value = temporary(left.code + op + right.code);
+        } else {
+            value = array(
+                *std::get<std::shared_ptr<ArrayNode>>(expression.getPrimary()));
+        }
+        // The first step of a chain reads an operand it doesn't own, and
+        // later steps work in place on what it produced.
+        for (auto& postfix : expression.getPostfix().getValues()) {
+            if (auto range =
+                    std::get_if<std::shared_ptr<ArrayRangeNode>>(&postfix)) {
+                std::string start = bound((*range)->getStart(), "size_t{0}");
+                std::string end =
+                    bound((*range)->getEnd(), value.code + ".getSize()");
+                if (value.owned)
+                    line("nativeSliceInPlace(" + value.code + ", " + start +
+                         ", " + end + ");");
+                else
+                    value = temporary("nativeSlice(" + value.code + ", " +
+                                      start + ", " + end + ")");
+                continue;
+            }
+            auto& method = *std::get<std::shared_ptr<MethodNode>>(postfix);
+            if (!method.getBuiltin().has_value()) {
+                value = error("Unknown method " + method.getIdentifier());
+                continue;
+            }
+            std::string builtin = shared.method(method.getIdentifier());
+            std::string values = arguments(method.getParameters());
+            if (value.owned)
+                line("nativeMethodInPlace(" + builtin + ", " + value.code +
+                     values + ");");
+            else
+                value = temporary("nativeMethod(" + builtin + ", " +
+                                  value.code + values + ")");
+        }
+        return value;
+    }
+
+    Shared& shared;
+    const Bindings& bindings;
+    const Functions& functions;
+    std::string self;
+    std::ostringstream code;
+    size_t depth = 0;
+    size_t next = 0;
+    std::vector<std::unordered_map<size_t, std::string>> scopes;
+    // Variables holding the hoisted expressions, by their slot.
+    std::unordered_map<size_t, std::string> hoisted;
+    size_t parallel = 0;
+    bool tailCalls = false;
+    // Whether the last line written was a self tail call's jump.
+    bool jumped = false;
+};
+
+// Gathers the top level of the program in the order `interpret` runs it,
+// with used files spliced in where they are used.
+void load(RootNode root, std::vector<TopLevel>& program,
+          std::vector<std::string>& loaded, ModuleLoader& modules) {
+    for (auto& value : root.getValues()) {
+        if (auto binding =
+                std::get_if<std::shared_ptr<VariableBindingNode>>(&value)) {
+            program.push_back(*binding);
+        } else if (auto definition =
+                       std::get_if<std::shared_ptr<FunctionDefinitionNode>>(
+                           &value)) {
+            program.push_back(*definition);
+        } else if (auto use = std::get_if<std::shared_ptr<UseNode>>(&value)) {
+            auto& array = (*use)->getValue()->getValue();
+            auto path = std::get_if<std::vector<int>>(&array);
+            if ((*use)->getType() == UseNode::Type::STANDARD_HEADER ||
+                path == nullptr)
+                throw std::runtime_error(unsupported("use <graphics>"));
+            std::string used(path->begin(), path->end());
+            if (std::find(loaded.begin(), loaded.end(), used) != loaded.end())
+                continue;
+            loaded.push_back(used);
+            load(modules.loadUsed(used), program, loaded, modules);
+        }
+    }
+}
+
+// The calls a body's returns make as tail calls. Returns inside a pfor
+// only raise an error, so its body is skipped.
+void tailCalls(const BodyNode& body,
+               std::vector<const FunctionCallNode*>& calls);
+
+void tailCalls(const IfNode& ifNode,
+               std::vector<const FunctionCallNode*>& calls) {
+    tailCalls(*ifNode.getBody(), calls);
+    if (ifNode.getElseIfBranches().has_value())
+        tailCalls(*ifNode.getElseIfBranches().value(), calls);
+    if (ifNode.getElseBody().has_value())
+        tailCalls(*ifNode.getElseBody().value(), calls);
+}
+
+void tailCalls(const BodyNode& body,
+               std::vector<const FunctionCallNode*>& calls) {
+    for (auto& statement : body.getStatements()) {
+        auto& value = statement->getValue();
+        if (auto returnNode =
+                std::get_if<std::shared_ptr<ReturnNode>>(&value)) {
+            if (auto call = (*returnNode)->getTailCall()) calls.push_back(call);
+        } else if (auto ifNode = std::get_if<std::shared_ptr<IfNode>>(&value)) {
+            tailCalls(**ifNode, calls);
+        } else if (auto whileNode =
+                       std::get_if<std::shared_ptr<WhileNode>>(&value)) {
+            tailCalls(*(*whileNode)->getBody(), calls);
+        } else if (auto forLoop =
+                       std::get_if<std::shared_ptr<ForLoopNode>>(&value)) {
+            if (!(*forLoop)->isParallel())
+                tailCalls(*(*forLoop)->getBody(), calls);
+        }
+    }
+}
+
+std::string bindingName(const VariableBindingNode& binding) {
+    if (auto declaration =
+            std::get_if<std::shared_ptr<VariableDeclarationNode>>(
+                &binding.getValue()))
+        return (*declaration)->getIdentifier();
+    return std::get<std::shared_ptr<VariableAssignmentNode>>(
+               binding.getValue())
+        ->getLeft();
+}
+
+}  // namespace
+
+void emitCpp(const std::string& filename, std::ostream& out) {
+    std::vector<TopLevel> program;
+    std::vector<std::string> loaded;
+    {
+        ModuleLoader modules(false);
+        load(modules.loadMain(filename), program, loaded, modules);
+    }
+
+    // Function bodies run once the whole program is loaded and see its
+    // final bindings; the top level sees them as they are made.
+    Bindings final;
+    Functions functions;
+    auto& params = functions.params;
+    std::vector<std::string> functionNames;
+    for (auto& value : program) {
+        if (auto definition =
+                std::get_if<std::shared_ptr<FunctionDefinitionNode>>(&value)) {
+            auto& name = (*definition)->getIdentifier();
+            std::string function = "f_" + cppName(name);
+            while (params.count(function) != 0)
+                function += "_" + std::to_string(functionNames.size());
+            functionNames.push_back(function);
+            params[function] = (*definition)->getParams().size();
+            final.functions[name] = function;
+        } else {
+            auto& binding = *std::get<std::shared_ptr<VariableBindingNode>>(
+                value);
+            if (std::holds_alternative<
+                    std::shared_ptr<VariableDeclarationNode>>(
+                    binding.getValue()))
+                final.globals.insert(bindingName(binding));
+        }
+    }
+    for (auto& name : final.globals)
+        if (final.functions.count(name) != 0)
+            throw std::runtime_error(
+                unsupported(name + " naming both a function and an array"));
+
+    // Each function another one tail-calls gets an entry point taking its
+    // arguments as a vector, for nativeFinish() to call.
+    std::vector<const FunctionDefinitionNode*> definitions;
+    for (auto& value : program)
+        if (auto definition =
+                std::get_if<std::shared_ptr<FunctionDefinitionNode>>(&value))
+            definitions.push_back(definition->get());
+    std::unordered_set<std::string> tailCalled;
+    for (size_t i = 0; i < definitions.size(); i++) {
+        std::vector<const FunctionCallNode*> calls;
+        tailCalls(*definitions[i]->getBody(), calls);
+        for (auto call : calls) {
+            auto callee = final.functions.find(call->getIdentifier());
+            if (callee == final.functions.end() ||
+                callee->second == functionNames[i] ||
+                params.at(callee->second) != call->getParameters().size())
+                continue;
+            functions.tailCalling.insert(functionNames[i]);
+            tailCalled.insert(callee->second);
+        }
+    }
+
+    Shared shared;
+    std::ostringstream bodies;
+    std::ostringstream declarations;
+    for (size_t i = 0; i < definitions.size(); i++) {
+        auto& function = functionNames[i];
+        BodyEmitter body(shared, final, functions, function);
+        size_t count = definitions[i]->getParams().size();
+        bool memoized = definitions[i]->isMemoized();
+        bodies << "\n" << body.function(*definitions[i]);
+        std::string types;
+        for (size_t param = 0; param < count; param++)
+            types += param == 0 ? "Value" : ", Value";
+        declarations << "Value " << function << "(" << types << ");\n";
+        if (memoized) {
+            declarations << "Value memo_" << function << "(" << types
+                         << ");\n"
+                         << "MemoCache cache_" << function << ";\n";
+            bodies << "\nValue " << function << "(";
+            for (size_t param = 0; param < count; param++)
+                bodies << (param == 0 ? "" : ", ") << "Value p" << param;
+            bodies << ") {\n    return nativeMemo(cache_" << function
+                   << ", memo_" << function;
+            for (size_t param = 0; param < count; param++)
+                bodies << ", std::move(p" << param << ")";
+            bodies << ");\n}\n";
+        }
+        if (tailCalled.count(function) == 0) continue;
+        // Tail calls carry on the call that made them, so they skip a memo
+        // fn's cache.
+        bodies << "\nValue tail_" << function
+               << "(std::vector<Value>& arguments) {\n    return "
+               << (memoized ? "memo_" : "") << function << "(";
+        for (size_t param = 0; param < count; param++)
+            bodies << (param == 0 ? "" : ", ") << "std::move(arguments["
+                   << param << "])";
+        bodies << ");\n}\n";
+        declarations << "Value tail_" << function
+                     << "(std::vector<Value>& arguments);\n";
+    }
+
+    Bindings current;
+    BodyEmitter initialize(shared, current, functions, "initialize");
+    size_t nextFunction = 0;
+    for (auto& value : program) {
+        if (std::holds_alternative<std::shared_ptr<FunctionDefinitionNode>>(
+                value)) {
+            auto& name = std::get<std::shared_ptr<FunctionDefinitionNode>>(
+                             value)
+                             ->getIdentifier();
+            current.functions[name] = functionNames[nextFunction++];
+            continue;
+        }
+        auto& binding = *std::get<std::shared_ptr<VariableBindingNode>>(value);
+        initialize.topLevel(binding);
+        if (std::holds_alternative<std::shared_ptr<VariableDeclarationNode>>(
+                binding.getValue()))
+            current.globals.insert(bindingName(binding));
+    }
+
+    std::string main = "nullptr";
+    auto mainFunction = final.functions.find("main");
+    if (mainFunction != final.functions.end()) {
+        main = mainFunction->second;
+        if (params.at(main) != 2) {
+            bodies << "\nValue callMain(Value, Value) {\n"
+                      << "    return nativeError("
+                      << quoted("Function main expected " +
+                                std::to_string(params.at(main)) +
+                                " argument(s) but received 2")
+                      << ");\n}\n";
+            main = "callMain";
+        }
+    } else if (final.globals.count("main") != 0) {
+        bodies << "\nValue callMain(Value, Value) {\n"
+                  << "    return nativeError(\"main must be defined as a "
+                     "function.\");\n}\n";
+        main = "callMain";
+    }
+
+    out << "// Generated by ints --emit-cpp from " << filename << ".\n"
+        << "// Build it against the ints runtime library, ints_runtime.\n\n"
+        << "#include <climits>\n#include <optional>\n#include <utility>\n"
+        << "#include <vector>\n\n#include \"compiler/native.h\"\n\n"
+        << "namespace {\n\n"
+        << declarations.str() << "\n"
+        << shared.text();
+    std::vector<std::string> globals(final.globals.begin(),
+                                     final.globals.end());
+    std::sort(globals.begin(), globals.end());
+    for (auto& global : globals)
+        out << "std::optional<Value> g_" << cppName(global) << ";\n";
+    out << bodies.str() << "\nvoid initialize() {\n"
+        << initialize.text() << "}\n\n}  // namespace\n\n"
+        << "int main(int argc, char* argv[]) {\n"
+        << "    return nativeMain(argc, argv, initialize, " << main
+        << ");\n}\n";
+}
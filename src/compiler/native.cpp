@@ -0,0 +1,175 @@
+// Copyright 2025 Caden Crowson
+
+#include "compiler/native.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "runtime/context.h"
+
+Value nativeLiteral(std::initializer_list<int> elements) {
+    DynamicArray literal(elements.size());
+    std::copy(elements.begin(), elements.end(), literal.data);
+    return Value(std::move(literal), elements.size());
+}
+
+Value nativeElement(int element) {
+    DynamicArray elementArray(1);
+    elementArray[0] = element;
+    return Value(std::move(elementArray), 1);
+}
+
+Value nativeNothing() { return Value(DynamicArray(0), 0); }
+
+Value nativeError(const std::string& message) {
+    throw std::runtime_error(message);
+}
+
+const Value& nativeGlobal(const std::optional<Value>& global,
+                          const char* name) {
+    if (!global.has_value())
+        throw std::runtime_error(std::string("Undefined variable: ") + name);
+    return global.value();
+}
+
+void nativeCheckDefined(const std::optional<Value>& global,
+                        const char* name) {
+    if (!global.has_value())
+        throw std::runtime_error(std::string(name) + " has not been defined");
+}
+
+void nativeCheckAssign(const char* name) {
+    if (currentContext().runningTasks > 0)
+        throw std::runtime_error("Cannot assign " + std::string(name) +
+                                 " while spawned tasks are running");
+}
+
+size_t nativeBound(const Value& bound) {
+    ArrayView result = bound.view();
+    if (result.size != 1 || result[0] < 0)
+        throw std::runtime_error(
+            "Array Bounds value must be an integer or evaluate to an array "
+            "with 1 positive value");
+    return result[0];
+}
+
+void nativeCheckSlice(size_t start, size_t end, size_t size) {
+    if (end < start)
+        throw std::runtime_error(
+            "Array Range upper bound must be greater than or equal to the "
+            "lower bound");
+    if (end > size)
+        throw std::runtime_error(
+            "Array range bounds must be smaller than the length of the "
+            "array");
+}
+
+// Variables aren't shared here the way the walker shares them, so slices
+// of them are copied out.
+Value nativeSlice(const Value& source, size_t start, size_t end) {
+    nativeCheckSlice(start, end, source.getSize());
+    ArrayView view = source.view();
+    DynamicArray result(end - start);
+    std::copy(view.begin() + start, view.begin() + end, result.data);
+    return Value(std::move(result), end - start);
+}
+
+void nativeSliceInPlace(Value& value, size_t start, size_t end) {
+    nativeCheckSlice(start, end, value.getSize());
+    value.sliceInPlace(start, end);
+}
+
+bool nativeFits(std::optional<size_t> size, bool canGrow,
+                const Value& value) {
+    return size == value.getSize() || (size < value.getSize() && canGrow);
+}
+
+BuiltinFunction nativeBuiltinFunction(const char* name) {
+    if (auto builtin = builtinFunctionFromName(name)) return builtin.value();
+    throw std::runtime_error(std::string("Undefined function '") + name +
+                             "'");
+}
+
+BuiltinMethod nativeBuiltinMethod(const char* name) {
+    if (auto builtin = builtinMethodFromName(name)) return builtin.value();
+    throw std::runtime_error(std::string("Unknown method ") + name);
+}
+
+size_t nativeParallelTasks(size_t iterations) {
+    return std::min(iterations, parallelThreads() * 4);
+}
+
+Value nativeReductionIdentity(ReductionNode::Type type, const Value& value) {
+    if (type == ReductionNode::TYPE_APPEND)
+        return Value(DynamicArray::growable(), 0);
+    size_t size = value.getSize();
+    DynamicArray identity(size);
+    std::fill(identity.data, identity.data + size,
+              type == ReductionNode::TYPE_MULTIPLY ? 1 : 0);
+    return Value(std::move(identity), size);
+}
+
+void nativeMergeReduction(ReductionNode::Type type, Value& target,
+                          Value partial) {
+    if (type == ReductionNode::TYPE_APPEND) {
+        nativeMethodInPlace(BuiltinMethod::APPEND, target, std::move(partial));
+        return;
+    }
+    target.replace(type == ReductionNode::TYPE_ADD ? target + partial
+                                                   : target * partial);
+}
+
+thread_local NativeTailCall nativeTailCall;
+
+Value nativeFinish(Value result) {
+    while (nativeTailCall.function != nullptr) {
+        NativeFunction function = nativeTailCall.function;
+        std::vector<Value> arguments = std::move(nativeTailCall.arguments);
+        nativeTailCall.function = nullptr;
+        result.replace(function(arguments));
+    }
+    return result;
+}
+
+int nativeMain(int argc, char* argv[], void (*initialize)(),
+               Value (*main)(Value, Value)) {
+    size_t size = 0;
+    for (int i = 1; i < argc; i++) size += 1 + std::strlen(argv[i]);
+    DynamicArray commandLineArgs = DynamicArray::uninitialized(size);
+    commandLineArgs.canGrow = true;
+    int* out = commandLineArgs.data;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        *out++ = static_cast<int>(arg.size());
+        out = std::copy(arg.begin(), arg.end(), out);
+    }
+    int count = argc - 1;
+    try {
+        initialize();
+        if (main != nullptr) {
+            nativeFinish(main(Value(DynamicArray::copyOf({&count, 1}, true), 1),
+                              Value(std::move(commandLineArgs), size)));
+        }
+        finishTasks();
+    } catch (const ScriptExit& scriptExit) {
+        abandonTasks();
+        flushOutput();
+        return scriptExit.code();
+    } catch (const std::exception& e) {
+        abandonTasks();
+        flushOutput();
+        std::cerr << "Error: " << e.what() << '\n';
+        exit(1);
+    }
+    flushOutput();
+    return 0;
+}
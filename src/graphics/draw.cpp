@@ -0,0 +1,150 @@
+// Copyright 2025 Caden Crowson
+
+#include "graphics/draw.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "graphics/window.h"
+#include "imgui/imgui.h"
+#include "runtime/builtins.h"
+
+static void expectArguments(const std::string& name,
+                            const std::vector<Value>& args, size_t expected) {
+    if (args.size() != expected)
+        throw std::runtime_error("Function " + name + " expected " +
+                                 std::to_string(expected) +
+                                 " argument(s) but received " +
+                                 std::to_string(args.size()));
+}
+
+static void expectSize(const std::string& name, const std::string& what,
+                       const ArrayView& array, size_t size) {
+    if (array.size != size)
+        throw std::runtime_error("Function " + name + " expected " + what +
+                                 " of " + std::to_string(size) +
+                                 " element(s) but received " +
+                                 std::to_string(array.size));
+}
+
+// [x, y, width, height]
+static void readArea(const std::string& name, const Value& value,
+                     DrawCommand& command) {
+    ArrayView area = value.view();
+    expectSize(name, "an area", area, 4);
+    if (area[2] < 0 || area[3] < 0)
+        throw std::runtime_error("Function " + name +
+                                 " expected an area of positive size");
+    command.x = area[0];
+    command.y = area[1];
+    command.width = area[2];
+    command.height = area[3];
+}
+
+// [red, green, blue] or [red, green, blue, alpha], each from 0 to 255.
+static uint32_t readColor(const std::string& name, const Value& value) {
+    ArrayView color = value.view();
+    if (color.size != 3 && color.size != 4)
+        throw std::runtime_error("Function " + name +
+                                 " expected a color of 3 or 4 elements but "
+                                 "received " +
+                                 std::to_string(color.size));
+    for (int component : color)
+        if (component < 0 || component > 255)
+            throw std::runtime_error(
+                "Color components must be between 0 and 255");
+    return IM_COL32(color[0], color[1], color[2],
+                    color.size == 4 ? color[3] : 255);
+}
+
+static Value builtinRect(std::vector<Value>& args) {
+    expectArguments("rect", args, 2);
+    DrawCommand command;
+    command.type = DrawCommand::Type::RECT;
+    readArea("rect", args[0], command);
+    command.color = readColor("rect", args[1]);
+    submitDrawCommand(command);
+    return Value(DynamicArray(0), 0);
+}
+
+static Value builtinText(std::vector<Value>& args) {
+    expectArguments("text", args, 3);
+    DrawCommand command;
+    command.type = DrawCommand::Type::TEXT;
+    ArrayView position = args[0].view();
+    expectSize("text", "a position", position, 2);
+    command.x = position[0];
+    command.y = position[1];
+    command.text = valueToString(args[1]);
+    command.color = readColor("text", args[2]);
+    submitDrawCommand(command);
+    return Value(DynamicArray(0), 0);
+}
+
+// Every element is one pixel's color packed as 0xRRGGBB, row by row.
+static Value builtinPixels(std::vector<Value>& args) {
+    expectArguments("pixels", args, 3);
+    DrawCommand command;
+    command.type = DrawCommand::Type::PIXELS;
+    readArea("pixels", args[0], command);
+    ArrayView columns = args[1].view();
+    expectSize("pixels", "a width", columns, 1);
+    ArrayView pixels = args[2].view();
+    if (columns[0] <= 0 || pixels.size % columns[0] != 0)
+        throw std::runtime_error(
+            "Function pixels expected whole rows of pixels");
+    command.columns = columns[0];
+    command.pixels.reserve(pixels.size);
+    for (int pixel : pixels)
+        command.pixels.push_back(IM_COL32((pixel >> 16) & 0xff,
+                                          (pixel >> 8) & 0xff, pixel & 0xff,
+                                          255));
+    submitDrawCommand(command);
+    return Value(DynamicArray(0), 0);
+}
+
+// Each pixel is four elements, red, green, blue and alpha, from 0 to 255.
+static Value builtinFramebuffer(std::vector<Value>& args) {
+    expectArguments("framebuffer", args, 2);
+    ArrayView width = args[0].view();
+    expectSize("framebuffer", "a width", width, 1);
+    ArrayView channels = args[1].view();
+    if (width[0] <= 0 || channels.size == 0 ||
+        channels.size % (4 * static_cast<size_t>(width[0])) != 0)
+        throw std::runtime_error(
+            "Function framebuffer expected whole rows of pixels");
+    // Only the main thread draws, and the buffer we get back is the one it
+    // filled a few frames ago, so its allocation is reused.
+    static Frame frame;
+    frame.width = width[0];
+    frame.height = channels.size / (4 * frame.width);
+    frame.pixels.resize(channels.size);
+    unsigned outOfRange = 0;
+    for (size_t i = 0; i < channels.size; i++) {
+        outOfRange |= static_cast<unsigned>(channels[i]) > 255;
+        frame.pixels[i] = static_cast<unsigned char>(channels[i]);
+    }
+    if (outOfRange)
+        throw std::runtime_error(
+            "Color components must be between 0 and 255");
+    submitFrame(frame);
+    return Value(DynamicArray(0), 0);
+}
+
+static Value builtinPresent(std::vector<Value>& args) {
+    expectArguments("present", args, 0);
+    DrawCommand command;
+    command.type = DrawCommand::Type::PRESENT;
+    submitDrawCommand(command);
+    return Value(DynamicArray(0), 0);
+}
+
+void registerDrawingBuiltins() {
+    registerBuiltinFunction("rect", builtinRect);
+    registerBuiltinFunction("text", builtinText);
+    registerBuiltinFunction("pixels", builtinPixels);
+    registerBuiltinFunction("framebuffer", builtinFramebuffer);
+    registerBuiltinFunction("present", builtinPresent);
+}
@@ -0,0 +1,130 @@
+// Copyright 2025 Caden Crowson
+
+#include "graphics/framebuffer.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "imgui/imgui.h"
+
+void FrameMailbox::publish(Frame& frame) {
+    std::swap(frames[back], frame);
+    back = latest.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+Frame* FrameMailbox::take() {
+    if ((latest.load(std::memory_order_acquire) & FRESH) == 0) return nullptr;
+    front = latest.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+    return &frames[front];
+}
+
+// Pixel buffer objects are newer than the OpenGL 1.1 that gl.h declares on
+// every platform, so their entry points are looked up through GLFW once
+// the context exists.
+namespace {
+
+constexpr GLenum PIXEL_UNPACK_BUFFER = 0x88EC;
+constexpr GLenum STREAM_DRAW = 0x88E0;
+constexpr GLbitfield MAP_WRITE_BIT = 0x0002;
+constexpr GLbitfield MAP_INVALIDATE_BUFFER_BIT = 0x0008;
+constexpr GLint CLAMP_TO_EDGE = 0x812F;
+
+struct BufferFunctions {
+    void(APIENTRY* genBuffers)(GLsizei, GLuint*);
+    void(APIENTRY* deleteBuffers)(GLsizei, const GLuint*);
+    void(APIENTRY* bindBuffer)(GLenum, GLuint);
+    void(APIENTRY* bufferData)(GLenum, std::ptrdiff_t, const void*, GLenum);
+    void*(APIENTRY* mapBufferRange)(GLenum, std::ptrdiff_t, std::ptrdiff_t,
+                                    GLbitfield);
+    GLboolean(APIENTRY* unmapBuffer)(GLenum);
+};
+
+BufferFunctions gl;
+
+template <typename Function>
+bool lookup(Function& function, const char* name) {
+    function = reinterpret_cast<Function>(glfwGetProcAddress(name));
+    return function != nullptr;
+}
+
+}  // namespace
+
+bool FrameTexture::create() {
+    if (!lookup(gl.genBuffers, "glGenBuffers") ||
+        !lookup(gl.deleteBuffers, "glDeleteBuffers") ||
+        !lookup(gl.bindBuffer, "glBindBuffer") ||
+        !lookup(gl.bufferData, "glBufferData") ||
+        !lookup(gl.mapBufferRange, "glMapBufferRange") ||
+        !lookup(gl.unmapBuffer, "glUnmapBuffer"))
+        return false;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gl.genBuffers(2, buffers);
+    return true;
+}
+
+void FrameTexture::destroy() {
+    if (texture == 0) return;
+    gl.deleteBuffers(2, buffers);
+    glDeleteTextures(1, &texture);
+    texture = 0;
+}
+
+void FrameTexture::update(FrameMailbox& mailbox) {
+    if (texture == 0) return;
+    // The frame copied in last time has had a whole frame to reach the GPU,
+    // so updating the texture from it doesn't wait.
+    if (pending >= 0) {
+        gl.bindBuffer(PIXEL_UNPACK_BUFFER, buffers[pending]);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        GLsizei width = static_cast<GLsizei>(bufferWidth[pending]);
+        GLsizei height = static_cast<GLsizei>(bufferHeight[pending]);
+        if (bufferWidth[pending] != textureWidth ||
+            bufferHeight[pending] != textureHeight) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+            textureWidth = bufferWidth[pending];
+            textureHeight = bufferHeight[pending];
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+                            GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        pending = -1;
+    }
+    if (Frame* frame = mailbox.take()) {
+        filled ^= 1;
+        auto size = static_cast<std::ptrdiff_t>(frame->pixels.size());
+        gl.bindBuffer(PIXEL_UNPACK_BUFFER, buffers[filled]);
+        // Orphaning the old storage lets the driver hand out fresh memory
+        // instead of waiting for the GPU to finish reading it.
+        gl.bufferData(PIXEL_UNPACK_BUFFER, size, nullptr, STREAM_DRAW);
+        void* target = gl.mapBufferRange(
+            PIXEL_UNPACK_BUFFER, 0, size,
+            MAP_WRITE_BIT | MAP_INVALIDATE_BUFFER_BIT);
+        if (target != nullptr) {
+            std::memcpy(target, frame->pixels.data(), frame->pixels.size());
+            gl.unmapBuffer(PIXEL_UNPACK_BUFFER);
+            bufferWidth[filled] = frame->width;
+            bufferHeight[filled] = frame->height;
+            pending = filled;
+        }
+    }
+    gl.bindBuffer(PIXEL_UNPACK_BUFFER, 0);
+}
+
+void FrameTexture::draw(ImDrawList& list, float width, float height) const {
+    if (textureWidth == 0) return;
+    list.AddImage(static_cast<ImTextureID>(texture), ImVec2(0, 0),
+                  ImVec2(width, height));
+}
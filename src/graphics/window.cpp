@@ -0,0 +1,257 @@
+// Copyright 2025 Caden Crowson
+
+#include "graphics/window.h"
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "graphics/framebuffer.h"
+#include "imgui/backends/imgui_impl_glfw.h"
+#include "imgui/backends/imgui_impl_opengl3.h"
+#include "imgui/imgui.h"
+#include "util/spsc_queue.h"
+
+namespace {
+
+enum class WindowState { CLOSED, OPENING, OPEN };
+
+std::mutex stateMutex;
+std::condition_variable stateChanged;
+WindowState state = WindowState::CLOSED;
+// Never destroyed, since exit() may end the program with the window open,
+// and destroying a running thread terminates.
+std::thread* windowThread = nullptr;
+
+// Drawing commands flow from the thread that opened the window, the only
+// producer, to the GUI thread, which takes at most a queue's worth each
+// frame so a script drawing flat out can't hold up the frame rate.
+constexpr size_t COMMAND_QUEUE_SIZE = 4096;
+using CommandQueue = SpscQueue<DrawCommand, COMMAND_QUEUE_SIZE>;
+CommandQueue* commands = nullptr;
+FrameMailbox* frames = nullptr;
+std::atomic<bool> accepting{false};
+std::thread::id producer;
+// Producer only: commands that found the queue full, and whether anything
+// was drawn since the last PRESENT.
+std::deque<DrawCommand> overflow;
+bool unpresented = false;
+
+void setState(WindowState next) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        state = next;
+    }
+    stateChanged.notify_all();
+}
+
+// Moves the commands that arrived since the last frame into `scene`, and
+// `scene` into `shown` on every PRESENT.
+void takeCommands(std::vector<DrawCommand>& scene,
+                  std::vector<DrawCommand>& shown) {
+    DrawCommand command;
+    for (size_t i = 0; i < COMMAND_QUEUE_SIZE && commands->pop(command); i++) {
+        if (command.type == DrawCommand::Type::PRESENT) {
+            shown.swap(scene);
+            scene.clear();
+        } else {
+            scene.push_back(std::move(command));
+        }
+    }
+}
+
+void draw(ImDrawList& list, const DrawCommand& command) {
+    ImVec2 origin(command.x, command.y);
+    switch (command.type) {
+        case DrawCommand::Type::RECT:
+            list.AddRectFilled(origin,
+                               ImVec2(command.x + command.width,
+                                      command.y + command.height),
+                               command.color);
+            break;
+        case DrawCommand::Type::TEXT:
+            list.AddText(origin, command.color, command.text.c_str());
+            break;
+        case DrawCommand::Type::PIXELS: {
+            size_t rows = command.pixels.size() / command.columns;
+            float width = command.width / command.columns;
+            float height = command.height / rows;
+            for (size_t row = 0; row < rows; row++) {
+                float y = command.y + row * height;
+                for (size_t column = 0; column < command.columns; column++) {
+                    float x = command.x + column * width;
+                    list.AddRectFilled(
+                        ImVec2(x, y), ImVec2(x + width, y + height),
+                        command.pixels[row * command.columns + column]);
+                }
+            }
+            break;
+        }
+        case DrawCommand::Type::PRESENT:
+            break;
+    }
+}
+
+// Throws unless the calling thread may draw, and returns whether the window
+// still takes what it draws.
+bool canDraw() {
+    if (commands == nullptr)
+        throw std::runtime_error(
+            "Drawing needs the window opened by use <graphics>");
+    if (std::this_thread::get_id() != producer)
+        throw std::runtime_error(
+            "Only the main thread can draw, not the iterations of a pfor");
+    return accepting.load(std::memory_order_acquire);
+}
+
+// Producer only. Sends the commands held back while the queue was full, and
+// returns whether all of them went.
+bool sendOverflow() {
+    while (!overflow.empty() && commands->push(overflow.front()))
+        overflow.pop_front();
+    return overflow.empty();
+}
+
+}  // namespace
+
+static void error_callback(int error, const char* description) {
+    std::cerr << "GLFW Error " << error << ": " << description << std::endl;
+}
+
+static void guiThreadFunction(int width, int height) {
+    glfwSetErrorCallback(error_callback);
+    if (!glfwInit()) {
+        setState(WindowState::CLOSED);
+        return;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+#if __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(width, height,
+                                          "Dear ImGui Example", NULL, NULL);
+    if (!window) {
+        glfwTerminate();
+        setState(WindowState::CLOSED);
+        return;
+    }
+
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(1);
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+
+    ImGui::StyleColorsDark();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330");
+
+    FrameTexture frameTexture;
+    if (!frameTexture.create())
+        std::cerr << "OpenGL has no pixel buffer objects; framebuffer() "
+                     "won't show anything\n";
+
+    accepting = true;
+    setState(WindowState::OPEN);
+
+    std::vector<DrawCommand> scene, shown;
+    while (!glfwWindowShouldClose(window)) {
+        glfwPollEvents();
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        takeCommands(scene, shown);
+        frameTexture.update(*frames);
+        ImDrawList& list = *ImGui::GetBackgroundDrawList();
+        frameTexture.draw(list, io.DisplaySize.x, io.DisplaySize.y);
+        for (const DrawCommand& command : shown) draw(list, command);
+
+        ImGui::Render();
+        int display_w, display_h;
+        glfwGetFramebufferSize(window, &display_w, &display_h);
+        glViewport(0, 0, display_w, display_h);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+        glfwSwapBuffers(window);
+    }
+
+    accepting = false;
+
+    // Cleanup
+    frameTexture.destroy();
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    setState(WindowState::CLOSED);
+}
+
+void openWindow(int width, int height) {
+    waitForWindow();
+    if (commands == nullptr) {
+        commands = new CommandQueue();
+        frames = new FrameMailbox();
+    }
+    producer = std::this_thread::get_id();
+    setState(WindowState::OPENING);
+    windowThread = new std::thread(guiThreadFunction, width, height);
+    std::unique_lock<std::mutex> lock(stateMutex);
+    stateChanged.wait(lock, []() { return state != WindowState::OPENING; });
+    if (state != WindowState::OPEN)
+        throw std::runtime_error("Failed to open a window");
+}
+
+bool isWindowOpen() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return state == WindowState::OPEN;
+}
+
+void submitDrawCommand(DrawCommand& command) {
+    if (!canDraw()) {
+        overflow.clear();
+        return;
+    }
+    unpresented = command.type != DrawCommand::Type::PRESENT;
+    if (!sendOverflow() || !commands->push(command))
+        overflow.push_back(std::move(command));
+}
+
+void submitFrame(Frame& frame) {
+    if (canDraw()) frames->publish(frame);
+}
+
+void waitForWindow() {
+    if (windowThread == nullptr) return;
+    if (unpresented) {
+        DrawCommand present;
+        present.type = DrawCommand::Type::PRESENT;
+        submitDrawCommand(present);
+    }
+    // The program is over, so waiting for the GUI thread to catch up is
+    // fine now.
+    while (accepting.load(std::memory_order_acquire) && !sendOverflow())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    overflow.clear();
+    windowThread->join();
+    delete windowThread;
+    windowThread = nullptr;
+}
@@ -2,30 +2,93 @@
 
 #include "lexer/tokenize.h"
 
-#include <cctype>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "util/error.h"
 
-static std::string collectWhile(const std::string& code, size_t& i,
-                                size_t& char_num, int (*predicate)(int)) {
-    std::string result;
-    --i;
-    --char_num;
-    while (++i < code.size() && predicate(code[i]) != 0) {
-        result.push_back(code[i]);
-        ++char_num;
-    }
-    --i;
-    --char_num;
-    return result;
+namespace {
+
+enum CharClass : uint8_t {
+    IDENTIFIER_START = 1 << 0,
+    IDENTIFIER_PART = 1 << 1,
+    DIGIT = 1 << 2,
+    SPACE = 1 << 3,
+};
+
+constexpr std::array<uint8_t, 256> buildClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (int c = 'a'; c <= 'z'; c++)
+        classes[c] = IDENTIFIER_START | IDENTIFIER_PART;
+    for (int c = 'A'; c <= 'Z'; c++)
+        classes[c] = IDENTIFIER_START | IDENTIFIER_PART;
+    for (int c = '0'; c <= '9'; c++) classes[c] = DIGIT | IDENTIFIER_PART;
+    classes['_'] = IDENTIFIER_START | IDENTIFIER_PART;
+    classes['-'] = IDENTIFIER_PART;
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'})
+        classes[static_cast<uint8_t>(c)] = SPACE;
+    return classes;
+}
+
+constexpr std::array<Symbol, 256> buildSymbols() {
+    std::array<Symbol, 256> symbols{};
+    symbols['['] = Symbol::LEFT_BRACKET;
+    symbols[']'] = Symbol::RIGHT_BRACKET;
+    symbols['-'] = Symbol::MINUS;
+    symbols['>'] = Symbol::GREATER;
+    symbols['<'] = Symbol::LESS;
+    symbols['{'] = Symbol::LEFT_BRACE;
+    symbols['}'] = Symbol::RIGHT_BRACE;
+    symbols[':'] = Symbol::COLON;
+    symbols['+'] = Symbol::PLUS;
+    symbols['!'] = Symbol::BANG;
+    symbols['='] = Symbol::EQUALS;
+    symbols['*'] = Symbol::STAR;
+    symbols['/'] = Symbol::SLASH;
+    symbols['%'] = Symbol::PERCENT;
+    symbols[';'] = Symbol::SEMICOLON;
+    symbols['('] = Symbol::LEFT_PARENTHESIS;
+    symbols[')'] = Symbol::RIGHT_PARENTHESIS;
+    symbols['.'] = Symbol::DOT;
+    symbols[','] = Symbol::COMMA;
+    symbols['&'] = Symbol::AMPERSAND;
+    symbols['|'] = Symbol::PIPE;
+    symbols['^'] = Symbol::CARET;
+    return symbols;
+}
+
+constexpr std::array<uint8_t, 256> CHAR_CLASSES = buildClasses();
+constexpr std::array<Symbol, 256> SYMBOLS = buildSymbols();
+
+bool hasClass(char c, uint8_t charClass) {
+    return (CHAR_CLASSES[static_cast<uint8_t>(c)] & charClass) != 0;
+}
+
+}  // namespace
+
+Symbol symbolFromChar(char c) { return SYMBOLS[static_cast<uint8_t>(c)]; }
+
+// Escaped string literals have no spelling in the source to point at, so
+// they point here instead. Every distinct one is kept for the process.
+static std::string_view intern(std::string text) {
+    static std::mutex mutex;
+    static std::unordered_set<std::string> strings;
+    std::lock_guard<std::mutex> lock(mutex);
+    return *strings.insert(std::move(text)).first;
 }
 
-static std::string interpretEscapes(const std::string& raw) {
+static std::string interpretEscapes(std::string_view raw) {
     std::string result;
-    result.reserve(raw.size());  // optimize for performance
+    result.reserve(raw.size());
 
     for (size_t i = 0; i < raw.size(); ++i) {
         if (raw[i] == '\\' && i + 1 < raw.size()) {
@@ -67,59 +130,191 @@ static std::string interpretEscapes(const std::string& raw) {
     return result;
 }
 
-int isidentchar(int c) {
-    return static_cast<int>(static_cast<bool>(std::isalnum(c)) || c == '_' ||
-                            c == '-');
+static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+TokenStream::TokenStream(std::istream& input) : input(&input) {}
+
+TokenStream::TokenStream(std::string_view code)
+    : exhausted(true), source(code) {}
+
+void TokenStream::unexpectedCharacter(size_t start) const {
+    throw std::runtime_error(
+        "Unexpected character '" + std::string(1, source[start]) +
+        "' at line " + std::to_string(line) + ", char " +
+        std::to_string(base + start - lineStart + 1));
 }
 
-std::vector<Token> tokenize(const std::string& code) {
-    const std::string symbols = "[]-><{}:+!=*/%;().,";
-    std::vector<Token> result;
-    size_t char_num = 1;
-    size_t line_num = 1;
-
-    const size_t code_length = code.length();
-    for (size_t i = 0; i < code_length; i++) {
-        const char c = code[i];
-        if (std::isalpha(c) || c == '_') {
-            auto identifier = collectWhile(code, i, char_num, isidentchar);
-            result.emplace_back(TokenType::IDENTIFIER, identifier);
-        } else if (std::isdigit(c) || (c == '-' && i + 1 < code_length &&
-                                       std::isdigit(code[i + 1]))) {
+void TokenStream::unterminatedString(size_t start) const {
+    size_t endLine = line;
+    size_t endLineStart = lineStart;
+    for (size_t j = start; j < source.size(); j++)
+        if (source[j] == '\n') {
+            ++endLine;
+            endLineStart = base + j + 1;
+        }
+    throw UnexpectedEOFError(
+        "String Literal at line " + std::to_string(endLine) + ", char " +
+            std::to_string(base + source.size() - endLineStart + 1),
+        "\"");
+}
+
+// Lexes the token at `position` and hands it to `emit` along with where it
+// starts, the line it starts on and whether it was interned; false at the
+// end of the source. A token that reaches the end of what has been read so
+// far may go on in the next chunk, so it is lexed again once that has been
+// read.
+template <typename Emit>
+bool TokenStream::lex(Emit emit) {
+    while (true) {
+        const char* data = source.data();
+        const size_t size = source.size();
+        size_t i = position - base;
+        while (i < size && hasClass(data[i], SPACE)) {
+            if (data[i] == '\n') {
+                ++line;
+                lineStart = base + i + 1;
+            }
             ++i;
-            ++char_num;
-            auto int_lit = std::string(1, c) +
-                           collectWhile(code, i, char_num, std::isdigit);
-            result.emplace_back(TokenType::INT_LIT, int_lit);
+        }
+        position = base + i;
+        if (i == size) {
+            if (fill()) continue;
+            return false;
+        }
+
+        const size_t start = i;
+        const char c = data[i];
+        TokenType type;
+        bool escaped = false;
+        if (hasClass(c, IDENTIFIER_START)) {
+            type = TokenType::IDENTIFIER;
+            while (++i < size && hasClass(data[i], IDENTIFIER_PART)) {
+            }
+            if (i == size && fill()) continue;
+        } else if (hasClass(c, DIGIT) ||
+                   (c == '-' && i + 1 < size && hasClass(data[i + 1], DIGIT))) {
+            type = TokenType::INT_LIT;
+            while (++i < size && hasClass(data[i], DIGIT)) {
+            }
+            if (i == size && fill()) continue;
         } else if (c == '"') {
-            std::string string_lit;
+            type = TokenType::STRING_LIT;
             ++i;
-            ++char_num;
-            while (i < code_length && (code[i] != '"' || code[i - 1] == '\\')) {
-                string_lit += code[i++];
-                ++char_num;
+            while (i < size && (data[i] != '"' || data[i - 1] == '\\')) {
+                escaped |= data[i] == '\\';
+                ++i;
+            }
+            if (i == size) {
+                if (fill()) continue;
+                unterminatedString(start);
             }
-            if (i >= code_length)
-                throw UnexpectedEOFError(
-                    "String Literal at line " + std::to_string(line_num) +
-                        ", char " + std::to_string(char_num),
-                    "\"");
-            result.emplace_back(TokenType::STRING_LIT,
-                                interpretEscapes(string_lit));
-        } else if (c == '\n') {
-            ++line_num;
-            char_num = 1;
-        } else if (symbols.find(c) != std::string::npos) {
-            result.emplace_back(TokenType::SYMBOL, std::string(1, c));
-        } else if (!std::isspace(c)) {
-            throw std::runtime_error("Unexpected character '" +
-                                     std::string(1, c) + "' at line " +
-                                     std::to_string(line_num) + ", char " +
-                                     std::to_string(char_num));
+            ++i;
+        } else if (c == '-' && i + 1 == size && fill()) {
+            // A '-' that ends the chunk may start a negative number.
+            continue;
+        } else if (symbolFromChar(c) != Symbol::NONE) {
+            type = TokenType::SYMBOL;
+            ++i;
+        } else {
+            unexpectedCharacter(start);
+        }
+
+        std::string_view text(data + start, i - start);
+        size_t offset = position;
+        size_t tokenLine = line;
+        if (type == TokenType::STRING_LIT) {
+            for (size_t j = start; j < i; j++)
+                if (data[j] == '\n') {
+                    ++line;
+                    lineStart = base + j + 1;
+                }
+            text = text.substr(1, text.size() - 2);
+            ++offset;
+            if (escaped) text = intern(interpretEscapes(text));
         }
-        char_num++;
+        position = base + i;
+        emit(type, text, offset, tokenLine, escaped);
+        return true;
     }
+}
+
+// Reads another chunk, first dropping the source before the oldest token
+// still held. Moving the buffer moves the text the held tokens view, so
+// they are pointed at it again. False once the input is used up.
+bool TokenStream::fill() {
+    if (input == nullptr || exhausted) {
+        exhausted = true;
+        return false;
+    }
+    size_t keep = head == window.size() ? position : window[head].offset;
+    buffer.erase(0, keep - base);
+    base = keep;
+    size_t resident = buffer.size();
+    buffer.resize(resident + CHUNK_SIZE);
+    input->read(buffer.data() + resident, CHUNK_SIZE);
+    if (input->bad()) throw std::runtime_error("Failed to read source");
+    size_t count = static_cast<size_t>(input->gcount());
+    buffer.resize(resident + count);
+    source = buffer;
+    for (size_t j = head; j < window.size(); j++) {
+        Entry& entry = window[j];
+        if (!entry.interned)
+            entry.token = Token(entry.token.getType(),
+                                source.substr(entry.offset - base,
+                                              entry.token.getValue().size()));
+    }
+    exhausted = count == 0;
+    return !exhausted;
+}
+
+bool TokenStream::has(size_t i) {
+    auto push = [this](TokenType type, std::string_view text, size_t offset,
+                       size_t line, bool interned) {
+        window.push_back({Token(type, text), offset, line, interned});
+    };
+    while (first + window.size() - head <= i)
+        if (!lex(push)) return false;
+    return true;
+}
 
+TokenStream::Entry& TokenStream::entry(size_t i) {
+    if (i < first)
+        throw std::runtime_error("Token " + std::to_string(i) +
+                                 " has already been released");
+    if (!has(i)) throw UnexpectedEOFError("Source", "token");
+    return window[head + i - first];
+}
+
+const Token& TokenStream::operator[](size_t i) { return entry(i).token; }
+
+size_t TokenStream::lineOf(size_t i) { return entry(i).line; }
+
+void TokenStream::release(size_t i) {
+    if (i <= first) return;
+    size_t count = std::min(i - first, window.size() - head);
+    head += count;
+    first += count;
+    // Released entries are dropped in bulk once they make up half the
+    // window, so releasing costs amortized constant time.
+    if (head == window.size()) {
+        window.clear();
+        head = 0;
+    } else if (head >= 64 && head * 2 >= window.size()) {
+        window.erase(window.begin(), window.begin() + head);
+        head = 0;
+    }
+}
+
+std::vector<Token> tokenize(const std::string& code) {
+    std::vector<Token> result;
+    // Typical source averages a little over three bytes per token.
+    result.reserve(code.size() / 3);
+    // Nothing is held for lookahead, so the window can be skipped.
+    TokenStream stream(code);
+    auto push = [&result](TokenType type, std::string_view text, size_t,
+                          size_t, bool) { result.emplace_back(type, text); };
+    while (stream.lex(push)) {
+    }
     return result;
 }
 
@@ -137,15 +332,26 @@ std::string tokenTypeToString(const TokenType& type) {
             return "UNKNOWN";
     }
 }
-Token::Token(TokenType type, std::string value) : type(type), value(value) {}
 
-Token::operator std::string() {
-    return tokenTypeToString(type) + " - " + value;
+Token::Token(TokenType type, std::string_view value)
+    : type(type),
+      symbol(type == TokenType::SYMBOL && value.size() == 1
+                 ? symbolFromChar(value[0])
+                 : Symbol::NONE),
+      value(value) {}
+
+Token::operator std::string() const {
+    return tokenTypeToString(type) + " - " + std::string(value);
 }
 
 bool Token::operator==(const Token& other) const {
-    return type == other.getType() && value == other.getValue();
+    if (type != other.type) return false;
+    if (type == TokenType::SYMBOL) return symbol == other.symbol;
+    return value == other.value;
 }
+
 const TokenType& Token::getType() const { return type; }
 
-const std::string& Token::getValue() const { return value; }
+std::string_view Token::getValue() const { return value; }
+
+Symbol Token::getSymbol() const { return symbol; }
@@ -1,29 +1,156 @@
 // Copyright 2025 Caden Crowson
 
+#include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
 
+#include "compiler/emit.h"
 #include "runtime/interpreter.h"
+#include "runtime/server.h"
+#include "runtime/stats.h"
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [--engine=walker|vm] [--threads=N] [--parallel-threshold=N]"
+                 " [--gpu-threshold=N] [--max-depth=N] [--output-buffer=N]"
+                 " [--memo-limit=N] [--no-module-cache]"
+                 " [--no-tiering] [--profile[=FILE]] [--stats]"
+                 " [--emit-cpp[=FILE]] [--connect=SOCKET]"
+                 " <filename> [args...]\n"
+              << "       " << program
+              << " [options] --serve=SOCKET [--workers=N]\n";
+}
+
+// Writes the script's C++ translation to `output`, or stdout when it's empty.
+static int emit(const std::string& filename, const std::string& output) {
+    try {
+        if (output.empty()) {
+            emitCpp(filename, std::cout);
+            return 0;
+        }
+        std::ofstream file(output);
+        if (!file) {
+            std::cerr << "Error: Could not open " << output << '\n';
+            return 1;
+        }
+        emitCpp(filename, file);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+// Parses `--name=N` options; anything but a non-negative integer is rejected.
+static std::optional<size_t> optionValue(const std::string& option,
+                                         const std::string& prefix) {
+    if (option.rfind(prefix, 0) != 0) return std::nullopt;
+    std::string digits = option.substr(prefix.size());
+    if (digits.empty() ||
+        digits.find_first_not_of("0123456789") != std::string::npos)
+        return std::nullopt;
+    return std::stoul(digits);
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename> [args...]\n";
+    InterpretOptions options;
+    std::optional<std::string> emitOutput;
+    std::optional<std::string> serveSocket;
+    std::optional<std::string> connectSocket;
+    size_t workers = 0;
+    int first = 1;
+    for (; first < argc; ++first) {
+        const std::string option = argv[first];
+        if (option.rfind("--", 0) != 0) break;
+        if (option == "--engine=walker") {
+            options.engine = Engine::TREE_WALKER;
+        } else if (option == "--engine=vm") {
+            options.engine = Engine::VM;
+        } else if (option == "--no-module-cache") {
+            options.moduleCache = false;
+        } else if (option == "--no-tiering") {
+            options.tiering = false;
+        } else if (option == "--emit-cpp") {
+            emitOutput = "";
+        } else if (option.rfind("--emit-cpp=", 0) == 0 && option.size() > 11) {
+            emitOutput = option.substr(11);
+        } else if (option.rfind("--serve=", 0) == 0 && option.size() > 8) {
+            serveSocket = option.substr(8);
+        } else if (option.rfind("--connect=", 0) == 0 && option.size() > 10) {
+            connectSocket = option.substr(10);
+        } else if (auto value = optionValue(option, "--workers=")) {
+            workers = value.value();
+        } else if (option == "--stats") {
+            // Registered here so exit() and runtime errors print them too.
+            enableStats();
+            std::atexit([]() { printStats(std::cerr); });
+        } else if (option == "--profile") {
+            options.profile = "ints.prof";
+        } else if (option.rfind("--profile=", 0) == 0 && option.size() > 10) {
+            options.profile = option.substr(10);
+        } else if (auto value = optionValue(option, "--threads=")) {
+            options.threads = value.value();
+        } else if (auto value = optionValue(option, "--parallel-threshold=")) {
+            options.parallelThreshold = value.value();
+        } else if (auto value = optionValue(option, "--gpu-threshold=")) {
+            options.gpuThreshold = value.value();
+        } else if (auto value = optionValue(option, "--max-depth=")) {
+            options.maxCallDepth = value.value();
+        } else if (auto value = optionValue(option, "--output-buffer=")) {
+            options.outputBuffer = value.value();
+        } else if (auto value = optionValue(option, "--memo-limit=")) {
+            options.memoLimit = value.value();
+        } else {
+            std::cerr << "Unknown option " << option << '\n';
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!options.profile.empty() && options.engine == Engine::VM) {
+        std::cerr << "--profile is only supported by the walker engine\n";
+        return 1;
+    }
+    if (serveSocket.has_value()) {
+        if (!options.profile.empty()) {
+            std::cerr << "--profile is not supported by --serve\n";
+            return 1;
+        }
+        try {
+            serve(serveSocket.value(), workers, options);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
+        }
+        return 1;
+    }
+    if (first >= argc) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    const std::string filename = argv[1];
+    const std::string filename = argv[first];
+    if (emitOutput.has_value()) return emit(filename, emitOutput.value());
     std::vector<std::string> args;
-    for (int i = 2; i < argc; ++i) {
+    for (int i = first + 1; i < argc; ++i) {
         args.emplace_back(argv[i]);
     }
+    if (connectSocket.has_value()) {
+        try {
+            return runOnServer(connectSocket.value(), filename, args);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
 
-    interpret(filename, argc - 2, args);
+    interpret(filename, std::move(args), options);
 
-    while (isGuiRunning())
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    waitForGui();
 
     return 0;
 }
@@ -0,0 +1,153 @@
+// Copyright 2025 Caden Crowson
+
+#include "parser/fold.h"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "runtime/value.h"
+
+namespace {
+
+// The elements of an expression that is nothing but a literal.
+const std::vector<int>* literal(const ExpressionNode& expression) {
+    if (!expression.getPostfix().getValues().empty()) return nullptr;
+    auto array =
+        std::get_if<std::shared_ptr<ArrayNode>>(&expression.getPrimary());
+    if (array == nullptr) return nullptr;
+    return std::get_if<std::vector<int>>(&(*array)->getValue());
+}
+
+std::vector<int> elements(const Value& value) {
+    ArrayView view = value.view();
+    return std::vector<int>(view.begin(), view.end());
+}
+
+// Division by zero throws, so it is left to happen when the script gets to
+// it, with the line it is on.
+bool canDivide(const std::vector<int>& divisors) {
+    for (int divisor : divisors)
+        if (divisor == 0) return false;
+    return true;
+}
+
+Value literalValue(const std::vector<int>& elements) {
+    DynamicArray literal(elements.size());
+    std::copy(elements.begin(), elements.end(), literal.data);
+    return Value(std::move(literal), elements.size());
+}
+
+std::optional<std::vector<int>> foldArithmetic(
+    const ArithmeticNode& arithmetic) {
+    auto left = literal(*arithmetic.left);
+    auto right = literal(*arithmetic.right);
+    if (left == nullptr || right == nullptr) return std::nullopt;
+    if ((arithmetic.type == ArithmeticNode::TYPE_DIVISION ||
+         arithmetic.type == ArithmeticNode::TYPE_MODULO) &&
+        !canDivide(*right))
+        return std::nullopt;
+    Value leftValue = literalValue(*left);
+    Value rightValue = literalValue(*right);
+    try {
+        switch (arithmetic.type) {
+            case ArithmeticNode::TYPE_ADDITION:
+                return elements(leftValue + rightValue);
+            case ArithmeticNode::TYPE_SUBTRACTION:
+                return elements(leftValue - rightValue);
+            case ArithmeticNode::TYPE_MULTIPLICATION:
+                return elements(leftValue * rightValue);
+            case ArithmeticNode::TYPE_DIVISION:
+                return elements(leftValue / rightValue);
+            case ArithmeticNode::TYPE_MODULO:
+                return elements(leftValue % rightValue);
+            case ArithmeticNode::TYPE_AND:
+                return elements(leftValue & rightValue);
+            case ArithmeticNode::TYPE_OR:
+                return elements(leftValue | rightValue);
+            case ArithmeticNode::TYPE_XOR:
+                return elements(leftValue ^ rightValue);
+            case ArithmeticNode::TYPE_SHIFT_LEFT:
+                return elements(leftValue << rightValue);
+            case ArithmeticNode::TYPE_SHIFT_RIGHT:
+                return elements(leftValue >> rightValue);
+            default:
+                return std::nullopt;
+        }
+    } catch (const std::runtime_error&) {
+        // Mismatched lengths, reported when the expression runs.
+        return std::nullopt;
+    }
+}
+
+std::optional<size_t> constantBound(
+    const std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>&
+        bound,
+    size_t otherwise) {
+    if (!bound.has_value()) return otherwise;
+    if (auto index = std::get_if<size_t>(&bound.value())) return *index;
+    auto value =
+        literal(*std::get<std::shared_ptr<ExpressionNode>>(bound.value()));
+    if (value == nullptr || value->size() != 1 || (*value)[0] < 0)
+        return std::nullopt;
+    return (*value)[0];
+}
+
+// Applies one postfix step to a literal, if it can be done now.
+bool foldPostfix(
+    const std::variant<std::shared_ptr<ArrayRangeNode>,
+                       std::shared_ptr<MethodNode>>& step,
+    std::vector<int>& values) {
+    if (auto range = std::get_if<std::shared_ptr<ArrayRangeNode>>(&step)) {
+        auto start = constantBound((*range)->getStart(), 0);
+        auto end = constantBound((*range)->getEnd(), values.size());
+        if (!start || !end || *end < *start || *end > values.size())
+            return false;
+        values = std::vector<int>(values.begin() + *start,
+                                  values.begin() + *end);
+        return true;
+    }
+    auto& method = *std::get<std::shared_ptr<MethodNode>>(step);
+    if (method.getBuiltin() != BuiltinMethod::SIZE ||
+        !method.getParameters().empty() || values.size() > INT_MAX)
+        return false;
+    values = {static_cast<int>(values.size())};
+    return true;
+}
+
+}  // namespace
+
+void foldExpression(ExpressionNode& expression) {
+    std::optional<std::vector<int>> values;
+    if (auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+            &expression.getPrimary())) {
+        values = foldArithmetic(**arithmetic);
+    } else {
+        auto& array = *std::get<std::shared_ptr<ArrayNode>>(
+            expression.getPrimary());
+        if (auto literal = std::get_if<std::vector<int>>(&array.getValue()))
+            values = *literal;
+    }
+    if (values.has_value()) {
+        size_t steps = 0;
+        for (auto& step : expression.getPostfix().getValues()) {
+            if (!foldPostfix(step, values.value())) break;
+            steps++;
+        }
+        if (steps != 0 || std::holds_alternative<
+                              std::shared_ptr<ArithmeticNode>>(
+                              expression.getPrimary()))
+            expression.fold(std::move(values.value()), steps);
+    }
+    auto array =
+        std::get_if<std::shared_ptr<ArrayNode>>(&expression.getPrimary());
+    if (array == nullptr || (*array)->getLiteral() != nullptr) return;
+    if (auto literal = std::get_if<std::vector<int>>(&(*array)->getValue()))
+        (*array)->setLiteral(
+            std::make_shared<const Value>(literalValue(*literal)));
+}
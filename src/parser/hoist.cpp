@@ -0,0 +1,293 @@
+// Copyright 2025 Caden Crowson
+
+#include "parser/hoist.h"
+
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "runtime/builtins.h"
+
+namespace {
+
+using Condition = std::variant<std::shared_ptr<IfCompareNode>,
+                               std::shared_ptr<IfDeclarationNode>>;
+using Bound =
+    std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>;
+
+// The locals written anywhere inside a loop, nested loops and pfor bodies
+// included.
+class Writes {
+ public:
+    void body(const BodyNode& body) {
+        for (auto& statement : body.getStatements())
+            this->statement(*statement);
+    }
+
+    void condition(const Condition& condition) {
+        if (auto declaration =
+                std::get_if<std::shared_ptr<IfDeclarationNode>>(&condition))
+            write((*declaration)->getVariableDeclaration()->getSlot());
+    }
+
+    void forLoop(const ForLoopNode& forLoop) {
+        slots.insert(forLoop.getElementSlot());
+        for (auto& reduction : forLoop.getReductions())
+            slots.insert(reduction->getSlot());
+        body(*forLoop.getBody());
+    }
+
+    std::unordered_set<size_t> slots;
+
+ private:
+    void write(const std::optional<VariableSlot>& slot) {
+        if (slot.has_value()) slots.insert(slot->index);
+    }
+
+    void ifChain(const IfNode& ifNode) {
+        condition(ifNode.getCondition());
+        body(*ifNode.getBody());
+        if (ifNode.getElseIfBranches().has_value())
+            ifChain(*ifNode.getElseIfBranches().value());
+        if (ifNode.getElseBody().has_value())
+            body(*ifNode.getElseBody().value());
+    }
+
+    void statement(const StatementNode& statement) {
+        auto& value = statement.getValue();
+        if (auto binding =
+                std::get_if<std::shared_ptr<VariableBindingNode>>(&value)) {
+            std::visit([this](auto&& node) { write(node->getSlot()); },
+                       (*binding)->getValue());
+        } else if (auto loop =
+                       std::get_if<std::shared_ptr<ForLoopNode>>(&value)) {
+            forLoop(**loop);
+        } else if (auto whileNode =
+                       std::get_if<std::shared_ptr<WhileNode>>(&value)) {
+            condition((*whileNode)->getCondition());
+            body(*(*whileNode)->getBody());
+        } else if (auto ifNode = std::get_if<std::shared_ptr<IfNode>>(&value)) {
+            ifChain(**ifNode);
+        }
+    }
+};
+
+class Hoisting {
+ public:
+    explicit Hoisting(FunctionDefinitionNode& function)
+        : function(function), next(function.getFrameSize()) {}
+
+    void run() {
+        body(*function.getBody());
+        function.setFrameSize(next);
+    }
+
+ private:
+    struct Loop {
+        std::unordered_set<size_t> written;
+        std::vector<size_t> hoisted;
+    };
+
+    // Only expressions that do some work are worth a slot: a plain variable
+    // or literal is already read in place, and arithmetic on two single
+    // elements is cheaper than looking a slot up.
+    static bool worthwhile(const ExpressionNode& expression) {
+        if (!expression.getPostfix().getValues().empty()) return true;
+        auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+            &expression.getPrimary());
+        return arithmetic != nullptr && !(*arithmetic)->scalar;
+    }
+
+    static bool invariant(const Bound& bound, const Loop& loop) {
+        if (!bound.has_value()) return true;
+        auto value = std::get_if<std::shared_ptr<ExpressionNode>>(&*bound);
+        return value == nullptr || invariant(**value, loop);
+    }
+
+    static bool invariant(const ArrayNode& array, const Loop& loop) {
+        auto& value = array.getValue();
+        if (std::holds_alternative<std::vector<int>>(value)) return true;
+        if (std::holds_alternative<std::shared_ptr<FunctionCallNode>>(value))
+            return false;
+        // Globals can change in any call the loop makes.
+        auto& slot = array.getSlot();
+        return slot.has_value() && loop.written.count(slot->index) == 0;
+    }
+
+    static bool invariant(const ExpressionNode& expression, const Loop& loop) {
+        if (auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+                &expression.getPrimary())) {
+            if (!invariant(*(*arithmetic)->left, loop) ||
+                !invariant(*(*arithmetic)->right, loop))
+                return false;
+        } else if (!invariant(*std::get<std::shared_ptr<ArrayNode>>(
+                                  expression.getPrimary()),
+                              loop)) {
+            return false;
+        }
+        for (auto& postfix : expression.getPostfix().getValues()) {
+            if (auto range =
+                    std::get_if<std::shared_ptr<ArrayRangeNode>>(&postfix)) {
+                if (!invariant((*range)->getStart(), loop) ||
+                    !invariant((*range)->getEnd(), loop))
+                    return false;
+                continue;
+            }
+            auto& method = *std::get<std::shared_ptr<MethodNode>>(postfix);
+            if (!method.getBuiltin().has_value() ||
+                !isPureMethod(method.getBuiltin().value()))
+                return false;
+            for (auto& parameter : method.getParameters())
+                if (!invariant(*parameter, loop)) return false;
+        }
+        return true;
+    }
+
+    // Hoists the expression out of the outermost loop it doesn't change in,
+    // or failing that, whatever parts of it it can.
+    void expression(ExpressionNode& expression) {
+        if (worthwhile(expression)) {
+            for (auto& loop : loops) {
+                if (!invariant(expression, loop)) continue;
+                expression.setHoistedSlot({next});
+                loop.hoisted.push_back(next++);
+                return;
+            }
+        }
+        if (auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+                &expression.getPrimary())) {
+            this->expression(*(*arithmetic)->left);
+            this->expression(*(*arithmetic)->right);
+        } else if (auto call = std::get_if<std::shared_ptr<FunctionCallNode>>(
+                       &std::get<std::shared_ptr<ArrayNode>>(
+                            expression.getPrimary())
+                            ->getValue())) {
+            expressions((*call)->getParameters());
+        }
+        for (auto& postfix : expression.getPostfix().getValues()) {
+            if (auto range =
+                    std::get_if<std::shared_ptr<ArrayRangeNode>>(&postfix)) {
+                bound((*range)->getStart());
+                bound((*range)->getEnd());
+            } else {
+                expressions(
+                    std::get<std::shared_ptr<MethodNode>>(postfix)
+                        ->getParameters());
+            }
+        }
+    }
+
+    void expressions(
+        const std::vector<std::shared_ptr<ExpressionNode>>& expressions) {
+        for (auto& expression : expressions) this->expression(*expression);
+    }
+
+    void bound(const Bound& bound) {
+        if (!bound.has_value()) return;
+        if (auto value = std::get_if<std::shared_ptr<ExpressionNode>>(&*bound))
+            expression(**value);
+    }
+
+    void condition(const Condition& condition) {
+        if (auto compare =
+                std::get_if<std::shared_ptr<IfCompareNode>>(&condition)) {
+            expression(*(*compare)->getLeft());
+            expression(*(*compare)->getRight());
+        } else if (auto& value =
+                       std::get<std::shared_ptr<IfDeclarationNode>>(condition)
+                           ->getVariableDeclaration()
+                           ->getValue()) {
+            expression(*value.value());
+        }
+    }
+
+    void ifChain(const IfNode& ifNode) {
+        condition(ifNode.getCondition());
+        body(*ifNode.getBody());
+        if (ifNode.getElseIfBranches().has_value())
+            ifChain(*ifNode.getElseIfBranches().value());
+        if (ifNode.getElseBody().has_value())
+            body(*ifNode.getElseBody().value());
+    }
+
+    // The iterable is evaluated once, before the loop starts.
+    void forLoop(ForLoopNode& forLoop) {
+        expression(*forLoop.getIterable());
+        if (forLoop.isParallel()) {
+            std::vector<Loop> outer = std::move(loops);
+            loops.clear();
+            body(*forLoop.getBody());
+            loops = std::move(outer);
+            return;
+        }
+        Writes writes;
+        writes.forLoop(forLoop);
+        loops.push_back(Loop{std::move(writes.slots), {}});
+        body(*forLoop.getBody());
+        forLoop.setHoistedSlots(std::move(loops.back().hoisted));
+        loops.pop_back();
+    }
+
+    void whileLoop(WhileNode& whileNode) {
+        Writes writes;
+        writes.condition(whileNode.getCondition());
+        writes.body(*whileNode.getBody());
+        loops.push_back(Loop{std::move(writes.slots), {}});
+        condition(whileNode.getCondition());
+        body(*whileNode.getBody());
+        whileNode.setHoistedSlots(std::move(loops.back().hoisted));
+        loops.pop_back();
+    }
+
+    void statement(const StatementNode& statement) {
+        auto& value = statement.getValue();
+        if (auto binding =
+                std::get_if<std::shared_ptr<VariableBindingNode>>(&value)) {
+            if (auto declaration =
+                    std::get_if<std::shared_ptr<VariableDeclarationNode>>(
+                        &(*binding)->getValue())) {
+                if (auto& initial = (*declaration)->getValue())
+                    expression(*initial.value());
+            } else {
+                expression(
+                    *std::get<std::shared_ptr<VariableAssignmentNode>>(
+                         (*binding)->getValue())
+                         ->getRight());
+            }
+        } else if (auto loop =
+                       std::get_if<std::shared_ptr<ForLoopNode>>(&value)) {
+            forLoop(**loop);
+        } else if (auto whileNode =
+                       std::get_if<std::shared_ptr<WhileNode>>(&value)) {
+            whileLoop(**whileNode);
+        } else if (auto ifNode = std::get_if<std::shared_ptr<IfNode>>(&value)) {
+            ifChain(**ifNode);
+        } else if (auto call =
+                       std::get_if<std::shared_ptr<FunctionCallNode>>(&value)) {
+            expressions((*call)->getParameters());
+        } else if (auto returnNode =
+                       std::get_if<std::shared_ptr<ReturnNode>>(&value)) {
+            expression(*(*returnNode)->getValue());
+        }
+    }
+
+    void body(const BodyNode& body) {
+        for (auto& statement : body.getStatements())
+            this->statement(*statement);
+    }
+
+    FunctionDefinitionNode& function;
+    // The loops being walked, outermost first, as far out as the nearest
+    // pfor.
+    std::vector<Loop> loops;
+    size_t next;
+};
+
+}  // namespace
+
+void hoistInvariants(FunctionDefinitionNode& function) {
+    Hoisting(function).run();
+}
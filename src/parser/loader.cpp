@@ -0,0 +1,147 @@
+// Copyright 2025 Caden Crowson
+
+#include "parser/loader.h"
+
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "parser/module.h"
+#include "parser/resolve.h"
+
+namespace {
+
+// What a file is as of now, to tell whether it changed after being read.
+struct Stamp {
+    bool exists = false;
+    uintmax_t size = 0;
+    std::filesystem::file_time_type modified;
+
+    bool operator==(const Stamp& other) const {
+        return exists == other.exists && size == other.size &&
+               modified == other.modified;
+    }
+};
+
+Stamp stamp(const std::string& filename) {
+    std::error_code error;
+    Stamp result;
+    result.size = std::filesystem::file_size(filename, error);
+    if (error) return Stamp();
+    result.modified = std::filesystem::last_write_time(filename, error);
+    if (error) return Stamp();
+    result.exists = true;
+    return result;
+}
+
+RootNode loadResolved(const std::string& filename, bool cached) {
+    RootNode root = loadModule(filename, cached);
+    resolveVariables(root);
+    return root;
+}
+
+}  // namespace
+
+struct ModuleLoader::Pending {
+    // Taken before the file is read, so a change while it is being read
+    // still shows.
+    Stamp stamp;
+    ThreadPool::Job job;
+    std::optional<RootNode> root;
+    bool taken = false;
+};
+
+ModuleLoader::ModuleLoader(bool cached) : cached(cached) {}
+
+ModuleLoader::~ModuleLoader() {
+    // Loads that are running may start more.
+    while (true) {
+        std::vector<ThreadPool::Job> running;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running.swap(jobs);
+        }
+        if (running.empty()) return;
+        for (auto& job : running) {
+            try {
+                waitForJob(job);
+            } catch (...) {
+                // Nothing took the file, so its error doesn't matter.
+            }
+        }
+    }
+}
+
+RootNode ModuleLoader::loadMain(const std::string& filename) {
+    return load(filename, false);
+}
+
+RootNode ModuleLoader::loadUsed(const std::string& filename) {
+    return load(filename, cached);
+}
+
+RootNode ModuleLoader::load(const std::string& filename, bool cachedHere) {
+    std::shared_ptr<Pending> prefetched;
+    if (cachedHere == cached) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = pending.find(filename);
+        if (found != pending.end() && !found->second->taken) {
+            prefetched = found->second;
+            prefetched->taken = true;
+        }
+    }
+    std::optional<RootNode> root;
+    if (prefetched) {
+        std::exception_ptr error;
+        try {
+            waitForJob(prefetched->job);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (prefetched->stamp == stamp(filename)) {
+            if (error) std::rethrow_exception(error);
+            root = std::move(prefetched->root);
+        }
+    }
+    if (!root) {
+        root = loadResolved(filename, cachedHere);
+        prefetchUses(*root);
+    }
+    return std::move(*root);
+}
+
+// Errors are left for load() to rethrow, and a file that can't be read yet
+// may still be written before its `use` is reached.
+void ModuleLoader::prefetchUses(const RootNode& root) {
+    for (auto& value : root.getValues()) {
+        auto use = std::get_if<std::shared_ptr<UseNode>>(&value);
+        if (use == nullptr || (*use)->getType() != UseNode::Type::PATH)
+            continue;
+        auto path =
+            std::get_if<std::vector<int>>(&(*use)->getValue()->getValue());
+        if (path == nullptr) continue;
+        // With one thread there is nothing for the loads to overlap with.
+        // Asking starts the thread pool, so scripts that use no files never
+        // do.
+        if (parallelThreads() == 1) return;
+        std::string filename(path->begin(), path->end());
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.count(filename) != 0) continue;
+        auto file = std::make_shared<Pending>();
+        file->stamp = stamp(filename);
+        pending.emplace(filename, file);
+        file->job = spawnJob([this, file, filename] {
+            file->root = loadResolved(filename, cached);
+            prefetchUses(*file->root);
+        });
+        jobs.push_back(file->job);
+    }
+}
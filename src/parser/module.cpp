@@ -0,0 +1,697 @@
+// Copyright 2025 Caden Crowson
+
+#include "parser/module.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "lexer/tokenize.h"
+#include "util/arena.h"
+#include "util/file.h"
+
+namespace {
+
+constexpr std::string_view MAGIC = "INTSAST";
+// Bumped whenever the encoding or the node classes change.
+constexpr uint64_t FORMAT_VERSION = 7;
+
+// What a cache file has to match to stand in for its source.
+struct SourceKey {
+    std::string path;
+    uint64_t size;
+    int64_t modified;
+};
+
+std::optional<SourceKey> sourceKey(const std::string& filename) {
+    std::error_code error;
+    auto path = std::filesystem::absolute(filename, error);
+    if (error) return std::nullopt;
+    auto size = std::filesystem::file_size(path, error);
+    if (error) return std::nullopt;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) return std::nullopt;
+    return SourceKey{path.lexically_normal().string(), size,
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         modified.time_since_epoch())
+                         .count()};
+}
+
+std::optional<std::filesystem::path> cacheDirectory() {
+    const char* directory = std::getenv("INTS_CACHE_DIR");
+    if (directory != nullptr && *directory != '\0') return directory;
+    directory = std::getenv("XDG_CACHE_HOME");
+    if (directory != nullptr && *directory != '\0')
+        return std::filesystem::path(directory) / "ints";
+    directory = std::getenv("HOME");
+    if (directory != nullptr && *directory != '\0')
+        return std::filesystem::path(directory) / ".cache" / "ints";
+    return std::nullopt;
+}
+
+uint64_t fnv1a(std::string_view bytes) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Cache files are named after a hash of the source's path; the full path is
+// checked again on load.
+std::string cacheName(std::string_view path) {
+    uint64_t hash = fnv1a(path);
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.astc",
+                  static_cast<unsigned long long>(hash));
+    return name;
+}
+
+// Numbers are LEB128 varints, with signed ones zigzag encoded first. Each
+// variant is written as its alternative's index followed by that
+// alternative, so the order of the alternatives in parse.h is part of the
+// format.
+class ModuleWriter {
+ public:
+    std::string take() { return std::move(out); }
+
+    // `checksum` is the hash of the payload that follows the header.
+    void header(const SourceKey& key, uint64_t checksum) {
+        out.append(MAGIC);
+        number(FORMAT_VERSION);
+        string(key.path);
+        number(key.size);
+        integer(key.modified);
+        number(checksum);
+    }
+
+    void root(const RootNode& root) {
+        number(root.getValues().size());
+        for (auto& value : root.getValues()) {
+            number(value.index());
+            std::visit(
+                [this](auto&& arg) {
+                    using T = std::decay_t<decltype(arg)>;
+                    constexpr bool isVariableBinding =
+                        std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
+                    constexpr bool isFunctionCall =
+                        std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                    constexpr bool isFunctionDef = std::is_same_v<
+                        T, std::shared_ptr<FunctionDefinitionNode>>;
+                    if constexpr (isVariableBinding) {
+                        binding(*arg);
+                    } else if constexpr (isFunctionCall) {
+                        call(*arg);
+                    } else if constexpr (isFunctionDef) {
+                        function(*arg);
+                    } else {
+                        use(*arg);
+                    }
+                },
+                value);
+        }
+    }
+
+ private:
+    void number(uint64_t value) {
+        for (; value >= 0x80; value >>= 7)
+            out.push_back(static_cast<char>(value | 0x80));
+        out.push_back(static_cast<char>(value));
+    }
+
+    void integer(int64_t value) {
+        number((static_cast<uint64_t>(value) << 1) ^
+               static_cast<uint64_t>(value >> 63));
+    }
+
+    void string(std::string_view value) {
+        number(value.size());
+        out.append(value);
+    }
+
+    void expressions(
+        const std::vector<std::shared_ptr<ExpressionNode>>& expressions) {
+        number(expressions.size());
+        for (auto& expression : expressions) this->expression(*expression);
+    }
+
+    void expression(const ExpressionNode& expression) {
+        auto& primary = expression.getPrimary();
+        number(primary.index());
+        if (auto arithmetic =
+                std::get_if<std::shared_ptr<ArithmeticNode>>(&primary)) {
+            number((*arithmetic)->type);
+            this->expression(*(*arithmetic)->left);
+            this->expression(*(*arithmetic)->right);
+        } else {
+            array(*std::get<std::shared_ptr<ArrayNode>>(primary));
+        }
+        auto& postfix = expression.getPostfix().getValues();
+        number(postfix.size());
+        for (auto& value : postfix) {
+            number(value.index());
+            if (auto range = std::get_if<std::shared_ptr<ArrayRangeNode>>(
+                    &value)) {
+                bound((*range)->getStart());
+                bound((*range)->getEnd());
+            } else {
+                auto& method = std::get<std::shared_ptr<MethodNode>>(value);
+                string(method->getIdentifier());
+                expressions(method->getParameters());
+            }
+        }
+    }
+
+    void bound(
+        const std::optional<
+            std::variant<size_t, std::shared_ptr<ExpressionNode>>>& bound) {
+        number(bound.has_value() ? bound->index() + 1 : 0);
+        if (!bound.has_value()) return;
+        if (auto constant = std::get_if<size_t>(&bound.value()))
+            number(*constant);
+        else
+            expression(*std::get<std::shared_ptr<ExpressionNode>>(*bound));
+    }
+
+    void array(const ArrayNode& array) {
+        auto& value = array.getValue();
+        number(value.index());
+        if (auto literal = std::get_if<std::vector<int>>(&value)) {
+            number(literal->size());
+            for (int element : *literal) integer(element);
+        } else if (auto identifier = std::get_if<std::string>(&value)) {
+            string(*identifier);
+        } else {
+            call(*std::get<std::shared_ptr<FunctionCallNode>>(value));
+        }
+    }
+
+    void call(const FunctionCallNode& call) {
+        string(call.getIdentifier());
+        expressions(call.getParameters());
+    }
+
+    void descriptor(const ArrayDescriptor& descriptor) {
+        auto& size = descriptor.getSize();
+        number(size.has_value() ? size.value() + 1 : 0);
+        number(descriptor.getCanGrow());
+    }
+
+    void declaration(const VariableDeclarationNode& declaration) {
+        string(declaration.getIdentifier());
+        descriptor(declaration.getDescriptor());
+        auto& value = declaration.getValue();
+        number(value.has_value());
+        if (value.has_value()) expression(*value.value());
+    }
+
+    void binding(const VariableBindingNode& binding) {
+        auto& value = binding.getValue();
+        number(value.index());
+        if (auto declaration =
+                std::get_if<std::shared_ptr<VariableDeclarationNode>>(&value)) {
+            this->declaration(**declaration);
+        } else {
+            auto& assignment =
+                std::get<std::shared_ptr<VariableAssignmentNode>>(value);
+            string(assignment->getLeft());
+            expression(*assignment->getRight());
+        }
+    }
+
+    void condition(const std::variant<std::shared_ptr<IfCompareNode>,
+                                      std::shared_ptr<IfDeclarationNode>>&
+                       condition) {
+        number(condition.index());
+        if (auto compare =
+                std::get_if<std::shared_ptr<IfCompareNode>>(&condition)) {
+            number((*compare)->getType());
+            expression(*(*compare)->getLeft());
+            expression(*(*compare)->getRight());
+        } else {
+            declaration(*std::get<std::shared_ptr<IfDeclarationNode>>(
+                             condition)
+                             ->getVariableDeclaration());
+        }
+    }
+
+    void ifNode(const IfNode& node) {
+        condition(node.getCondition());
+        body(*node.getBody());
+        auto& elseIf = node.getElseIfBranches();
+        number(elseIf.has_value());
+        if (elseIf.has_value()) ifNode(*elseIf.value());
+        auto& elseBody = node.getElseBody();
+        number(elseBody.has_value());
+        if (elseBody.has_value()) body(*elseBody.value());
+    }
+
+    void body(const BodyNode& body) {
+        number(body.getStatements().size());
+        for (auto& statement : body.getStatements()) {
+            auto& value = statement->getValue();
+            number(value.index());
+            number(statement->getLine());
+            std::visit(
+                [this](auto&& arg) {
+                    using T = std::decay_t<decltype(arg)>;
+                    constexpr bool isVariableBinding =
+                        std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
+                    constexpr bool isForLoop =
+                        std::is_same_v<T, std::shared_ptr<ForLoopNode>>;
+                    constexpr bool isIf =
+                        std::is_same_v<T, std::shared_ptr<IfNode>>;
+                    constexpr bool isWhile =
+                        std::is_same_v<T, std::shared_ptr<WhileNode>>;
+                    constexpr bool isFunctionCall =
+                        std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                    if constexpr (isVariableBinding) {
+                        binding(*arg);
+                    } else if constexpr (isForLoop) {
+                        forLoop(*arg);
+                    } else if constexpr (isIf) {
+                        ifNode(*arg);
+                    } else if constexpr (isWhile) {
+                        whileLoop(*arg);
+                    } else if constexpr (isFunctionCall) {
+                        call(*arg);
+                    } else {
+                        expression(*arg->getValue());
+                    }
+                },
+                value);
+        }
+    }
+
+    void whileLoop(const WhileNode& loop) {
+        condition(loop.getCondition());
+        body(*loop.getBody());
+    }
+
+    void forLoop(const ForLoopNode& loop) {
+        string(loop.getElement());
+        expression(*loop.getIterable());
+        body(*loop.getBody());
+        number(loop.isParallel());
+        number(loop.getReductions().size());
+        for (auto& reduction : loop.getReductions()) {
+            string(reduction->getVariable());
+            number(reduction->getType());
+        }
+    }
+
+    void function(const FunctionDefinitionNode& function) {
+        string(function.getIdentifier());
+        number(function.getParams().size());
+        for (auto& param : function.getParams()) {
+            string(param->getIdentifier());
+            descriptor(param->getDescriptor());
+        }
+        descriptor(function.getOutput());
+        body(*function.getBody());
+        number(function.isMemoized());
+        number(function.getLine());
+    }
+
+    void use(const UseNode& use) {
+        array(*use.getValue());
+        number(use.getType());
+    }
+
+    std::string out;
+};
+
+}  // namespace
+
+// Reads back what ModuleWriter wrote, allocating the nodes from one arena as
+// the parser does. Malformed input throws rather than reading out of bounds.
+class ModuleReader {
+ public:
+    explicit ModuleReader(std::string_view data)
+        : data(data), arena(std::make_shared<Arena>()) {}
+
+    // False unless the file belongs to this source and its payload is
+    // intact, so that a damaged file is parsed again rather than trusted.
+    bool header(const SourceKey& key) {
+        if (data.substr(0, MAGIC.size()) != MAGIC) return false;
+        position = MAGIC.size();
+        if (number() != FORMAT_VERSION || string() != key.path ||
+            number() != key.size || integer() != key.modified)
+            return false;
+        uint64_t checksum = number();
+        return fnv1a(data.substr(position)) == checksum;
+    }
+
+    RootNode root() {
+        std::vector<std::variant<std::shared_ptr<VariableBindingNode>,
+                                 std::shared_ptr<FunctionCallNode>,
+                                 std::shared_ptr<FunctionDefinitionNode>,
+                                 std::shared_ptr<UseNode>>>
+            values(count());
+        for (auto& value : values) {
+            switch (choice(4)) {
+                case 0:
+                    value = binding();
+                    break;
+                case 1:
+                    value = call();
+                    break;
+                case 2:
+                    value = function();
+                    break;
+                default:
+                    value = use();
+                    break;
+            }
+        }
+        if (position != data.size()) corrupt();
+        return RootNode(std::move(values));
+    }
+
+ private:
+    [[noreturn]] static void corrupt() {
+        throw std::runtime_error("Corrupt module cache");
+    }
+
+    template <typename T>
+    std::shared_ptr<T> node(T value) {
+        return std::allocate_shared<T>(ArenaAllocator<T>(arena),
+                                       std::move(value));
+    }
+
+    uint64_t number() {
+        uint64_t result = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (position == data.size()) corrupt();
+            auto byte = static_cast<unsigned char>(data[position++]);
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return result;
+        }
+        corrupt();
+    }
+
+    int64_t integer() {
+        uint64_t value = number();
+        return static_cast<int64_t>(value >> 1) ^
+               -static_cast<int64_t>(value & 1);
+    }
+
+    // Every element takes at least a byte, which bounds a count before
+    // anything is allocated for it.
+    size_t count() {
+        uint64_t value = number();
+        if (value > data.size() - position) corrupt();
+        return value;
+    }
+
+    size_t choice(size_t options) {
+        uint64_t value = number();
+        if (value >= options) corrupt();
+        return value;
+    }
+
+    bool flag() { return choice(2) == 1; }
+
+    std::string string() {
+        size_t size = count();
+        std::string result(data.substr(position, size));
+        position += size;
+        return result;
+    }
+
+    std::vector<std::shared_ptr<ExpressionNode>> expressions() {
+        std::vector<std::shared_ptr<ExpressionNode>> result(count());
+        for (auto& expression : result) expression = this->expression();
+        return result;
+    }
+
+    std::shared_ptr<ExpressionNode> expression() {
+        std::variant<std::shared_ptr<ArithmeticNode>,
+                     std::shared_ptr<ArrayNode>>
+            primary;
+        if (choice(2) == 0) {
+            auto type = static_cast<ArithmeticNode::Type>(
+                choice(ArithmeticNode::TYPE_SHIFT_RIGHT + 1));
+            auto left = expression();
+            auto right = expression();
+            primary =
+                node(ArithmeticNode(std::move(left), std::move(right), type));
+        } else {
+            primary = array();
+        }
+        std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
+                                 std::shared_ptr<MethodNode>>>
+            postfix(count());
+        for (auto& value : postfix) {
+            if (choice(2) == 0) {
+                auto start = bound();
+                auto end = bound();
+                value = node(ArrayRangeNode(std::move(start), std::move(end)));
+            } else {
+                std::string identifier = string();
+                value = node(MethodNode(std::move(identifier), expressions()));
+            }
+        }
+        return node(ExpressionNode(std::move(primary),
+                                   ArrayPostFixNode(std::move(postfix))));
+    }
+
+    std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>
+    bound() {
+        switch (choice(3)) {
+            case 0:
+                return std::nullopt;
+            case 1:
+                return static_cast<size_t>(number());
+            default:
+                return expression();
+        }
+    }
+
+    std::shared_ptr<ArrayNode> array() {
+        switch (choice(3)) {
+            case 0: {
+                std::vector<int> literal(count());
+                for (int& element : literal)
+                    element = static_cast<int>(integer());
+                return node(ArrayNode(std::move(literal)));
+            }
+            case 1:
+                return node(ArrayNode(string()));
+            default:
+                return node(ArrayNode(call()));
+        }
+    }
+
+    std::shared_ptr<FunctionCallNode> call() {
+        std::string identifier = string();
+        return node(FunctionCallNode(std::move(identifier), expressions()));
+    }
+
+    ArrayDescriptor descriptor() {
+        uint64_t size = number();
+        bool canGrow = flag();
+        return ArrayDescriptor(
+            size == 0 ? std::nullopt : std::optional<size_t>(size - 1),
+            canGrow);
+    }
+
+    std::shared_ptr<VariableDeclarationNode> declaration() {
+        std::string identifier = string();
+        ArrayDescriptor descriptor = this->descriptor();
+        std::optional<std::shared_ptr<ExpressionNode>> value;
+        if (flag()) value = expression();
+        return node(VariableDeclarationNode(std::move(identifier), descriptor,
+                                            std::move(value)));
+    }
+
+    std::shared_ptr<VariableBindingNode> binding() {
+        if (choice(2) == 0) return node(VariableBindingNode(declaration()));
+        std::string left = string();
+        return node(VariableBindingNode(
+            node(VariableAssignmentNode(std::move(left), expression()))));
+    }
+
+    std::variant<std::shared_ptr<IfCompareNode>,
+                 std::shared_ptr<IfDeclarationNode>>
+    condition() {
+        if (choice(2) == 1) return node(IfDeclarationNode(declaration()));
+        auto type = static_cast<IfCompareNode::Type>(
+            choice(IfCompareNode::Type::GE + 1));
+        auto left = expression();
+        auto right = expression();
+        return node(IfCompareNode(type, std::move(left), std::move(right)));
+    }
+
+    std::shared_ptr<IfNode> ifNode() {
+        auto condition = this->condition();
+        auto body = this->body();
+        std::optional<std::shared_ptr<IfNode>> elseIf;
+        if (flag()) elseIf = ifNode();
+        std::optional<std::shared_ptr<BodyNode>> elseBody;
+        if (flag()) elseBody = this->body();
+        return node(IfNode(std::move(condition), std::move(body),
+                           std::move(elseIf), std::move(elseBody)));
+    }
+
+    std::shared_ptr<BodyNode> body() {
+        std::vector<std::shared_ptr<StatementNode>> statements(count());
+        for (auto& statement : statements) {
+            size_t kind = choice(6);
+            size_t line = number();
+            switch (kind) {
+                case 0:
+                    statement = node(StatementNode(binding()));
+                    break;
+                case 1:
+                    statement = node(StatementNode(forLoop()));
+                    break;
+                case 2:
+                    statement = node(StatementNode(ifNode()));
+                    break;
+                case 3:
+                    statement = node(StatementNode(whileLoop()));
+                    break;
+                case 4:
+                    statement = node(StatementNode(call()));
+                    break;
+                default:
+                    statement =
+                        node(StatementNode(node(ReturnNode(expression()))));
+                    break;
+            }
+            statement->setLine(line);
+        }
+        return node(BodyNode(std::move(statements)));
+    }
+
+    std::shared_ptr<WhileNode> whileLoop() {
+        auto condition = this->condition();
+        return node(WhileNode(std::move(condition), body()));
+    }
+
+    std::shared_ptr<ForLoopNode> forLoop() {
+        std::string element = string();
+        auto iterable = expression();
+        auto body = this->body();
+        bool parallel = flag();
+        std::vector<std::shared_ptr<ReductionNode>> reductions(count());
+        for (auto& reduction : reductions) {
+            std::string variable = string();
+            auto type = static_cast<ReductionNode::Type>(
+                choice(ReductionNode::TYPE_APPEND + 1));
+            reduction = node(ReductionNode(std::move(variable), type));
+        }
+        return node(ForLoopNode(std::move(element), std::move(iterable),
+                                std::move(body), parallel,
+                                std::move(reductions)));
+    }
+
+    std::shared_ptr<FunctionDefinitionNode> function() {
+        std::string identifier = string();
+        std::vector<std::shared_ptr<FunctionParameterNode>> params(count());
+        for (auto& param : params) {
+            std::string name = string();
+            param = node(FunctionParameterNode(std::move(name), descriptor()));
+        }
+        ArrayDescriptor output = descriptor();
+        auto body = this->body();
+        bool memoized = flag();
+        auto result = node(FunctionDefinitionNode(
+            std::move(identifier), std::move(params), output, std::move(body),
+            memoized));
+        result->setLine(number());
+        return result;
+    }
+
+    std::shared_ptr<UseNode> use() {
+        auto value = array();
+        auto type = static_cast<UseNode::Type>(
+            choice(UseNode::Type::STANDARD_HEADER + 1));
+        return node(UseNode(std::move(value), type));
+    }
+
+    std::string_view data;
+    size_t position = 0;
+    std::shared_ptr<Arena> arena;
+};
+
+namespace {
+
+RootNode parseFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open file: " + filename);
+    TokenStream tokens(file);
+    return RootNode::parse(tokens);
+}
+
+std::optional<RootNode> readCache(const std::filesystem::path& cacheFile,
+                                  const SourceKey& key) {
+    try {
+        MappedFile file(cacheFile.string());
+        ModuleReader reader(file.contents());
+        if (!reader.header(key)) return std::nullopt;
+        return reader.root();
+    } catch (const std::exception&) {
+        // Anything that fails to decode is a miss like any other.
+        return std::nullopt;
+    }
+}
+
+void writeCache(const std::filesystem::path& directory,
+                const std::filesystem::path& cacheFile, const SourceKey& key,
+                const RootNode& root) {
+    ModuleWriter payload;
+    payload.root(root);
+    std::string body = payload.take();
+    ModuleWriter writer;
+    writer.header(key, fnv1a(body));
+    std::string bytes = writer.take() + body;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) return;
+    // Written aside and renamed into place, so a concurrent reader sees
+    // either the old file or the whole new one.
+    auto temporary = cacheFile;
+    temporary += "." + std::to_string(std::random_device()()) + ".tmp";
+    bool written;
+    {
+        std::ofstream out(temporary, std::ios::out | std::ios::binary |
+                                         std::ios::trunc);
+        written = static_cast<bool>(out.write(
+            bytes.data(), static_cast<std::streamsize>(bytes.size())));
+    }
+    if (written) std::filesystem::rename(temporary, cacheFile, error);
+    if (!written || error) std::filesystem::remove(temporary, error);
+}
+
+}  // namespace
+
+RootNode loadModule(const std::string& filename, bool cached) {
+    std::optional<SourceKey> key;
+    std::optional<std::filesystem::path> directory;
+    if (cached) {
+        key = sourceKey(filename);
+        directory = cacheDirectory();
+    }
+    if (!key || !directory) return parseFile(filename);
+    auto cacheFile = directory.value() / cacheName(key->path);
+    if (auto root = readCache(cacheFile, key.value()))
+        return std::move(root.value());
+    RootNode root = parseFile(filename);
+    writeCache(directory.value(), cacheFile, key.value(), root);
+    return root;
+}
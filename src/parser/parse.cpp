@@ -2,43 +2,89 @@
 
 #include "parser/parse.h"
 
+#include <charconv>
 #include <iostream>
 #include <memory>
-#include <stack>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
 #include <vector>
 
+#include "util/arena.h"
 #include "util/error.h"
 
-static const Token& expect(const std::vector<Token>& tokens, size_t i,
-                           const std::string& source, TokenType type,
-                           const std::string& expectedValue = "") {
-    if (i >= tokens.size()) {
+namespace {
+
+thread_local std::shared_ptr<Arena> nodeArena;
+
+// Nodes parsed while one of these is alive on a thread are laid out in parse
+// order in one arena, so walking a function's tree stays within a few
+// contiguous chunks.
+class NodeArenaScope {
+ public:
+    NodeArenaScope() : previous(std::move(nodeArena)) {
+        nodeArena = std::make_shared<Arena>();
+    }
+    ~NodeArenaScope() { nodeArena = std::move(previous); }
+
+ private:
+    std::shared_ptr<Arena> previous;
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> makeNode(Args&&... args) {
+    if (!nodeArena) return std::make_shared<T>(std::forward<Args>(args)...);
+    return std::allocate_shared<T>(ArenaAllocator<T>(nodeArena),
+                                   std::forward<Args>(args)...);
+}
+
+}  // namespace
+
+static const Token& expect(TokenStream& tokens, size_t i,
+                           std::string_view source, TokenType type,
+                           std::string_view expectedValue = "") {
+    if (!tokens.has(i)) {
         throw UnexpectedEOFError(
-            source, expectedValue.empty() ? "token" : expectedValue);
+            std::string(source),
+            expectedValue.empty() ? "token" : std::string(expectedValue));
     }
     const Token& token = tokens[i];
     if (token.getType() != type) {
-        throw UnexpectedTokenError(
-            source, token.getValue(),
-            expectedValue.empty() ? tokenTypeToString(type) : expectedValue);
+        throw UnexpectedTokenError(std::string(source), token.getValue(),
+                                   expectedValue.empty()
+                                       ? tokenTypeToString(type)
+                                       : std::string(expectedValue));
     }
     if (!expectedValue.empty() && token.getValue() != expectedValue) {
-        throw UnexpectedTokenError(source, token.getValue(), expectedValue);
+        throw UnexpectedTokenError(std::string(source), token.getValue(),
+                                   std::string(expectedValue));
     }
     return token;
 }
 
+// Integer literals are converted straight from the source text.
+static int parseInt(const Token& token) {
+    std::string_view text = token.getValue();
+    const char* end = text.data() + text.size();
+    int value = 0;
+    auto [last, error] = std::from_chars(text.data(), end, value);
+    if (error != std::errc() || last != end)
+        throw std::runtime_error("Integer literal " + std::string(text) +
+                                 " is out of range");
+    return value;
+}
+
 static std::vector<std::shared_ptr<ExpressionNode>> parseExpressions(
-    std::vector<Token>& tokens, size_t& i, char end = ')') {
+    TokenStream& tokens, size_t& i, char end = ')') {
     std::vector<std::shared_ptr<ExpressionNode>> expressions;
-    while (i < tokens.size() && !(tokens[i].getType() == TokenType::SYMBOL &&
+    while (tokens.has(i) && !(tokens[i].getType() == TokenType::SYMBOL &&
                                   tokens[i].getValue()[0] == end)) {
         expressions.push_back(
-            std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i)));
-        if (i >= tokens.size())
+            makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i)));
+        if (!tokens.has(i))
             throw UnexpectedEOFError("Expression",
                                      ", or " + std::string(1, end));
         if (tokens[i].getType() == TokenType::SYMBOL &&
@@ -56,31 +102,35 @@ static std::string nTabs(size_t n) {
     return result;
 }
 
-RootNode RootNode::parse(std::vector<Token>& tokens) {
+RootNode RootNode::parse(TokenStream& tokens) {
+    NodeArenaScope arena;
     std::vector<std::variant<
         std::shared_ptr<VariableBindingNode>, std::shared_ptr<FunctionCallNode>,
         std::shared_ptr<FunctionDefinitionNode>, std::shared_ptr<UseNode>>>
         values;
-    size_t numTokens = tokens.size();
     size_t i = 0;
-    while (i < numTokens) {
+    while (tokens.has(i)) {
+        // Nothing before the next top level item is looked at again.
+        tokens.release(i);
         switch (tokens[i].getType()) {
             case TokenType::IDENTIFIER:
-                if (tokens[i].getValue() == "fn") {
-                    values.push_back(std::make_shared<FunctionDefinitionNode>(
+                if (tokens[i].getValue() == "fn" ||
+                    (tokens[i].getValue() == "memo" && tokens.has(i + 1) &&
+                     tokens[i + 1] == Token(TokenType::IDENTIFIER, "fn"))) {
+                    values.push_back(makeNode<FunctionDefinitionNode>(
                         FunctionDefinitionNode::parse(tokens, i)));
                     break;
                 } else if (tokens[i].getValue() == "use") {
                     values.push_back(
-                        std::make_shared<UseNode>(UseNode::parse(tokens, i)));
+                        makeNode<UseNode>(UseNode::parse(tokens, i)));
                     break;
                 } else {
-                    if (i + 1 < tokens.size() &&
+                    if (tokens.has(i + 1) &&
                         tokens[i + 1] == Token(TokenType::SYMBOL, "(")) {
-                        values.push_back(std::make_shared<FunctionCallNode>(
+                        values.push_back(makeNode<FunctionCallNode>(
                             FunctionCallNode::parse(tokens, i)));
                     } else {
-                        values.push_back(std::make_shared<VariableBindingNode>(
+                        values.push_back(makeNode<VariableBindingNode>(
                             VariableBindingNode::parse(tokens, i)));
                     }
 
@@ -91,7 +141,7 @@ RootNode RootNode::parse(std::vector<Token>& tokens) {
                 [[fallthrough]];
             default:
                 throw std::runtime_error("Unexpected value " +
-                                         tokens[i].getValue() +
+                                         std::string(tokens[i].getValue()) +
                                          ". Expected let, use, or fn");
         }
     }
@@ -134,11 +184,11 @@ RootNode::RootNode(
         values)
     : values(std::move(values)) {}
 
-FunctionParameterNode FunctionParameterNode::parse(std::vector<Token>& tokens,
+FunctionParameterNode FunctionParameterNode::parse(TokenStream& tokens,
                                                    size_t& i) {
-    auto identifier =
+    std::string identifier(
         expect(tokens, i, "Function Parameter", TokenType::IDENTIFIER)
-            .getValue();
+            .getValue());
     ++i;
 
     expect(tokens, i, "Function Definition", TokenType::SYMBOL, ":");
@@ -153,30 +203,34 @@ FunctionParameterNode::FunctionParameterNode(std::string identifier,
 FunctionDefinitionNode::FunctionDefinitionNode(
     std::string identifier,
     std::vector<std::shared_ptr<FunctionParameterNode>> params,
-    ArrayDescriptor output, std::shared_ptr<BodyNode> body)
+    ArrayDescriptor output, std::shared_ptr<BodyNode> body, bool memoized)
     : identifier(std::move(identifier)),
       params(params),
       output(output),
-      body(std::move(body)) {}
+      body(std::move(body)),
+      memoized(memoized) {}
 
-FunctionDefinitionNode FunctionDefinitionNode::parse(std::vector<Token>& tokens,
+FunctionDefinitionNode FunctionDefinitionNode::parse(TokenStream& tokens,
                                                      size_t& i) {
+    size_t line = tokens.lineOf(i);
+    bool memoized = tokens[i] == Token(TokenType::IDENTIFIER, "memo");
+    if (memoized) ++i;
     expect(tokens, i, "Function Definition", TokenType::IDENTIFIER, "fn");
     ++i;
 
-    auto identifier =
+    std::string identifier(
         expect(tokens, i, "Function Definition", TokenType::IDENTIFIER)
-            .getValue();
+            .getValue());
     ++i;
 
     expect(tokens, i, "Function Definition", TokenType::SYMBOL, "(");
     ++i;
 
     std::vector<std::shared_ptr<FunctionParameterNode>> params;
-    while (i < tokens.size() && !(tokens[i] == Token(TokenType::SYMBOL, ")"))) {
-        params.emplace_back(std::make_shared<FunctionParameterNode>(
+    while (tokens.has(i) && !(tokens[i] == Token(TokenType::SYMBOL, ")"))) {
+        params.emplace_back(makeNode<FunctionParameterNode>(
             FunctionParameterNode::parse(tokens, i)));
-        if (i < tokens.size() && tokens[i] == Token(TokenType::SYMBOL, ","))
+        if (tokens.has(i) && tokens[i] == Token(TokenType::SYMBOL, ","))
             ++i;
     }
     expect(tokens, i, "Function Definition", TokenType::SYMBOL, ")");
@@ -190,23 +244,25 @@ FunctionDefinitionNode FunctionDefinitionNode::parse(std::vector<Token>& tokens,
     ArrayDescriptor output = ArrayDescriptor::parse(tokens, i);
     std::shared_ptr<BodyNode> body = BodyNode::parse(tokens, i);
 
-    return FunctionDefinitionNode(identifier, params, output, std::move(body));
+    FunctionDefinitionNode result(identifier, params, output, std::move(body),
+                                  memoized);
+    result.setLine(line);
+    return result;
 }
 
-ArrayDescriptor ArrayDescriptor::parse(std::vector<Token>& tokens, size_t& i) {
+ArrayDescriptor ArrayDescriptor::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "Array Descriptor", TokenType::SYMBOL, "[");
     ++i;
 
     std::optional<size_t> size;
-    if (i < tokens.size() && tokens[i].getType() == TokenType::INT_LIT) {
-        size = std::stoi(tokens[i].getValue());
+    if (tokens.has(i) && tokens[i].getType() == TokenType::INT_LIT) {
+        size = parseInt(tokens[i]);
         ++i;
     }
 
-    expect(tokens, i, "Array Descriptor", TokenType::SYMBOL);
-    bool canGrow =
-        tokens[i].getValue().size() > 0 && tokens[i].getValue()[0] == '+';
+    bool canGrow = tokens.has(i) && tokens[i].getSymbol() == Symbol::PLUS;
     if (canGrow) ++i;
+
     expect(tokens, i, "Array Descriptor", TokenType::SYMBOL, "]");
     ++i;
 
@@ -216,18 +272,18 @@ ArrayDescriptor ArrayDescriptor::parse(std::vector<Token>& tokens, size_t& i) {
 ArrayDescriptor::ArrayDescriptor(std::optional<size_t> size, bool canGrow)
     : size(std::move(size)), canGrow(canGrow) {}
 
-std::shared_ptr<BodyNode> BodyNode::parse(std::vector<Token>& tokens,
+std::shared_ptr<BodyNode> BodyNode::parse(TokenStream& tokens,
                                           size_t& i) {
     expect(tokens, i, "Body", TokenType::SYMBOL, "{");
     ++i;
     std::vector<std::shared_ptr<StatementNode>> statements;
-    while (i < tokens.size() && !(tokens[i].getType() == TokenType::SYMBOL &&
+    while (tokens.has(i) && !(tokens[i].getType() == TokenType::SYMBOL &&
                                   tokens[i].getValue()[0] == '}')) {
         statements.push_back(StatementNode::parse(tokens, i));
     }
     expect(tokens, i, "Body", TokenType::SYMBOL, "}");
     ++i;
-    return std::make_shared<BodyNode>(std::move(statements));
+    return makeNode<BodyNode>(std::move(statements));
 }
 
 BodyNode::BodyNode(std::vector<std::shared_ptr<StatementNode>> statements)
@@ -241,34 +297,35 @@ StatementNode::StatementNode(
         value)
     : value(std::move(value)) {}
 
-std::shared_ptr<StatementNode> StatementNode::parse(std::vector<Token>& tokens,
+std::shared_ptr<StatementNode> StatementNode::parse(TokenStream& tokens,
                                                     size_t& i) {
-    if (i >= tokens.size()) throw UnexpectedEOFError("Statement", "token");
+    if (!tokens.has(i)) throw UnexpectedEOFError("Statement", "token");
 
+    size_t line = tokens.lineOf(i);
     std::shared_ptr<StatementNode> result;
     if (tokens[i].getType() == TokenType::IDENTIFIER) {
         auto identifier = tokens[i].getValue();
         if (identifier == "if") {
-            result = std::make_shared<StatementNode>(
-                std::make_shared<IfNode>(IfNode::parse(tokens, i)));
-        } else if (identifier == "for") {
-            result = std::make_shared<StatementNode>(
-                std::make_shared<ForLoopNode>(ForLoopNode::parse(tokens, i)));
+            result = makeNode<StatementNode>(
+                makeNode<IfNode>(IfNode::parse(tokens, i)));
+        } else if (identifier == "for" || identifier == "pfor") {
+            result = makeNode<StatementNode>(
+                makeNode<ForLoopNode>(ForLoopNode::parse(tokens, i)));
         } else if (identifier == "while") {
-            result = std::make_shared<StatementNode>(
-                std::make_shared<WhileNode>(WhileNode::parse(tokens, i)));
+            result = makeNode<StatementNode>(
+                makeNode<WhileNode>(WhileNode::parse(tokens, i)));
         } else if (identifier == "return") {
-            result = std::make_shared<StatementNode>(
-                std::make_shared<ReturnNode>(ReturnNode::parse(tokens, i)));
+            result = makeNode<StatementNode>(
+                makeNode<ReturnNode>(ReturnNode::parse(tokens, i)));
         } else {
-            if (i + 1 < tokens.size() &&
+            if (tokens.has(i + 1) &&
                 tokens[i + 1] == Token(TokenType::SYMBOL, "(")) {
-                result = std::make_shared<StatementNode>(
-                    std::make_shared<FunctionCallNode>(
+                result = makeNode<StatementNode>(
+                    makeNode<FunctionCallNode>(
                         FunctionCallNode::parse(tokens, i)));
             } else {
-                result = std::make_shared<StatementNode>(
-                    std::make_shared<VariableBindingNode>(
+                result = makeNode<StatementNode>(
+                    makeNode<VariableBindingNode>(
                         VariableBindingNode::parse(tokens, i)));
             }
 
@@ -278,17 +335,19 @@ std::shared_ptr<StatementNode> StatementNode::parse(std::vector<Token>& tokens,
     } else {
         throw UnexpectedTokenError(
             "Statement", tokens[i].getValue(),
-            "Identifier. Previous token: " + tokens[i - 1].getValue());
+            "Identifier. Previous token: " +
+                std::string(tokens[i - 1].getValue()));
     }
 
+    result->setLine(line);
     return result;
 }
 
-ReturnNode ReturnNode::parse(std::vector<Token>& tokens, size_t& i) {
+ReturnNode ReturnNode::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "Return", TokenType::IDENTIFIER, "return");
     ++i;
     auto expression =
-        std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i));
+        makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
     expect(tokens, i, "Return", TokenType::SYMBOL, ";");
     ++i;
     return ReturnNode(std::move(expression));
@@ -308,10 +367,10 @@ IfNode::IfNode(std::variant<std::shared_ptr<IfCompareNode>,
       elseIfBranches(std::move(elseIfBranches)),
       elseBody(std::move(elseBody)) {}
 
-IfNode IfNode::parse(std::vector<Token>& tokens, size_t& i) {
+IfNode IfNode::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "If", TokenType::IDENTIFIER, "if");
     ++i;
-    if (i >= tokens.size()) throw UnexpectedEOFError("If", "token");
+    if (!tokens.has(i)) throw UnexpectedEOFError("If", "token");
 
     std::variant<std::shared_ptr<IfCompareNode>,
                  std::shared_ptr<IfDeclarationNode>>
@@ -324,23 +383,23 @@ IfNode IfNode::parse(std::vector<Token>& tokens, size_t& i) {
                       IfDeclarationNode>(IfDeclarationNode::parse(tokens, i))}
                 : std::variant<std::shared_ptr<IfCompareNode>,
                                std::shared_ptr<IfDeclarationNode>>{
-                      std::make_shared<IfCompareNode>(
+                      makeNode<IfCompareNode>(
                           IfCompareNode::parse(tokens, i))};
 
     std::shared_ptr<BodyNode> body = BodyNode::parse(tokens, i);
     std::optional<std::shared_ptr<IfNode>> elseIfBranches;
     std::optional<std::shared_ptr<BodyNode>> elseBody;
 
-    if (i < tokens.size() && tokens[i].getType() == TokenType::IDENTIFIER &&
+    if (tokens.has(i) && tokens[i].getType() == TokenType::IDENTIFIER &&
         tokens[i].getValue() == "else") {
         ++i;
-        if (i >= tokens.size())
+        if (!tokens.has(i))
             throw UnexpectedEOFError("If", "if or { after else");
         if (tokens[i].getType() == TokenType::SYMBOL &&
             tokens[i].getValue()[0] == '{') {
             elseBody = BodyNode::parse(tokens, i);
         } else {
-            elseIfBranches = std::make_shared<IfNode>(IfNode::parse(tokens, i));
+            elseIfBranches = makeNode<IfNode>(IfNode::parse(tokens, i));
         }
     }
 
@@ -348,32 +407,71 @@ IfNode IfNode::parse(std::vector<Token>& tokens, size_t& i) {
                   std::move(elseIfBranches), std::move(elseBody));
 }
 
-ForLoopNode ForLoopNode::parse(std::vector<Token>& tokens, size_t& i) {
-    expect(tokens, i, "For Loop", TokenType::IDENTIFIER, "for");
+ForLoopNode ForLoopNode::parse(TokenStream& tokens, size_t& i) {
+    bool parallel = tokens.has(i) &&
+                    tokens[i] == Token(TokenType::IDENTIFIER, "pfor");
+    if (!parallel) expect(tokens, i, "For Loop", TokenType::IDENTIFIER, "for");
     ++i;
-    auto elementIdentifier =
-        expect(tokens, i, "For Loop", TokenType::IDENTIFIER).getValue();
+    std::string elementIdentifier(
+        expect(tokens, i, "For Loop", TokenType::IDENTIFIER).getValue());
     ++i;
     expect(tokens, i, "For Loop", TokenType::SYMBOL, ":");
     ++i;
     auto iterable =
-        std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i));
+        makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
+    std::vector<std::shared_ptr<ReductionNode>> reductions;
+    if (parallel && tokens.has(i) &&
+        tokens[i] == Token(TokenType::IDENTIFIER, "reduce")) {
+        do {
+            ++i;
+            reductions.push_back(makeNode<ReductionNode>(
+                ReductionNode::parse(tokens, i)));
+        } while (tokens.has(i) &&
+                 tokens[i] == Token(TokenType::SYMBOL, ","));
+    }
     return ForLoopNode(std::move(elementIdentifier), std::move(iterable),
-                       BodyNode::parse(tokens, i));
+                       BodyNode::parse(tokens, i), parallel,
+                       std::move(reductions));
 }
 
 ForLoopNode::ForLoopNode(std::string element,
                          std::shared_ptr<ExpressionNode> iterable,
-                         std::shared_ptr<BodyNode> body)
+                         std::shared_ptr<BodyNode> body, bool parallel,
+                         std::vector<std::shared_ptr<ReductionNode>> reductions)
     : element(std::move(element)),
       iterable(std::move(iterable)),
-      body(std::move(body)) {}
+      body(std::move(body)),
+      parallel(parallel),
+      reductions(std::move(reductions)) {}
+
+ReductionNode ReductionNode::parse(TokenStream& tokens, size_t& i) {
+    std::string variable(
+        expect(tokens, i, "Reduction", TokenType::IDENTIFIER).getValue());
+    ++i;
+    if (!tokens.has(i))
+        throw UnexpectedEOFError("Reduction", "+, * or append");
+    Type type;
+    if (tokens[i] == Token(TokenType::SYMBOL, "+"))
+        type = TYPE_ADD;
+    else if (tokens[i] == Token(TokenType::SYMBOL, "*"))
+        type = TYPE_MULTIPLY;
+    else if (tokens[i] == Token(TokenType::IDENTIFIER, "append"))
+        type = TYPE_APPEND;
+    else
+        throw UnexpectedTokenError("Reduction", tokens[i].getValue(),
+                                   "+, * or append");
+    ++i;
+    return ReductionNode(std::move(variable), type);
+}
 
-MethodNode MethodNode::parse(std::vector<Token>& tokens, size_t& i) {
+ReductionNode::ReductionNode(std::string variable, Type type)
+    : variable(std::move(variable)), type(type) {}
+
+MethodNode MethodNode::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "Method", TokenType::SYMBOL, ".");
     ++i;
-    auto identifier =
-        expect(tokens, i, "Method", TokenType::IDENTIFIER).getValue();
+    std::string identifier(
+        expect(tokens, i, "Method", TokenType::IDENTIFIER).getValue());
     ++i;
     expect(tokens, i, "Method", TokenType::SYMBOL, "(");
     ++i;
@@ -388,15 +486,15 @@ MethodNode::MethodNode(std::string identifier,
                        std::vector<std::shared_ptr<ExpressionNode>> parameters)
     : identifier(std::move(identifier)), parameters(std::move(parameters)) {}
 
-VariableBindingNode VariableBindingNode::parse(std::vector<Token>& tokens,
+VariableBindingNode VariableBindingNode::parse(TokenStream& tokens,
                                                size_t& i) {
-    auto ident1 =
-        expect(tokens, i, "Variable Bind", TokenType::IDENTIFIER).getValue();
+    std::string ident1(
+        expect(tokens, i, "Variable Bind", TokenType::IDENTIFIER).getValue());
     if (ident1 == "let") {
-        return VariableBindingNode(std::make_shared<VariableDeclarationNode>(
+        return VariableBindingNode(makeNode<VariableDeclarationNode>(
             VariableDeclarationNode::parse(tokens, i)));
     } else {
-        return VariableBindingNode(std::make_shared<VariableAssignmentNode>(
+        return VariableBindingNode(makeNode<VariableAssignmentNode>(
             VariableAssignmentNode::parse(tokens, i)));
     }
 }
@@ -407,10 +505,10 @@ VariableBindingNode::VariableBindingNode(
         value)
     : value(std::move(value)) {}
 
-FunctionCallNode FunctionCallNode::parse(std::vector<Token>& tokens,
+FunctionCallNode FunctionCallNode::parse(TokenStream& tokens,
                                          size_t& i) {
-    auto identifier =
-        expect(tokens, i, "Function Call", TokenType::IDENTIFIER).getValue();
+    std::string identifier(
+        expect(tokens, i, "Function Call", TokenType::IDENTIFIER).getValue());
     ++i;
     expect(tokens, i, "Function Call", TokenType::SYMBOL, "(");
     ++i;
@@ -421,7 +519,7 @@ FunctionCallNode FunctionCallNode::parse(std::vector<Token>& tokens,
     expect(tokens, i, "Function Call", TokenType::SYMBOL, ")");
     ++i;
 
-    if (i >= tokens.size())
+    if (!tokens.has(i))
         throw UnexpectedEOFError("Function Call", "; or . after function call");
 
     return FunctionCallNode(identifier, std::move(parameters));
@@ -432,13 +530,13 @@ FunctionCallNode::FunctionCallNode(
     std::vector<std::shared_ptr<ExpressionNode>> parameters)
     : identifier(std::move(identifier)), parameters(std::move(parameters)) {}
 
-IfCompareNode IfCompareNode::parse(std::vector<Token>& tokens, size_t& i) {
+IfCompareNode IfCompareNode::parse(TokenStream& tokens, size_t& i) {
     std::shared_ptr<ExpressionNode> left =
-        std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i));
+        makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
     char symbol1 =
         expect(tokens, i, "If Comparison", TokenType::SYMBOL).getValue()[0];
     ++i;
-    bool nextIsEq = i < tokens.size() &&
+    bool nextIsEq = tokens.has(i) &&
                     tokens[i].getType() == TokenType::SYMBOL &&
                     tokens[i].getValue()[0] == '=';
     if (nextIsEq) ++i;
@@ -483,7 +581,7 @@ IfCompareNode IfCompareNode::parse(std::vector<Token>& tokens, size_t& i) {
         }
     }
     std::shared_ptr<ExpressionNode> right =
-        std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i));
+        makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
     return IfCompareNode(type, std::move(left), std::move(right));
 }
 
@@ -491,9 +589,9 @@ IfCompareNode::IfCompareNode(Type type, std::shared_ptr<ExpressionNode> left,
                              std::shared_ptr<ExpressionNode> right)
     : type(type), left(std::move(left)), right(std::move(right)) {}
 
-IfDeclarationNode IfDeclarationNode::parse(std::vector<Token>& tokens,
+IfDeclarationNode IfDeclarationNode::parse(TokenStream& tokens,
                                            size_t& i) {
-    return IfDeclarationNode(std::make_shared<VariableDeclarationNode>(
+    return IfDeclarationNode(makeNode<VariableDeclarationNode>(
         VariableDeclarationNode::parse(tokens, i)));
 }
 
@@ -502,22 +600,22 @@ IfDeclarationNode::IfDeclarationNode(
     : variableDeclaration(std::move(variableDeclaration)) {}
 
 VariableDeclarationNode VariableDeclarationNode::parse(
-    std::vector<Token>& tokens, size_t& i) {
+    TokenStream& tokens, size_t& i) {
     expect(tokens, i, "Variable Declaration", TokenType::IDENTIFIER, "let");
     ++i;
-    auto identifier =
+    std::string identifier(
         expect(tokens, i, "Variable Declaration", TokenType::IDENTIFIER)
-            .getValue();
+            .getValue());
     ++i;
     expect(tokens, i, "Variable Declaration", TokenType::SYMBOL, ":");
     ++i;
     auto descriptor = ArrayDescriptor::parse(tokens, i);
     std::optional<std::shared_ptr<ExpressionNode>> value;
-    if (i < tokens.size() && tokens[i].getType() == TokenType::SYMBOL &&
+    if (tokens.has(i) && tokens[i].getType() == TokenType::SYMBOL &&
         tokens[i].getValue()[0] == '=') {
         ++i;
         value =
-            std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i));
+            makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
     }
     return VariableDeclarationNode(identifier, descriptor, std::move(value));
 }
@@ -529,7 +627,7 @@ VariableDeclarationNode::VariableDeclarationNode(
       descriptor(descriptor),
       value(std::move(value)) {}
 
-// VariableMethodNode VariableMethodNode::parse(std::vector<Token>& tokens,
+// VariableMethodNode VariableMethodNode::parse(TokenStream& tokens,
 //                                              size_t& i) {
 //     auto identifier =
 //         expect(tokens, i, "Variable Method",
@@ -542,15 +640,16 @@ VariableDeclarationNode::VariableDeclarationNode(
 //                                        MethodNode method)
 //     : identifier(std::move(identifier)), method(std::move(method)) {}
 
-VariableAssignmentNode VariableAssignmentNode::parse(std::vector<Token>& tokens,
+VariableAssignmentNode VariableAssignmentNode::parse(TokenStream& tokens,
                                                      size_t& i) {
-    auto left = expect(tokens, i, "Variable Assignment", TokenType::IDENTIFIER)
-                    .getValue();
+    std::string left(
+        expect(tokens, i, "Variable Assignment", TokenType::IDENTIFIER)
+            .getValue());
     ++i;
     expect(tokens, i, "Variable Assignment", TokenType::SYMBOL, "=");
     ++i;
     return VariableAssignmentNode(
-        std::move(left), std::make_shared<ExpressionNode>(
+        std::move(left), makeNode<ExpressionNode>(
                              std::move(ExpressionNode::parse(tokens, i))));
 }
 
@@ -558,161 +657,123 @@ VariableAssignmentNode::VariableAssignmentNode(
     std::string left, std::shared_ptr<ExpressionNode> right)
     : left(std::move(left)), right(std::move(right)) {}
 
-ExpressionNode ExpressionNode::parse(std::vector<Token>& tokens, size_t& i) {
-    unsigned numLeftParentheses = 0;
-    std::stack<std::variant<ArithmeticNode::Type, ExpressionNode>> output;
-    std::stack<std::pair<std::optional<ArithmeticNode::Type>,
-                         ArithmeticNode::Precedence>>
-        operators;
-    while (i < tokens.size() && !(numLeftParentheses == 0 &&
-                                  tokens[i] == Token(TokenType::SYMBOL, ")"))) {
-        auto& token = tokens[i];
-        switch (token.getType()) {
-            case TokenType::IDENTIFIER:
-            case TokenType::STRING_LIT: {
-                auto arrayNode = ArrayNode::parse(tokens, i);
-                auto postFix = ArrayPostFixNode::parse(tokens, i);
-                output.push(ExpressionNode(
-                    std::make_shared<ArrayNode>(std::move(arrayNode)),
-                    std::move(postFix)));
-                --i;
-                break;
-            }
-            case TokenType::INT_LIT:
-                throw std::runtime_error(
-                    "Unexpected int literal in array expression.");
-                break;
-            case TokenType::SYMBOL: {
-                char c = token.getValue()[0];
-                if (c == '[') {
-                    auto arrayNode = ArrayNode::parse(tokens, i);
-                    auto postFix = ArrayPostFixNode::parse(tokens, i);
-                    output.push(ExpressionNode(
-                        std::make_shared<ArrayNode>(std::move(arrayNode)),
-                        std::move(postFix)));
-                    --i;
-                } else if (c == ')') {
-                    while (operators.size() > 0 &&
-                           operators.top().second !=
-                               ArithmeticNode::Precedence::LEFT_PARENTHESIS) {
-                        output.push(operators.top().first.value());
-                        operators.pop();
-                    }
-                    if (operators.size() == 0)
-                        throw std::runtime_error(
-                            "More ) than ( in array expression.");
-                    operators.pop();
-                    --numLeftParentheses;
-                } else {
-                    std::optional<ArithmeticNode::Type> newOperator;
-                    ArithmeticNode::Precedence newPrecedence;
-                    switch (c) {
-                        case '+':
-                            newOperator = ArithmeticNode::Type::TYPE_ADDITION;
-                            newPrecedence = ArithmeticNode::Precedence::ADD_SUB;
-                            break;
-                        case '-':
-                            newOperator =
-                                ArithmeticNode::Type::TYPE_SUBTRACTION;
-                            newPrecedence = ArithmeticNode::Precedence::ADD_SUB;
-                            break;
-                        case '*':
-                            newOperator =
-                                ArithmeticNode::Type::TYPE_MULTIPLICATION;
-                            newPrecedence =
-                                ArithmeticNode::Precedence::MULT_DIV;
-                            break;
-                        case '/':
-                            newOperator = ArithmeticNode::Type::TYPE_DIVISION;
-                            newPrecedence =
-                                ArithmeticNode::Precedence::MULT_DIV;
-                            break;
-                        case '(':
-                            newPrecedence =
-                                ArithmeticNode::Precedence::LEFT_PARENTHESIS;
-                            ++numLeftParentheses;
-                            break;
-                        default:
-                            goto exit_loop;
-                            break;
-                    }
-                    while (operators.size() > 0 &&
-                           operators.top().second >= newPrecedence) {
-                        output.push(operators.top().first.value());
-                        operators.pop();
-                    }
-                    operators.push(std::make_pair(newOperator, newPrecedence));
-                }
-            } break;
-        }
-        ++i;
+static ArrayPostFixNode noPostfix() {
+    return ArrayPostFixNode(
+        std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
+                                 std::shared_ptr<MethodNode>>>());
+}
+
+static std::optional<ArithmeticNode::Type> binaryOperator(TokenStream& tokens,
+                                                          size_t i) {
+    if (!tokens.has(i) || tokens[i].getType() != TokenType::SYMBOL)
+        return std::nullopt;
+    switch (tokens[i].getSymbol()) {
+        case Symbol::PLUS:
+            return ArithmeticNode::TYPE_ADDITION;
+        case Symbol::MINUS:
+            return ArithmeticNode::TYPE_SUBTRACTION;
+        case Symbol::STAR:
+            return ArithmeticNode::TYPE_MULTIPLICATION;
+        case Symbol::SLASH:
+            return ArithmeticNode::TYPE_DIVISION;
+        case Symbol::PERCENT:
+            return ArithmeticNode::TYPE_MODULO;
+        case Symbol::AMPERSAND:
+            return ArithmeticNode::TYPE_AND;
+        case Symbol::PIPE:
+            return ArithmeticNode::TYPE_OR;
+        case Symbol::CARET:
+            return ArithmeticNode::TYPE_XOR;
+        default:
+            break;
     }
-exit_loop: {}
-    while (!operators.empty()) {
-        output.push(operators.top().first.value());
-        operators.pop();
+    // Shifts are two symbols, `<<` and `>>`; one alone is a comparison.
+    Symbol symbol = tokens[i].getSymbol();
+    if ((symbol == Symbol::LESS || symbol == Symbol::GREATER) &&
+        tokens.has(i + 1) && tokens[i + 1].getSymbol() == symbol)
+        return symbol == Symbol::LESS ? ArithmeticNode::TYPE_SHIFT_LEFT
+                                      : ArithmeticNode::TYPE_SHIFT_RIGHT;
+    return std::nullopt;
+}
+
+static size_t operatorLength(ArithmeticNode::Type type) {
+    return type == ArithmeticNode::TYPE_SHIFT_LEFT ||
+                   type == ArithmeticNode::TYPE_SHIFT_RIGHT
+               ? 2
+               : 1;
+}
+
+static ArithmeticNode::Precedence precedence(ArithmeticNode::Type type) {
+    switch (type) {
+        case ArithmeticNode::TYPE_ADDITION:
+        case ArithmeticNode::TYPE_SUBTRACTION:
+            return ArithmeticNode::Precedence::ADD_SUB;
+        case ArithmeticNode::TYPE_SHIFT_LEFT:
+        case ArithmeticNode::TYPE_SHIFT_RIGHT:
+            return ArithmeticNode::Precedence::SHIFT;
+        case ArithmeticNode::TYPE_AND:
+            return ArithmeticNode::Precedence::BIT_AND;
+        case ArithmeticNode::TYPE_XOR:
+            return ArithmeticNode::Precedence::BIT_XOR;
+        case ArithmeticNode::TYPE_OR:
+            return ArithmeticNode::Precedence::BIT_OR;
+        default:
+            return ArithmeticNode::Precedence::MULT_DIV;
     }
-    if (output.size() == 0) throw std::runtime_error("Empty expression.");
-    auto top = std::move(output.top());
-    output.pop();
-    if (std::holds_alternative<ExpressionNode>(top)) {
-        if (output.size() > 0)
-            throw std::runtime_error("Invalid array expression.");
-        return std::move(std::get<ExpressionNode>(top));
+}
+
+static ExpressionNode parseOperand(TokenStream& tokens, size_t& i);
+
+// Precedence climbing: operators bind to the left, so a chain of equal
+// precedence is built by the loop rather than by recursion.
+static ExpressionNode parseArithmetic(TokenStream& tokens, size_t& i,
+                                      int minPrecedence) {
+    ExpressionNode left = parseOperand(tokens, i);
+    while (auto type = binaryOperator(tokens, i)) {
+        int current = precedence(type.value());
+        if (current < minPrecedence) break;
+        i += operatorLength(type.value());
+        ExpressionNode right = parseArithmetic(tokens, i, current + 1);
+        left = ExpressionNode(
+            makeNode<ArithmeticNode>(makeNode<ExpressionNode>(std::move(left)),
+                                     makeNode<ExpressionNode>(std::move(right)),
+                                     type.value()),
+            noPostfix());
     }
-    std::stack<ArithmeticNode> result;
-    result.push(
-        ArithmeticNode(nullptr, nullptr, std::get<ArithmeticNode::Type>(top)));
-    while (output.size() > 0) {
-        auto top = std::move(output.top());
-        output.pop();
-        if (std::holds_alternative<ExpressionNode>(top)) {
-            if (result.top().right == nullptr) {
-                result.top().right = std::make_unique<ExpressionNode>(
-                    std::move(std::get<ExpressionNode>(top)));
-            } else if (result.top().left == nullptr) {
-                result.top().left = std::make_unique<ExpressionNode>(
-                    std::move(std::get<ExpressionNode>(top)));
-
-                while (result.size() > 1) {
-                    auto current = std::move(result.top());
-                    result.pop();
-                    if (result.top().right == nullptr) {
-                        result.top().right = std::make_unique<ExpressionNode>(
-                            std::make_shared<ArithmeticNode>(
-                                std::move(current)),
-                            ArrayPostFixNode(
-                                std::vector<std::variant<
-                                    std::shared_ptr<ArrayRangeNode>,
-                                    std::shared_ptr<MethodNode>>>()));
-                        break;
-                    } else if (result.top().left == nullptr) {
-                        result.top().left = std::make_unique<ExpressionNode>(
-                            std::make_shared<ArithmeticNode>(
-                                std::move(current)),
-                            ArrayPostFixNode(
-                                std::vector<std::variant<
-                                    std::shared_ptr<ArrayRangeNode>,
-                                    std::shared_ptr<MethodNode>>>()));
-                    } else {
-                        throw std::runtime_error("Invalid array expression");
-                    }
-                }
-            } else {
-                throw std::runtime_error("Invalid array expression");
+    return left;
+}
+
+static ExpressionNode parseOperand(TokenStream& tokens, size_t& i) {
+    if (!tokens.has(i)) throw std::runtime_error("Empty expression.");
+    const Token& token = tokens[i];
+    switch (token.getType()) {
+        case TokenType::INT_LIT:
+            throw std::runtime_error(
+                "Unexpected int literal in array expression.");
+        case TokenType::SYMBOL:
+            if (token.getSymbol() == Symbol::LEFT_PARENTHESIS) {
+                ++i;
+                ExpressionNode inner = parseArithmetic(tokens, i, 0);
+                expect(tokens, i, "Array Expression", TokenType::SYMBOL, ")");
+                ++i;
+                return inner;
             }
-        } else {
-            result.push(ArithmeticNode(nullptr, nullptr,
-                                       std::get<ArithmeticNode::Type>(top)));
-        }
+            if (token.getSymbol() != Symbol::LEFT_BRACKET)
+                throw std::runtime_error("Empty expression.");
+            break;
+        default:
+            break;
     }
-    if (result.size() != 1)
-        throw std::runtime_error("Invalid array expression");
-    return ExpressionNode(
-        std::make_shared<ArithmeticNode>(std::move(result.top())),
-        ArrayPostFixNode(
-            std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
-                                     std::shared_ptr<MethodNode>>>()));
+    auto arrayNode = ArrayNode::parse(tokens, i);
+    auto postFix = ArrayPostFixNode::parse(tokens, i);
+    return ExpressionNode(makeNode<ArrayNode>(std::move(arrayNode)),
+                          std::move(postFix));
+}
+
+// An expression ends at the first token that can't continue it, such as an
+// identifier after an operand, so that keywords like `reduce` can follow.
+ExpressionNode ExpressionNode::parse(TokenStream& tokens, size_t& i) {
+    return parseArithmetic(tokens, i, 0);
 }
 
 ExpressionNode::ExpressionNode(
@@ -725,35 +786,36 @@ ArithmeticNode::ArithmeticNode(std::shared_ptr<ExpressionNode> left,
                                std::shared_ptr<ExpressionNode> right, Type type)
     : left(std::move(left)), right(std::move(right)), type(type) {}
 
-ArrayNode ArrayNode::parse(std::vector<Token>& tokens, size_t& i) {
+ArrayNode ArrayNode::parse(TokenStream& tokens, size_t& i) {
     std::variant<std::vector<int>, std::string,
                  std::shared_ptr<FunctionCallNode>>
         value;
     if (tokens[i].getType() == TokenType::IDENTIFIER) {
-        if (i + 1 < tokens.size() &&
+        if (tokens.has(i + 1) &&
             tokens[i + 1] == Token(TokenType::SYMBOL, "(")) {
-            value = std::make_shared<FunctionCallNode>(
+            value = makeNode<FunctionCallNode>(
                 std::move(FunctionCallNode::parse(tokens, i)));
         } else {
-            value = std::move(tokens[i].getValue());
+            value = std::string(tokens[i].getValue());
             ++i;
         }
     } else {
         std::vector<int> ints;
-        if (i < tokens.size() && tokens[i].getType() == TokenType::STRING_LIT) {
+        if (tokens.has(i) && tokens[i].getType() == TokenType::STRING_LIT) {
             ints = ArrayNode::stringToInts(tokens[i].getValue());
             ++i;
         } else {
             expect(tokens, i, "Array", TokenType::SYMBOL, "[");
             ++i;
-            while (i < tokens.size() &&
-                   !(tokens[i].getType() == TokenType::SYMBOL &&
-                     tokens[i].getValue()[0] == ']')) {
-                ints.push_back(std::stoi(
-                    expect(tokens, i, "Array", TokenType::INT_LIT).getValue()));
+            // Elements are never looked at again, so a long literal doesn't
+            // keep all of its tokens resident.
+            while (tokens.has(i) &&
+                   tokens[i].getSymbol() != Symbol::RIGHT_BRACKET) {
+                tokens.release(i);
+                ints.push_back(
+                    parseInt(expect(tokens, i, "Array", TokenType::INT_LIT)));
                 ++i;
-                if (!(tokens[i].getType() == TokenType::SYMBOL &&
-                      tokens[i].getValue()[0] == ']')) {
+                if (tokens[i].getSymbol() != Symbol::RIGHT_BRACKET) {
                     expect(tokens, i, "Array", TokenType::SYMBOL, ",");
                     ++i;
                 }
@@ -771,46 +833,44 @@ ArrayNode::ArrayNode(std::variant<std::vector<int>, std::string,
                          value)
     : value(std::move(value)) {}
 
-ArrayRangeNode ArrayRangeNode::parse(std::vector<Token>& tokens, size_t& i) {
+ArrayRangeNode ArrayRangeNode::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "Array Range", TokenType::SYMBOL, "[");
     ++i;
     std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>> start;
     std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>> end;
-    if (i + 1 >= tokens.size())
+    if (!tokens.has(i + 1))
         throw UnexpectedEOFError("Array Range", "Lower bound or :");
     if (tokens[i].getType() == TokenType::INT_LIT) {
-        size_t startAsSizeT = std::stoi(tokens[i].getValue());
+        size_t startAsSizeT = parseInt(tokens[i]);
         ++i;
-        if (i < tokens.size() && tokens[i] == Token(TokenType::SYMBOL, "]")) {
+        if (tokens.has(i) && tokens[i] == Token(TokenType::SYMBOL, "]")) {
             ++i;
             return ArrayRangeNode(startAsSizeT, startAsSizeT + 1);
         }
         start = startAsSizeT;
     } else if (!(tokens[i] == Token(TokenType::SYMBOL, ":"))) {
-        ExpressionNode startAsExpression = ExpressionNode::parse(tokens, i);
-        if (i < tokens.size() && tokens[i] == Token(TokenType::SYMBOL, "]")) {
+        start = makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
+        if (tokens.has(i) && tokens[i] == Token(TokenType::SYMBOL, "]")) {
             ++i;
-            ExpressionNode endAsExpression = ExpressionNode(
-                std::make_shared<ArithmeticNode>(
-                    std::make_shared<ExpressionNode>(startAsExpression),
-                    std::make_shared<ExpressionNode>((std::vector<int>){1}),
+            end = makeNode<ExpressionNode>(ExpressionNode(
+                makeNode<ArithmeticNode>(
+                    std::get<std::shared_ptr<ExpressionNode>>(start.value()),
+                    makeNode<ExpressionNode>(std::vector<int>{1}),
                     ArithmeticNode::TYPE_ADDITION),
-                ArrayPostFixNode(
-                    std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
-                                             std::shared_ptr<MethodNode>>>()));
+                noPostfix()));
+            return ArrayRangeNode(start, end);
         }
-        start = std::make_shared<ExpressionNode>(startAsExpression);
     }
     expect(tokens, i, "Array Range", TokenType::SYMBOL, ":");
     ++i;
-    if (i + 1 >= tokens.size())
+    if (!tokens.has(i + 1))
         throw UnexpectedEOFError("Array Range", "Lower bound or :");
     if (tokens[i].getType() == TokenType::INT_LIT) {
-        end = static_cast<size_t>(std::stoi(tokens[i].getValue()));
+        end = static_cast<size_t>(parseInt(tokens[i]));
         ++i;
     } else if (!(tokens[i] == Token(TokenType::SYMBOL, "]"))) {
         end =
-            std::make_shared<ExpressionNode>(ExpressionNode::parse(tokens, i));
+            makeNode<ExpressionNode>(ExpressionNode::parse(tokens, i));
     }
     expect(tokens, i, "Array Range", TokenType::SYMBOL, "]");
     ++i;
@@ -824,7 +884,8 @@ ArrayRangeNode::ArrayRangeNode(
     : start(std::move(start)), end(std::move(end)) {}
 
 std::string FunctionDefinitionNode::toStringIndented(size_t indent) const {
-    std::string result = nTabs(indent) + "fn " + identifier + "(";
+    std::string result =
+        nTabs(indent) + (memoized ? "memo fn " : "fn ") + identifier + "(";
     for (auto& param : params) result += std::string(*param);
 
     result +=
@@ -874,8 +935,24 @@ std::string StatementNode::toStringIndented(size_t indent) const {
 }
 
 std::string ForLoopNode::toStringIndented(size_t indent) const {
-    return "for " + element + " : " + std::string(*iterable) + " " +
-           body->toStringIndented(indent);
+    std::string result = (parallel ? "pfor " : "for ") + element + " : " +
+                         std::string(*iterable) + " ";
+    for (size_t j = 0; j < reductions.size(); j++)
+        result += (j == 0 ? "reduce " : ", ") + std::string(*reductions[j]) +
+                  (j + 1 == reductions.size() ? " " : "");
+    return result + body->toStringIndented(indent);
+}
+
+ReductionNode::operator std::string() const {
+    switch (type) {
+        case TYPE_ADD:
+            return variable + " +";
+        case TYPE_MULTIPLY:
+            return variable + " *";
+        case TYPE_APPEND:
+            return variable + " append";
+    }
+    return variable;
 }
 
 VariableBindingNode::operator std::string() const {
@@ -1016,6 +1093,24 @@ ArithmeticNode::operator std::string() const {
         case Type::TYPE_DIVISION:
             math_op += " / ";
             break;
+        case Type::TYPE_MODULO:
+            math_op += " % ";
+            break;
+        case Type::TYPE_AND:
+            math_op += " & ";
+            break;
+        case Type::TYPE_OR:
+            math_op += " | ";
+            break;
+        case Type::TYPE_XOR:
+            math_op += " ^ ";
+            break;
+        case Type::TYPE_SHIFT_LEFT:
+            math_op += " << ";
+            break;
+        case Type::TYPE_SHIFT_RIGHT:
+            math_op += " >> ";
+            break;
         default:
             break;
     }
@@ -1067,19 +1162,19 @@ ArrayDescriptor::operator std::string() const {
     return result;
 }
 
-ArrayPostFixNode ArrayPostFixNode::parse(std::vector<Token>& tokens,
+ArrayPostFixNode ArrayPostFixNode::parse(TokenStream& tokens,
                                          size_t& i) {
     std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
                              std::shared_ptr<MethodNode>>>
         result;
-    while (i < tokens.size() && tokens[i].getType() == TokenType::SYMBOL &&
+    while (tokens.has(i) && tokens[i].getType() == TokenType::SYMBOL &&
            (tokens[i].getValue()[0] == '[' || tokens[i].getValue()[0] == '.'))
         if (tokens[i].getValue()[0] == '[')
-            result.push_back(std::make_shared<ArrayRangeNode>(
+            result.push_back(makeNode<ArrayRangeNode>(
                 ArrayRangeNode::parse(tokens, i)));
         else
             result.push_back(
-                std::make_shared<MethodNode>(MethodNode::parse(tokens, i)));
+                makeNode<MethodNode>(MethodNode::parse(tokens, i)));
     return ArrayPostFixNode(std::move(result));
 }
 
@@ -1171,6 +1266,22 @@ const std::shared_ptr<BodyNode>& FunctionDefinitionNode::getBody() const {
     return body;
 }
 
+size_t FunctionDefinitionNode::getFrameSize() const { return frameSize; }
+
+void FunctionDefinitionNode::setFrameSize(size_t frameSize) {
+    this->frameSize = frameSize;
+}
+
+size_t FunctionDefinitionNode::getLine() const { return line; }
+
+void FunctionDefinitionNode::setLine(size_t line) { this->line = line; }
+
+TierState& FunctionDefinitionNode::getTier() const { return tier; }
+
+bool FunctionDefinitionNode::isMemoized() const { return memoized; }
+
+MemoState& FunctionDefinitionNode::getMemo() const { return memo; }
+
 const std::vector<std::shared_ptr<StatementNode>>& BodyNode::getStatements()
     const {
     return statements;
@@ -1184,6 +1295,10 @@ StatementNode::getValue() const {
     return value;
 }
 
+size_t StatementNode::getLine() const { return line; }
+
+void StatementNode::setLine(size_t line) { this->line = line; }
+
 FunctionParameterNode::operator std::string() const {
     return identifier + ": " + std::string(descriptor);
 }
@@ -1207,6 +1322,18 @@ ExpressionNode::getPrimary() const {
 
 const ArrayPostFixNode& ExpressionNode::getPostfix() const { return postfix; }
 
+void ExpressionNode::fold(std::vector<int> values, size_t steps) {
+    primary = std::make_shared<ArrayNode>(std::move(values));
+    auto& chain = postfix.values;
+    chain.erase(chain.begin(), chain.begin() + steps);
+}
+
+const std::optional<VariableSlot>& ExpressionNode::getHoistedSlot() const {
+    return hoistedSlot;
+}
+
+void ExpressionNode::setHoistedSlot(VariableSlot slot) { hoistedSlot = slot; }
+
 const std::string& VariableDeclarationNode::getIdentifier() const {
     return identifier;
 }
@@ -1220,6 +1347,12 @@ VariableDeclarationNode::getValue() const {
     return value;
 }
 
+const std::optional<VariableSlot>& VariableDeclarationNode::getSlot() const {
+    return slot;
+}
+
+void VariableDeclarationNode::setSlot(VariableSlot slot) { this->slot = slot; }
+
 const std::variant<std::shared_ptr<VariableDeclarationNode>,
                    std::shared_ptr<VariableAssignmentNode>>&
 VariableBindingNode::getValue() const {
@@ -1238,7 +1371,19 @@ ArrayNode::getValue() const {
     return value;
 }
 
-std::vector<int> ArrayNode::stringToInts(const std::string& string) {
+const std::optional<VariableSlot>& ArrayNode::getSlot() const { return slot; }
+
+void ArrayNode::setSlot(VariableSlot slot) { this->slot = slot; }
+
+const std::shared_ptr<const Value>& ArrayNode::getLiteral() const {
+    return literal;
+}
+
+void ArrayNode::setLiteral(std::shared_ptr<const Value> literal) {
+    this->literal = std::move(literal);
+}
+
+std::vector<int> ArrayNode::stringToInts(std::string_view string) {
     std::vector<int> ints;
     ints.reserve(string.size());
     for (size_t i = 0; i < string.size(); i++) ints.push_back(string[i]);
@@ -1254,6 +1399,16 @@ FunctionCallNode::getParameters() const {
     return parameters;
 }
 
+const std::optional<BuiltinFunction>& FunctionCallNode::getBuiltin() const {
+    return builtin;
+}
+
+void FunctionCallNode::setBuiltin(BuiltinFunction builtin) {
+    this->builtin = builtin;
+}
+
+CallSiteCache& FunctionCallNode::getCache() const { return cache; }
+
 const std::string& MethodNode::getIdentifier() const { return identifier; }
 
 const std::vector<std::shared_ptr<ExpressionNode>>& MethodNode::getParameters()
@@ -1261,6 +1416,12 @@ const std::vector<std::shared_ptr<ExpressionNode>>& MethodNode::getParameters()
     return parameters;
 }
 
+const std::optional<BuiltinMethod>& MethodNode::getBuiltin() const {
+    return builtin;
+}
+
+void MethodNode::setBuiltin(BuiltinMethod builtin) { this->builtin = builtin; }
+
 const std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>&
 ArrayRangeNode::getStart() const {
     return start;
@@ -1278,6 +1439,12 @@ const std::shared_ptr<ExpressionNode>& VariableAssignmentNode::getRight()
     return right;
 }
 
+const std::optional<VariableSlot>& VariableAssignmentNode::getSlot() const {
+    return slot;
+}
+
+void VariableAssignmentNode::setSlot(VariableSlot slot) { this->slot = slot; }
+
 const std::string& ForLoopNode::getElement() const { return element; }
 
 const std::shared_ptr<ExpressionNode>& ForLoopNode::getIterable() const {
@@ -1286,6 +1453,58 @@ const std::shared_ptr<ExpressionNode>& ForLoopNode::getIterable() const {
 
 const std::shared_ptr<BodyNode>& ForLoopNode::getBody() const { return body; }
 
+size_t ForLoopNode::getElementSlot() const { return elementSlot; }
+
+void ForLoopNode::setElementSlot(size_t elementSlot) {
+    this->elementSlot = elementSlot;
+}
+
+bool ForLoopNode::isParallel() const { return parallel; }
+
+const std::vector<std::shared_ptr<ReductionNode>>& ForLoopNode::getReductions()
+    const {
+    return reductions;
+}
+
+const FunctionCallNode* ForLoopNode::getRangeCall() const {
+    auto& steps = iterable->getPostfix().getValues();
+    if (steps.size() > 1 ||
+        (steps.size() == 1 &&
+         !std::holds_alternative<std::shared_ptr<ArrayRangeNode>>(steps[0])))
+        return nullptr;
+    auto array =
+        std::get_if<std::shared_ptr<ArrayNode>>(&iterable->getPrimary());
+    if (array == nullptr) return nullptr;
+    auto functionCall =
+        std::get_if<std::shared_ptr<FunctionCallNode>>(&(*array)->getValue());
+    if (functionCall == nullptr ||
+        (*functionCall)->getBuiltin() != BuiltinFunction::RANGE)
+        return nullptr;
+    return functionCall->get();
+}
+
+const ArrayRangeNode* ForLoopNode::getRangeSlice() const {
+    auto& steps = iterable->getPostfix().getValues();
+    if (steps.empty()) return nullptr;
+    return std::get<std::shared_ptr<ArrayRangeNode>>(steps[0]).get();
+}
+
+const std::vector<size_t>& ForLoopNode::getHoistedSlots() const {
+    return hoistedSlots;
+}
+
+void ForLoopNode::setHoistedSlots(std::vector<size_t> slots) {
+    hoistedSlots = std::move(slots);
+}
+
+const std::string& ReductionNode::getVariable() const { return variable; }
+
+ReductionNode::Type ReductionNode::getType() const { return type; }
+
+size_t ReductionNode::getSlot() const { return slot; }
+
+void ReductionNode::setSlot(size_t slot) { this->slot = slot; }
+
 const std::variant<std::shared_ptr<IfCompareNode>,
                    std::shared_ptr<IfDeclarationNode>>&
 IfNode::getCondition() const {
@@ -1322,30 +1541,39 @@ const std::shared_ptr<ExpressionNode>& ReturnNode::getValue() const {
     return value;
 }
 
+const FunctionCallNode* ReturnNode::getTailCall() const {
+    if (!value->getPostfix().getValues().empty()) return nullptr;
+    auto array = std::get_if<std::shared_ptr<ArrayNode>>(&value->getPrimary());
+    if (array == nullptr) return nullptr;
+    auto functionCall =
+        std::get_if<std::shared_ptr<FunctionCallNode>>(&(*array)->getValue());
+    return functionCall == nullptr ? nullptr : functionCall->get();
+}
+
 ExpressionNode::ExpressionNode(std::vector<int> values)
-    : primary(std::make_shared<ArrayNode>(values)),
+    : primary(makeNode<ArrayNode>(values)),
       postfix(ArrayPostFixNode(
           std::vector<std::variant<std::shared_ptr<ArrayRangeNode>,
                                    std::shared_ptr<MethodNode>>>())) {}
 
-UseNode UseNode::parse(std::vector<Token>& tokens, size_t& i) {
+UseNode UseNode::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "use", TokenType::IDENTIFIER, "use");
     ++i;
-    if (i >= tokens.size())
+    if (!tokens.has(i))
         throw UnexpectedEOFError("use",
                                  "\"array literal\" or <standard_header>");
     if (tokens[i] == Token(TokenType::SYMBOL, "<")) {
         ++i;
-        auto standardHeader =
-            expect(tokens, i, "use", TokenType::IDENTIFIER).getValue();
+        std::string standardHeader(
+            expect(tokens, i, "use", TokenType::IDENTIFIER).getValue());
         ++i;
         expect(tokens, i, "use", TokenType::SYMBOL, ">");
         ++i;
-        return UseNode(std::make_shared<ArrayNode>(
+        return UseNode(makeNode<ArrayNode>(
                            ArrayNode::stringToInts(standardHeader)),
                        Type::STANDARD_HEADER);
     }
-    return UseNode(std::make_shared<ArrayNode>(ArrayNode::parse(tokens, i)),
+    return UseNode(makeNode<ArrayNode>(ArrayNode::parse(tokens, i)),
                    Type::PATH);
 }
 
@@ -1373,10 +1601,10 @@ WhileNode::WhileNode(std::variant<std::shared_ptr<IfCompareNode>,
                      std::shared_ptr<BodyNode> body)
     : condition(std::move(condition)), body(std::move(body)) {}
 
-WhileNode WhileNode::parse(std::vector<Token>& tokens, size_t& i) {
+WhileNode WhileNode::parse(TokenStream& tokens, size_t& i) {
     expect(tokens, i, "while", TokenType::IDENTIFIER, "while");
     ++i;
-    if (i >= tokens.size()) throw UnexpectedEOFError("while", "token");
+    if (!tokens.has(i)) throw UnexpectedEOFError("while", "token");
 
     std::variant<std::shared_ptr<IfCompareNode>,
                  std::shared_ptr<IfDeclarationNode>>
@@ -1389,7 +1617,7 @@ WhileNode WhileNode::parse(std::vector<Token>& tokens, size_t& i) {
                       IfDeclarationNode>(IfDeclarationNode::parse(tokens, i))}
                 : std::variant<std::shared_ptr<IfCompareNode>,
                                std::shared_ptr<IfDeclarationNode>>{
-                      std::make_shared<IfCompareNode>(
+                      makeNode<IfCompareNode>(
                           IfCompareNode::parse(tokens, i))};
 
     std::shared_ptr<BodyNode> body = BodyNode::parse(tokens, i);
@@ -1424,3 +1652,11 @@ WhileNode::getCondition() const {
 }
 
 const std::shared_ptr<BodyNode>& WhileNode::getBody() const { return body; }
+
+const std::vector<size_t>& WhileNode::getHoistedSlots() const {
+    return hoistedSlots;
+}
+
+void WhileNode::setHoistedSlots(std::vector<size_t> slots) {
+    hoistedSlots = std::move(slots);
+}
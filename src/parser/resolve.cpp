@@ -0,0 +1,355 @@
+// Copyright 2025 Caden Crowson
+
+#include "parser/resolve.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "parser/fold.h"
+#include "parser/hoist.h"
+#include "parser/shape.h"
+#include "runtime/builtins.h"
+
+namespace {
+
+class Resolver {
+ public:
+    // `spawnIsBuiltin` is false when the file defines a function named spawn.
+    explicit Resolver(bool spawnIsBuiltin) : spawnIsBuiltin(spawnIsBuiltin) {}
+
+    void resolveFunction(FunctionDefinitionNode& function) {
+        if (function.isMemoized()) memoized = &function;
+        beginBlock();
+        for (auto& param : function.getParams())
+            declare(param->getIdentifier());
+        resolveBody(function.getBody());
+        endBlock();
+        function.setFrameSize(frameSize);
+    }
+
+    // Globals have no frame, so only the builtins they call are resolved.
+    void resolveGlobal(const VariableBindingNode& binding) {
+        auto& value = binding.getValue();
+        if (auto declaration =
+                std::get_if<std::shared_ptr<VariableDeclarationNode>>(&value)) {
+            if ((*declaration)->getValue().has_value())
+                resolveExpression((*declaration)->getValue().value());
+        } else {
+            resolveExpression(
+                std::get<std::shared_ptr<VariableAssignmentNode>>(value)
+                    ->getRight());
+        }
+    }
+
+ private:
+    // Blocks only scope names; their variables live in the function frame.
+    // A block's slots are released when it ends so that sibling blocks can
+    // reuse them, and the frame is sized for the deepest nesting.
+    struct Block {
+        std::unordered_map<std::string, size_t> slots;
+        size_t start;
+    };
+
+    void beginBlock() { blocks.push_back(Block{{}, nextSlot}); }
+
+    void endBlock() {
+        nextSlot = blocks.back().start;
+        blocks.pop_back();
+    }
+
+    size_t declare(const std::string& name) {
+        auto& block = blocks.back();
+        auto found = block.slots.find(name);
+        if (found != block.slots.end()) return found->second;
+        block.slots.emplace(name, nextSlot);
+        frameSize = std::max(frameSize, nextSlot + 1);
+        return nextSlot++;
+    }
+
+    std::optional<VariableSlot> lookup(const std::string& name) const {
+        for (auto block = blocks.rbegin(); block != blocks.rend(); ++block) {
+            auto found = block->slots.find(name);
+            if (found != block->slots.end())
+                return VariableSlot{found->second};
+        }
+        return std::nullopt;
+    }
+
+    void resolveExpressions(
+        const std::vector<std::shared_ptr<ExpressionNode>>& expressions) {
+        for (auto& expression : expressions) resolveExpression(expression);
+    }
+
+    void resolveArrayRangeBound(
+        const std::optional<std::variant<size_t, std::shared_ptr<ExpressionNode>>>&
+            bound) {
+        if (!bound.has_value()) return;
+        if (auto expression =
+                std::get_if<std::shared_ptr<ExpressionNode>>(&bound.value()))
+            resolveExpression(*expression);
+    }
+
+    // A memo fn's results are kept, so it may only depend on its arguments.
+    // The functions it calls are trusted to do the same.
+    void checkMemoized(const std::string& what) const {
+        if (memoized != nullptr)
+            throw std::runtime_error("Memoized function " +
+                                     memoized->getIdentifier() + " cannot " +
+                                     what);
+    }
+
+    // User functions still shadow a builtin of the same name; the ID only
+    // saves looking the builtin up again when there is none.
+    void resolveFunctionCall(FunctionCallNode& functionCall) {
+        auto& name = functionCall.getIdentifier();
+        auto builtin = builtinFunctionFromName(name);
+        // Calls to a user spawn aren't tagged, so no engine starts a task.
+        if (builtin == BuiltinFunction::SPAWN && !spawnIsBuiltin)
+            builtin.reset();
+        if (builtin) {
+            functionCall.setBuiltin(builtin.value());
+            if (!isPureFunction(builtin.value())) checkMemoized("call " + name);
+        }
+        auto& parameters = functionCall.getParameters();
+        if (builtin == BuiltinFunction::SPAWN) {
+            // The first argument names the function, not a variable.
+            if (spawnedName(functionCall) == nullptr)
+                throw std::runtime_error(
+                    "spawn expects the name of a function first");
+            for (size_t i = 1; i < parameters.size(); i++)
+                resolveExpression(parameters[i]);
+            return;
+        }
+        resolveExpressions(parameters);
+    }
+
+    void resolveExpression(const std::shared_ptr<ExpressionNode>& expression) {
+        std::visit(
+            [this](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isArithmetic =
+                    std::is_same_v<T, std::shared_ptr<ArithmeticNode>>;
+                constexpr bool isArray =
+                    std::is_same_v<T, std::shared_ptr<ArrayNode>>;
+                if constexpr (isArithmetic) {
+                    resolveExpression(arg->left);
+                    resolveExpression(arg->right);
+                } else if constexpr (isArray) {
+                    auto& value = arg->getValue();
+                    if (auto name = std::get_if<std::string>(&value)) {
+                        if (auto slot = lookup(*name))
+                            arg->setSlot(*slot);
+                        else
+                            checkMemoized("read global " + *name);
+                    } else if (auto functionCall = std::get_if<
+                                   std::shared_ptr<FunctionCallNode>>(&value)) {
+                        resolveFunctionCall(**functionCall);
+                    }
+                }
+            },
+            expression->getPrimary());
+        for (auto& postfix : expression->getPostfix().getValues()) {
+            std::visit(
+                [this](auto&& arg) {
+                    using T = std::decay_t<decltype(arg)>;
+                    constexpr bool isArrayRange =
+                        std::is_same_v<T, std::shared_ptr<ArrayRangeNode>>;
+                    constexpr bool isMethod =
+                        std::is_same_v<T, std::shared_ptr<MethodNode>>;
+                    if constexpr (isArrayRange) {
+                        resolveArrayRangeBound(arg->getStart());
+                        resolveArrayRangeBound(arg->getEnd());
+                    } else if constexpr (isMethod) {
+                        auto& name = arg->getIdentifier();
+                        if (auto builtin = builtinMethodFromName(name)) {
+                            arg->setBuiltin(builtin.value());
+                            if (!isPureMethod(builtin.value()))
+                                checkMemoized("call " + name);
+                        }
+                        resolveExpressions(arg->getParameters());
+                    }
+                },
+                postfix);
+        }
+        foldExpression(*expression);
+    }
+
+    void resolveVariableDeclaration(
+        const std::shared_ptr<VariableDeclarationNode>& declaration) {
+        if (declaration->getValue().has_value())
+            resolveExpression(declaration->getValue().value());
+        declaration->setSlot(
+            VariableSlot{declare(declaration->getIdentifier())});
+    }
+
+    void resolveCondition(
+        const std::variant<std::shared_ptr<IfCompareNode>,
+                           std::shared_ptr<IfDeclarationNode>>& condition) {
+        std::visit(
+            [this](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isCompare =
+                    std::is_same_v<T, std::shared_ptr<IfCompareNode>>;
+                constexpr bool isDeclaration =
+                    std::is_same_v<T, std::shared_ptr<IfDeclarationNode>>;
+                if constexpr (isCompare) {
+                    resolveExpression(arg->getLeft());
+                    resolveExpression(arg->getRight());
+                } else if constexpr (isDeclaration) {
+                    resolveVariableDeclaration(arg->getVariableDeclaration());
+                }
+            },
+            condition);
+    }
+
+    void resolveIf(const std::shared_ptr<IfNode>& ifNode) {
+        beginBlock();
+        resolveCondition(ifNode->getCondition());
+        resolveBody(ifNode->getBody());
+        if (ifNode->getElseIfBranches().has_value())
+            resolveIf(ifNode->getElseIfBranches().value());
+        if (ifNode->getElseBody().has_value())
+            resolveBody(ifNode->getElseBody().value());
+        endBlock();
+    }
+
+    void resolveReductions(const ForLoopNode& forLoop) {
+        ParallelLoop loop{nextSlot, {}};
+        for (auto& reduction : forLoop.getReductions()) {
+            auto slot = lookup(reduction->getVariable());
+            if (!slot)
+                throw std::runtime_error(
+                    "pfor can only reduce local variables, but " +
+                    reduction->getVariable() + " is not one");
+            reduction->setSlot(slot->index);
+            loop.reduced.push_back(slot->index);
+        }
+        parallelLoops.push_back(std::move(loop));
+    }
+
+    // Iterations of a pfor run concurrently in copies of the frame, so the
+    // only outside variables they may assign are the ones they reduce.
+    void checkParallelAssignment(const std::string& name,
+                                 const std::optional<VariableSlot>& slot) {
+        for (auto& loop : parallelLoops) {
+            if (!slot)
+                throw std::runtime_error("Cannot assign global " + name +
+                                         " inside pfor");
+            bool reduced = std::find(loop.reduced.begin(), loop.reduced.end(),
+                                     slot->index) != loop.reduced.end();
+            if (slot->index < loop.start && !reduced)
+                throw std::runtime_error("Cannot assign " + name +
+                                         " inside pfor unless it is reduced");
+        }
+    }
+
+    void resolveStatement(const std::shared_ptr<StatementNode>& statement) {
+        std::visit(
+            [this](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVariableBinding =
+                    std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
+                constexpr bool isForLoop =
+                    std::is_same_v<T, std::shared_ptr<ForLoopNode>>;
+                constexpr bool isWhile =
+                    std::is_same_v<T, std::shared_ptr<WhileNode>>;
+                constexpr bool isIfNode =
+                    std::is_same_v<T, std::shared_ptr<IfNode>>;
+                constexpr bool isFunctionCall =
+                    std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                constexpr bool isReturn =
+                    std::is_same_v<T, std::shared_ptr<ReturnNode>>;
+                if constexpr (isVariableBinding) {
+                    auto& binding = arg->getValue();
+                    if (auto declaration = std::get_if<
+                            std::shared_ptr<VariableDeclarationNode>>(
+                            &binding)) {
+                        resolveVariableDeclaration(*declaration);
+                    } else {
+                        auto& assignment = std::get<
+                            std::shared_ptr<VariableAssignmentNode>>(binding);
+                        resolveExpression(assignment->getRight());
+                        auto slot = lookup(assignment->getLeft());
+                        checkParallelAssignment(assignment->getLeft(), slot);
+                        if (slot)
+                            assignment->setSlot(*slot);
+                        else
+                            checkMemoized("assign global " +
+                                          assignment->getLeft());
+                    }
+                } else if constexpr (isForLoop) {
+                    resolveExpression(arg->getIterable());
+                    if (arg->isParallel()) resolveReductions(*arg);
+                    beginBlock();
+                    arg->setElementSlot(declare(arg->getElement()));
+                    resolveBody(arg->getBody());
+                    endBlock();
+                    if (arg->isParallel()) parallelLoops.pop_back();
+                } else if constexpr (isWhile) {
+                    beginBlock();
+                    resolveCondition(arg->getCondition());
+                    resolveBody(arg->getBody());
+                    endBlock();
+                } else if constexpr (isIfNode) {
+                    resolveIf(arg);
+                } else if constexpr (isFunctionCall) {
+                    resolveFunctionCall(*arg);
+                } else if constexpr (isReturn) {
+                    if (!parallelLoops.empty())
+                        throw std::runtime_error(
+                            "Cannot return from inside pfor");
+                    resolveExpression(arg->getValue());
+                }
+            },
+            statement->getValue());
+    }
+
+    void resolveBody(const std::shared_ptr<BodyNode>& body) {
+        for (auto& statement : body->getStatements())
+            resolveStatement(statement);
+    }
+
+    // Variables from slot `start` up are declared inside the loop.
+    struct ParallelLoop {
+        size_t start;
+        std::vector<size_t> reduced;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<ParallelLoop> parallelLoops;
+    // The memo fn being resolved, if it is one.
+    const FunctionDefinitionNode* memoized = nullptr;
+    bool spawnIsBuiltin;
+    size_t nextSlot = 0;
+    size_t frameSize = 0;
+};
+
+}  // namespace
+
+void resolveVariables(const RootNode& root) {
+    bool spawnIsBuiltin = true;
+    for (auto& value : root.getValues())
+        if (auto function =
+                std::get_if<std::shared_ptr<FunctionDefinitionNode>>(&value))
+            if ((*function)->getIdentifier() == "spawn") spawnIsBuiltin = false;
+    for (auto& value : root.getValues()) {
+        if (auto function =
+                std::get_if<std::shared_ptr<FunctionDefinitionNode>>(
+                    &value)) {
+            Resolver(spawnIsBuiltin).resolveFunction(**function);
+            inferShapes(**function);
+            hoistInvariants(**function);
+        } else if (auto binding =
+                       std::get_if<std::shared_ptr<VariableBindingNode>>(
+                           &value)) {
+            Resolver(spawnIsBuiltin).resolveGlobal(**binding);
+        }
+    }
+}
@@ -0,0 +1,315 @@
+// Copyright 2025 Caden Crowson
+
+#include "parser/shape.h"
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace {
+
+// The size a value always has, when it is known.
+using Shape = std::optional<size_t>;
+
+const char* verb(ArithmeticNode::Type type) {
+    switch (type) {
+        case ArithmeticNode::TYPE_ADDITION:
+            return "add";
+        case ArithmeticNode::TYPE_SUBTRACTION:
+            return "subtract";
+        case ArithmeticNode::TYPE_MULTIPLICATION:
+            return "multiply";
+        case ArithmeticNode::TYPE_DIVISION:
+            return "divide";
+        case ArithmeticNode::TYPE_MODULO:
+            return "take the remainder of";
+        case ArithmeticNode::TYPE_AND:
+            return "bitwise-and";
+        case ArithmeticNode::TYPE_OR:
+            return "bitwise-or";
+        case ArithmeticNode::TYPE_XOR:
+            return "bitwise-xor";
+        default:
+            return "shift";
+    }
+}
+
+Shape descriptorShape(const ArrayDescriptor& descriptor) {
+    if (descriptor.getCanGrow()) return std::nullopt;
+    return descriptor.getSize();
+}
+
+class ShapeInference {
+ public:
+    explicit ShapeInference(const FunctionDefinitionNode& function)
+        : function(function), slots(function.getFrameSize()) {}
+
+    // A variable's shape is known when every value written to its slot has
+    // that shape. Slots start unwritten and can only lose a known shape, so
+    // passing over the body until nothing changes ends, and the last pass
+    // only marks and reports.
+    void run() {
+        do {
+            changed = false;
+            walk();
+        } while (changed);
+        final = true;
+        walk();
+    }
+
+ private:
+    struct Slot {
+        bool written = false;
+        Shape shape;
+    };
+
+    void walk() {
+        auto& params = function.getParams();
+        for (size_t i = 0; i < params.size(); i++)
+            write(i, descriptorShape(params[i]->getDescriptor()));
+        body(*function.getBody());
+    }
+
+    void write(size_t index, Shape shape) {
+        auto& slot = slots[index];
+        if (!slot.written) {
+            slot = Slot{true, shape};
+            changed = true;
+        } else if (slot.shape.has_value() && slot.shape != shape) {
+            slot.shape.reset();
+            changed = true;
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error(message + " at line " + std::to_string(line));
+    }
+
+    Shape arithmetic(ArithmeticNode& arithmetic) {
+        Shape left = expression(*arithmetic.left);
+        Shape right = expression(*arithmetic.right);
+        if (!final) return combine(left, right);
+        arithmetic.scalar = left == Shape(1) && right == Shape(1);
+        if (left && right && *left != *right && *left != 1 && *right != 1)
+            fail(std::string("Cannot ") + verb(arithmetic.type) +
+                 " arrays with different sizes (" + std::to_string(*left) +
+                 " and " + std::to_string(*right) + ")");
+        return combine(left, right);
+    }
+
+    // A single element is broadcast, so an operand of any other size fixes
+    // the size of the result, or the operation fails.
+    static Shape combine(Shape left, Shape right) {
+        if (left && *left != 1) return left;
+        if (right && *right != 1) return right;
+        if (left && right) return 1;
+        return std::nullopt;
+    }
+
+    Shape bound(
+        const std::optional<std::variant<size_t,
+                                         std::shared_ptr<ExpressionNode>>>&
+            bound,
+        Shape otherwise) {
+        if (!bound.has_value()) return otherwise;
+        if (auto index = std::get_if<size_t>(&bound.value())) return *index;
+        auto& value = *std::get<std::shared_ptr<ExpressionNode>>(bound.value());
+        expression(value);
+        auto array =
+            std::get_if<std::shared_ptr<ArrayNode>>(&value.getPrimary());
+        if (array == nullptr || !value.getPostfix().getValues().empty())
+            return std::nullopt;
+        auto literal = std::get_if<std::vector<int>>(&(*array)->getValue());
+        if (literal == nullptr || literal->size() != 1 || (*literal)[0] < 0)
+            return std::nullopt;
+        return (*literal)[0];
+    }
+
+    void expressions(
+        const std::vector<std::shared_ptr<ExpressionNode>>& expressions) {
+        for (auto& expression : expressions) this->expression(*expression);
+    }
+
+    Shape array(const ArrayNode& array) {
+        auto& value = array.getValue();
+        if (auto literal = std::get_if<std::vector<int>>(&value))
+            return literal->size();
+        if (auto call = std::get_if<std::shared_ptr<FunctionCallNode>>(&value))
+            expressions((*call)->getParameters());
+        if (!array.getSlot().has_value()) return std::nullopt;
+        auto& slot = slots[array.getSlot()->index];
+        return slot.written ? slot.shape : std::nullopt;
+    }
+
+    Shape method(const MethodNode& method, Shape shape) {
+        std::vector<Shape> parameters;
+        for (auto& parameter : method.getParameters())
+            parameters.push_back(expression(*parameter));
+        if (!method.getBuiltin().has_value()) return std::nullopt;
+        switch (method.getBuiltin().value()) {
+            case BuiltinMethod::SIZE:
+            case BuiltinMethod::SUM:
+            case BuiltinMethod::MIN:
+            case BuiltinMethod::MAX:
+            case BuiltinMethod::PROD:
+            case BuiltinMethod::FIND:
+            case BuiltinMethod::BSEARCH:
+            case BuiltinMethod::INDEXOF:
+            case BuiltinMethod::TOINT:
+                return 1;
+            case BuiltinMethod::SQRT:
+            case BuiltinMethod::SORT:
+            case BuiltinMethod::SCAN:
+            case BuiltinMethod::REVERSE:
+                return shape;
+            case BuiltinMethod::APPEND:
+                if (parameters.size() == 1 && shape && parameters[0])
+                    return *shape + *parameters[0];
+                return std::nullopt;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    Shape expression(const ExpressionNode& expression) {
+        Shape shape;
+        if (auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+                &expression.getPrimary()))
+            shape = this->arithmetic(**arithmetic);
+        else
+            shape = array(
+                *std::get<std::shared_ptr<ArrayNode>>(expression.getPrimary()));
+        for (auto& postfix : expression.getPostfix().getValues()) {
+            if (auto range =
+                    std::get_if<std::shared_ptr<ArrayRangeNode>>(&postfix)) {
+                Shape start = bound((*range)->getStart(), 0);
+                Shape end = bound((*range)->getEnd(), shape);
+                shape = start && end && *end >= *start
+                            ? Shape(*end - *start)
+                            : std::nullopt;
+            } else {
+                shape = method(*std::get<std::shared_ptr<MethodNode>>(postfix),
+                               shape);
+            }
+        }
+        return shape;
+    }
+
+    // A declaration with no value is empty when it can grow, zeros when it
+    // has a fixed size, and fails otherwise.
+    void declaration(const VariableDeclarationNode& declaration,
+                     bool checked) {
+        auto& descriptor = declaration.getDescriptor();
+        bool hasValue = declaration.getValue().has_value();
+        Shape value;
+        if (hasValue) value = expression(*declaration.getValue().value());
+        Shape shape;
+        if (descriptor.getCanGrow()) {
+            shape = hasValue ? value : Shape(0);
+        } else if (!descriptor.getSize().has_value()) {
+            if (!hasValue) return;
+            shape = value;
+        } else {
+            shape = descriptor.getSize();
+            if (final && !checked && value && *value != *shape)
+                fail("Cannot declare " + declaration.getIdentifier() +
+                     " as [" + std::to_string(*shape) +
+                     "] with an array of size " + std::to_string(*value));
+        }
+        if (auto& slot = declaration.getSlot()) write(slot->index, shape);
+    }
+
+    void condition(
+        const std::variant<std::shared_ptr<IfCompareNode>,
+                           std::shared_ptr<IfDeclarationNode>>& condition) {
+        if (auto compare =
+                std::get_if<std::shared_ptr<IfCompareNode>>(&condition)) {
+            Shape left = expression(*(*compare)->getLeft());
+            Shape right = expression(*(*compare)->getRight());
+            if (final)
+                (*compare)->scalar = left == Shape(1) && right == Shape(1);
+        } else {
+            // Values that don't fit skip the branch instead of failing.
+            declaration(*std::get<std::shared_ptr<IfDeclarationNode>>(condition)
+                             ->getVariableDeclaration(),
+                        true);
+        }
+    }
+
+    void ifChain(const IfNode& ifNode) {
+        condition(ifNode.getCondition());
+        body(*ifNode.getBody());
+        if (ifNode.getElseIfBranches().has_value())
+            ifChain(*ifNode.getElseIfBranches().value());
+        if (ifNode.getElseBody().has_value())
+            body(*ifNode.getElseBody().value());
+    }
+
+    void binding(const VariableBindingNode& binding) {
+        if (auto declaration =
+                std::get_if<std::shared_ptr<VariableDeclarationNode>>(
+                    &binding.getValue())) {
+            this->declaration(**declaration, false);
+            return;
+        }
+        auto& assignment =
+            *std::get<std::shared_ptr<VariableAssignmentNode>>(
+                binding.getValue());
+        Shape shape = expression(*assignment.getRight());
+        if (auto& slot = assignment.getSlot()) write(slot->index, shape);
+    }
+
+    void forLoop(const ForLoopNode& forLoop) {
+        expression(*forLoop.getIterable());
+        // Appended partials are merged into the variable after the loop.
+        for (auto& reduction : forLoop.getReductions())
+            if (reduction->getType() == ReductionNode::TYPE_APPEND)
+                write(reduction->getSlot(), std::nullopt);
+        write(forLoop.getElementSlot(), 1);
+        body(*forLoop.getBody());
+    }
+
+    void statement(const StatementNode& statement) {
+        line = statement.getLine();
+        auto& value = statement.getValue();
+        if (auto binding =
+                std::get_if<std::shared_ptr<VariableBindingNode>>(&value)) {
+            this->binding(**binding);
+        } else if (auto loop =
+                       std::get_if<std::shared_ptr<ForLoopNode>>(&value)) {
+            forLoop(**loop);
+        } else if (auto whileNode =
+                       std::get_if<std::shared_ptr<WhileNode>>(&value)) {
+            condition((*whileNode)->getCondition());
+            body(*(*whileNode)->getBody());
+        } else if (auto ifNode = std::get_if<std::shared_ptr<IfNode>>(&value)) {
+            ifChain(**ifNode);
+        } else if (auto call =
+                       std::get_if<std::shared_ptr<FunctionCallNode>>(&value)) {
+            expressions((*call)->getParameters());
+        } else if (auto returnNode =
+                       std::get_if<std::shared_ptr<ReturnNode>>(&value)) {
+            expression(*(*returnNode)->getValue());
+        }
+    }
+
+    void body(const BodyNode& body) {
+        for (auto& statement : body.getStatements())
+            this->statement(*statement);
+    }
+
+    const FunctionDefinitionNode& function;
+    std::vector<Slot> slots;
+    bool changed = false;
+    bool final = false;
+    size_t line = 0;
+};
+
+}  // namespace
+
+void inferShapes(const FunctionDefinitionNode& function) {
+    ShapeInference(function).run();
+}
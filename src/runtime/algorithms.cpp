@@ -0,0 +1,90 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/algorithms.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "runtime/kernels.h"
+#include "runtime/parallel.h"
+
+// Runs worth giving their own thread, or 1 when the array is not large.
+static size_t parallelRuns(size_t size) {
+    return std::min(parallelThreads(),
+                    size / std::max<size_t>(parallelThreshold(), 1));
+}
+
+void sortInts(int* data, size_t size) {
+    size_t runs = parallelRuns(size);
+    if (runs < 2) {
+        std::sort(data, data + size);
+        return;
+    }
+
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= runs; i++) bounds.push_back(size * i / runs);
+    parallelEach(runs, [&](size_t run) {
+        std::sort(data + bounds[run], data + bounds[run + 1]);
+    });
+
+    // Each round merges neighbouring runs from one buffer into the other.
+    auto buffer = std::make_unique<int[]>(size);
+    int* from = data;
+    int* to = buffer.get();
+    while (bounds.size() > 2) {
+        size_t pairs = (bounds.size() - 1) / 2;
+        parallelEach(pairs, [&](size_t pair) {
+            size_t begin = bounds[2 * pair];
+            size_t middle = bounds[2 * pair + 1];
+            size_t end = bounds[2 * pair + 2];
+            std::merge(from + begin, from + middle, from + middle, from + end,
+                       to + begin);
+        });
+        if ((bounds.size() - 1) % 2 == 1)
+            std::copy(from + bounds[bounds.size() - 2],
+                      from + bounds.back(), to + bounds[bounds.size() - 2]);
+        std::vector<size_t> merged;
+        for (size_t i = 0; i < bounds.size(); i += 2)
+            merged.push_back(bounds[i]);
+        if (merged.back() != bounds.back()) merged.push_back(bounds.back());
+        bounds = std::move(merged);
+        std::swap(from, to);
+    }
+    if (from != data) std::copy(from, from + size, data);
+}
+
+static void scanRun(const int* data, int* out, size_t size, int offset) {
+    unsigned total = static_cast<unsigned>(offset);
+    for (size_t i = 0; i < size; i++) {
+        total += static_cast<unsigned>(data[i]);
+        out[i] = static_cast<int>(total);
+    }
+}
+
+// Large scans sum each run in parallel, then scan every run again starting
+// from the total of the runs before it.
+void prefixSum(const int* data, int* out, size_t size) {
+    size_t runs = parallelRuns(size);
+    if (runs < 2) {
+        scanRun(data, out, size, 0);
+        return;
+    }
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= runs; i++) bounds.push_back(size * i / runs);
+    std::vector<int> offsets(runs + 1, 0);
+    parallelEach(runs, [&](size_t run) {
+        offsets[run + 1] =
+            applyReduction(ReductionKernel::SUM, data + bounds[run],
+                           bounds[run + 1] - bounds[run]);
+    });
+    for (size_t run = 1; run <= runs; run++)
+        offsets[run] =
+            static_cast<int>(static_cast<unsigned>(offsets[run]) +
+                             static_cast<unsigned>(offsets[run - 1]));
+    parallelEach(runs, [&](size_t run) {
+        scanRun(data + bounds[run], out + bounds[run],
+                bounds[run + 1] - bounds[run], offsets[run]);
+    });
+}
@@ -0,0 +1,1154 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/builtins.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "parser/parse.h"
+#include "runtime/algorithms.h"
+#include "runtime/channel.h"
+#include "runtime/context.h"
+#include "runtime/gpu.h"
+#include "runtime/kernels.h"
+#include "runtime/parallel.h"
+#include "runtime/table.h"
+#include "util/file.h"
+#include "util/pool.h"
+#include "util/terminal.h"
+
+static void expectArguments(const std::string& name,
+                            const std::vector<Value>& args, size_t expected) {
+    if (args.size() != expected)
+        throw std::runtime_error("Function " + name + " expected " +
+                                 std::to_string(expected) +
+                                 " argument(s) but received " +
+                                 std::to_string(args.size()));
+}
+
+// A growable result of one element.
+static DynamicArray growableScalar(int element) {
+    return DynamicArray::copyOf({&element, 1}, true);
+}
+
+std::string valueToString(const Value& value) {
+    ArrayView array = value.view();
+    std::string result;
+    result.reserve(array.size);
+    for (int element : array) result += static_cast<char>(element);
+    return result;
+}
+
+// Output is collected in memory and written out in large blocks: the
+// context's standard output, and every file written to by path. Those files
+// stay open between calls, so appending record by record doesn't reopen
+// them; the least recently opened is closed once too many are.
+constexpr size_t MAX_OPEN_OUTPUTS = 16;
+
+static BufferedOutput& standardOutput() {
+    return currentContext().standardOutput;
+}
+
+void setOutputBufferSize(size_t size) {
+    Context& context = currentContext();
+    context.outputCapacity =
+        size != 0 ? size : BufferedOutput::DEFAULT_CAPACITY;
+    context.standardOutput.setCapacity(context.outputCapacity);
+    std::lock_guard<std::mutex> lock(context.outputsMutex);
+    for (auto& output : context.outputs)
+        output.second->setCapacity(context.outputCapacity);
+}
+
+void flushOutput() {
+    Context& context = currentContext();
+    context.standardOutput.flush();
+    std::lock_guard<std::mutex> lock(context.outputsMutex);
+    for (auto& output : context.outputs) output.second->flush();
+}
+
+static bool sameString(ArrayView array, const std::string& string) {
+    return array.size == string.size() &&
+           std::equal(array.begin(), array.end(), string.begin(),
+                      [](int element, char c) {
+                          return static_cast<char>(element) == c;
+                      });
+}
+
+// Writing replaces the file's contents, and appending keeps them. Either
+// way the file stays open for the appends that follow.
+static void writeFile(const Value& path, const Value& data, bool append) {
+    ArrayView name = path.view();
+    ArrayView bytes = data.view();
+    Context& context = currentContext();
+    auto& outputs = context.outputs;
+    std::lock_guard<std::mutex> lock(context.outputsMutex);
+    auto output = std::find_if(
+        outputs.begin(), outputs.end(),
+        [name](const auto& output) { return sameString(name, output.first); });
+    if (output != outputs.end() && !append) {
+        output->second.reset();
+        output = outputs.erase(output);
+    }
+    if (output == outputs.end()) {
+        if (outputs.size() == MAX_OPEN_OUTPUTS) outputs.erase(outputs.begin());
+        std::string filename = valueToString(path);
+        auto file =
+            BufferedOutput::open(filename, append, context.outputCapacity);
+        outputs.emplace_back(std::move(filename), std::move(file));
+        output = outputs.end() - 1;
+    }
+    output->second->write(bytes.data, bytes.size);
+}
+
+static Value builtinPrint(std::vector<Value>& args) {
+    expectArguments("print", args, 1);
+    ArrayView array = args[0].view();
+    standardOutput().write(array.data, array.size);
+    return Value(DynamicArray(0), 0);
+}
+
+static Value builtinWrite(std::vector<Value>& args) {
+    expectArguments("write", args, 2);
+    writeFile(args[0], args[1], false);
+    return Value(DynamicArray(0), 0);
+}
+
+static Value builtinAppendfile(std::vector<Value>& args) {
+    expectArguments("appendfile", args, 2);
+    writeFile(args[0], args[1], true);
+    return Value(DynamicArray(0), 0);
+}
+
+static Value builtinFlush(std::vector<Value>& args) {
+    expectArguments("flush", args, 0);
+    flushOutput();
+    return Value(DynamicArray(0), 0);
+}
+
+// Bytes are widened straight from the mapped file into the result, so the
+// file is never copied as a string. The result is growable so that binding
+// it to a growable variable moves it rather than copying.
+static Value builtinRead(std::vector<Value>& args) {
+    expectArguments("read", args, 1);
+    flushOutput();
+    MappedFile file(valueToString(args[0]));
+    std::string_view contents = file.contents();
+    DynamicArray ints = DynamicArray::uninitialized(contents.size());
+    std::copy(contents.begin(), contents.end(), ints.data);
+    ints.canGrow = true;
+    size_t size = ints.size;
+    return Value(std::move(ints), size);
+}
+
+// Arrays saved with `save` are a 16-byte header, ARRAY_MAGIC and the element
+// count as a little-endian uint64, followed by the elements as little-endian
+// int32s. `load` maps the file and hands the elements to the result in
+// place, so loading costs the same at any size and pages are only read in
+// as they are used.
+static constexpr char ARRAY_MAGIC[8] = {'I', 'N', 'T', 'S', 'A', 'R', 'R', 0};
+static constexpr size_t ARRAY_HEADER = 16;
+static_assert(sizeof(int) == 4, "Array files hold 32-bit elements");
+
+static bool littleEndian() {
+    const uint32_t probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+}
+
+static uint32_t swapBytes(uint32_t value) {
+    return (value >> 24) | ((value >> 8) & 0xff00) |
+           ((value << 8) & 0xff0000) | (value << 24);
+}
+
+// Closes the buffered output for a file about to be rewritten directly.
+static void forgetOutput(const Value& path) {
+    ArrayView name = path.view();
+    Context& context = currentContext();
+    auto& outputs = context.outputs;
+    std::lock_guard<std::mutex> lock(context.outputsMutex);
+    auto output = std::find_if(
+        outputs.begin(), outputs.end(),
+        [name](const auto& output) { return sameString(name, output.first); });
+    if (output != outputs.end()) outputs.erase(output);
+}
+
+static Value builtinSave(std::vector<Value>& args) {
+    expectArguments("save", args, 2);
+    flushOutput();
+    forgetOutput(args[0]);
+    std::string filename = valueToString(args[0]);
+    ArrayView array = args[1].view();
+    char header[ARRAY_HEADER] = {};
+    std::copy(std::begin(ARRAY_MAGIC), std::end(ARRAY_MAGIC), header);
+    for (size_t i = 0; i < 8; i++)
+        header[8 + i] = static_cast<char>(
+            (static_cast<uint64_t>(array.size) >> (8 * i)) & 0xff);
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open file: " + filename);
+    file.write(header, ARRAY_HEADER);
+    if (littleEndian()) {
+        file.write(reinterpret_cast<const char*>(array.data),
+                   array.size * sizeof(int));
+    } else {
+        std::vector<uint32_t> block;
+        for (size_t start = 0; start < array.size; start += 1 << 16) {
+            size_t end = std::min(array.size, start + (1 << 16));
+            block.clear();
+            for (size_t i = start; i < end; i++)
+                block.push_back(
+                    swapBytes(static_cast<uint32_t>(array.data[i])));
+            file.write(reinterpret_cast<const char*>(block.data()),
+                       block.size() * sizeof(uint32_t));
+        }
+    }
+    if (!file) throw std::runtime_error("Failed to write file: " + filename);
+    return Value(DynamicArray(0), 0);
+}
+
+// The element count in an array file's header, if `contents` is one.
+static std::optional<size_t> arrayLength(std::string_view contents) {
+    if (contents.size() < ARRAY_HEADER ||
+        !std::equal(std::begin(ARRAY_MAGIC), std::end(ARRAY_MAGIC),
+                    contents.begin()))
+        return std::nullopt;
+    uint64_t count = 0;
+    for (size_t i = 0; i < 8; i++)
+        count |= static_cast<uint64_t>(
+                     static_cast<unsigned char>(contents[8 + i]))
+                 << (8 * i);
+    if (count != (contents.size() - ARRAY_HEADER) / sizeof(int) ||
+        (contents.size() - ARRAY_HEADER) % sizeof(int) != 0)
+        return std::nullopt;
+    return static_cast<size_t>(count);
+}
+
+static Value builtinLoad(std::vector<Value>& args) {
+    expectArguments("load", args, 1);
+    flushOutput();
+    std::string filename = valueToString(args[0]);
+    auto notArray = [&filename]() {
+        return std::runtime_error(
+            "Function load expected an array file but received " + filename);
+    };
+    size_t mapped = 0;
+    if (char* base = littleEndian() ? mapFile(filename, mapped) : nullptr) {
+        auto count = arrayLength(std::string_view(base, mapped));
+        if (!count || count.value() == 0) {
+            unmapFile(base, mapped);
+            if (!count) throw notArray();
+            return Value(DynamicArray(0), 0);
+        }
+        auto elements = reinterpret_cast<int*>(base + ARRAY_HEADER);
+        return Value(
+            DynamicArray::fromMapping(elements, count.value(), mapped),
+            count.value());
+    }
+    MappedFile file(filename);
+    std::string_view contents = file.contents();
+    auto count = arrayLength(contents);
+    if (!count) throw notArray();
+    DynamicArray result(count.value());
+    std::memcpy(result.data, contents.data() + ARRAY_HEADER,
+                count.value() * sizeof(int));
+    if (!littleEndian())
+        for (size_t i = 0; i < count.value(); i++)
+            result.data[i] = static_cast<int>(
+                swapBytes(static_cast<uint32_t>(result.data[i])));
+    return Value(std::move(result), count.value());
+}
+
+// Streams are the context's, indexed by handle. Closing a stream frees its
+// handle for the next open; a read in progress keeps its reader alive.
+
+static size_t handleArgument(const std::string& name, const Value& value,
+                             const std::string& kind = "file") {
+    ArrayView handle = value.view();
+    if (handle.size != 1 || handle[0] < 0)
+        throw std::runtime_error("Function " + name + " expected a " + kind +
+                                 " handle but received " +
+                                 std::string(value));
+    return static_cast<size_t>(handle[0]);
+}
+
+static std::runtime_error notOpen(const std::string& name, size_t handle) {
+    return std::runtime_error("Function " + name +
+                              " received a handle that is not open: " +
+                              std::to_string(handle));
+}
+
+static std::shared_ptr<ChunkReader> stream(const std::string& name,
+                                           const Value& value) {
+    size_t handle = handleArgument(name, value);
+    Context& context = currentContext();
+    auto& streams = context.streams;
+    std::lock_guard<std::mutex> lock(context.streamsMutex);
+    if (handle >= streams.size() || !streams[handle])
+        throw notOpen(name, handle);
+    return streams[handle];
+}
+
+static Value builtinOpen(std::vector<Value>& args) {
+    expectArguments("open", args, 1);
+    flushOutput();
+    auto reader = std::make_shared<ChunkReader>(valueToString(args[0]));
+    Context& context = currentContext();
+    auto& streams = context.streams;
+    std::lock_guard<std::mutex> lock(context.streamsMutex);
+    auto slot = std::find(streams.begin(), streams.end(), nullptr);
+    if (slot == streams.end()) slot = streams.insert(slot, nullptr);
+    *slot = std::move(reader);
+    DynamicArray result(1);
+    result[0] = static_cast<int>(slot - streams.begin());
+    return Value(std::move(result), 1);
+}
+
+// Gives up to n more bytes of the stream, and an empty array once it is
+// exhausted.
+static Value builtinReadchunk(std::vector<Value>& args) {
+    expectArguments("readchunk", args, 2);
+    auto reader = stream("readchunk", args[0]);
+    ArrayView limit = args[1].view();
+    if (limit.size != 1 || limit[0] < 0)
+        throw std::runtime_error(
+            "Function readchunk expected a non-negative size [1] byte count "
+            "but received " +
+            std::string(args[1]));
+    size_t remaining = static_cast<size_t>(limit[0]);
+    DynamicArray ints = DynamicArray::growable();
+    while (remaining > 0) {
+        std::string_view bytes = reader->next(remaining);
+        if (bytes.empty()) break;
+        ints.reserve(std::max(ints.size + bytes.size(), 2 * ints.capacity()));
+        std::copy(bytes.begin(), bytes.end(), ints.data + ints.size);
+        ints.size += bytes.size();
+        remaining -= bytes.size();
+    }
+    size_t size = ints.size;
+    return Value(std::move(ints), size);
+}
+
+// The reader's thread stops once the last read using it returns.
+static Value builtinClose(std::vector<Value>& args) {
+    expectArguments("close", args, 1);
+    size_t handle = handleArgument("close", args[0]);
+    std::shared_ptr<ChunkReader> reader;
+    {
+        Context& context = currentContext();
+        std::lock_guard<std::mutex> lock(context.streamsMutex);
+        if (handle < context.streams.size())
+            reader = std::move(context.streams[handle]);
+    }
+    if (!reader) throw notOpen("close", handle);
+    return Value(DynamicArray(0), 0);
+}
+
+// Tasks started with spawn are the context's, indexed by handle like
+// streams, until they are awaited. A task's result has a slot of its own,
+// filled by its job, so that the job doesn't keep the task alive.
+struct SpawnedTask {
+    ThreadPool::Job job;
+    std::shared_ptr<std::optional<Value>> result;
+};
+
+Value spawnTask(std::function<Value()> call) {
+    auto task = std::make_shared<SpawnedTask>();
+    task->result = std::make_shared<std::optional<Value>>();
+    Context& context = currentContext();
+    context.runningTasks++;
+    task->job = spawnJob([result = task->result, call = std::move(call)] {
+        // The job runs in the context that spawned it.
+        struct Finished {
+            ~Finished() { currentContext().runningTasks--; }
+        } finished;
+        *result = call();
+    });
+    std::lock_guard<std::mutex> lock(context.tasksMutex);
+    auto& tasks = context.tasks;
+    auto slot = std::find(tasks.begin(), tasks.end(), nullptr);
+    if (slot == tasks.end()) slot = tasks.insert(slot, nullptr);
+    *slot = std::move(task);
+    return Value(growableScalar(static_cast<int>(slot - tasks.begin())), 1);
+}
+
+// Tasks may spawn more while they run, so this goes on until none are left.
+// The first error, or exit, of a task nobody awaited is the run's.
+static std::exception_ptr waitForTasks() {
+    Context& context = currentContext();
+    std::exception_ptr first;
+    while (true) {
+        std::vector<std::shared_ptr<SpawnedTask>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(context.tasksMutex);
+            tasks.swap(context.tasks);
+        }
+        if (tasks.empty()) return first;
+        for (auto& task : tasks) {
+            if (!task) continue;
+            try {
+                waitForJob(task->job);
+            } catch (...) {
+                if (!first) first = std::current_exception();
+            }
+        }
+    }
+}
+
+void finishTasks() {
+    if (std::exception_ptr error = waitForTasks())
+        std::rethrow_exception(error);
+}
+
+void abandonTasks() { waitForTasks(); }
+
+const std::string* spawnedName(const FunctionCallNode& call) {
+    auto& parameters = call.getParameters();
+    if (parameters.empty() ||
+        !parameters[0]->getPostfix().getValues().empty())
+        return nullptr;
+    auto array =
+        std::get_if<std::shared_ptr<ArrayNode>>(&parameters[0]->getPrimary());
+    if (array == nullptr) return nullptr;
+    return std::get_if<std::string>(&(*array)->getValue());
+}
+
+// The engines start the call themselves, as only they can make it; this
+// runs only for a call whose first argument names no function.
+static Value builtinSpawn(std::vector<Value>& args) {
+    if (args.empty())
+        throw std::runtime_error(
+            "Function spawn expected a function and its arguments");
+    throw std::runtime_error(
+        "Function spawn expected the name of a function but received " +
+        std::string(args[0]));
+}
+
+// Gives what the task's function returned, or throws what it threw. The
+// handle is free for the next spawn once the task is awaited.
+static Value builtinAwait(std::vector<Value>& args) {
+    expectArguments("await", args, 1);
+    size_t handle = handleArgument("await", args[0], "task");
+    std::shared_ptr<SpawnedTask> task;
+    {
+        Context& context = currentContext();
+        std::lock_guard<std::mutex> lock(context.tasksMutex);
+        if (handle < context.tasks.size())
+            task = std::move(context.tasks[handle]);
+    }
+    if (!task)
+        throw std::runtime_error(
+            "Function await received a handle that is not a running task: " +
+            std::to_string(handle));
+    waitForJob(task->job);
+    return std::move(task->result->value());
+}
+
+// Channels last as long as the script's context, since any task may still
+// hold a handle to one.
+constexpr size_t MAX_CHANNEL_CAPACITY = 1 << 20;
+
+static std::shared_ptr<Channel> channel(const std::string& name,
+                                        const Value& value) {
+    size_t handle = handleArgument(name, value, "channel");
+    Context& context = currentContext();
+    std::lock_guard<std::mutex> lock(context.channelsMutex);
+    if (handle >= context.channels.size())
+        throw std::runtime_error("Function " + name +
+                                 " received a handle that is not a channel: " +
+                                 std::to_string(handle));
+    return context.channels[handle];
+}
+
+static Value builtinChan(std::vector<Value>& args) {
+    expectArguments("chan", args, 1);
+    ArrayView capacity = args[0].view();
+    if (capacity.size != 1 || capacity[0] < 1 ||
+        static_cast<size_t>(capacity[0]) > MAX_CHANNEL_CAPACITY)
+        throw std::runtime_error(
+            "Function chan expected a capacity from 1 to " +
+            std::to_string(MAX_CHANNEL_CAPACITY) + " but received " +
+            std::string(args[0]));
+    Context& context = currentContext();
+    std::lock_guard<std::mutex> lock(context.channelsMutex);
+    context.channels.push_back(std::make_shared<Channel>(capacity[0]));
+    DynamicArray result(1);
+    result[0] = static_cast<int>(context.channels.size() - 1);
+    return Value(std::move(result), 1);
+}
+
+// Waits while the channel is full. The value is moved in, so sending a
+// variable costs no copy of it. Either end wakes the threads blocked on
+// channels once it has changed one.
+static Value builtinSend(std::vector<Value>& args) {
+    expectArguments("send", args, 2);
+    auto target = channel("send", args[0]);
+    Value& value = args[1];
+    blockUntil([&target, &value] { return target->trySend(value); });
+    wakeBlocked();
+    return Value(DynamicArray(0), 0);
+}
+
+// Waits while the channel is empty.
+static Value builtinRecv(std::vector<Value>& args) {
+    expectArguments("recv", args, 1);
+    auto source = channel("recv", args[0]);
+    std::optional<Value> value;
+    blockUntil([&source, &value] {
+        value = source->tryReceive();
+        return value.has_value();
+    });
+    wakeBlocked();
+    return std::move(value.value());
+}
+
+// Ctrl+C only arrives as a key where the console doesn't turn it into
+// SIGINT itself.
+static int checkInterrupt(int key) {
+    if (key == 3) std::raise(SIGINT);
+    return key;
+}
+
+static Value builtinGetchar(std::vector<Value>& args) {
+    expectArguments("getchar", args, 0);
+    flushOutput();
+    return Value(growableScalar(checkInterrupt(readKey())), 1);
+}
+
+// An empty array when no key is waiting.
+static Value builtinPollchar(std::vector<Value>& args) {
+    expectArguments("pollchar", args, 0);
+    flushOutput();
+    std::optional<int> key = pollKey();
+    if (!key) return Value(DynamicArray(0), 0);
+    return Value(growableScalar(checkInterrupt(key.value())), 1);
+}
+
+// clear, cursor and screen write straight through, after anything printed
+// before them, so a frame shows as soon as it is drawn.
+
+static void writeTerminal(const std::string& out) {
+    BufferedOutput& output = standardOutput();
+    output.write(out);
+    output.flush();
+}
+
+static Value builtinClear(std::vector<Value>& args) {
+    expectArguments("clear", args, 0);
+    Context& context = currentContext();
+    std::lock_guard<std::mutex> lock(context.screenMutex);
+    context.standardOutput.flush();
+    std::string out;
+    clearScreen(out);
+    context.screen.cleared();
+    writeTerminal(out);
+    return Value(DynamicArray(0), 0);
+}
+
+static size_t nonNegative(const std::string& name, int value) {
+    if (value < 0)
+        throw std::runtime_error("Function " + name +
+                                 " expected non-negative coordinates");
+    return static_cast<size_t>(value);
+}
+
+static Value builtinCursor(std::vector<Value>& args) {
+    expectArguments("cursor", args, 1);
+    ArrayView position = args[0].view();
+    if (position.size != 2)
+        throw std::runtime_error(
+            "Function cursor expected a position of 2 elements but received " +
+            std::to_string(position.size));
+    std::lock_guard<std::mutex> lock(currentContext().screenMutex);
+    standardOutput().flush();
+    std::string out;
+    moveCursor(out, nonNegative("cursor", position[0]),
+               nonNegative("cursor", position[1]));
+    writeTerminal(out);
+    return Value(DynamicArray(0), 0);
+}
+
+// Draws a frame of `width` characters to a row, rewriting only the cells
+// that differ from the last frame.
+static Value builtinScreen(std::vector<Value>& args) {
+    expectArguments("screen", args, 2);
+    ArrayView width = args[0].view();
+    ArrayView cells = args[1].view();
+    if (width.size != 1 || width[0] <= 0 ||
+        cells.size % static_cast<size_t>(width[0]) != 0)
+        throw std::runtime_error("Function screen expected whole rows");
+    Context& context = currentContext();
+    std::lock_guard<std::mutex> lock(context.screenMutex);
+    context.standardOutput.flush();
+    std::string out;
+    context.screen.draw(out, cells.data, cells.size, width[0]);
+    writeTerminal(out);
+    return Value(DynamicArray(0), 0);
+}
+
+size_t rangeSize(const std::vector<Value>& args) {
+    expectArguments("range", args, 1);
+    ArrayView param1 = args[0].view();
+    if (param1.size != 1)
+        throw std::runtime_error(
+            "Function range expected 1 argument with size [1] but received [" +
+            std::to_string(param1.size) + "]");
+    int length = param1[0];
+    if (length < 0)
+        throw std::runtime_error(
+            "Function range expected 1 non-negative argument with size [1] but "
+            "received the value " +
+            std::string(args[0]));
+    return static_cast<size_t>(length);
+}
+
+static Value builtinRange(std::vector<Value>& args) {
+    size_t size = rangeSize(args);
+    auto result = DynamicArray::uninitialized(size);
+    int* data = result.data;
+    parallelFor(size, [data](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) data[i] = i;
+    });
+
+    return Value(std::move(result), size);
+}
+
+// An empty map (runtime/table.h), to fill with put.
+static Value builtinMap(std::vector<Value>& args) {
+    expectArguments("map", args, 0);
+    size_t size = tableSize(TABLE_MIN_CAPACITY);
+    DynamicArray table(size);
+    table.canGrow = true;
+    initTable(table.data, TABLE_MIN_CAPACITY);
+    return Value(std::move(table), size);
+}
+
+// Unwinds rather than ending the process, which may be running other
+// scripts.
+static Value builtinExit(std::vector<Value>& args) {
+    expectArguments("exit", args, 1);
+    flushOutput();
+    throw ScriptExit(args[0].view()[0]);
+}
+
+// Heap allocations so far, so scripts can check that a loop or a call has
+// stopped allocating once it is warm.
+static Value builtinAllocations(std::vector<Value>& args) {
+    expectArguments("allocations", args, 0);
+    DynamicArray result(1);
+    result[0] = static_cast<int>(heapAllocations());
+    return Value(std::move(result), 1);
+}
+
+static Value applyAppend(const Value& value, std::vector<Value>& parameters) {
+    if (parameters.size() != 1)
+        throw std::runtime_error("append expects 1 argument with type []");
+    auto& param1 = parameters[0];
+    ArrayView left = value.view();
+    ArrayView right = param1.view();
+    size_t size = left.size + right.size;
+    auto result = DynamicArray::uninitialized(size);
+    std::copy(left.begin(), left.end(), result.data);
+    std::copy(right.begin(), right.end(), result.data + left.size);
+    return Value(std::move(result), size);
+}
+
+static void squareRoots(const int* source, int* out, size_t size) {
+    if (gpuSquareRoots(source, out, size)) return;
+    parallelFor(size, [source, out](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) out[i] = sqrt(source[i]);
+    });
+}
+
+static Value applySqrt(const Value& value, std::vector<Value>& parameters) {
+    if (parameters.size() != 0)
+        throw std::runtime_error("sqrt expects 0 arguments");
+    ArrayView array = value.view();
+    auto result = DynamicArray::uninitialized(array.size);
+    squareRoots(array.data, result.data, array.size);
+    return Value(std::move(result), array.size);
+}
+
+static Value applySize(const Value& value, std::vector<Value>& parameters) {
+    if (parameters.size() != 0)
+        throw std::runtime_error("size expects 0 arguments");
+    DynamicArray result(1);
+    result[0] = value.getSize();
+    return Value(std::move(result), 1);
+}
+
+// min and max have no identity an empty array could return.
+static Value applyReduction(const std::string& name, ReductionKernel kernel,
+                            const Value& value,
+                            std::vector<Value>& parameters) {
+    if (parameters.size() != 0)
+        throw std::runtime_error(name + " expects 0 arguments");
+    ArrayView array = value.view();
+    if (array.size == 0 && (kernel == ReductionKernel::MIN ||
+                            kernel == ReductionKernel::MAX))
+        throw std::runtime_error(name + " expects a non-empty array");
+    DynamicArray result(1);
+    std::optional<int> offloaded =
+        gpuReduction(kernel, array.data, array.size);
+    result[0] = offloaded ? offloaded.value()
+                          : applyReduction(kernel, array.data, array.size);
+    return Value(std::move(result), 1);
+}
+
+static void expectNoArguments(const std::string& name,
+                              const std::vector<Value>& parameters) {
+    if (parameters.size() != 0)
+        throw std::runtime_error(name + " expects 0 arguments");
+}
+
+static int searchTarget(const std::string& name,
+                        const std::vector<Value>& parameters) {
+    if (parameters.size() != 1 || parameters[0].getSize() != 1)
+        throw std::runtime_error(name + " expects 1 argument with size [1]");
+    return parameters[0].view()[0];
+}
+
+static Value indexResult(size_t index, size_t size) {
+    DynamicArray result(1);
+    result[0] = index < size ? static_cast<int>(index) : -1;
+    return Value(std::move(result), 1);
+}
+
+static Value applySort(const Value& value, std::vector<Value>& parameters) {
+    expectNoArguments("sort", parameters);
+    ArrayView array = value.view();
+    auto result = DynamicArray::uninitialized(array.size);
+    std::copy(array.begin(), array.end(), result.data);
+    sortInts(result.data, array.size);
+    return Value(std::move(result), array.size);
+}
+
+// Both searches give the index of the first match, or -1.
+static Value applyFind(const Value& value, std::vector<Value>& parameters) {
+    int target = searchTarget("find", parameters);
+    ArrayView array = value.view();
+    return indexResult(findFirst(array.data, array.size, target), array.size);
+}
+
+// The array must already be sorted.
+static Value applyBsearch(const Value& value, std::vector<Value>& parameters) {
+    int target = searchTarget("bsearch", parameters);
+    ArrayView array = value.view();
+    const int* found = std::lower_bound(array.begin(), array.end(), target);
+    size_t index = found != array.end() && *found == target
+                       ? static_cast<size_t>(found - array.begin())
+                       : array.size;
+    return indexResult(index, array.size);
+}
+
+static Value applyScan(const Value& value, std::vector<Value>& parameters) {
+    expectNoArguments("scan", parameters);
+    ArrayView array = value.view();
+    auto result = DynamicArray::uninitialized(array.size);
+    prefixSum(array.data, result.data, array.size);
+    return Value(std::move(result), array.size);
+}
+
+static Value applyReverse(const Value& value, std::vector<Value>& parameters) {
+    expectNoArguments("reverse", parameters);
+    ArrayView array = value.view();
+    auto result = DynamicArray::uninitialized(array.size);
+    std::reverse_copy(array.begin(), array.end(), result.data);
+    return Value(std::move(result), array.size);
+}
+
+static ArrayView sequenceArgument(const std::string& name,
+                                  const std::vector<Value>& parameters) {
+    if (parameters.size() != 1 || parameters[0].getSize() == 0)
+        throw std::runtime_error(name + " expects 1 non-empty argument");
+    return parameters[0].view();
+}
+
+// Index of the first occurrence of `needle` at or after `start`, or the
+// haystack's size when there is none. Candidates for its first element are
+// found with the vectorized search that `find` uses.
+static size_t findSequence(ArrayView haystack, ArrayView needle,
+                           size_t start) {
+    if (needle.size > haystack.size) return haystack.size;
+    size_t last = haystack.size - needle.size;
+    while (start <= last) {
+        size_t found = start + findFirst(haystack.data + start,
+                                         last + 1 - start, needle[0]);
+        if (found > last) break;
+        if (std::equal(needle.begin() + 1, needle.end(),
+                       haystack.data + found + 1))
+            return found;
+        start = found + 1;
+    }
+    return haystack.size;
+}
+
+static Value applyIndexof(const Value& value, std::vector<Value>& parameters) {
+    ArrayView needle = sequenceArgument("indexof", parameters);
+    ArrayView array = value.view();
+    return indexResult(findSequence(array, needle, 0), array.size);
+}
+
+// The pieces between separators, each as its length followed by its
+// elements, the way `main` receives its arguments.
+static Value applySplit(const Value& value, std::vector<Value>& parameters) {
+    ArrayView separator = sequenceArgument("split", parameters);
+    ArrayView array = value.view();
+    // Every piece after the first replaces a separator of at least one
+    // element with its length, so one extra element is always enough.
+    auto result = DynamicArray::uninitialized(array.size + 1);
+    int* out = result.data;
+    size_t start = 0;
+    while (true) {
+        size_t end = findSequence(array, separator, start);
+        *out++ = static_cast<int>(end - start);
+        out = std::copy(array.data + start, array.data + end, out);
+        if (end == array.size) break;
+        start = end + separator.size;
+    }
+    result.size = static_cast<size_t>(out - result.data);
+    size_t size = result.size;
+    return Value(std::move(result), size);
+}
+
+// Decimal digits with an optional leading '-', as fromint writes them. The
+// errors show the elements received, as text that isn't printable would
+// show nothing.
+static Value applyToint(const Value& value, std::vector<Value>& parameters) {
+    expectNoArguments("toint", parameters);
+    auto failure = [&value](const std::string& expected) {
+        return std::runtime_error("toint expects " + expected +
+                                  " but received " + std::string(value));
+    };
+    ArrayView digits = value.view();
+    bool negative = digits.size > 0 && digits[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if (i == digits.size) throw failure("decimal digits");
+    int64_t number = 0;
+    for (; i < digits.size; i++) {
+        if (digits[i] < '0' || digits[i] > '9')
+            throw failure("decimal digits");
+        number = number * 10 + (digits[i] - '0');
+        if (number > int64_t{INT32_MAX} + 1)
+            throw failure("a number that fits in 32 bits");
+    }
+    if (negative) number = -number;
+    if (number > INT32_MAX) throw failure("a number that fits in 32 bits");
+    DynamicArray result(1);
+    result[0] = static_cast<int>(number);
+    return Value(std::move(result), 1);
+}
+
+static Value applyFromint(const Value& value, std::vector<Value>& parameters) {
+    expectNoArguments("fromint", parameters);
+    if (value.getSize() != 1)
+        throw std::runtime_error("fromint expects a value with size [1]");
+    std::string digits = std::to_string(value.view()[0]);
+    auto result = DynamicArray::uninitialized(digits.size());
+    std::copy(digits.begin(), digits.end(), result.data);
+    return Value(std::move(result), digits.size());
+}
+
+static ArrayView tableOf(const std::string& name, const Value& value) {
+    ArrayView table = value.view();
+    if (!isTable(table.data, table.size))
+        throw std::runtime_error(name + " expects a map made by map()");
+    return table;
+}
+
+static Value applyGet(const Value& value, std::vector<Value>& parameters) {
+    int key = searchTarget("get", parameters);
+    const int* found = tableValue(tableOf("get", value).data, key);
+    if (found == nullptr)
+        throw std::runtime_error("Key " + std::to_string(key) +
+                                 " is not in the map");
+    DynamicArray result(1);
+    result[0] = *found;
+    return Value(std::move(result), 1);
+}
+
+static Value applyHas(const Value& value, std::vector<Value>& parameters) {
+    int key = searchTarget("has", parameters);
+    DynamicArray result(1);
+    result[0] = tableValue(tableOf("has", value).data, key) != nullptr;
+    return Value(std::move(result), 1);
+}
+
+static std::pair<int, int> entryArguments(
+    const std::vector<Value>& parameters) {
+    if (parameters.size() != 2 || parameters[0].getSize() != 1 ||
+        parameters[1].getSize() != 1)
+        throw std::runtime_error("put expects 2 arguments with size [1]");
+    return {parameters[0].view()[0], parameters[1].view()[0]};
+}
+
+// Doubles the table once it would be more than 3/4 full.
+static Value applyPut(const Value& value, std::vector<Value>& parameters) {
+    ArrayView table = tableOf("put", value);
+    auto [key, entry] = entryArguments(parameters);
+    DynamicArray result = DynamicArray::growable();
+    if (tableFull(table.data, key)) {
+        size_t capacity = 2 * static_cast<size_t>(table[0]);
+        result = DynamicArray(tableSize(capacity));
+        result.canGrow = true;
+        initTable(result.data, capacity);
+        rehashTable(table.data, result.data);
+    } else {
+        result = DynamicArray::copyOf(table, true);
+    }
+    tableInsert(result.data, key, entry);
+    size_t size = result.size;
+    return Value(std::move(result), size);
+}
+
+// Elements of a value that owns its storage, which in-place methods may
+// overwrite. Slices have nothing of their own to write to.
+static std::optional<std::pair<int*, size_t>> ownedElements(Value& value) {
+    if (auto array = std::get_if<DynamicArray>(&value.value))
+        return std::make_pair(array->data, array->size);
+    return std::nullopt;
+}
+
+static bool appendInPlace(Value& value, std::vector<Value>& parameters) {
+    if (parameters.size() != 1)
+        throw std::runtime_error("append expects 1 argument with type []");
+    // A slice is given its own elements first. Once growable, further
+    // appends only copy when the capacity runs out.
+    if (std::holds_alternative<ArraySlice>(value.value))
+        value.value.emplace<DynamicArray>(
+            DynamicArray::copyOf(value.view(), true));
+    auto& array = std::get<DynamicArray>(value.value);
+    array.canGrow = true;
+    ArrayView right = parameters[0].view();
+    array.append(right.data, right.size);
+    value.minimum = array.size;
+    return true;
+}
+
+static bool sqrtInPlace(Value& value, std::vector<Value>& parameters) {
+    auto elements = ownedElements(value);
+    if (!elements) return false;
+    expectNoArguments("sqrt", parameters);
+    squareRoots(elements->first, elements->first, elements->second);
+    return true;
+}
+
+static bool sortInPlace(Value& value, std::vector<Value>& parameters) {
+    auto elements = ownedElements(value);
+    if (!elements) return false;
+    expectNoArguments("sort", parameters);
+    sortInts(elements->first, elements->second);
+    return true;
+}
+
+static bool scanInPlace(Value& value, std::vector<Value>& parameters) {
+    auto elements = ownedElements(value);
+    if (!elements) return false;
+    expectNoArguments("scan", parameters);
+    prefixSum(elements->first, elements->first, elements->second);
+    return true;
+}
+
+static bool reverseInPlace(Value& value, std::vector<Value>& parameters) {
+    auto elements = ownedElements(value);
+    if (!elements) return false;
+    expectNoArguments("reverse", parameters);
+    std::reverse(elements->first, elements->first + elements->second);
+    return true;
+}
+
+static bool putInPlace(Value& value, std::vector<Value>& parameters) {
+    auto elements = ownedElements(value);
+    if (!elements) return false;
+    ArrayView table = tableOf("put", value);
+    auto [key, entry] = entryArguments(parameters);
+    if (tableFull(table.data, key)) return false;
+    tableInsert(elements->first, key, entry);
+    return true;
+}
+
+static BuiltinMethodHandler reduction(const std::string& name,
+                                      ReductionKernel kernel) {
+    return [name, kernel](const Value& value, std::vector<Value>& parameters) {
+        return applyReduction(name, kernel, value, parameters);
+    };
+}
+
+namespace {
+
+struct FunctionEntry {
+    std::string name;
+    BuiltinFunctionHandler handler;
+    // Set for the builtins that only compute their result from their
+    // arguments, and cleared once the handler is one registered from
+    // outside.
+    bool pure = false;
+};
+
+struct MethodEntry {
+    std::string name;
+    BuiltinMethodHandler handler;
+    BuiltinMethodInPlaceHandler inPlace;
+    // Cleared once the handler is one registered from outside.
+    bool pure = true;
+};
+
+}  // namespace
+
+// Entries start in BuiltinFunction and BuiltinMethod order, so the enums
+// index them directly.
+static std::vector<FunctionEntry>& functionTable() {
+    static std::vector<FunctionEntry> table = {
+        {"print", builtinPrint},     {"read", builtinRead},
+        {"getchar", builtinGetchar}, {"clear", builtinClear},
+        {"range", builtinRange, true}, {"exit", builtinExit},
+        {"allocations", builtinAllocations},
+        {"open", builtinOpen},       {"readchunk", builtinReadchunk},
+        {"close", builtinClose},     {"write", builtinWrite},
+        {"appendfile", builtinAppendfile}, {"flush", builtinFlush},
+        {"save", builtinSave},       {"load", builtinLoad},
+        {"pollchar", builtinPollchar}, {"cursor", builtinCursor},
+        {"screen", builtinScreen},   {"map", builtinMap, true},
+        {"spawn", builtinSpawn},     {"await", builtinAwait},
+        {"chan", builtinChan},       {"send", builtinSend},
+        {"recv", builtinRecv},
+    };
+    return table;
+}
+
+// The receiver is owned by the caller of an in-place handler, so appends
+// grow its storage geometrically and element-wise results are written over
+// its elements.
+static std::vector<MethodEntry>& methodTable() {
+    static std::vector<MethodEntry> table = {
+        {"append", applyAppend, appendInPlace},
+        {"sqrt", applySqrt, sqrtInPlace},
+        {"size", applySize, nullptr},
+        {"sum", reduction("sum", ReductionKernel::SUM), nullptr},
+        {"min", reduction("min", ReductionKernel::MIN), nullptr},
+        {"max", reduction("max", ReductionKernel::MAX), nullptr},
+        {"prod", reduction("prod", ReductionKernel::PRODUCT), nullptr},
+        {"sort", applySort, sortInPlace},
+        {"find", applyFind, nullptr},
+        {"bsearch", applyBsearch, nullptr},
+        {"scan", applyScan, scanInPlace},
+        {"reverse", applyReverse, reverseInPlace},
+        {"get", applyGet, nullptr},
+        {"put", applyPut, putInPlace},
+        {"has", applyHas, nullptr},
+        {"split", applySplit, nullptr},
+        {"indexof", applyIndexof, nullptr},
+        {"toint", applyToint, nullptr},
+        {"fromint", applyFromint, nullptr},
+    };
+    return table;
+}
+
+template <typename Entry>
+static std::optional<size_t> findEntry(const std::vector<Entry>& table,
+                                       const std::string& name) {
+    for (size_t i = 0; i < table.size(); i++)
+        if (table[i].name == name) return i;
+    return std::nullopt;
+}
+
+BuiltinFunction registerBuiltinFunction(const std::string& name,
+                                        BuiltinFunctionHandler handler) {
+    auto& table = functionTable();
+    auto index = findEntry(table, name);
+    if (index.has_value()) {
+        table[index.value()].handler = std::move(handler);
+        table[index.value()].pure = false;
+    } else {
+        index = table.size();
+        table.push_back({name, std::move(handler)});
+    }
+    return static_cast<BuiltinFunction>(index.value());
+}
+
+BuiltinMethod registerBuiltinMethod(const std::string& name,
+                                    BuiltinMethodHandler handler,
+                                    BuiltinMethodInPlaceHandler inPlace) {
+    auto& table = methodTable();
+    auto index = findEntry(table, name);
+    if (index.has_value()) {
+        table[index.value()].handler = std::move(handler);
+        table[index.value()].inPlace = std::move(inPlace);
+        table[index.value()].pure = false;
+    } else {
+        index = table.size();
+        table.push_back({name, std::move(handler), std::move(inPlace), false});
+    }
+    return static_cast<BuiltinMethod>(index.value());
+}
+
+bool countsAsRange(BuiltinFunction function) {
+    return function == BuiltinFunction::RANGE && isPureFunction(function);
+}
+
+bool isPureFunction(BuiltinFunction function) {
+    auto& table = functionTable();
+    auto index = static_cast<size_t>(function);
+    return index < table.size() && table[index].pure;
+}
+
+bool isPureMethod(BuiltinMethod method) {
+    auto& table = methodTable();
+    auto index = static_cast<size_t>(method);
+    return index < table.size() && table[index].pure;
+}
+
+std::optional<BuiltinFunction> builtinFunctionFromName(
+    const std::string& name) {
+    if (auto index = findEntry(functionTable(), name))
+        return static_cast<BuiltinFunction>(index.value());
+    return std::nullopt;
+}
+
+std::optional<BuiltinMethod> builtinMethodFromName(const std::string& name) {
+    if (auto index = findEntry(methodTable(), name))
+        return static_cast<BuiltinMethod>(index.value());
+    return std::nullopt;
+}
+
+Value callBuiltinFunction(BuiltinFunction function, std::vector<Value>& args) {
+    auto& table = functionTable();
+    auto index = static_cast<size_t>(function);
+    if (index >= table.size())
+        throw std::runtime_error("Unknown builtin function");
+    return table[index].handler(args);
+}
+
+static const MethodEntry& methodEntry(BuiltinMethod method) {
+    auto& table = methodTable();
+    auto index = static_cast<size_t>(method);
+    if (index >= table.size())
+        throw std::runtime_error("Unknown builtin method");
+    return table[index];
+}
+
+Value callBuiltinMethod(BuiltinMethod method, const Value& value,
+                        std::vector<Value>& args) {
+    return methodEntry(method).handler(value, args);
+}
+
+void callBuiltinMethodInPlace(BuiltinMethod method, Value& value,
+                              std::vector<Value>& args) {
+    auto& entry = methodEntry(method);
+    if (entry.inPlace && entry.inPlace(value, args)) return;
+    value.replace(entry.handler(value, args));
+}
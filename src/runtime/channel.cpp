@@ -0,0 +1,60 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/channel.h"
+
+#include <optional>
+#include <utility>
+
+Channel::Channel(size_t capacity)
+    : capacity(capacity), cells(std::make_unique<Cell[]>(capacity)) {
+    for (size_t i = 0; i < capacity; i++)
+        cells[i].sequence.store(2 * i, std::memory_order_relaxed);
+}
+
+// A cell's sequence is twice the position it waits for, plus one once it is
+// filled, so a full cell never looks empty to the next lap's sender even
+// when the ring has one cell. A sender claims the cell at its position once
+// the sequence has caught up with it, and a receiver once it is filled; a
+// sequence short of that means the channel is full, or empty.
+bool Channel::trySend(Value& value) {
+    size_t position = sendPosition.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[position % capacity];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence == 2 * position) {
+            if (sendPosition.compare_exchange_weak(position, position + 1,
+                                                   std::memory_order_relaxed)) {
+                cell.value.emplace(std::move(value));
+                cell.sequence.store(2 * position + 1,
+                                    std::memory_order_release);
+                return true;
+            }
+        } else if (sequence < 2 * position) {
+            return false;
+        } else {
+            position = sendPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::optional<Value> Channel::tryReceive() {
+    size_t position = receivePosition.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[position % capacity];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence == 2 * position + 1) {
+            if (receivePosition.compare_exchange_weak(
+                    position, position + 1, std::memory_order_relaxed)) {
+                std::optional<Value> value = std::move(cell.value);
+                cell.value.reset();
+                cell.sequence.store(2 * (position + capacity),
+                                    std::memory_order_release);
+                return value;
+            }
+        } else if (sequence < 2 * position + 1) {
+            return std::nullopt;
+        } else {
+            position = receivePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,30 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/context.h"
+
+#include <cstdio>
+#include <utility>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static bool stdoutIsTerminal() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdout));
+#else
+    return isatty(fileno(stdout));
+#endif
+}
+
+Context::Context()
+    : standardOutput(stdout, outputCapacity, stdoutIsTerminal()) {}
+
+Context::Context(OutputSink sink)
+    : standardOutput(std::move(sink), outputCapacity) {}
+
+Context& processContext() {
+    static Context context;
+    return context;
+}
@@ -0,0 +1,162 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/fusion.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "runtime/fixed.h"
+#include "runtime/gpu.h"
+#include "runtime/kernels.h"
+#include "runtime/parallel.h"
+
+namespace {
+
+Value combine(ArithmeticKernel kernel, const Value& left, const Value& right) {
+    Value result = left;
+    switch (kernel) {
+        case ArithmeticKernel::ADD:
+            return result + right;
+        case ArithmeticKernel::SUB:
+            return result - right;
+        case ArithmeticKernel::MUL:
+            return result * right;
+        case ArithmeticKernel::DIV:
+            return result / right;
+        case ArithmeticKernel::MOD:
+            return result % right;
+        case ArithmeticKernel::AND:
+            return result & right;
+        case ArithmeticKernel::OR:
+            return result | right;
+        case ArithmeticKernel::XOR:
+            return result ^ right;
+        case ArithmeticKernel::SHL:
+            return result << right;
+        case ArithmeticKernel::SHR:
+            return result >> right;
+    }
+    throw std::runtime_error("Error interpreting arithmetic");
+}
+
+}  // namespace
+
+void FusedArithmetic::pushOperand(std::shared_ptr<const Value> operand) {
+    pending.push_back(operand->getSize());
+    depth = std::max(depth, pending.size());
+    steps.push_back(Step{std::nullopt, operands.size()});
+    operands.push_back(std::move(operand));
+}
+
+void FusedArithmetic::pushOperation(ArithmeticKernel kernel) {
+    size_t right = pending.back();
+    pending.pop_back();
+    size_t left = pending.back();
+    pending.back() = broadcastSize(kernel, left, right);
+
+    // A node over single elements is computed right away, which leaves every
+    // remaining single-element term a broadcast leaf.
+    size_t count = steps.size();
+    if (left <= 1 && right <= 1 && count >= 2 && !steps[count - 1].kernel &&
+        !steps[count - 2].kernel) {
+        auto& target = operands[steps[count - 2].operand];
+        target = std::make_shared<const Value>(
+            combine(kernel, *target, *operands[steps[count - 1].operand]));
+        operands.pop_back();
+        steps.pop_back();
+        return;
+    }
+    steps.push_back(Step{kernel, 0});
+}
+
+Value FusedArithmetic::evaluate() const {
+    if (steps.size() == 1) return *operands.front();
+
+    size_t size = pending.back();
+    auto result = DynamicArray::uninitialized(size);
+    if (size <= FIXED_ARRAY_LIMIT && depth <= SMALL_DEPTH) {
+        evaluateSmall(result.data, size);
+        return Value(std::move(result), size);
+    }
+    if (gpuEnabled(size)) {
+        std::vector<GpuStep> gpuSteps;
+        for (const Step& step : steps)
+            gpuSteps.push_back(GpuStep{step.kernel, step.operand});
+        std::vector<GpuOperand> gpuOperands;
+        for (auto& operand : operands)
+            gpuOperands.push_back(
+                GpuOperand{operand->getData(), operand->getSize()});
+        if (gpuArithmetic(gpuSteps, gpuOperands, result.data, size))
+            return Value(std::move(result), size);
+    }
+
+    std::vector<Term> terms;
+    terms.reserve(operands.size());
+    for (auto& operand : operands)
+        terms.push_back(Term{operand->getData(), operand->getSize() == 1});
+
+    // Workers each take a run of tiles with scratch space of their own.
+    parallelFor(size, [&](size_t begin, size_t end) {
+        std::vector<int> scratch(TILE_SIZE * depth);
+        std::vector<Term> stack;
+        stack.reserve(depth);
+        for (size_t start = begin; start < end; start += TILE_SIZE) {
+            size_t count = std::min(TILE_SIZE, end - start);
+            stack.clear();
+            for (size_t i = 0; i < steps.size(); i++) {
+                const Step& step = steps[i];
+                if (!step.kernel) {
+                    Term term = terms[step.operand];
+                    if (!term.broadcast) term.data += start;
+                    stack.push_back(term);
+                    continue;
+                }
+                Term right = stack.back();
+                stack.pop_back();
+                Term left = stack.back();
+                int* out =
+                    i + 1 == steps.size()
+                        ? result.data + start
+                        : scratch.data() + (stack.size() - 1) * TILE_SIZE;
+                if (left.broadcast)
+                    applyArithmeticScalarLeft(step.kernel.value(), *left.data,
+                                              right.data, out, count);
+                else if (right.broadcast)
+                    applyArithmeticScalarRight(step.kernel.value(),
+                                               left.data, *right.data, out,
+                                               count);
+                else
+                    applyArithmetic(step.kernel.value(), left.data,
+                                    right.data, out, count);
+                stack.back() = Term{out, false};
+            }
+        }
+    });
+    return Value(std::move(result), size);
+}
+
+// The same walk over the steps for a result of at most FIXED_ARRAY_LIMIT
+// elements, with scratch on the stack and the unrolled kernels.
+void FusedArithmetic::evaluateSmall(int* out, size_t size) const {
+    int scratch[SMALL_DEPTH][FIXED_ARRAY_LIMIT];
+    Term stack[SMALL_DEPTH];
+    size_t top = 0;
+    for (size_t i = 0; i < steps.size(); i++) {
+        const Step& step = steps[i];
+        if (!step.kernel) {
+            const Value& operand = *operands[step.operand];
+            stack[top++] = Term{operand.getData(), operand.getSize() == 1};
+            continue;
+        }
+        Term right = stack[--top];
+        Term left = stack[top - 1];
+        int* target = i + 1 == steps.size() ? out : scratch[top - 1];
+        fixedArithmetic(step.kernel.value(), left.data,
+                        left.broadcast ? 1 : size, right.data,
+                        right.broadcast ? 1 : size, target, size);
+        stack[top - 1] = Term{target, false};
+    }
+}
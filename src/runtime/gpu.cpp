@@ -0,0 +1,508 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/gpu.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef INTS_GPU
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glcorearb.h>
+#endif
+
+#include "runtime/kernels.h"
+
+namespace {
+
+std::atomic<size_t> configuredThreshold{0};
+
+}  // namespace
+
+void configureGpu(size_t threshold) { configuredThreshold = threshold; }
+
+bool gpuEnabled(size_t size) {
+    size_t threshold = configuredThreshold.load(std::memory_order_relaxed);
+    return threshold != 0 && size >= threshold;
+}
+
+#ifdef INTS_GPU
+
+namespace {
+
+constexpr size_t GROUP_SIZE = 256;
+// Launches past this many groups loop over the rest instead.
+constexpr size_t MAX_GROUPS = 65535;
+// Few enough partial results from a reduction to finish them on the CPU.
+constexpr size_t MAX_REDUCTION_GROUPS = 1024;
+
+// The GL entry points the runtime uses, looked up once the context exists.
+struct Gl {
+    PFNGLGETERRORPROC GetError;
+    PFNGLGETINTEGERVPROC GetIntegerv;
+    PFNGLGETINTEGER64VPROC GetInteger64v;
+    PFNGLCREATESHADERPROC CreateShader;
+    PFNGLSHADERSOURCEPROC ShaderSource;
+    PFNGLCOMPILESHADERPROC CompileShader;
+    PFNGLGETSHADERIVPROC GetShaderiv;
+    PFNGLDELETESHADERPROC DeleteShader;
+    PFNGLCREATEPROGRAMPROC CreateProgram;
+    PFNGLATTACHSHADERPROC AttachShader;
+    PFNGLLINKPROGRAMPROC LinkProgram;
+    PFNGLGETPROGRAMIVPROC GetProgramiv;
+    PFNGLDELETEPROGRAMPROC DeleteProgram;
+    PFNGLUSEPROGRAMPROC UseProgram;
+    PFNGLUNIFORM1UIPROC Uniform1ui;
+    PFNGLUNIFORM1IPROC Uniform1i;
+    PFNGLGENBUFFERSPROC GenBuffers;
+    PFNGLBINDBUFFERPROC BindBuffer;
+    PFNGLBUFFERDATAPROC BufferData;
+    PFNGLBUFFERSUBDATAPROC BufferSubData;
+    PFNGLGETBUFFERSUBDATAPROC GetBufferSubData;
+    PFNGLBINDBUFFERBASEPROC BindBufferBase;
+    PFNGLDISPATCHCOMPUTEPROC DispatchCompute;
+    PFNGLMEMORYBARRIERPROC MemoryBarrier;
+};
+
+template <typename Function>
+bool lookUp(Function& function, const char* name) {
+    function = reinterpret_cast<Function>(eglGetProcAddress(name));
+    return function != nullptr;
+}
+
+bool lookUp(Gl& gl) {
+    return lookUp(gl.GetError, "glGetError") &&
+           lookUp(gl.GetIntegerv, "glGetIntegerv") &&
+           lookUp(gl.GetInteger64v, "glGetInteger64v") &&
+           lookUp(gl.CreateShader, "glCreateShader") &&
+           lookUp(gl.ShaderSource, "glShaderSource") &&
+           lookUp(gl.CompileShader, "glCompileShader") &&
+           lookUp(gl.GetShaderiv, "glGetShaderiv") &&
+           lookUp(gl.DeleteShader, "glDeleteShader") &&
+           lookUp(gl.CreateProgram, "glCreateProgram") &&
+           lookUp(gl.AttachShader, "glAttachShader") &&
+           lookUp(gl.LinkProgram, "glLinkProgram") &&
+           lookUp(gl.GetProgramiv, "glGetProgramiv") &&
+           lookUp(gl.DeleteProgram, "glDeleteProgram") &&
+           lookUp(gl.UseProgram, "glUseProgram") &&
+           lookUp(gl.Uniform1ui, "glUniform1ui") &&
+           lookUp(gl.Uniform1i, "glUniform1i") &&
+           lookUp(gl.GenBuffers, "glGenBuffers") &&
+           lookUp(gl.BindBuffer, "glBindBuffer") &&
+           lookUp(gl.BufferData, "glBufferData") &&
+           lookUp(gl.BufferSubData, "glBufferSubData") &&
+           lookUp(gl.GetBufferSubData, "glGetBufferSubData") &&
+           lookUp(gl.BindBufferBase, "glBindBufferBase") &&
+           lookUp(gl.DispatchCompute, "glDispatchCompute") &&
+           lookUp(gl.MemoryBarrier, "glMemoryBarrier");
+}
+
+// Makes a context current on this thread for as long as it lives, then puts
+// back whatever was current before, such as a window's.
+class CurrentContext {
+ public:
+    CurrentContext(EGLDisplay display, EGLContext context)
+        : display(display),
+          previousApi(eglQueryAPI()),
+          previousDisplay(eglGetCurrentDisplay()),
+          previousDraw(eglGetCurrentSurface(EGL_DRAW)),
+          previousRead(eglGetCurrentSurface(EGL_READ)),
+          previousContext(eglGetCurrentContext()) {
+        eglBindAPI(EGL_OPENGL_API);
+        current =
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+    ~CurrentContext() {
+        if (previousContext != EGL_NO_CONTEXT)
+            eglMakeCurrent(previousDisplay, previousDraw, previousRead,
+                           previousContext);
+        else
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                           EGL_NO_CONTEXT);
+        eglBindAPI(previousApi);
+    }
+    CurrentContext(const CurrentContext&) = delete;
+    CurrentContext& operator=(const CurrentContext&) = delete;
+
+    explicit operator bool() const { return current == EGL_TRUE; }
+
+ private:
+    EGLDisplay display;
+    EGLenum previousApi;
+    EGLDisplay previousDisplay;
+    EGLSurface previousDraw;
+    EGLSurface previousRead;
+    EGLContext previousContext;
+    EGLBoolean current = EGL_FALSE;
+};
+
+// The one context, made on first use and kept until the process ends.
+// Dispatches take turns with it, and a call that finds it busy runs on the
+// CPU rather than wait.
+class Device {
+ public:
+    // Null when the system has no GPU, or OpenGL 4.3, to offer.
+    static Device* get() {
+        static Device* device = make();
+        return device;
+    }
+
+    // Runs `source` over `size` elements with arrays[i] bound at i + 1 and
+    // scalars[i] the uniform at i + 1, then reads `outSize` ints back from
+    // binding 0.
+    bool run(const std::string& source, const std::vector<const int*>& arrays,
+             size_t size, const std::vector<int>& scalars, size_t groups,
+             int* out, size_t outSize) {
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (!lock.owns_lock()) return false;
+        if (arrays.size() + 1 > maxBuffers ||
+            size * sizeof(int) > maxBufferBytes)
+            return false;
+        CurrentContext current(display, context);
+        if (!current) return false;
+
+        GLuint program = compiled(source);
+        if (program == 0) return false;
+        gl.UseProgram(program);
+        gl.Uniform1ui(0, static_cast<GLuint>(size));
+        for (size_t i = 0; i < scalars.size(); i++)
+            gl.Uniform1i(static_cast<GLint>(i + 1), scalars[i]);
+        bind(0, nullptr, outSize * sizeof(int));
+        for (size_t i = 0; i < arrays.size(); i++)
+            bind(i + 1, arrays[i], size * sizeof(int));
+        gl.DispatchCompute(static_cast<GLuint>(groups), 1, 1);
+        gl.MemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[0].name);
+        gl.GetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                            static_cast<GLsizeiptr>(outSize * sizeof(int)),
+                            out);
+        return gl.GetError() == GL_NO_ERROR;
+    }
+
+ private:
+    struct Buffer {
+        GLuint name = 0;
+        size_t capacity = 0;
+    };
+
+    static Device* make() {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        EGLDisplay display = EGL_NO_DISPLAY;
+        if (getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                         EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY ||
+            eglInitialize(display, nullptr, nullptr) != EGL_TRUE)
+            return nullptr;
+
+        EGLenum previousApi = eglQueryAPI();
+        eglBindAPI(EGL_OPENGL_API);
+        const EGLint attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     4,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     3,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+        EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR,
+                                              EGL_NO_CONTEXT, attributes);
+        eglBindAPI(previousApi);
+        if (context == EGL_NO_CONTEXT) return nullptr;
+
+        auto device = new Device(display, context);
+        CurrentContext current(display, context);
+        if (!current || !lookUp(device->gl)) {
+            delete device;
+            return nullptr;
+        }
+        GLint blocks = 0;
+        GLint64 bytes = 0;
+        device->gl.GetIntegerv(GL_MAX_COMPUTE_SHADER_STORAGE_BLOCKS, &blocks);
+        device->gl.GetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &bytes);
+        device->maxBuffers = static_cast<size_t>(std::max<GLint>(blocks, 0));
+        // Indices in the shaders are 32-bit.
+        device->maxBufferBytes = std::min<size_t>(
+            static_cast<size_t>(std::max<GLint64>(bytes, 0)),
+            size_t{INT32_MAX} * sizeof(int));
+        return device;
+    }
+
+    Device(EGLDisplay display, EGLContext context)
+        : display(display), context(context) {}
+
+    // Programs are kept by their source for as long as the process runs; 0
+    // records one the driver rejected.
+    GLuint compiled(const std::string& source) {
+        auto found = programs.find(source);
+        if (found != programs.end()) return found->second;
+        GLuint shader = gl.CreateShader(GL_COMPUTE_SHADER);
+        const char* text = source.c_str();
+        gl.ShaderSource(shader, 1, &text, nullptr);
+        gl.CompileShader(shader);
+        GLint status = GL_FALSE;
+        gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        GLuint program = 0;
+        if (status == GL_TRUE) {
+            program = gl.CreateProgram();
+            gl.AttachShader(program, shader);
+            gl.LinkProgram(program);
+            gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+            if (status != GL_TRUE) {
+                gl.DeleteProgram(program);
+                program = 0;
+            }
+        }
+        gl.DeleteShader(shader);
+        programs.emplace(source, program);
+        return program;
+    }
+
+    // Buffers only grow, so repeated work of one size allocates nothing.
+    void bind(size_t binding, const int* data, size_t bytes) {
+        if (buffers.size() <= binding) buffers.resize(binding + 1);
+        Buffer& buffer = buffers[binding];
+        if (buffer.name == 0) gl.GenBuffers(1, &buffer.name);
+        gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.name);
+        if (buffer.capacity < bytes) {
+            gl.BufferData(GL_SHADER_STORAGE_BUFFER,
+                          static_cast<GLsizeiptr>(bytes), data,
+                          GL_DYNAMIC_COPY);
+            buffer.capacity = bytes;
+        } else if (data != nullptr) {
+            gl.BufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+                             static_cast<GLsizeiptr>(bytes), data);
+        }
+        gl.BindBufferBase(GL_SHADER_STORAGE_BUFFER,
+                          static_cast<GLuint>(binding), buffer.name);
+    }
+
+    std::mutex mutex;
+    EGLDisplay display;
+    EGLContext context;
+    Gl gl{};
+    size_t maxBuffers = 0;
+    size_t maxBufferBytes = 0;
+    std::unordered_map<std::string, GLuint> programs;
+    std::vector<Buffer> buffers;
+};
+
+size_t groupsFor(size_t size, size_t limit) {
+    return std::max<size_t>(
+        1, std::min((size + GROUP_SIZE - 1) / GROUP_SIZE, limit));
+}
+
+// Declares the result at binding 0, `arrays` inputs after it and `scalars`
+// int uniforms, and opens main with a loop that strides over every element.
+std::string header(size_t arrays, size_t scalars) {
+    std::string source =
+        "#version 430\n"
+        "layout(local_size_x = " +
+        std::to_string(GROUP_SIZE) +
+        ") in;\n"
+        "layout(std430, binding = 0) writeonly buffer Out { int result[]; };\n"
+        "layout(location = 0) uniform uint count;\n";
+    for (size_t i = 1; i <= arrays; i++) {
+        std::string n = std::to_string(i);
+        source += "layout(std430, binding = " + n + ") readonly buffer In" +
+                  n + " { int in" + n + "[]; };\n";
+    }
+    for (size_t i = 1; i <= scalars; i++) {
+        std::string n = std::to_string(i);
+        source += "layout(location = " + n + ") uniform int scalar" + n +
+                  ";\n";
+    }
+    return source;
+}
+
+const char* const STRIDE_LOOP =
+    "    uint stride = gl_NumWorkGroups.x * gl_WorkGroupSize.x;\n"
+    "    for (uint i = gl_GlobalInvocationID.x; i < count; i += stride) {\n";
+
+std::string expression(ArithmeticKernel kernel, const std::string& left,
+                       const std::string& right) {
+    switch (kernel) {
+        case ArithmeticKernel::ADD:
+            return left + " + " + right;
+        case ArithmeticKernel::SUB:
+            return left + " - " + right;
+        case ArithmeticKernel::MUL:
+            return left + " * " + right;
+        case ArithmeticKernel::AND:
+            return left + " & " + right;
+        case ArithmeticKernel::OR:
+            return left + " | " + right;
+        case ArithmeticKernel::XOR:
+            return left + " ^ " + right;
+        case ArithmeticKernel::SHL:
+            return "int(uint(" + left + ") << uint(" + right + " & 31))";
+        case ArithmeticKernel::SHR:
+            return left + " >> (" + right + " & 31)";
+        case ArithmeticKernel::DIV:
+        case ArithmeticKernel::MOD:
+            break;
+    }
+    return "";
+}
+
+}  // namespace
+
+bool gpuArithmetic(const std::vector<GpuStep>& steps,
+                   const std::vector<GpuOperand>& operands, int* out,
+                   size_t size) {
+    if (!gpuEnabled(size)) return false;
+    for (const GpuStep& step : steps)
+        if (step.kernel == ArithmeticKernel::DIV ||
+            step.kernel == ArithmeticKernel::MOD)
+            return false;
+    Device* device = Device::get();
+    if (device == nullptr) return false;
+
+    // An array used more than once is uploaded once.
+    std::vector<const int*> arrays;
+    std::vector<int> scalars;
+    std::vector<std::string> names;
+    for (const GpuOperand& operand : operands) {
+        if (operand.size == 1) {
+            scalars.push_back(operand.data[0]);
+            names.push_back("scalar" + std::to_string(scalars.size()));
+            continue;
+        }
+        auto found = std::find(arrays.begin(), arrays.end(), operand.data);
+        size_t binding = static_cast<size_t>(found - arrays.begin()) + 1;
+        if (found == arrays.end()) arrays.push_back(operand.data);
+        names.push_back("in" + std::to_string(binding) + "[i]");
+    }
+
+    std::string body;
+    std::vector<std::string> stack;
+    for (size_t i = 0; i < steps.size(); i++) {
+        const GpuStep& step = steps[i];
+        std::string term = "t" + std::to_string(i);
+        if (!step.kernel) {
+            body += "        int " + term + " = " + names[step.operand] +
+                    ";\n";
+        } else {
+            std::string right = stack.back();
+            stack.pop_back();
+            body += "        int " + term + " = " +
+                    expression(step.kernel.value(), stack.back(), right) +
+                    ";\n";
+            stack.pop_back();
+        }
+        stack.push_back(term);
+    }
+    std::string source = header(arrays.size(), scalars.size()) +
+                         "void main() {\n" + STRIDE_LOOP + body +
+                         "        result[i] = " + stack.back() +
+                         ";\n    }\n}\n";
+    return device->run(source, arrays, size, scalars,
+                       groupsFor(size, MAX_GROUPS), out, size);
+}
+
+// Floors the square root of every element. The float estimate is corrected
+// to the exact floor, and a negative element gives INT_MIN, which is what
+// converting the NaN the CPU computes produces on x86.
+bool gpuSquareRoots(const int* source, int* out, size_t size) {
+    if (!gpuEnabled(size)) return false;
+    Device* device = Device::get();
+    if (device == nullptr) return false;
+    static const std::string program =
+        header(1, 0) +
+        "int root(int x) {\n"
+        "    if (x < 0) return int(0x80000000u);\n"
+        "    uint value = uint(x);\n"
+        "    uint r = uint(sqrt(float(x)));\n"
+        "    while (r * r > value) r--;\n"
+        "    while ((r + 1u) * (r + 1u) <= value) r++;\n"
+        "    return int(r);\n"
+        "}\n"
+        "void main() {\n" +
+        STRIDE_LOOP + "        result[i] = root(in1[i]);\n    }\n}\n";
+    return device->run(program, {source}, size, {},
+                       groupsFor(size, MAX_GROUPS), out, size);
+}
+
+// Each group folds its share into one partial result in shared memory, and
+// the partials are folded on the CPU.
+std::optional<int> gpuReduction(ReductionKernel kernel, const int* data,
+                                size_t size) {
+    if (!gpuEnabled(size)) return std::nullopt;
+    Device* device = Device::get();
+    if (device == nullptr) return std::nullopt;
+    std::string identity;
+    std::string combine;
+    switch (kernel) {
+        case ReductionKernel::SUM:
+            identity = "0";
+            combine = "a + b";
+            break;
+        case ReductionKernel::MIN:
+            identity = "0x7fffffff";
+            combine = "min(a, b)";
+            break;
+        case ReductionKernel::MAX:
+            identity = "int(0x80000000u)";
+            combine = "max(a, b)";
+            break;
+        case ReductionKernel::PRODUCT:
+            identity = "1";
+            combine = "a * b";
+            break;
+    }
+    std::string source =
+        header(1, 0) + "shared int partial[" + std::to_string(GROUP_SIZE) +
+        "];\n"
+        "int combine(int a, int b) { return " +
+        combine +
+        "; }\n"
+        "void main() {\n"
+        "    int value = " +
+        identity + ";\n" + STRIDE_LOOP +
+        "        value = combine(value, in1[i]);\n"
+        "    }\n"
+        "    uint lane = gl_LocalInvocationIndex;\n"
+        "    partial[lane] = value;\n"
+        "    memoryBarrierShared();\n"
+        "    barrier();\n"
+        "    for (uint width = gl_WorkGroupSize.x / 2u; width > 0u;\n"
+        "         width /= 2u) {\n"
+        "        if (lane < width)\n"
+        "            partial[lane] = combine(partial[lane],\n"
+        "                                    partial[lane + width]);\n"
+        "        memoryBarrierShared();\n"
+        "        barrier();\n"
+        "    }\n"
+        "    if (lane == 0u) result[gl_WorkGroupID.x] = partial[0];\n"
+        "}\n";
+    size_t groups = groupsFor(size, MAX_REDUCTION_GROUPS);
+    std::vector<int> partials(groups);
+    if (!device->run(source, {data}, size, {}, groups, partials.data(),
+                     groups))
+        return std::nullopt;
+    return applyReduction(kernel, partials.data(), groups);
+}
+
+#else
+
+bool gpuArithmetic(const std::vector<GpuStep>&, const std::vector<GpuOperand>&,
+                   int*, size_t) {
+    return false;
+}
+
+bool gpuSquareRoots(const int*, int*, size_t) { return false; }
+
+std::optional<int> gpuReduction(ReductionKernel, const int*, size_t) {
+    return std::nullopt;
+}
+
+#endif
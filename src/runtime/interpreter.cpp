@@ -2,36 +2,60 @@
 
 #include "runtime/interpreter.h"
 
-#include <GLFW/glfw3.h>
-
 #include <algorithm>
 #include <atomic>
-#include <cmath>
-#include <csignal>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
-#include <thread>
 #include <utility>
 #include <vector>
-#ifdef _WIN32
-#include <conio.h>
-#else
-#include <termios.h>
-#include <unistd.h>
-#endif
 
-#include "imgui/backends/imgui_impl_glfw.h"
-#include "imgui/backends/imgui_impl_opengl3.h"
-#include "imgui/imgui.h"
-#include "lexer/tokenize.h"
+#include "compiler/compile.h"
+#include "parser/loader.h"
 #include "parser/parse.h"
-#include "util/file.h"
+#include "runtime/builtins.h"
+#include "runtime/context.h"
+#include "runtime/fusion.h"
+#include "runtime/gpu.h"
+#include "runtime/kernels.h"
+#include "runtime/memo.h"
+#include "runtime/parallel.h"
+#include "runtime/profile.h"
+#include "runtime/scalar.h"
+#include "runtime/stats.h"
+#include "runtime/vm.h"
+#include "util/pool.h"
+#ifdef INTS_GRAPHICS
+#include "graphics/window.h"
+#endif
+
+// Bumped whenever a name may start or stop naming a function, which
+// invalidates the function every call site has cached. Bindings only change
+// outside pfor, so no call runs concurrently with a bump.
+static std::atomic<uint64_t> functionBindings{1};
+
+static bool isFunction(
+    const std::variant<std::shared_ptr<Value>,
+                       std::shared_ptr<FunctionDefinitionNode>>& value) {
+    return std::holds_alternative<std::shared_ptr<FunctionDefinitionNode>>(
+        value);
+}
+
+Scope::Scope(std::weak_ptr<Scope> parent, size_t frameSize)
+    : parent(parent), frame(frameSize) {
+    countScope();
+}
 
-std::atomic<bool> guiRunning;
+const std::weak_ptr<Scope>& Scope::getParent() const { return parent; }
 
-Scope::Scope(std::weak_ptr<Scope> parent) : parent(parent) {}
+std::shared_ptr<Value>& Scope::slot(const VariableSlot& slot) {
+    return frame[slot.index];
+}
 
 bool Scope::has(const std::string& name) const {
     return variables.find(name) != variables.end();
@@ -61,8 +85,14 @@ void Scope::set(
     const std::string& name,
     const std::variant<std::shared_ptr<Value>,
                        std::shared_ptr<FunctionDefinitionNode>>& value) {
-    if (has(name)) {
-        variables.insert_or_assign(name, value);
+    if (auto found = variables.find(name); found != variables.end()) {
+        // Spawned tasks read globals without locking them.
+        if (parent.expired() && currentContext().runningTasks > 0)
+            throw std::runtime_error("Cannot assign " + name +
+                                     " while spawned tasks are running");
+        if (isFunction(found->second) || isFunction(value))
+            functionBindings++;
+        found->second = value;
     } else if (auto parent_locked = parent.lock()) {
         parent_locked->set(name, value);
     } else {
@@ -74,9 +104,27 @@ void Scope::define(
     const std::string& name,
     const std::variant<std::shared_ptr<Value>,
                        std::shared_ptr<FunctionDefinitionNode>>& value) {
+    functionBindings++;
     variables[name] = value;
 }
 
+const std::unordered_map<std::string,
+                         std::variant<std::shared_ptr<Value>,
+                                      std::shared_ptr<FunctionDefinitionNode>>>&
+Scope::getVariables() const {
+    return variables;
+}
+
+void Scope::setTailCall(TailCall tailCall) {
+    this->tailCall = std::move(tailCall);
+}
+
+std::optional<TailCall> Scope::takeTailCall() {
+    std::optional<TailCall> result = std::move(tailCall);
+    tailCall.reset();
+    return result;
+}
+
 static void interpretFunctionDefinition(
     std::shared_ptr<FunctionDefinitionNode> functionDefinition,
     std::weak_ptr<Scope> parent) {
@@ -92,36 +140,58 @@ static Value interpretExpression(
     const std::shared_ptr<ExpressionNode>& expression,
     std::weak_ptr<Scope> scope);
 
-static std::vector<std::shared_ptr<Value>> interpretParameters(
+static SharedValues interpretParameters(
     const std::vector<std::shared_ptr<ExpressionNode>>& parameters,
     std::weak_ptr<Scope> scope) {
-    std::vector<std::shared_ptr<Value>> result;
+    SharedValues result;
+    result.reserve(parameters.size());
     for (auto& parameter : parameters)
         result.push_back(
-            std::make_shared<Value>(interpretExpression(parameter, scope)));
+            makePooled<Value>(interpretExpression(parameter, scope)));
     return result;
 }
 
+static std::shared_ptr<Value> lookupVariable(const ArrayNode& array,
+                                             const std::string& name,
+                                             Scope& scope) {
+    if (auto& slot = array.getSlot()) {
+        if (auto& value = scope.slot(slot.value())) return value;
+        throw std::runtime_error("Undefined variable: " + name);
+    }
+    if (auto value = *std::get_if<std::shared_ptr<Value>>(&scope.get(name)))
+        return value;
+    else
+        throw std::runtime_error(
+            "Cannot use " + name +
+            " as an array, as it is defined as a function");
+}
+
 static Value interpretArray(const std::shared_ptr<ArrayNode>& array,
                             std::weak_ptr<Scope> scope) {
     if (auto lockedScope = scope.lock()) {
         return std::visit(
-            [&scope, &lockedScope](auto&& arg) {
+            [&scope, &lockedScope, &array](auto&& arg) {
                 using T = std::decay_t<decltype(arg)>;
                 constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
                 constexpr bool isString = std::is_same_v<T, std::string>;
                 constexpr bool isFunctionCall =
                     std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
                 if constexpr (isVector) {
-                    return Value(arg, arg.size());
+                    // Resolved literals share one value; short ones are
+                    // copied into inline storage, which costs no allocation.
+                    if (auto& literal = array->getLiteral())
+                        return Value::slice(literal, 0, arg.size());
+                    DynamicArray literal(arg.size());
+                    std::copy(arg.begin(), arg.end(), literal.data);
+                    return Value(std::move(literal), arg.size());
                 } else if constexpr (isString) {
-                    if (auto value = *std::get_if<std::shared_ptr<Value>>(
-                            &lockedScope->get(arg)))
-                        return *value;
-                    else
-                        throw std::runtime_error(
-                            "Cannot use " + arg +
-                            " as an array, as it is defined as a function");
+                    // Variables are only written in place while nothing
+                    // else holds them, so reading one shares its elements.
+                    auto variable = lookupVariable(*array, arg, *lockedScope);
+                    Value value =
+                        Value::slice(variable, 0, variable->getSize());
+                    value.minimum = variable->minimum;
+                    return value;
                 } else if constexpr (isFunctionCall) {
                     return interpretFunctionCall(arg, scope);
                 }
@@ -131,9 +201,138 @@ static Value interpretArray(const std::shared_ptr<ArrayNode>& array,
     throw std::runtime_error("Error interpreting array");
 }
 
+static const ArithmeticNode* arithmeticSubtree(
+    const std::shared_ptr<ExpressionNode>& expression) {
+    if (!expression->getPostfix().getValues().empty() ||
+        expression->getHoistedSlot().has_value())
+        return nullptr;
+    auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+        &expression->getPrimary());
+    return arithmetic != nullptr ? arithmetic->get() : nullptr;
+}
+
+static ArithmeticKernel arithmeticKernel(ArithmeticNode::Type type) {
+    switch (type) {
+        case ArithmeticNode::TYPE_ADDITION:
+            return ArithmeticKernel::ADD;
+        case ArithmeticNode::TYPE_SUBTRACTION:
+            return ArithmeticKernel::SUB;
+        case ArithmeticNode::TYPE_MULTIPLICATION:
+            return ArithmeticKernel::MUL;
+        case ArithmeticNode::TYPE_DIVISION:
+            return ArithmeticKernel::DIV;
+        case ArithmeticNode::TYPE_MODULO:
+            return ArithmeticKernel::MOD;
+        case ArithmeticNode::TYPE_AND:
+            return ArithmeticKernel::AND;
+        case ArithmeticNode::TYPE_OR:
+            return ArithmeticKernel::OR;
+        case ArithmeticNode::TYPE_XOR:
+            return ArithmeticKernel::XOR;
+        case ArithmeticNode::TYPE_SHIFT_LEFT:
+            return ArithmeticKernel::SHL;
+        case ArithmeticNode::TYPE_SHIFT_RIGHT:
+            return ArithmeticKernel::SHR;
+        default:
+            throw std::runtime_error("Error interpreting arithmetic");
+    }
+}
+
+static std::shared_ptr<const Value> interpretHoisted(
+    const std::shared_ptr<ExpressionNode>& expression,
+    std::weak_ptr<Scope> scope);
+
+// Plain variables and literals are read in place rather than copied.
+static std::shared_ptr<const Value> interpretOperand(
+    const std::shared_ptr<ExpressionNode>& expression,
+    std::weak_ptr<Scope> scope) {
+    if (expression->getHoistedSlot().has_value())
+        return interpretHoisted(expression, scope);
+    auto array = std::get_if<std::shared_ptr<ArrayNode>>(
+        &expression->getPrimary());
+    if (array != nullptr && expression->getPostfix().getValues().empty()) {
+        if (auto& literal = (*array)->getLiteral()) return literal;
+        auto name = std::get_if<std::string>(&(*array)->getValue());
+        auto lockedScope = scope.lock();
+        if (name != nullptr && lockedScope)
+            return lookupVariable(**array, *name, *lockedScope);
+    }
+    return makePooled<const Value>(
+        interpretExpression(expression, scope));
+}
+
+static void fuseArithmetic(const ArithmeticNode& arithmetic,
+                           FusedArithmetic& fused,
+                           std::weak_ptr<Scope> scope) {
+    for (auto operand : {&arithmetic.left, &arithmetic.right}) {
+        if (auto subtree = arithmeticSubtree(*operand))
+            fuseArithmetic(*subtree, fused, scope);
+        else
+            fused.pushOperand(interpretOperand(*operand, scope));
+    }
+    fused.pushOperation(arithmeticKernel(arithmetic.type));
+}
+
+static int scalarArithmetic(const ArithmeticNode& arithmetic,
+                            std::weak_ptr<Scope> scope);
+
+static int scalarOperand(const std::shared_ptr<ExpressionNode>& expression,
+                         std::weak_ptr<Scope> scope) {
+    if (auto subtree = arithmeticSubtree(expression);
+        subtree != nullptr && subtree->scalar)
+        return scalarArithmetic(*subtree, scope);
+    return interpretOperand(expression, scope)->view()[0];
+}
+
+// Arithmetic on operands proven to be single elements (parser/shape.h) works
+// on plain ints, wrapping like the kernels do.
+static int scalarArithmetic(const ArithmeticNode& arithmetic,
+                            std::weak_ptr<Scope> scope) {
+    auto left = static_cast<unsigned>(scalarOperand(arithmetic.left, scope));
+    auto right = static_cast<unsigned>(scalarOperand(arithmetic.right, scope));
+    switch (arithmetic.type) {
+        case ArithmeticNode::TYPE_ADDITION:
+            return static_cast<int>(left + right);
+        case ArithmeticNode::TYPE_SUBTRACTION:
+            return static_cast<int>(left - right);
+        case ArithmeticNode::TYPE_MULTIPLICATION:
+            return static_cast<int>(left * right);
+        case ArithmeticNode::TYPE_DIVISION:
+            return Divide()(static_cast<int>(left), static_cast<int>(right));
+        case ArithmeticNode::TYPE_MODULO:
+            return Remainder()(static_cast<int>(left),
+                               static_cast<int>(right));
+        case ArithmeticNode::TYPE_AND:
+            return static_cast<int>(left & right);
+        case ArithmeticNode::TYPE_OR:
+            return static_cast<int>(left | right);
+        case ArithmeticNode::TYPE_XOR:
+            return static_cast<int>(left ^ right);
+        case ArithmeticNode::TYPE_SHIFT_LEFT:
+            return static_cast<int>(left << (right & 31));
+        case ArithmeticNode::TYPE_SHIFT_RIGHT:
+            return ShiftRight()(static_cast<int>(left),
+                                static_cast<int>(right));
+        default:
+            throw std::runtime_error("Error interpreting arithmetic");
+    }
+}
+
 static Value interpretArithmetic(
     const std::shared_ptr<ArithmeticNode>& arithmetic,
     std::weak_ptr<Scope> scope) {
+    if (arithmetic->scalar) {
+        DynamicArray result(1);
+        result[0] = scalarArithmetic(*arithmetic, scope);
+        return Value(std::move(result), 1);
+    }
+    // Chains like `a * b + c` run as one fused pass over their operands.
+    if (arithmeticSubtree(arithmetic->left) != nullptr ||
+        arithmeticSubtree(arithmetic->right) != nullptr) {
+        FusedArithmetic fused;
+        fuseArithmetic(*arithmetic, fused, scope);
+        return fused.evaluate();
+    }
     Value left = interpretExpression(arithmetic->left, scope);
     Value right = interpretExpression(arithmetic->right, scope);
     switch (arithmetic->type) {
@@ -145,78 +344,31 @@ static Value interpretArithmetic(
             return left * right;
         case ArithmeticNode::TYPE_DIVISION:
             return left / right;
+        case ArithmeticNode::TYPE_MODULO:
+            return left % right;
+        case ArithmeticNode::TYPE_AND:
+            return left & right;
+        case ArithmeticNode::TYPE_OR:
+            return left | right;
+        case ArithmeticNode::TYPE_XOR:
+            return left ^ right;
+        case ArithmeticNode::TYPE_SHIFT_LEFT:
+            return left << right;
+        case ArithmeticNode::TYPE_SHIFT_RIGHT:
+            return left >> right;
         default:
             throw std::runtime_error("Error interpreting arithmetic");
     }
 }
 
-static Value applyAppend(const Value& value,
-                         std::vector<std::shared_ptr<Value>> parameters) {
-    if (parameters.size() != 1)
-        throw std::runtime_error("append expects 1 argument with type []");
-    auto& param1 = parameters[0];
-    size_t size1 = value.getSize();
-    size_t size2 = param1->getSize();
-    DynamicArray result(size1 + size2);
-    std::visit(
-        [&result, &size1](auto&& arg) {
-            using T = std::decay_t<decltype(arg)>;
-            constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
-            constexpr bool isDynamic = std::is_same_v<T, DynamicArray>;
-            if constexpr (isVector) {
-                for (size_t i = 0; i < size1; i++) result[i] = arg[i];
-            } else if constexpr (isDynamic) {
-                for (size_t i = 0; i < size1; i++) result[i] = arg[i];
-            }
-        },
-        value.value);
-    std::visit(
-        [&result, &size1, &size2](auto&& arg) {
-            using T = std::decay_t<decltype(arg)>;
-            constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
-            constexpr bool isDynamic = std::is_same_v<T, DynamicArray>;
-            if constexpr (isVector) {
-                for (size_t i = 0; i < size2; i++) result[size1 + i] = arg[i];
-            } else if constexpr (isDynamic) {
-                for (size_t i = 0; i < size2; i++) result[size1 + i] = arg[i];
-            }
-        },
-        param1->value);
-    return Value(result, size1 + size2);
-}
-
-static Value applySqrt(const Value& value,
-                       std::vector<std::shared_ptr<Value>> parameters) {
-    if (parameters.size() != 0)
-        throw std::runtime_error("sqrt expects 0 arguments");
-    DynamicArray fixedValue = DynamicArray::fromValue(value);
-    DynamicArray result(fixedValue.size);
-    for (size_t i = 0; i < fixedValue.size; i++)
-        result[i] = sqrt(fixedValue[i]);
-    return Value(result, result.size);
-}
-
-static Value applySize(const Value& value,
-                       std::vector<std::shared_ptr<Value>> parameters) {
-    if (parameters.size() != 0)
-        throw std::runtime_error("size expects 0 arguments");
-    DynamicArray result(1);
-    result[0] = value.getSize();
-    return Value(result, 1);
-}
-
-static Value applyMethod(const Value& value,
-                         const std::shared_ptr<MethodNode>& method,
-                         std::weak_ptr<Scope> scope) {
-    auto parameters = interpretParameters(method->getParameters(), scope);
-    if (method->getIdentifier() == "append")
-        return applyAppend(value, parameters);
-    else if (method->getIdentifier() == "sqrt")
-        return applySqrt(value, parameters);
-    else if (method->getIdentifier() == "size")
-        return applySize(value, parameters);
-    else
-        throw std::runtime_error("Unknown method " + method->getIdentifier());
+static std::vector<Value> interpretArguments(
+    const std::vector<std::shared_ptr<ExpressionNode>>& parameters,
+    std::weak_ptr<Scope> scope) {
+    std::vector<Value> result;
+    result.reserve(parameters.size());
+    for (auto& parameter : parameters)
+        result.push_back(interpretExpression(parameter, scope));
+    return result;
 }
 
 static size_t interpretArrayRangeBound(
@@ -231,8 +383,8 @@ static size_t interpretArrayRangeBound(
             if constexpr (isSizeT) {
                 return value;
             } else if constexpr (isExpression) {
-                auto result =
-                    DynamicArray::fromValue(interpretExpression(value, scope));
+                Value bound = interpretExpression(value, scope);
+                ArrayView result = bound.view();
                 if (result.size != 1 || result[0] < 0)
                     throw std::runtime_error(
                         "Array Bounds value must be an integer or evaluate to "
@@ -243,52 +395,65 @@ static size_t interpretArrayRangeBound(
         value);
 }
 
-static Value interpretArrayRange(const std::shared_ptr<ArrayRangeNode>& range,
-                                 const Value& value,
-                                 std::weak_ptr<Scope> scope) {
-    size_t size = value.getSize();
-    auto startV = range->getStart().value_or(static_cast<size_t>(0));
-    auto endV = range->getEnd().value_or(size);
+static std::pair<size_t, size_t> interpretArrayRange(
+    const ArrayRangeNode& range, size_t size, std::weak_ptr<Scope> scope) {
+    auto startV = range.getStart().value_or(static_cast<size_t>(0));
+    auto endV = range.getEnd().value_or(size);
     size_t start = interpretArrayRangeBound(startV, scope);
     size_t end = interpretArrayRangeBound(endV, scope);
     if (end < start)
         throw std::runtime_error(
             "Array Range upper bound must be greater than or equal to the "
             "lower bound");
-    size_t newSize = end - start;
-    DynamicArray result(newSize);
     if (end > size)
         throw std::runtime_error(
             "Array range bounds must be smaller than the "
             "length of the array");
-    auto staticValue = DynamicArray::fromValue(value);
-    for (size_t i = 0; i < newSize; i++) {
-        result[i] = staticValue[i + start];
-    }
-    return Value(result, newSize);
+    return {start, end};
 }
 
-static Value applyPostfix(const Value& value,
+// Evaluates a postfix chain in place on one value owned by the chain. A chain
+// that starts from a variable reads the variable's `source` until a step
+// produces a value of its own, so slicing a variable shares its elements.
+static Value applyPostfix(std::optional<Value> value,
+                          const std::shared_ptr<const Value>& source,
                           const ArrayPostFixNode& postfixNode,
                           std::weak_ptr<Scope> scope) {
-    Value* resultValue = new Value(value);
     for (auto& postfix : postfixNode.getValues()) {
-        resultValue = new Value(std::visit(
-            [&scope, &resultValue](auto&& arg) {
+        std::visit(
+            [&scope, &value, &source](auto&& arg) {
                 using T = std::decay_t<decltype(arg)>;
                 constexpr bool isArrayRange =
                     std::is_same_v<T, std::shared_ptr<ArrayRangeNode>>;
                 constexpr bool isMethod =
                     std::is_same_v<T, std::shared_ptr<MethodNode>>;
                 if constexpr (isArrayRange) {
-                    return interpretArrayRange(arg, *resultValue, scope);
+                    auto [start, end] = interpretArrayRange(
+                        *arg, (value.has_value() ? *value : *source).getSize(),
+                        scope);
+                    if (value.has_value())
+                        value->sliceInPlace(start, end);
+                    else
+                        value.emplace(Value::slice(source, start, end));
                 } else if constexpr (isMethod) {
-                    return applyMethod(*resultValue, arg, scope);
+                    auto& builtin = arg->getBuiltin();
+                    if (!builtin.has_value())
+                        throw std::runtime_error("Unknown method " +
+                                                 arg->getIdentifier());
+                    auto parameters =
+                        interpretArguments(arg->getParameters(), scope);
+                    if (value.has_value())
+                        callBuiltinMethodInPlace(builtin.value(), *value,
+                                                 parameters);
+                    else
+                        value.emplace(callBuiltinMethod(builtin.value(),
+                                                        *source, parameters));
                 }
             },
-            postfix));
+            postfix);
     }
-    return *resultValue;
+    if (value.has_value()) return std::move(value.value());
+    return *source;
 }
 
 static std::optional<Value> interpretBody(const std::shared_ptr<BodyNode>& body,
@@ -297,9 +462,24 @@ static Value interpretFunctionCall(
     const std::shared_ptr<FunctionCallNode>& functionCall,
     std::weak_ptr<Scope> parent);
 
-static Value interpretExpression(
+static Value evaluateExpression(
     const std::shared_ptr<ExpressionNode>& expression,
     std::weak_ptr<Scope> scope) {
+    // A postfix chain on a variable starts from the variable itself, so that
+    // slicing it shares its elements instead of copying them.
+    auto& postfix = expression->getPostfix();
+    auto array = std::get_if<std::shared_ptr<ArrayNode>>(
+        &expression->getPrimary());
+    if (array != nullptr && !postfix.getValues().empty()) {
+        if (auto& literal = (*array)->getLiteral())
+            return applyPostfix(std::nullopt, literal, postfix, scope);
+        auto name = std::get_if<std::string>(&(*array)->getValue());
+        auto lockedScope = scope.lock();
+        if (name != nullptr && lockedScope)
+            return applyPostfix(std::nullopt,
+                                lookupVariable(**array, *name, *lockedScope),
+                                postfix, scope);
+    }
     Value value = std::visit(
         [&scope, &expression](auto&& arg) {
             using T = std::decay_t<decltype(arg)>;
@@ -314,7 +494,37 @@ static Value interpretExpression(
             }
         },
         expression->getPrimary());
-    return applyPostfix(value, expression->getPostfix(), scope);
+    return applyPostfix(std::move(value), nullptr, postfix, scope);
+}
+
+// An expression hoisted out of a loop (parser/hoist.h) is evaluated the
+// first time the loop reaches it and kept in its slot until the loop starts
+// again.
+static std::shared_ptr<const Value> interpretHoisted(
+    const std::shared_ptr<ExpressionNode>& expression,
+    std::weak_ptr<Scope> scope) {
+    auto lockedScope = scope.lock();
+    if (!lockedScope) throw std::runtime_error("Error interpreting expression");
+    VariableSlot slot = expression->getHoistedSlot().value();
+    if (auto& value = lockedScope->slot(slot)) return value;
+    auto value = makePooled<Value>(evaluateExpression(expression, scope));
+    lockedScope->slot(slot) = value;
+    return value;
+}
+
+static Value interpretExpression(
+    const std::shared_ptr<ExpressionNode>& expression,
+    std::weak_ptr<Scope> scope) {
+    if (!expression->getHoistedSlot().has_value())
+        return evaluateExpression(expression, scope);
+    auto hoisted = interpretHoisted(expression, scope);
+    Value value = Value::slice(hoisted, 0, hoisted->getSize());
+    value.minimum = hoisted->minimum;
+    return value;
+}
+
+static void forgetHoisted(const std::vector<size_t>& slots, Scope& scope) {
+    for (size_t slot : slots) scope.slot({slot}).reset();
 }
 
 static void interpretVariableDeclaration(
@@ -325,23 +535,70 @@ static void interpretVariableDeclaration(
         if (variableDeclaration->getValue().has_value())
             value = interpretExpression(variableDeclaration->getValue().value(),
                                         scope);
-        lockedScope->define(variableDeclaration->getIdentifier(),
-                            std::make_shared<Value>(Value::fromDescriptor(
-                                variableDeclaration->getDescriptor(), value)));
+        auto declared = makePooled<Value>(
+            Value::fromDescriptor(variableDeclaration->getDescriptor(),
+                                  std::move(value)));
+        if (auto& slot = variableDeclaration->getSlot())
+            lockedScope->slot(slot.value()) = std::move(declared);
+        else
+            lockedScope->define(variableDeclaration->getIdentifier(),
+                                std::move(declared));
     } else {
         throw std::runtime_error("Error interpreting variable declaration");
     }
 }
 
+// Matches `x = x.append(...)` or `x = x.put(...)` on a local, which can
+// update x's own storage since the arguments are evaluated before x is
+// touched.
+static const MethodNode* selfUpdate(
+    const VariableAssignmentNode& variableAssignment) {
+    auto& right = variableAssignment.getRight();
+    auto& postfix = right->getPostfix().getValues();
+    auto array = std::get_if<std::shared_ptr<ArrayNode>>(&right->getPrimary());
+    if (array == nullptr || postfix.size() != 1) return nullptr;
+    auto& slot = (*array)->getSlot();
+    if (!slot.has_value() ||
+        slot->index != variableAssignment.getSlot()->index)
+        return nullptr;
+    auto method = std::get_if<std::shared_ptr<MethodNode>>(&postfix[0]);
+    if (method == nullptr ||
+        ((*method)->getBuiltin() != BuiltinMethod::APPEND &&
+         (*method)->getBuiltin() != BuiltinMethod::PUT))
+        return nullptr;
+    return method->get();
+}
+
 static void interpretVariableAssignment(
     const std::shared_ptr<VariableAssignmentNode>& variableAssignment,
     std::weak_ptr<Scope> scope) {
     if (auto lockedScope = scope.lock()) {
+        if (auto& slot = variableAssignment->getSlot()) {
+            auto& target = lockedScope->slot(slot.value());
+            if (!target)
+                throw std::runtime_error(variableAssignment->getLeft() +
+                                         " has not been defined");
+            auto update = selfUpdate(*variableAssignment);
+            if (update != nullptr && target.use_count() == 1) {
+                auto parameters =
+                    interpretArguments(update->getParameters(), scope);
+                callBuiltinMethodInPlace(update->getBuiltin().value(),
+                                         *target, parameters);
+                return;
+            }
+            Value value =
+                interpretExpression(variableAssignment->getRight(), scope);
+            if (target.use_count() == 1)
+                target->replace(std::move(value));
+            else
+                target = makePooled<Value>(std::move(value));
+            return;
+        }
         if (!lockedScope->hasRecursive(variableAssignment->getLeft()))
             throw std::runtime_error(variableAssignment->getLeft() +
                                      " has not been defined");
 
-        auto right = std::make_shared<Value>(
+        auto right = makePooled<Value>(
             interpretExpression(variableAssignment->getRight(), scope));
         lockedScope->set(variableAssignment->getLeft(), right);
     } else {
@@ -371,7 +628,7 @@ static void interpretVariableBinding(
 static bool interpretIfDeclaration(
     const std::shared_ptr<IfDeclarationNode>& condition,
     std::weak_ptr<Scope> scope) {
-    auto expression = condition->getVariableDeclaration()->getValue();
+    const auto& expression = condition->getVariableDeclaration()->getValue();
 
     if (!expression.has_value()) {
         interpretVariableDeclaration(condition->getVariableDeclaration(),
@@ -379,14 +636,20 @@ static bool interpretIfDeclaration(
         return true;
     } else if (auto lockedScope = scope.lock()) {
         auto value = interpretExpression(expression.value(), scope);
-        auto descriptor = condition->getVariableDeclaration()->getDescriptor();
+        const auto& descriptor =
+            condition->getVariableDeclaration()->getDescriptor();
         if (descriptor.getSize() == value.getSize() ||
             (descriptor.getSize() < value.getSize() &&
              descriptor.getCanGrow())) {
-            lockedScope->define(
-                condition->getVariableDeclaration()->getIdentifier(),
-                std::make_shared<Value>(
-                    Value::fromDescriptor(descriptor, value)));
+            auto declared = makePooled<Value>(
+                Value::fromDescriptor(descriptor, std::move(value)));
+            auto& slot = condition->getVariableDeclaration()->getSlot();
+            if (slot.has_value())
+                lockedScope->slot(slot.value()) = std::move(declared);
+            else
+                lockedScope->define(
+                    condition->getVariableDeclaration()->getIdentifier(),
+                    std::move(declared));
             return true;
         } else {
             return false;
@@ -396,23 +659,39 @@ static bool interpretIfDeclaration(
     }
 }
 
+// Sides proven to be single elements compare as plain ints; anything else
+// compares in place, without copying either side.
+template <typename Operation>
+static bool interpretComparison(const IfCompareNode& condition,
+                                Operation operation,
+                                std::weak_ptr<Scope> scope) {
+    if (condition.scalar) {
+        int left = scalarOperand(condition.getLeft(), scope);
+        int right = scalarOperand(condition.getRight(), scope);
+        return operation(left, right);
+    }
+    auto left = interpretOperand(condition.getLeft(), scope);
+    auto right = interpretOperand(condition.getRight(), scope);
+    return operation(*left, *right);
+}
+
 static bool interpretIfCompare(const std::shared_ptr<IfCompareNode>& condition,
                                std::weak_ptr<Scope> scope) {
-    Value left = interpretExpression(condition->getLeft(), scope);
-    Value right = interpretExpression(condition->getRight(), scope);
     switch (condition->getType()) {
         case IfCompareNode::Type::EQ:
-            return left == right;
+            return interpretComparison(*condition, std::equal_to<>(), scope);
         case IfCompareNode::Type::NE:
-            return left != right;
+            return interpretComparison(*condition, std::not_equal_to<>(),
+                                       scope);
         case IfCompareNode::Type::LT:
-            return left < right;
+            return interpretComparison(*condition, std::less<>(), scope);
         case IfCompareNode::Type::LE:
-            return left <= right;
+            return interpretComparison(*condition, std::less_equal<>(), scope);
         case IfCompareNode::Type::GT:
-            return left > right;
+            return interpretComparison(*condition, std::greater<>(), scope);
         case IfCompareNode::Type::GE:
-            return left >= right;
+            return interpretComparison(*condition, std::greater_equal<>(),
+                                       scope);
     }
     throw std::runtime_error("Error interpreting if comparison");
 }
@@ -437,83 +716,205 @@ static bool interpretIfCondition(
 }
 
 static std::optional<Value> interpretWhile(
-    const std::shared_ptr<WhileNode>& whileNode,
-    std::weak_ptr<Scope> parentScope) {
-    auto scope = std::make_shared<Scope>(parentScope);
-    while (interpretIfCondition(whileNode->getCondition(), scope)) {
-        auto result = interpretBody(whileNode->getBody(), scope);
-        if (result.has_value()) return result.value();
+    const std::shared_ptr<WhileNode>& whileNode, std::weak_ptr<Scope> scope) {
+    auto lockedScope = scope.lock();
+    if (!lockedScope) throw std::runtime_error("Error interpreting while");
+    auto& hoisted = whileNode->getHoistedSlots();
+    forgetHoisted(hoisted, *lockedScope);
+    std::optional<Value> result;
+    while (!result.has_value() &&
+           interpretIfCondition(whileNode->getCondition(), scope))
+        result = interpretBody(whileNode->getBody(), scope);
+    forgetHoisted(hoisted, *lockedScope);
+    return result;
+}
+
+// Reuses the element's storage from the previous iteration unless the body
+// replaced it with something other than a single element or a slice of it is
+// still alive.
+static void bindElement(std::shared_ptr<Value>& slot, int element) {
+    if (slot && slot.use_count() == 1) {
+        auto array = std::get_if<DynamicArray>(&slot->value);
+        if (array != nullptr && array->size == 1) {
+            (*array)[0] = element;
+            slot->minimum = 1;
+            return;
+        }
+    }
+    DynamicArray elementArray(1);
+    elementArray[0] = element;
+    slot = makePooled<Value>(std::move(elementArray), 1);
+}
+
+static Value reductionIdentity(ReductionNode::Type type, const Value& value) {
+    if (type == ReductionNode::TYPE_APPEND)
+        return Value(DynamicArray::growable(), 0);
+    size_t size = value.getSize();
+    DynamicArray identity(size);
+    std::fill(identity.data, identity.data + size,
+              type == ReductionNode::TYPE_MULTIPLY ? 1 : 0);
+    return Value(std::move(identity), size);
+}
+
+static void mergeReduction(ReductionNode::Type type,
+                           std::shared_ptr<Value>& target, Value partial) {
+    if (type == ReductionNode::TYPE_APPEND) {
+        if (target.use_count() != 1) target = makePooled<Value>(*target);
+        std::vector<Value> parameters;
+        parameters.push_back(std::move(partial));
+        callBuiltinMethodInPlace(BuiltinMethod::APPEND, *target, parameters);
+        return;
+    }
+    Value merged = type == ReductionNode::TYPE_ADD ? *target + partial
+                                                   : *target * partial;
+    if (target.use_count() == 1)
+        target->replace(std::move(merged));
+    else
+        target = makePooled<Value>(std::move(merged));
+}
+
+static const FunctionDefinitionNode* userFunction(
+    const FunctionCallNode& functionCall, const Scope& scope);
+
+// The elements `for` runs over: those of an array, or for a call to range
+// and slices of it, the numbers from `start` to `end`, which are counted
+// through instead of being built.
+struct LoopElements {
+    std::optional<Value> array;
+    size_t start;
+    size_t end;
+
+    size_t size() const { return end - start; }
+    // The array's elements, or nullptr when counting; taken once per loop.
+    const int* data() const { return array ? array->getData() : nullptr; }
+    int at(const int* data, size_t i) const {
+        return data != nullptr ? data[i] : static_cast<int>(start + i);
+    }
+};
+
+static LoopElements interpretIterable(const ForLoopNode& forLoop,
+                                      const std::shared_ptr<Scope>& scope) {
+    const FunctionCallNode* range = forLoop.getRangeCall();
+    if (range != nullptr && userFunction(*range, *scope) == nullptr &&
+        countsAsRange(BuiltinFunction::RANGE)) {
+        size_t size =
+            rangeSize(interpretArguments(range->getParameters(), scope));
+        const ArrayRangeNode* slice = forLoop.getRangeSlice();
+        if (slice == nullptr) return LoopElements{std::nullopt, 0, size};
+        auto [start, end] = interpretArrayRange(*slice, size, scope);
+        return LoopElements{std::nullopt, start, end};
+    }
+    Value array = interpretExpression(forLoop.getIterable(), scope);
+    size_t size = array.getSize();
+    return LoopElements{std::move(array), 0, size};
+}
+
+// Splits the iterations into contiguous runs, each executed by one task in a
+// copy of the frame. Reduced variables start from their identity in every
+// copy and are merged back in iteration order once all tasks finish.
+static void interpretParallelFor(const std::shared_ptr<ForLoopNode>& forLoop,
+                                 const std::shared_ptr<Scope>& scope) {
+    LoopElements elements = interpretIterable(*forLoop, scope);
+    auto& reductions = forLoop->getReductions();
+    const int* data = elements.data();
+    size_t tasks = std::min(elements.size(), parallelThreads() * 4);
+    std::vector<std::vector<Value>> partials(tasks);
+    parallelEach(tasks, [&](size_t task) {
+        auto local = makePooled<Scope>(*scope);
+        for (auto& reduction : reductions) {
+            auto& slot = local->slot({reduction->getSlot()});
+            slot = makePooled<Value>(
+                reductionIdentity(reduction->getType(), *slot));
+        }
+        auto& element = local->slot({forLoop->getElementSlot()});
+        size_t begin = elements.size() * task / tasks;
+        size_t end = elements.size() * (task + 1) / tasks;
+        for (size_t i = begin; i < end; i++) {
+            bindElement(element, elements.at(data, i));
+            if (interpretBody(forLoop->getBody(), local).has_value())
+                throw std::runtime_error("Cannot return from inside pfor");
+        }
+        for (auto& reduction : reductions) {
+            auto& slot = local->slot({reduction->getSlot()});
+            if (slot.use_count() == 1)
+                partials[task].push_back(std::move(*slot));
+            else
+                partials[task].push_back(*slot);
+        }
+    });
+    for (auto& partial : partials) {
+        for (size_t i = 0; i < reductions.size(); i++)
+            mergeReduction(reductions[i]->getType(),
+                           scope->slot({reductions[i]->getSlot()}),
+                           std::move(partial[i]));
     }
-    return std::nullopt;
 }
 
 static std::optional<Value> interpretForLoop(
-    const std::shared_ptr<ForLoopNode>& forLoop,
-    std::weak_ptr<Scope> parentScope) {
-    auto iterable = interpretExpression(forLoop->getIterable(), parentScope);
-    size_t iterableSize = iterable.getSize();
-    return std::visit(
-        [&parentScope, &forLoop,
-         &iterableSize](auto&& iterable) -> std::optional<Value> {
-            using T = std::decay_t<decltype(iterable)>;
-            constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
-            constexpr bool isDynamicArray = std::is_same_v<T, DynamicArray>;
-            if constexpr (isVector) {
-                for (int element : iterable) {
-                    auto scope = std::make_shared<Scope>(parentScope);
-                    DynamicArray elementArray(1);
-                    elementArray[0] = element;
-                    scope->define(forLoop->getElement(),
-                                  std::make_shared<Value>(elementArray, 1));
-                    std::optional<Value> returnValue =
-                        interpretBody(forLoop->getBody(), scope);
-                    if (returnValue.has_value()) return returnValue.value();
-                }
-                return std::nullopt;
-            } else if constexpr (isDynamicArray) {
-                for (size_t i = 0; i < iterableSize; i++) {
-                    int element = iterable[i];
-                    auto scope = std::make_shared<Scope>(parentScope);
-                    DynamicArray elementArray(1);
-                    elementArray[0] = element;
-                    scope->define(forLoop->getElement(),
-                                  std::make_shared<Value>(elementArray, 1));
-                    std::optional<Value> returnValue =
-                        interpretBody(forLoop->getBody(), scope);
-                    if (returnValue.has_value()) return returnValue.value();
-                }
-                return std::nullopt;
-            }
-        },
-        iterable.value);
+    const std::shared_ptr<ForLoopNode>& forLoop, std::weak_ptr<Scope> scope) {
+    auto lockedScope = scope.lock();
+    if (!lockedScope) throw std::runtime_error("Error interpreting for loop");
+    if (forLoop->isParallel()) {
+        interpretParallelFor(forLoop, lockedScope);
+        return std::nullopt;
+    }
+    LoopElements elements = interpretIterable(*forLoop, lockedScope);
+    auto& hoisted = forLoop->getHoistedSlots();
+    forgetHoisted(hoisted, *lockedScope);
+    auto& slot = lockedScope->slot({forLoop->getElementSlot()});
+    const int* data = elements.data();
+    std::optional<Value> result;
+    for (size_t i = 0; i < elements.size() && !result.has_value(); i++) {
+        bindElement(slot, elements.at(data, i));
+        result = interpretBody(forLoop->getBody(), scope);
+    }
+    forgetHoisted(hoisted, *lockedScope);
+    return result;
 }
 
 static std::pair<std::optional<Value>, bool> interpretIf(
-    const std::shared_ptr<IfNode>& ifNode, std::weak_ptr<Scope> parentScope) {
-    auto scope = std::make_shared<Scope>(parentScope);
+    const std::shared_ptr<IfNode>& ifNode, std::weak_ptr<Scope> scope) {
     bool isConditionTrue = interpretIfCondition(ifNode->getCondition(), scope);
     if (isConditionTrue) return {interpretBody(ifNode->getBody(), scope), true};
 
-    auto elseIf = ifNode->getElseIfBranches();
+    const auto& elseIf = ifNode->getElseIfBranches();
     if (elseIf.has_value()) {
         auto elseIfResult = interpretIf(elseIf.value(), scope);
         if (elseIfResult.second) return {elseIfResult.first, true};
     }
-    auto elseBody = ifNode->getElseBody();
+    const auto& elseBody = ifNode->getElseBody();
     if (elseBody.has_value())
         return {interpretBody(elseBody.value(), scope), true};
 
     return {std::nullopt, false};
 }
 
+// Set on the thread running main while --profile is on, so pfor workers
+// never report to it.
+static std::unique_ptr<Profiler> activeProfiler;
+static thread_local Profiler* profiler = nullptr;
+
+// A tail call to a user function only evaluates its arguments here; the
+// call that made this frame runs it once the body has unwound.
 static Value interpretReturn(const std::shared_ptr<ReturnNode>& returnNode,
                              std::weak_ptr<Scope> scope) {
+    if (auto tailCall = returnNode->getTailCall()) {
+        auto lockedScope = scope.lock();
+        if (!lockedScope) throw std::runtime_error("Error interpreting return");
+        if (auto function = userFunction(*tailCall, *lockedScope)) {
+            lockedScope->setTailCall(TailCall{
+                function,
+                interpretParameters(tailCall->getParameters(), scope)});
+            return Value(DynamicArray(0), 0);
+        }
+    }
     return interpretExpression(returnNode->getValue(), scope);
 }
 
 static std::optional<Value> interpretStatement(
     const std::shared_ptr<StatementNode>& statement,
     std::weak_ptr<Scope> scope) {
+    if (profiler != nullptr) profiler->statement(statement->getLine());
     return std::visit(
         [&scope](auto&& arg) -> std::optional<Value> {
             using T = std::decay_t<decltype(arg)>;
@@ -552,180 +953,212 @@ static std::optional<Value> interpretBody(const std::shared_ptr<BodyNode>& body,
                                           std::weak_ptr<Scope> scope) {
     for (auto& statement : body->getStatements()) {
         auto returnValue = interpretStatement(statement, scope);
-        if (returnValue.has_value()) return returnValue.value();
+        if (returnValue.has_value()) return returnValue;
     }
     return std::nullopt;
 }
 
-static std::string valueToString(const Value& value) {
-    auto array = DynamicArray::fromValue(value);
-    std::string result;
-    result.reserve(array.size);
-    for (size_t i = 0; i < array.size; i++)
-        result += static_cast<char>(array.data[i]);
-    return result;
+// Functions only see their own locals and the globals they were defined
+// alongside, never the locals of their caller.
+static std::shared_ptr<Scope> globalScope(std::shared_ptr<Scope> scope) {
+    while (auto parent = scope->getParent().lock()) scope = parent;
+    return scope;
 }
 
-static Value interpretPrint(
-    const std::shared_ptr<FunctionCallNode>& functionCall,
-    std::weak_ptr<Scope> scope) {
-    if (functionCall->getParameters().size() != 1)
-        throw std::runtime_error(
-            "Function print expected 1 argument but received " +
-            functionCall->getParameters().size());
-    auto param1 = interpretExpression(functionCall->getParameters()[0], scope);
-    std::cout << valueToString(param1);
-
-    return Value(DynamicArray(0), 0);
+// The user function a call names, or null when the name is unbound and the
+// call is to a builtin. Only the first call after a binding change looks the
+// name up; the rest reuse what that call cached on the node.
+static const FunctionDefinitionNode* userFunction(
+    const FunctionCallNode& functionCall, const Scope& scope) {
+    auto& cache = functionCall.getCache();
+    uint64_t version = functionBindings.load(std::memory_order_acquire);
+    if (cache.version.load(std::memory_order_acquire) == version)
+        return cache.function.load(std::memory_order_relaxed);
+    auto& name = functionCall.getIdentifier();
+    const FunctionDefinitionNode* function = nullptr;
+    if (scope.hasRecursive(name)) {
+        auto definition =
+            std::get_if<std::shared_ptr<FunctionDefinitionNode>>(
+                &scope.get(name));
+        if (definition == nullptr)
+            throw std::runtime_error(name + " must be defined as a function.");
+        function = definition->get();
+    }
+    cache.function.store(function, std::memory_order_relaxed);
+    cache.version.store(version, std::memory_order_release);
+    return function;
 }
 
-static Value interpretRead(
-    const std::shared_ptr<FunctionCallNode>& functionCall,
-    std::weak_ptr<Scope> scope) {
-    if (functionCall->getParameters().size() != 1)
-        throw std::runtime_error(
-            "Function read expected 1 argument but received " +
-            functionCall->getParameters().size());
-    auto param1 = interpretExpression(functionCall->getParameters()[0], scope);
-    auto filename = valueToString(param1);
-    return interpretArray(std::make_shared<ArrayNode>(
-                              ArrayNode::stringToInts(readCode(filename))),
-                          scope);
-}
-
-static char getCharImmediate() {
-#ifdef _WIN32
-    char ch = _getch();
-#else
-    struct termios oldt, newt;
-    char ch;
-    tcgetattr(STDIN_FILENO, &oldt);
-    newt = oldt;
-    newt.c_lflag &= ~(ICANON | ECHO);  // raw mode
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-
-    ch = getchar();
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-#endif
-    if (ch == 3)  // Ctrl+C
-        std::raise(SIGINT);
-    return ch;
+// Native stack used per walker call limits how deep recursion can go.
+constexpr size_t WALKER_CALL_DEPTH = 2000;
+static thread_local size_t callDepth = 0;
+
+static size_t maxCallDepth() {
+    size_t limit = currentContext().maxCallDepth;
+    return limit != 0 ? limit : WALKER_CALL_DEPTH;
 }
 
-static Value interpretGetchar(
-    const std::shared_ptr<FunctionCallNode>& functionCall,
-    std::weak_ptr<Scope> scope) {
-    if (functionCall->getParameters().size() != 0)
+namespace {
+
+class CallDepthGuard {
+ public:
+    CallDepthGuard() {
+        if (size_t limit = maxCallDepth(); callDepth >= limit)
+            throw std::runtime_error("Maximum call depth of " +
+                                     std::to_string(limit) + " exceeded");
+        callDepth++;
+    }
+    ~CallDepthGuard() { callDepth--; }
+};
+
+class ProfileGuard {
+ public:
+    explicit ProfileGuard(const FunctionDefinitionNode& function) {
+        if (profiler != nullptr) profiler->enter(function);
+    }
+    ~ProfileGuard() {
+        if (profiler != nullptr) profiler->leave();
+    }
+};
+
+}  // namespace
+
+static std::shared_ptr<Scope> bindArguments(
+    const FunctionDefinitionNode& function,
+    SharedValues& arguments, const std::shared_ptr<Scope>& globals) {
+    auto& params = function.getParams();
+    if (params.size() != arguments.size())
         throw std::runtime_error(
-            "Function getchar expected 0 argument but received " +
-            functionCall->getParameters().size());
-    return interpretArray(std::make_shared<ArrayNode>(ArrayNode::stringToInts(
-                              std::string(1, getCharImmediate()))),
-                          scope);
+            "Function " + function.getIdentifier() + " expected " +
+            std::to_string(params.size()) + " argument(s) but received " +
+            std::to_string(arguments.size()));
+    auto scope = makePooled<Scope>(globals, function.getFrameSize());
+    for (size_t i = 0; i < params.size(); i++)
+        scope->slot({i}) = makePooled<Value>(Value::fromDescriptor(
+            params[i]->getDescriptor(), std::move(*arguments[i])));
+    return scope;
 }
 
-static void clearTerminal() {
-#ifdef _WIN32
-    std::system("cls");  // Windows
-#else
-    std::system("clear");  // Unix/Linux/macOS
-#endif
+// Runs the call on the scalar tier (runtime/scalar.h) once the function is
+// hot and compiled and every argument is a single element; nullopt leaves it
+// to the walker. Compiled code has no statements for the profiler to time,
+// so profiled runs stay in the walker.
+static std::optional<Value> interpretScalar(
+    const FunctionDefinitionNode& function, const SharedValues& arguments,
+    const Scope& globals) {
+    if (!currentContext().tiering || profiler != nullptr) return std::nullopt;
+    const ScalarFunction* compiled = scalarTier(
+        function, functionBindings.load(std::memory_order_acquire),
+        [&globals](const FunctionCallNode& call) {
+            return userFunction(call, globals);
+        });
+    if (compiled == nullptr || arguments.size() != function.getParams().size())
+        return std::nullopt;
+    int values[SCALAR_MAX_PARAMETERS];
+    for (size_t i = 0; i < arguments.size(); i++) {
+        ArrayView argument = arguments[i]->view();
+        if (argument.size != 1) return std::nullopt;
+        values[i] = argument[0];
+    }
+    auto result = runScalar(*compiled, values, callDepth, maxCallDepth());
+    if (!result.has_value()) return std::nullopt;
+    DynamicArray value(1);
+    value[0] = result.value();
+    return Value(std::move(value), 1);
 }
 
-static Value interpretClear(
-    const std::shared_ptr<FunctionCallNode>& functionCall) {
-    if (functionCall->getParameters().size() != 0)
-        throw std::runtime_error(
-            "Function clear expected 0 argument but received " +
-            functionCall->getParameters().size());
-    clearTerminal();
-    return Value(DynamicArray(0), 0);
+// Runs the call and then the tail calls it leaves, each in the frame of the
+// one before.
+static Value callFunction(const FunctionDefinitionNode* functionDefinition,
+                          SharedValues& arguments,
+                          const std::shared_ptr<Scope>& globals) {
+    CallDepthGuard depth;
+    ProfileGuard profile(*functionDefinition);
+    while (true) {
+        countCall(callDepth);
+        if (auto result =
+                interpretScalar(*functionDefinition, arguments, *globals))
+            return std::move(result.value());
+        auto scope = bindArguments(*functionDefinition, arguments, globals);
+        std::optional<Value> returnValue =
+            interpretBody(functionDefinition->getBody(), scope);
+        if (auto tailCall = scope->takeTailCall()) {
+            functionDefinition = tailCall->function;
+            arguments = std::move(tailCall->arguments);
+            if (profiler != nullptr) profiler->replace(*functionDefinition);
+            continue;
+        }
+        if (returnValue.has_value())
+            return std::move(returnValue.value());
+        else
+            return Value(DynamicArray(0), 0);
+    }
 }
 
-static Value interpretRange(
-    const std::shared_ptr<FunctionCallNode>& functionCall,
-    std::weak_ptr<Scope> scope) {
-    if (functionCall->getParameters().size() != 1)
-        throw std::runtime_error(
-            "Function range expected 1 argument but received " +
-            functionCall->getParameters().size());
-    auto param1 = DynamicArray::fromValue(
-        interpretExpression(functionCall->getParameters()[0], scope));
-    if (param1.size != 1)
-        throw std::runtime_error(
-            "Function range expected 1 argument with size [1] but received [" +
-            std::to_string(param1.size) + "]");
-    int length = param1[0];
-    if (length < 0)
-        throw std::runtime_error(
-            "Function range expected 1 non-negative argument with size [1] but "
-            "received the value " +
-            std::string(param1));
-    DynamicArray result(static_cast<size_t>(length));
-    for (size_t i = 0; i < result.size; i++) result[i] = i;
-
-    return Value(result, result.size);
+// Only calls are looked up in a memo fn's cache; tail calls into one carry
+// on the call that made them, which keeps what they return.
+static Value callMemoized(const FunctionDefinitionNode& functionDefinition,
+                          SharedValues& arguments,
+                          const std::shared_ptr<Scope>& globals) {
+    MemoKey key;
+    for (auto& argument : arguments) key.add(*argument);
+    MemoCache& cache = memoCache(functionDefinition);
+    if (auto cached = cache.find(key)) return std::move(cached.value());
+    Value result = callFunction(&functionDefinition, arguments, globals);
+    cache.store(std::move(key), result);
+    return result;
 }
 
-static Value interpretExit(
-    const std::shared_ptr<FunctionCallNode>& functionCall,
-    std::weak_ptr<Scope> scope) {
-    if (functionCall->getParameters().size() != 1)
+// The arguments are evaluated here, before the task starts, and the call
+// runs with the globals as they are until it returns.
+static Value interpretSpawn(const FunctionCallNode& functionCall,
+                            std::weak_ptr<Scope> parent,
+                            const std::shared_ptr<Scope>& scope) {
+    auto& name = *spawnedName(functionCall);
+    if (!scope->hasRecursive(name))
+        throw std::runtime_error("Undefined function '" + name + "'");
+    auto definition = std::get_if<std::shared_ptr<FunctionDefinitionNode>>(
+        &scope->get(name));
+    if (definition == nullptr)
+        throw std::runtime_error(name + " must be defined as a function.");
+    auto& parameters = functionCall.getParameters();
+    size_t params = (*definition)->getParams().size();
+    if (params != parameters.size() - 1)
         throw std::runtime_error(
-            "Function range expected 1 argument but received " +
-            functionCall->getParameters().size());
-    auto param1 = DynamicArray::fromValue(
-        interpretExpression(functionCall->getParameters()[0], scope));
-    exit(param1[0]);
+            "Function " + name + " expected " + std::to_string(params) +
+            " argument(s) but received " +
+            std::to_string(parameters.size() - 1));
+    auto arguments = interpretParameters(
+        std::vector<std::shared_ptr<ExpressionNode>>(parameters.begin() + 1,
+                                                     parameters.end()),
+        parent);
+    auto globals = globalScope(scope);
+    return spawnTask([function = *definition,
+                      arguments = std::move(arguments), globals]() mutable {
+        if (function->isMemoized())
+            return callMemoized(*function, arguments, globals);
+        return callFunction(function.get(), arguments, globals);
+    });
 }
 
 static Value interpretFunctionCall(
     const std::shared_ptr<FunctionCallNode>& functionCall,
     std::weak_ptr<Scope> parent) {
     if (auto lockedParent = parent.lock()) {
-        if (lockedParent->hasRecursive(functionCall->getIdentifier())) {
-            if (auto& functionDefinition =
-                    *std::get_if<std::shared_ptr<FunctionDefinitionNode>>(
-                        &lockedParent->get(functionCall->getIdentifier()))) {
-                auto arguments =
-                    interpretParameters(functionCall->getParameters(), parent);
-                auto scope = std::make_shared<Scope>(parent);
-                auto& params = functionDefinition->getParams();
-                if (params.size() != arguments.size())
-                    throw std::runtime_error(
-                        "Function " + functionDefinition->getIdentifier() +
-                        " expected " + std::to_string(params.size()) +
-                        " argument(s) but received " +
-                        std::to_string(arguments.size()));
-                for (size_t i = 0; i < params.size(); i++) {
-                    auto& param = params[i];
-                    auto& argument = arguments[i];
-                    scope->define(param->getIdentifier(),
-                                  std::make_shared<Value>(Value::fromDescriptor(
-                                      param->getDescriptor(), *argument)));
-                }
-                std::optional<Value> returnValue =
-                    interpretBody(functionDefinition->getBody(), scope);
-                if (returnValue.has_value())
-                    return returnValue.value();
-                else
-                    return Value(DynamicArray(0), 0);
-            } else {
-                throw std::runtime_error(functionCall->getIdentifier() +
-                                         " must be defined as a function.");
-            }
-        } else if (functionCall->getIdentifier() == "print") {
-            return interpretPrint(functionCall, parent);
-        } else if (functionCall->getIdentifier() == "read") {
-            return interpretRead(functionCall, parent);
-        } else if (functionCall->getIdentifier() == "getchar") {
-            return interpretGetchar(functionCall, parent);
-        } else if (functionCall->getIdentifier() == "clear") {
-            return interpretClear(functionCall);
-        } else if (functionCall->getIdentifier() == "range") {
-            return interpretRange(functionCall, parent);
-        } else if (functionCall->getIdentifier() == "exit") {
-            return interpretExit(functionCall, parent);
+        if (auto functionDefinition =
+                userFunction(*functionCall, *lockedParent)) {
+            auto arguments =
+                interpretParameters(functionCall->getParameters(), parent);
+            auto globals = globalScope(lockedParent);
+            if (functionDefinition->isMemoized())
+                return callMemoized(*functionDefinition, arguments, globals);
+            return callFunction(functionDefinition, arguments, globals);
+        } else if (functionCall->getBuiltin() == BuiltinFunction::SPAWN) {
+            return interpretSpawn(*functionCall, parent, lockedParent);
+        } else if (auto& builtin = functionCall->getBuiltin()) {
+            auto arguments =
+                interpretArguments(functionCall->getParameters(), parent);
+            return callBuiltinFunction(builtin.value(), arguments);
         } else {
             throw std::runtime_error("Undefined function '" +
                                      functionCall->getIdentifier() + "'");
@@ -735,94 +1168,34 @@ static Value interpretFunctionCall(
     }
 }
 
-bool isGuiRunning() { return guiRunning.load(); }
-
-static void error_callback(int error, const char* description) {
-    std::cerr << "GLFW Error " << error << ": " << description << std::endl;
-}
-
-static void guiThreadFunction(std::shared_ptr<Scope> scope) {
-    glfwSetErrorCallback(error_callback);
-    if (!glfwInit()) return;
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-#if __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+void waitForGui() {
+#ifdef INTS_GRAPHICS
+    waitForWindow();
 #endif
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    auto window_size = DynamicArray::fromValue(
-        *std::get<std::shared_ptr<Value>>(scope->get("window_size")));
-    GLFWwindow* window = glfwCreateWindow(window_size[0], window_size[1],
-                                          "Dear ImGui Example", NULL, NULL);
-    if (!window) {
-        glfwTerminate();
-        return;
-    }
-
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
-
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO();
-    (void)io;
-
-    ImGui::StyleColorsDark();
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330");
-
-    guiRunning = true;
-
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-
-        ImGui::Begin("Window");
-        ImGui::Text("Hello from the GUI thread!");
-        ImGui::End();
-
-        ImGui::Render();
-        int display_w, display_h;
-        glfwGetFramebufferSize(window, &display_w, &display_h);
-        glViewport(0, 0, display_w, display_h);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-        glfwSwapBuffers(window);
-    }
-
-    // Cleanup
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
-    glfwDestroyWindow(window);
-    glfwTerminate();
-
-    guiRunning = false;
 }
 
-static void interpretGraphics(std::shared_ptr<Scope> scope) {
-    std::thread guiThread([scope]() { guiThreadFunction(scope); });
-    guiThread.detach();
-    while (!isGuiRunning())
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+static void interpretGraphics([[maybe_unused]] std::shared_ptr<Scope> scope) {
+#ifdef INTS_GRAPHICS
+    ArrayView size =
+        std::get<std::shared_ptr<Value>>(scope->get("window_size"))->view();
+    openWindow(size[0], size[1]);
+#else
+    throw std::runtime_error(
+        "This build of ints has no graphics support for use <graphics>");
+#endif
 }
 
-static void interpretFile(const std::string& filename,
+static void interpretFile(RootNode root, const std::string& filename,
                           std::shared_ptr<Scope> scope,
                           std::vector<std::string>& interpretedStandardHeaders,
-                          std::vector<std::string>& interpretedFiles);
+                          std::vector<std::string>& interpretedFiles,
+                          ModuleLoader& modules, Program* program);
 
 static void interpretUse(const std::shared_ptr<UseNode>& use,
                          std::shared_ptr<Scope> scope,
                          std::vector<std::string>& interpretedStandardHeaders,
-                         std::vector<std::string>& interpretedFiles) {
+                         std::vector<std::string>& interpretedFiles,
+                         ModuleLoader& modules, Program* program) {
     if (use->getType() == UseNode::Type::STANDARD_HEADER) {
         std::string headerName =
             valueToString(interpretArray(use->getValue(), scope));
@@ -835,7 +1208,7 @@ static void interpretUse(const std::shared_ptr<UseNode>& use,
             window_size[0] = 800;
             window_size[1] = 600;
             scope->define("window_size",
-                          std::make_shared<Value>(
+                          makePooled<Value>(
                               DynamicArray(std::move(window_size), 2), 2));
         } else {
             throw std::runtime_error("Unknown header file " + headerName);
@@ -846,24 +1219,22 @@ static void interpretUse(const std::shared_ptr<UseNode>& use,
         if (std::find(interpretedFiles.begin(), interpretedFiles.end(),
                       filename) == interpretedFiles.end()) {
             interpretedFiles.push_back(filename);
-            interpretFile(filename, scope, interpretedStandardHeaders,
-                          interpretedFiles);
+            interpretFile(modules.loadUsed(filename), filename, scope,
+                          interpretedStandardHeaders, interpretedFiles,
+                          modules, program);
         }
     }
 }
 
-static void interpretFile(const std::string& filename,
+static void interpretFile(RootNode root, const std::string& filename,
                           std::shared_ptr<Scope> scope,
                           std::vector<std::string>& interpretedStandardHeaders,
-                          std::vector<std::string>& interpretedFiles) {
-    const std::string code = readCode(filename);
-    auto tokens = tokenize(code);
-    auto root = RootNode::parse(tokens);
-
+                          std::vector<std::string>& interpretedFiles,
+                          ModuleLoader& modules, Program* program) {
     for (auto value : root.getValues()) {
         std::visit(
-            [&scope, &interpretedStandardHeaders,
-             &interpretedFiles](auto&& arg) {
+            [&scope, &interpretedStandardHeaders, &interpretedFiles, &modules,
+             program, &filename](auto&& arg) {
                 using T = std::decay_t<decltype(arg)>;
                 constexpr bool isVariableBinding =
                     std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
@@ -875,46 +1246,216 @@ static void interpretFile(const std::string& filename,
                     interpretVariableBinding(arg, scope);
                 } else if constexpr (isFunctionDef) {
                     interpretFunctionDefinition(arg, scope);
+                    if (program != nullptr) compileFunction(arg, *program);
+                    if (profiler != nullptr) profiler->define(*arg, filename);
                 } else if constexpr (isUse) {
                     interpretUse(arg, scope, interpretedStandardHeaders,
-                                 interpretedFiles);
+                                 interpretedFiles, modules, program);
                 }
             },
             value);
     }
 }
 
-void interpret(const std::string& filename, int argc,
-               std::vector<std::string> args) {
-    guiRunning = false;
-    auto scope = std::make_shared<Scope>();
-    std::vector<std::string> interpretedStandardHeaders, interpretedFiles;
-    interpretFile(filename, scope, interpretedStandardHeaders,
-                  interpretedFiles);
-    if (scope->has("main")) {
-        for (auto standardHeader : interpretedStandardHeaders) {
-            if (standardHeader == "graphics") {
-                interpretGraphics(scope);
-            }
-        }
+// The options every Script in the process shares, since the thread pool, the
+// GPU and the memo caches are shared too.
+struct SharedOptions {
+    size_t threads;
+    size_t parallelThreshold;
+    size_t gpuThreshold;
+    size_t memoLimit;
+
+    bool operator==(const SharedOptions& other) const {
+        return threads == other.threads &&
+               parallelThreshold == other.parallelThreshold &&
+               gpuThreshold == other.gpuThreshold &&
+               memoLimit == other.memoLimit;
+    }
+};
+
+// The first Script settles the shared options; a later one asking for
+// different ones is refused rather than changing them under the others.
+static void configureShared(const InterpretOptions& options) {
+    static std::mutex mutex;
+    static std::optional<SharedOptions> settled;
+    SharedOptions wanted{options.threads, options.parallelThreshold,
+                         options.gpuThreshold, options.memoLimit};
+    std::lock_guard<std::mutex> lock(mutex);
+    if (settled) {
+        if (*settled == wanted) return;
+        throw std::runtime_error(
+            "Script options conflict with an earlier Script's: threads, "
+            "parallelThreshold, gpuThreshold and memoLimit are shared by "
+            "the whole process");
+    }
+    configureParallelism(options.threads, options.parallelThreshold);
+    configureGpu(options.gpuThreshold);
+    setMemoLimit(options.memoLimit);
+    settled = wanted;
+}
 
-        std::vector<int> commandLineArgs;
-        for (std::string arg : args) {
-            commandLineArgs.push_back(arg.size());
-            for (char c : arg) commandLineArgs.push_back(c);
-        }
+// Settles the options the current context keeps, and those shared by the
+// whole process.
+static void configure(const InterpretOptions& options) {
+    configureShared(options);
+#ifdef INTS_GRAPHICS
+    static std::once_flag drawingRegistered;
+    std::call_once(drawingRegistered, registerDrawingBuiltins);
+#endif
+    Context& context = currentContext();
+    context.maxCallDepth = options.maxCallDepth;
+    context.moduleCache = options.moduleCache;
+    context.tiering = options.tiering;
+    setOutputBufferSize(options.outputBuffer);
+}
 
-        std::vector<std::shared_ptr<ExpressionNode>> mainArgs = {
-            std::make_shared<ExpressionNode>(std::vector<int>{argc}),
-            std::make_shared<ExpressionNode>(commandLineArgs)};
-
-        try {
-            interpretFunctionCall(std::make_shared<FunctionCallNode>(
-                                      std::string("main"), mainArgs),
-                                  scope);
-        } catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << '\n';
-            exit(1);
-        }
+static std::unique_ptr<Context> makeContext(const InterpretOptions& options) {
+    if (options.output) return std::make_unique<Context>(options.output);
+    return std::make_unique<Context>();
+}
+
+Script::Script(const std::string& filename, const InterpretOptions& options)
+    : context(makeContext(options)), scope(std::make_shared<Scope>()) {
+    ContextGuard guard(context.get());
+    configure(options);
+    if (options.engine == Engine::VM) program = std::make_unique<Program>();
+    ModuleLoader modules(context->moduleCache);
+    interpretFile(modules.loadMain(filename), filename, scope, standardHeaders,
+                  files, modules, program.get());
+    if (program) {
+        program->link();
+        vm = std::make_unique<VirtualMachine>(
+            *program, scope,
+            options.maxCallDepth != 0 ? options.maxCallDepth
+                                      : VirtualMachine::DEFAULT_MAX_DEPTH);
+    }
+    auto& variables = scope->getVariables();
+    loaded.assign(variables.begin(), variables.end());
+}
+
+Script::~Script() = default;
+
+bool Script::has(const std::string& function) const {
+    return scope->has(function) &&
+           std::holds_alternative<std::shared_ptr<FunctionDefinitionNode>>(
+               scope->get(function));
+}
+
+bool Script::uses(const std::string& standardHeader) const {
+    return std::find(standardHeaders.begin(), standardHeaders.end(),
+                     standardHeader) != standardHeaders.end();
+}
+
+const std::vector<std::string>& Script::getFiles() const { return files; }
+
+// What a call printed is written out by the time it returns or throws, and
+// the tasks it spawned and never awaited have finished; the first of them to
+// fail fails the call.
+Value Script::call(const std::string& function, std::vector<Value> arguments) {
+    ContextGuard guard(context.get());
+    try {
+        Value result = run(function, std::move(arguments));
+        finishTasks();
+        flushOutput();
+        return result;
+    } catch (...) {
+        abandonTasks();
+        flushOutput();
+        throw;
+    }
+}
+
+Value Script::run(const std::string& function, std::vector<Value> arguments) {
+    if (vm) return vm->call(function, std::move(arguments));
+    if (!has(function))
+        throw std::runtime_error("Undefined function '" + function + "'");
+    auto& definition =
+        std::get<std::shared_ptr<FunctionDefinitionNode>>(scope->get(function));
+    SharedValues shared;
+    shared.reserve(arguments.size());
+    for (auto& argument : arguments)
+        shared.push_back(makePooled<Value>(std::move(argument)));
+    if (definition->isMemoized())
+        return callMemoized(*definition, shared, scope);
+    return callFunction(definition.get(), shared, scope);
+}
+
+std::vector<int> Script::callInts(const std::string& function,
+                                  const std::vector<ArrayView>& arguments) {
+    std::vector<Value> values;
+    values.reserve(arguments.size());
+    for (ArrayView argument : arguments)
+        values.emplace_back(DynamicArray::copyOf(argument, true), 0);
+    ArrayView result = call(function, std::move(values)).view();
+    return std::vector<int>(result.begin(), result.end());
+}
+
+// Ends the run the way the command line does: the profile is written and
+// the process exits with `code`.
+static void finish(int code) {
+    profiler = nullptr;
+    activeProfiler.reset();
+    exit(code);
+}
+
+// Each argument is its length followed by its characters. Both values are
+// moved through to main's parameters, so the arguments are written once and
+// never copied, however many there are.
+void Script::callMain(const std::vector<std::string>& args) {
+    if (!has("main")) return;
+    size_t size = 0;
+    for (const std::string& arg : args) size += 1 + arg.size();
+    DynamicArray commandLineArgs = DynamicArray::uninitialized(size);
+    commandLineArgs.canGrow = true;
+    int* out = commandLineArgs.data;
+    for (const std::string& arg : args) {
+        *out++ = static_cast<int>(arg.size());
+        out = std::copy(arg.begin(), arg.end(), out);
+    }
+    int argc = static_cast<int>(args.size());
+    // Not a braced list, whose elements could only be copied out of it.
+    std::vector<Value> arguments;
+    arguments.reserve(2);
+    arguments.emplace_back(DynamicArray::copyOf({&argc, 1}, true), 1);
+    arguments.emplace_back(std::move(commandLineArgs), size);
+    call("main", std::move(arguments));
+}
+
+// Globals are only ever rebound, never changed in place, so the values
+// loading bound are still intact. Names rebound to what they already hold
+// are left alone, which keeps the functions call sites have cached.
+void Script::reset() {
+    for (auto& [name, value] : loaded)
+        if (scope->get(name) != value) scope->set(name, value);
+}
+
+void interpret(const std::string& filename, std::vector<std::string> args,
+               const InterpretOptions& options) {
+    if (!options.profile.empty()) {
+        activeProfiler = std::make_unique<Profiler>(options.profile);
+        profiler = activeProfiler.get();
+    }
+    // Shape errors are found while loading, so they are reported like the
+    // ones main runs into.
+    std::unique_ptr<Script> script;
+    try {
+        script = std::make_unique<Script>(filename, options);
+    } catch (const ScriptExit& scriptExit) {
+        finish(scriptExit.code());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        finish(1);
+    }
+    try {
+        if (script->uses("graphics") && script->has("main"))
+            interpretGraphics(script->scope);
+        script->callMain(args);
+    } catch (const ScriptExit& scriptExit) {
+        finish(scriptExit.code());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        finish(1);
     }
+    profiler = nullptr;
+    activeProfiler.reset();
 }
@@ -0,0 +1,757 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/kernels.h"
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "runtime/parallel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INTS_KERNELS_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define INTS_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using ArithmeticFunction = void (*)(ArithmeticKernel, const int*, const int*,
+                                    int*, size_t);
+using CompareFunction = bool (*)(CompareKernel, const int*, const int*,
+                                 size_t);
+using ReductionFunction = int (*)(ReductionKernel, const int*, size_t);
+using FindFunction = size_t (*)(const int*, size_t, int);
+
+struct Kernels {
+    ArithmeticFunction arithmetic;
+    ArithmeticFunction scalarLeft;
+    ArithmeticFunction scalarRight;
+    CompareFunction compare;
+    ReductionFunction reduction;
+    FindFunction find;
+    const char* instructionSet;
+};
+
+// A broadcast operand is a single element applied across the whole buffer.
+template <bool broadcast>
+inline int element(const int* operand, size_t i) {
+    return broadcast ? operand[0] : operand[i];
+}
+
+template <bool broadcast>
+inline const int* advance(const int* operand, size_t i) {
+    return broadcast ? operand : operand + i;
+}
+
+template <bool broadcastLeft, bool broadcastRight, typename Operation>
+void scalarLoop(const int* left, const int* right, int* out, size_t size,
+                Operation operation) {
+    for (size_t i = 0; i < size; i++)
+        out[i] = operation(element<broadcastLeft>(left, i),
+                           element<broadcastRight>(right, i));
+}
+
+template <bool broadcastLeft, bool broadcastRight>
+void scalarArithmetic(ArithmeticKernel kernel, const int* left,
+                      const int* right, int* out, size_t size) {
+    switch (kernel) {
+        case ArithmeticKernel::ADD:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, std::plus<int>());
+        case ArithmeticKernel::SUB:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, std::minus<int>());
+        case ArithmeticKernel::MUL:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, std::multiplies<int>());
+        case ArithmeticKernel::DIV:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, Divide());
+        case ArithmeticKernel::MOD:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, Remainder());
+        case ArithmeticKernel::AND:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, std::bit_and<int>());
+        case ArithmeticKernel::OR:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, std::bit_or<int>());
+        case ArithmeticKernel::XOR:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, std::bit_xor<int>());
+        case ArithmeticKernel::SHL:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, ShiftLeft());
+        case ArithmeticKernel::SHR:
+            return scalarLoop<broadcastLeft, broadcastRight>(
+                left, right, out, size, ShiftRight());
+    }
+}
+
+bool scalarCompare(CompareKernel kernel, const int* left, const int* right,
+                   size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        bool holds = false;
+        switch (kernel) {
+            case CompareKernel::EQ:
+                holds = left[i] == right[i];
+                break;
+            case CompareKernel::NE:
+                holds = left[i] != right[i];
+                break;
+            case CompareKernel::LT:
+                holds = left[i] < right[i];
+                break;
+            case CompareKernel::LE:
+                holds = left[i] <= right[i];
+                break;
+            case CompareKernel::GT:
+                holds = left[i] > right[i];
+                break;
+            case CompareKernel::GE:
+                holds = left[i] >= right[i];
+                break;
+        }
+        if (!holds) return false;
+    }
+    return true;
+}
+
+int reductionIdentity(ReductionKernel kernel) {
+    switch (kernel) {
+        case ReductionKernel::SUM:
+            return 0;
+        case ReductionKernel::MIN:
+            return std::numeric_limits<int>::max();
+        case ReductionKernel::MAX:
+            return std::numeric_limits<int>::min();
+        case ReductionKernel::PRODUCT:
+            return 1;
+    }
+    return 0;
+}
+
+// Sums and products go through unsigned ints so that they wrap instead of
+// overflowing.
+int combine(ReductionKernel kernel, int left, int right) {
+    switch (kernel) {
+        case ReductionKernel::SUM:
+            return static_cast<int>(static_cast<unsigned>(left) +
+                                    static_cast<unsigned>(right));
+        case ReductionKernel::MIN:
+            return left < right ? left : right;
+        case ReductionKernel::MAX:
+            return left > right ? left : right;
+        case ReductionKernel::PRODUCT:
+            return static_cast<int>(static_cast<unsigned>(left) *
+                                    static_cast<unsigned>(right));
+    }
+    return left;
+}
+
+int scalarReduction(ReductionKernel kernel, const int* data, size_t size) {
+    int result = reductionIdentity(kernel);
+    for (size_t i = 0; i < size; i++) result = combine(kernel, result, data[i]);
+    return result;
+}
+
+// Folds the lanes of a vector accumulator together with the scalar tail.
+int finishReduction(ReductionKernel kernel, const int* lanes, size_t count,
+                    const int* tail, size_t tailSize) {
+    int result = scalarReduction(kernel, tail, tailSize);
+    for (size_t i = 0; i < count; i++)
+        result = combine(kernel, result, lanes[i]);
+    return result;
+}
+
+size_t scalarFind(const int* data, size_t size, int value) {
+    for (size_t i = 0; i < size; i++)
+        if (data[i] == value) return i;
+    return size;
+}
+
+#ifdef INTS_KERNELS_X86
+
+// Integer division goes through doubles, which represent every int quotient
+// exactly, and a remainder is what the quotient leaves. Blocks containing a
+// zero or -1 divisor take the scalar path so that they throw or wrap
+// exactly as the scalar loop does.
+
+__attribute__((target("avx2"))) __m256i divideAvx2(__m256i left,
+                                                   __m256i right) {
+    __m256d leftLow = _mm256_cvtepi32_pd(_mm256_castsi256_si128(left));
+    __m256d leftHigh = _mm256_cvtepi32_pd(_mm256_extracti128_si256(left, 1));
+    __m256d rightLow = _mm256_cvtepi32_pd(_mm256_castsi256_si128(right));
+    __m256d rightHigh =
+        _mm256_cvtepi32_pd(_mm256_extracti128_si256(right, 1));
+    __m128i low = _mm256_cvttpd_epi32(_mm256_div_pd(leftLow, rightLow));
+    __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(leftHigh, rightHigh));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+// A broadcast operand is splatted into a register once, outside the loop.
+template <bool broadcastLeft, bool broadcastRight>
+__attribute__((target("avx2"))) void avx2Arithmetic(ArithmeticKernel kernel,
+                                                    const int* left,
+                                                    const int* right, int* out,
+                                                    size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i shiftMask = _mm256_set1_epi32(31);
+    const __m256i fixedLeft = _mm256_set1_epi32(broadcastLeft ? *left : 0);
+    const __m256i fixedRight = _mm256_set1_epi32(broadcastRight ? *right : 0);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i a = broadcastLeft ? fixedLeft
+                                  : _mm256_loadu_si256(
+                                        reinterpret_cast<const __m256i*>(
+                                            left + i));
+        __m256i b = broadcastRight ? fixedRight
+                                   : _mm256_loadu_si256(
+                                         reinterpret_cast<const __m256i*>(
+                                             right + i));
+        __m256i result = zero;
+        switch (kernel) {
+            case ArithmeticKernel::ADD:
+                result = _mm256_add_epi32(a, b);
+                break;
+            case ArithmeticKernel::SUB:
+                result = _mm256_sub_epi32(a, b);
+                break;
+            case ArithmeticKernel::MUL:
+                result = _mm256_mullo_epi32(a, b);
+                break;
+            case ArithmeticKernel::DIV:
+            case ArithmeticKernel::MOD: {
+                __m256i unsafe =
+                    _mm256_or_si256(_mm256_cmpeq_epi32(b, zero),
+                                    _mm256_cmpeq_epi32(b, minusOne));
+                if (!_mm256_testz_si256(unsafe, unsafe)) {
+                    scalarArithmetic<broadcastLeft, broadcastRight>(
+                        kernel, advance<broadcastLeft>(left, i),
+                        advance<broadcastRight>(right, i), out + i, 8);
+                    continue;
+                }
+                result = divideAvx2(a, b);
+                if (kernel == ArithmeticKernel::MOD)
+                    result = _mm256_sub_epi32(a, _mm256_mullo_epi32(result, b));
+                break;
+            }
+            case ArithmeticKernel::AND:
+                result = _mm256_and_si256(a, b);
+                break;
+            case ArithmeticKernel::OR:
+                result = _mm256_or_si256(a, b);
+                break;
+            case ArithmeticKernel::XOR:
+                result = _mm256_xor_si256(a, b);
+                break;
+            case ArithmeticKernel::SHL:
+                result = _mm256_sllv_epi32(a, _mm256_and_si256(b, shiftMask));
+                break;
+            case ArithmeticKernel::SHR:
+                result = _mm256_srav_epi32(a, _mm256_and_si256(b, shiftMask));
+                break;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), result);
+    }
+    scalarArithmetic<broadcastLeft, broadcastRight>(
+        kernel, advance<broadcastLeft>(left, i),
+        advance<broadcastRight>(right, i), out + i, size - i);
+}
+
+__attribute__((target("avx2"))) bool avx2Compare(CompareKernel kernel,
+                                                 const int* left,
+                                                 const int* right,
+                                                 size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i a =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        __m256i b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i));
+        int mask = 0;
+        bool expectAll = true;
+        switch (kernel) {
+            case CompareKernel::EQ:
+                mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b));
+                break;
+            case CompareKernel::NE:
+                mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b));
+                expectAll = false;
+                break;
+            case CompareKernel::LT:
+                mask = _mm256_movemask_epi8(_mm256_cmpgt_epi32(b, a));
+                break;
+            case CompareKernel::LE:
+                mask = _mm256_movemask_epi8(_mm256_cmpgt_epi32(a, b));
+                expectAll = false;
+                break;
+            case CompareKernel::GT:
+                mask = _mm256_movemask_epi8(_mm256_cmpgt_epi32(a, b));
+                break;
+            case CompareKernel::GE:
+                mask = _mm256_movemask_epi8(_mm256_cmpgt_epi32(b, a));
+                expectAll = false;
+                break;
+        }
+        if (mask != (expectAll ? -1 : 0)) return false;
+    }
+    return scalarCompare(kernel, left + i, right + i, size - i);
+}
+
+__attribute__((target("avx2"))) int avx2Reduction(ReductionKernel kernel,
+                                                  const int* data,
+                                                  size_t size) {
+    __m256i accumulator = _mm256_set1_epi32(reductionIdentity(kernel));
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        switch (kernel) {
+            case ReductionKernel::SUM:
+                accumulator = _mm256_add_epi32(accumulator, block);
+                break;
+            case ReductionKernel::MIN:
+                accumulator = _mm256_min_epi32(accumulator, block);
+                break;
+            case ReductionKernel::MAX:
+                accumulator = _mm256_max_epi32(accumulator, block);
+                break;
+            case ReductionKernel::PRODUCT:
+                accumulator = _mm256_mullo_epi32(accumulator, block);
+                break;
+        }
+    }
+    int lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), accumulator);
+    return finishReduction(kernel, lanes, 8, data + i, size - i);
+}
+
+__attribute__((target("avx2"))) size_t avx2Find(const int* data,
+                                                 size_t size, int value) {
+    const __m256i needle = _mm256_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        int mask = _mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpeq_epi32(block, needle)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return i + scalarFind(data + i, size - i, value);
+}
+
+__attribute__((target("sse4.1"))) __m128i divideSse4(__m128i left,
+                                                     __m128i right) {
+    __m128d leftLow = _mm_cvtepi32_pd(left);
+    __m128d leftHigh = _mm_cvtepi32_pd(_mm_unpackhi_epi64(left, left));
+    __m128d rightLow = _mm_cvtepi32_pd(right);
+    __m128d rightHigh = _mm_cvtepi32_pd(_mm_unpackhi_epi64(right, right));
+    __m128i low = _mm_cvttpd_epi32(_mm_div_pd(leftLow, rightLow));
+    __m128i high = _mm_cvttpd_epi32(_mm_div_pd(leftHigh, rightHigh));
+    return _mm_unpacklo_epi64(low, high);
+}
+
+template <bool broadcastLeft, bool broadcastRight>
+__attribute__((target("sse4.1"))) void sse4Arithmetic(ArithmeticKernel kernel,
+                                                      const int* left,
+                                                      const int* right,
+                                                      int* out, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i shiftCount =
+        _mm_cvtsi32_si128(broadcastRight ? *right & 31 : 0);
+    const __m128i fixedLeft = _mm_set1_epi32(broadcastLeft ? *left : 0);
+    const __m128i fixedRight = _mm_set1_epi32(broadcastRight ? *right : 0);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i a = broadcastLeft ? fixedLeft
+                                  : _mm_loadu_si128(
+                                        reinterpret_cast<const __m128i*>(
+                                            left + i));
+        __m128i b = broadcastRight ? fixedRight
+                                   : _mm_loadu_si128(
+                                         reinterpret_cast<const __m128i*>(
+                                             right + i));
+        __m128i result = zero;
+        switch (kernel) {
+            case ArithmeticKernel::ADD:
+                result = _mm_add_epi32(a, b);
+                break;
+            case ArithmeticKernel::SUB:
+                result = _mm_sub_epi32(a, b);
+                break;
+            case ArithmeticKernel::MUL:
+                result = _mm_mullo_epi32(a, b);
+                break;
+            case ArithmeticKernel::DIV:
+            case ArithmeticKernel::MOD: {
+                __m128i unsafe = _mm_or_si128(_mm_cmpeq_epi32(b, zero),
+                                              _mm_cmpeq_epi32(b, minusOne));
+                if (!_mm_testz_si128(unsafe, unsafe)) {
+                    scalarArithmetic<broadcastLeft, broadcastRight>(
+                        kernel, advance<broadcastLeft>(left, i),
+                        advance<broadcastRight>(right, i), out + i, 4);
+                    continue;
+                }
+                result = divideSse4(a, b);
+                if (kernel == ArithmeticKernel::MOD)
+                    result = _mm_sub_epi32(a, _mm_mullo_epi32(result, b));
+                break;
+            }
+            case ArithmeticKernel::AND:
+                result = _mm_and_si128(a, b);
+                break;
+            case ArithmeticKernel::OR:
+                result = _mm_or_si128(a, b);
+                break;
+            case ArithmeticKernel::XOR:
+                result = _mm_xor_si128(a, b);
+                break;
+            // SSE only shifts every lane by the same count.
+            case ArithmeticKernel::SHL:
+            case ArithmeticKernel::SHR:
+                if (!broadcastRight) {
+                    scalarArithmetic<broadcastLeft, false>(
+                        kernel, advance<broadcastLeft>(left, i), right + i,
+                        out + i, 4);
+                    continue;
+                }
+                result = kernel == ArithmeticKernel::SHL
+                             ? _mm_sll_epi32(a, shiftCount)
+                             : _mm_sra_epi32(a, shiftCount);
+                break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), result);
+    }
+    scalarArithmetic<broadcastLeft, broadcastRight>(
+        kernel, advance<broadcastLeft>(left, i),
+        advance<broadcastRight>(right, i), out + i, size - i);
+}
+
+__attribute__((target("sse4.1"))) bool sse4Compare(CompareKernel kernel,
+                                                   const int* left,
+                                                   const int* right,
+                                                   size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i b =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        int mask = 0;
+        bool expectAll = true;
+        switch (kernel) {
+            case CompareKernel::EQ:
+                mask = _mm_movemask_epi8(_mm_cmpeq_epi32(a, b));
+                break;
+            case CompareKernel::NE:
+                mask = _mm_movemask_epi8(_mm_cmpeq_epi32(a, b));
+                expectAll = false;
+                break;
+            case CompareKernel::LT:
+                mask = _mm_movemask_epi8(_mm_cmpgt_epi32(b, a));
+                break;
+            case CompareKernel::LE:
+                mask = _mm_movemask_epi8(_mm_cmpgt_epi32(a, b));
+                expectAll = false;
+                break;
+            case CompareKernel::GT:
+                mask = _mm_movemask_epi8(_mm_cmpgt_epi32(a, b));
+                break;
+            case CompareKernel::GE:
+                mask = _mm_movemask_epi8(_mm_cmpgt_epi32(b, a));
+                expectAll = false;
+                break;
+        }
+        if (mask != (expectAll ? 0xFFFF : 0)) return false;
+    }
+    return scalarCompare(kernel, left + i, right + i, size - i);
+}
+
+__attribute__((target("sse4.1"))) int sse4Reduction(ReductionKernel kernel,
+                                                    const int* data,
+                                                    size_t size) {
+    __m128i accumulator = _mm_set1_epi32(reductionIdentity(kernel));
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        switch (kernel) {
+            case ReductionKernel::SUM:
+                accumulator = _mm_add_epi32(accumulator, block);
+                break;
+            case ReductionKernel::MIN:
+                accumulator = _mm_min_epi32(accumulator, block);
+                break;
+            case ReductionKernel::MAX:
+                accumulator = _mm_max_epi32(accumulator, block);
+                break;
+            case ReductionKernel::PRODUCT:
+                accumulator = _mm_mullo_epi32(accumulator, block);
+                break;
+        }
+    }
+    int lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), accumulator);
+    return finishReduction(kernel, lanes, 4, data + i, size - i);
+}
+
+__attribute__((target("sse4.1"))) size_t sse4Find(const int* data,
+                                                   size_t size, int value) {
+    const __m128i needle = _mm_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_ps(
+            _mm_castsi128_ps(_mm_cmpeq_epi32(block, needle)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return i + scalarFind(data + i, size - i, value);
+}
+
+#endif  // INTS_KERNELS_X86
+
+#ifdef INTS_KERNELS_NEON
+
+// NEON has no integer division, so DIV and MOD stay on the scalar loop.
+template <bool broadcastLeft, bool broadcastRight>
+void neonArithmetic(ArithmeticKernel kernel, const int* left, const int* right,
+                    int* out, size_t size) {
+    if (kernel == ArithmeticKernel::DIV || kernel == ArithmeticKernel::MOD)
+        return scalarArithmetic<broadcastLeft, broadcastRight>(
+            kernel, left, right, out, size);
+    const int32x4_t fixedLeft = vdupq_n_s32(broadcastLeft ? *left : 0);
+    const int32x4_t fixedRight = vdupq_n_s32(broadcastRight ? *right : 0);
+    const int32x4_t shiftMask = vdupq_n_s32(31);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        int32x4_t a = broadcastLeft ? fixedLeft : vld1q_s32(left + i);
+        int32x4_t b = broadcastRight ? fixedRight : vld1q_s32(right + i);
+        int32x4_t result;
+        switch (kernel) {
+            case ArithmeticKernel::ADD:
+                result = vaddq_s32(a, b);
+                break;
+            case ArithmeticKernel::SUB:
+                result = vsubq_s32(a, b);
+                break;
+            case ArithmeticKernel::AND:
+                result = vandq_s32(a, b);
+                break;
+            case ArithmeticKernel::OR:
+                result = vorrq_s32(a, b);
+                break;
+            case ArithmeticKernel::XOR:
+                result = veorq_s32(a, b);
+                break;
+            // A negative count shifts a signed lane right, keeping its sign.
+            case ArithmeticKernel::SHL:
+                result = vshlq_s32(a, vandq_s32(b, shiftMask));
+                break;
+            case ArithmeticKernel::SHR:
+                result = vshlq_s32(a, vnegq_s32(vandq_s32(b, shiftMask)));
+                break;
+            default:
+                result = vmulq_s32(a, b);
+                break;
+        }
+        vst1q_s32(out + i, result);
+    }
+    scalarArithmetic<broadcastLeft, broadcastRight>(
+        kernel, advance<broadcastLeft>(left, i),
+        advance<broadcastRight>(right, i), out + i, size - i);
+}
+
+bool neonCompare(CompareKernel kernel, const int* left, const int* right,
+                 size_t size) {
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        int32x4_t a = vld1q_s32(left + i);
+        int32x4_t b = vld1q_s32(right + i);
+        uint32x4_t holds = vdupq_n_u32(0);
+        switch (kernel) {
+            case CompareKernel::EQ:
+                holds = vceqq_s32(a, b);
+                break;
+            case CompareKernel::NE:
+                holds = vmvnq_u32(vceqq_s32(a, b));
+                break;
+            case CompareKernel::LT:
+                holds = vcltq_s32(a, b);
+                break;
+            case CompareKernel::LE:
+                holds = vcleq_s32(a, b);
+                break;
+            case CompareKernel::GT:
+                holds = vcgtq_s32(a, b);
+                break;
+            case CompareKernel::GE:
+                holds = vcgeq_s32(a, b);
+                break;
+        }
+        if (vminvq_u32(holds) == 0) return false;
+    }
+    return scalarCompare(kernel, left + i, right + i, size - i);
+}
+
+int neonReduction(ReductionKernel kernel, const int* data, size_t size) {
+    int32x4_t accumulator = vdupq_n_s32(reductionIdentity(kernel));
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        int32x4_t block = vld1q_s32(data + i);
+        switch (kernel) {
+            case ReductionKernel::SUM:
+                accumulator = vaddq_s32(accumulator, block);
+                break;
+            case ReductionKernel::MIN:
+                accumulator = vminq_s32(accumulator, block);
+                break;
+            case ReductionKernel::MAX:
+                accumulator = vmaxq_s32(accumulator, block);
+                break;
+            case ReductionKernel::PRODUCT:
+                accumulator = vmulq_s32(accumulator, block);
+                break;
+        }
+    }
+    int lanes[4];
+    vst1q_s32(lanes, accumulator);
+    return finishReduction(kernel, lanes, 4, data + i, size - i);
+}
+
+size_t neonFind(const int* data, size_t size, int value) {
+    const int32x4_t needle = vdupq_n_s32(value);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        if (vmaxvq_u32(vceqq_s32(vld1q_s32(data + i), needle)) != 0)
+            return i + scalarFind(data + i, 4, value);
+    }
+    return i + scalarFind(data + i, size - i, value);
+}
+
+#endif  // INTS_KERNELS_NEON
+
+Kernels selectKernels() {
+#if defined(INTS_KERNELS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Kernels{avx2Arithmetic<false, false>,
+                       avx2Arithmetic<true, false>,
+                       avx2Arithmetic<false, true>, avx2Compare,
+                       avx2Reduction, avx2Find, "avx2"};
+    if (__builtin_cpu_supports("sse4.1"))
+        return Kernels{sse4Arithmetic<false, false>,
+                       sse4Arithmetic<true, false>,
+                       sse4Arithmetic<false, true>, sse4Compare,
+                       sse4Reduction, sse4Find, "sse4.1"};
+#elif defined(INTS_KERNELS_NEON)
+    return Kernels{neonArithmetic<false, false>,
+                   neonArithmetic<true, false>,
+                   neonArithmetic<false, true>, neonCompare,
+                   neonReduction, neonFind, "neon"};
+#endif
+    return Kernels{scalarArithmetic<false, false>,
+                   scalarArithmetic<true, false>,
+                   scalarArithmetic<false, true>, scalarCompare,
+                   scalarReduction, scalarFind, "scalar"};
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+}  // namespace
+
+void divisionByZero() { throw std::runtime_error("Division by zero"); }
+
+// Large arrays are split across the thread pool; each chunk runs the same
+// vector loop on its own part of the buffers.
+void applyArithmetic(ArithmeticKernel kernel, const int* left,
+                     const int* right, int* out, size_t size) {
+    ArithmeticFunction arithmetic = kernels().arithmetic;
+    parallelFor(size, [=](size_t begin, size_t end) {
+        arithmetic(kernel, left + begin, right + begin, out + begin,
+                   end - begin);
+    });
+}
+
+void applyArithmeticScalarLeft(ArithmeticKernel kernel, int left,
+                               const int* right, int* out, size_t size) {
+    ArithmeticFunction arithmetic = kernels().scalarLeft;
+    parallelFor(size, [=](size_t begin, size_t end) {
+        arithmetic(kernel, &left, right + begin, out + begin, end - begin);
+    });
+}
+
+void applyArithmeticScalarRight(ArithmeticKernel kernel, const int* left,
+                                int right, int* out, size_t size) {
+    ArithmeticFunction arithmetic = kernels().scalarRight;
+    parallelFor(size, [=](size_t begin, size_t end) {
+        arithmetic(kernel, left + begin, &right, out + begin, end - begin);
+    });
+}
+
+int applyReduction(ReductionKernel kernel, const int* data, size_t size) {
+    ReductionFunction reduction = kernels().reduction;
+    if (size < parallelThreshold()) return reduction(kernel, data, size);
+    std::mutex mutex;
+    int result = reductionIdentity(kernel);
+    parallelFor(size, [&](size_t begin, size_t end) {
+        int partial = reduction(kernel, data + begin, end - begin);
+        std::lock_guard<std::mutex> lock(mutex);
+        result = combine(kernel, result, partial);
+    });
+    return result;
+}
+
+bool compareAll(CompareKernel kernel, const int* left, const int* right,
+                size_t size) {
+    return kernels().compare(kernel, left, right, size);
+}
+
+size_t findFirst(const int* data, size_t size, int value) {
+    return kernels().find(data, size, value);
+}
+
+const char* kernelInstructionSet() { return kernels().instructionSet; }
+
+const char* arithmeticVerb(ArithmeticKernel kernel) {
+    switch (kernel) {
+        case ArithmeticKernel::ADD:
+            return "add";
+        case ArithmeticKernel::SUB:
+            return "subtract";
+        case ArithmeticKernel::MUL:
+            return "multiply";
+        case ArithmeticKernel::DIV:
+            return "divide";
+        case ArithmeticKernel::MOD:
+            return "take the remainder of";
+        case ArithmeticKernel::AND:
+            return "bitwise-and";
+        case ArithmeticKernel::OR:
+            return "bitwise-or";
+        case ArithmeticKernel::XOR:
+            return "bitwise-xor";
+        case ArithmeticKernel::SHL:
+        case ArithmeticKernel::SHR:
+            return "shift";
+    }
+    return "combine";
+}
+
+size_t broadcastSize(ArithmeticKernel kernel, size_t left, size_t right) {
+    if (left == right || right == 1) return left;
+    if (left == 1) return right;
+    throw std::runtime_error(std::string("Cannot ") + arithmeticVerb(kernel) +
+                             " arrays with different sizes");
+}
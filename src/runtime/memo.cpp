@@ -0,0 +1,65 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/memo.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "runtime/stats.h"
+
+static constexpr size_t DEFAULT_MEMO_LIMIT = 1 << 16;
+static std::atomic<size_t> limit{DEFAULT_MEMO_LIMIT};
+
+void MemoKey::add(const Value& argument) {
+    ArrayView view = argument.view();
+    elements.reserve(elements.size() + 1 + view.size);
+    elements.push_back(static_cast<int>(view.size));
+    elements.insert(elements.end(), view.begin(), view.end());
+    // FNV-1a over whole elements.
+    auto mix = [this](unsigned value) {
+        hashed = (hashed ^ value) * 1099511628211ull;
+    };
+    mix(static_cast<unsigned>(view.size));
+    for (int element : view) mix(static_cast<unsigned>(element));
+}
+
+std::optional<Value> MemoCache::find(const MemoKey& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(&key);
+    countMemoLookup(found != index.end());
+    if (found == index.end()) return std::nullopt;
+    entries.splice(entries.begin(), entries, found->second);
+    return found->second->second;
+}
+
+void MemoCache::store(MemoKey key, const Value& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Another thread may have made the same call in the meantime.
+    if (auto found = index.find(&key); found != index.end()) {
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+    size_t capacity = memoLimit();
+    while (!entries.empty() && entries.size() >= capacity) {
+        index.erase(&entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(std::move(key), result);
+    index.emplace(&entries.front().first, entries.begin());
+}
+
+MemoCache& memoCache(const FunctionDefinitionNode& function) {
+    MemoState& state = function.getMemo();
+    std::call_once(state.created,
+                   [&state]() { state.cache = std::make_shared<MemoCache>(); });
+    return *state.cache;
+}
+
+void setMemoLimit(size_t entries) {
+    limit.store(entries == 0 ? DEFAULT_MEMO_LIMIT : entries,
+                std::memory_order_relaxed);
+}
+
+size_t memoLimit() { return limit.load(std::memory_order_relaxed); }
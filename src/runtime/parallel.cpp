@@ -0,0 +1,273 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "runtime/context.h"
+
+struct ThreadPool::Loop {
+    const Body* body;
+    // A spawned job's body, which `body` points at.
+    Body owned;
+    // The caller's, so that what the chunks print goes where its does.
+    Context* context;
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining;
+    std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(size_t threads) {
+    size_t count = threads > 1 ? threads - 1 : 0;
+    for (size_t i = 0; i < count; i++)
+        workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < count; i++)
+        this->threads.emplace_back([this, i] { work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) thread.join();
+    std::lock_guard<std::mutex> lock(sparesMutex);
+    for (auto& spare : spares) spare->thread.join();
+}
+
+size_t ThreadPool::size() const { return workers.size() + 1; }
+
+// Takes a chunk from worker `first`'s back, or failing that steals one from
+// the front of another worker's deque, and runs it.
+bool ThreadPool::runOne(size_t first) {
+    std::optional<Chunk> chunk;
+    for (size_t i = 0; i < workers.size() && !chunk; i++) {
+        size_t index = (first + i) % workers.size();
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.chunks.empty()) continue;
+        if (i == 0) {
+            chunk = worker.chunks.back();
+            worker.chunks.pop_back();
+        } else {
+            chunk = worker.chunks.front();
+            worker.chunks.pop_front();
+        }
+    }
+    if (!chunk) return false;
+    queued--;
+    run(*chunk);
+    return true;
+}
+
+void ThreadPool::run(const Chunk& chunk) {
+    Loop& loop = *chunk.loop;
+    std::exception_ptr error;
+    try {
+        ContextGuard context(loop.context);
+        (*loop.body)(chunk.begin, chunk.end);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    // The loop lives on its caller's stack, so it may be gone as soon as the
+    // lock is released after the last chunk.
+    std::lock_guard<std::mutex> lock(loop.mutex);
+    if (error && !loop.error) loop.error = error;
+    if (--loop.remaining == 0) loop.finished.notify_all();
+}
+
+ThreadPool::Job ThreadPool::spawn(std::function<void()> body) {
+    auto job = std::make_shared<Loop>();
+    job->owned = [body = std::move(body)](size_t, size_t) { body(); };
+    job->body = &job->owned;
+    job->context = ContextGuard::current();
+    job->remaining = 1;
+    // Without workers, the job gets a thread of its own, as it may not end
+    // until the caller has gone on to do something else.
+    if (workers.empty()) {
+        startSpare(Chunk{job.get(), 0, 1, job});
+        return job;
+    }
+    // Counted before it is published, so that a thread taking it at once
+    // never brings the count below zero.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued++;
+    }
+    Worker& worker = *workers[nextWorker++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.chunks.push_back(Chunk{job.get(), 0, 1, job});
+    }
+    wake.notify_one();
+    progressed();
+    return job;
+}
+
+void ThreadPool::wait(const Job& job) {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (job->remaining == 0) break;
+        }
+        if (!runOne(0)) {
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->finished.wait(lock, [&job] { return job->remaining == 0; });
+            break;
+        }
+    }
+    if (job->error) std::rethrow_exception(job->error);
+}
+
+void ThreadPool::block(const std::function<bool()>& attempt) {
+    if (attempt()) return;
+    struct Blocked {
+        explicit Blocked(std::atomic<size_t>& count) : count(count) {
+            count++;
+        }
+        ~Blocked() { count--; }
+        std::atomic<size_t>& count;
+    } blockedHere(blocked);
+    // The generation is read before each attempt, so a change made after
+    // the attempt has looked is never slept through.
+    while (true) {
+        size_t seen = generation.load();
+        if (attempt()) return;
+        if (queued > 0 && activeSpares < blocked) startSpare(std::nullopt);
+        std::unique_lock<std::mutex> lock(progressMutex);
+        progress.wait(lock, [this, seen] { return generation.load() != seen; });
+    }
+}
+
+void ThreadPool::progressed() {
+    generation++;
+    if (blocked == 0) return;
+    { std::lock_guard<std::mutex> lock(progressMutex); }
+    progress.notify_all();
+}
+
+void ThreadPool::startSpare(std::optional<Chunk> first) {
+    std::lock_guard<std::mutex> lock(sparesMutex);
+    spares.erase(std::remove_if(spares.begin(), spares.end(),
+                                [](const std::unique_ptr<Spare>& spare) {
+                                    if (!spare->done) return false;
+                                    spare->thread.join();
+                                    return true;
+                                }),
+                 spares.end());
+    auto spare = std::make_unique<Spare>();
+    Spare* started = spare.get();
+    activeSpares++;
+    started->thread = std::thread([this, started, first]() mutable {
+        if (first) run(*first);
+        first.reset();
+        while (runOne(0)) {
+        }
+        activeSpares--;
+        started->done = true;
+        // A blocked thread may be waiting to start a spare of its own.
+        progressed();
+    });
+    spares.push_back(std::move(spare));
+}
+
+void ThreadPool::work(size_t index) {
+    while (true) {
+        if (runOne(index)) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping) return;
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const Body& body) {
+    size_t chunks = std::min(count / std::max<size_t>(grain, 1),
+                             size() * 4);
+    if (workers.empty() || chunks < 2) {
+        body(0, count);
+        return;
+    }
+
+    Loop loop;
+    loop.body = &body;
+    loop.context = ContextGuard::current();
+    loop.remaining = chunks;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued += chunks;
+    }
+    for (size_t i = 0; i < chunks; i++) {
+        Worker& worker = *workers[i % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.chunks.push_back(
+            Chunk{&loop, count * i / chunks, count * (i + 1) / chunks, {}});
+    }
+    wake.notify_all();
+    progressed();
+
+    // Help until nothing is left to take, then wait for the chunks that other
+    // threads are still running.
+    while (runOne(0)) {
+    }
+    std::unique_lock<std::mutex> lock(loop.mutex);
+    loop.finished.wait(lock, [&loop] { return loop.remaining == 0; });
+    if (loop.error) std::rethrow_exception(loop.error);
+}
+
+namespace {
+
+// Scripts loaded on different threads may set these at the same time.
+std::atomic<size_t> configuredThreads{0};
+std::atomic<size_t> configuredThreshold{1 << 20};
+
+ThreadPool& sharedPool() {
+    static ThreadPool pool(configuredThreads.load() != 0
+                               ? configuredThreads.load()
+                               : std::max(1u,
+                                          std::thread::hardware_concurrency()));
+    return pool;
+}
+
+}  // namespace
+
+void configureParallelism(size_t threads, size_t threshold) {
+    configuredThreads = threads;
+    configuredThreshold = threshold;
+}
+
+size_t parallelThreads() { return sharedPool().size(); }
+
+size_t parallelThreshold() {
+    return configuredThreshold.load(std::memory_order_relaxed);
+}
+
+void runParallel(size_t count, const ThreadPool::Body& body) {
+    sharedPool().parallelFor(count, parallelThreshold() / 4, body);
+}
+
+ThreadPool::Job spawnJob(std::function<void()> body) {
+    return sharedPool().spawn(std::move(body));
+}
+
+void waitForJob(const ThreadPool::Job& job) { sharedPool().wait(job); }
+
+void blockUntil(const std::function<bool()>& attempt) {
+    sharedPool().block(attempt);
+}
+
+void wakeBlocked() { sharedPool().progressed(); }
+
+void parallelEach(size_t count, const std::function<void(size_t)>& task) {
+    sharedPool().parallelFor(count, 1, [&task](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) task(i);
+    });
+}
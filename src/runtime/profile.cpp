@@ -0,0 +1,186 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+Profiler::Profiler(std::string path)
+    : path(std::move(path)), start(std::chrono::steady_clock::now()) {
+    sampler = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, INTERVAL, [this]() { return stopping; }))
+            ticks.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+Profiler::~Profiler() {
+    try {
+        finish();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+    }
+}
+
+Profiler::Function& Profiler::lookup(const FunctionDefinitionNode& function) {
+    auto [entry, added] = functions.try_emplace(&function);
+    if (added) {
+        entry->second.name = function.getIdentifier();
+        entry->second.line = function.getLine();
+    }
+    return entry->second;
+}
+
+void Profiler::define(const FunctionDefinitionNode& function,
+                      const std::string& file) {
+    lookup(function).file = file;
+}
+
+void Profiler::enter(const FunctionDefinitionNode& function) {
+    sample();
+    Function& entry = lookup(function);
+    entry.calls++;
+    stack.push_back({&entry, entry.line});
+}
+
+void Profiler::replace(const FunctionDefinitionNode& function) {
+    sample();
+    Function& entry = lookup(function);
+    entry.calls++;
+    stack.back() = {&entry, entry.line};
+}
+
+void Profiler::leave() {
+    sample();
+    stack.pop_back();
+}
+
+void Profiler::statement(size_t line) {
+    sample();
+    if (stack.empty()) return;
+    stack.back().line = line;
+    stack.back().function->lines[line].executions++;
+}
+
+// Charges the ticks since the last call to the innermost function and line,
+// and to every function on the stack once as time spent inside it.
+void Profiler::sample() {
+    uint64_t now = ticks.load(std::memory_order_relaxed);
+    if (now == seen) return;
+    uint64_t count = now - seen;
+    seen = now;
+    if (stack.empty()) return;
+    samples += count;
+    Frame& top = stack.back();
+    top.function->self += count;
+    top.function->lines[top.line].samples += count;
+    std::string key;
+    for (Frame& frame : stack) {
+        if (frame.function->charged != samples) {
+            frame.function->charged = samples;
+            frame.function->total += count;
+        }
+        if (!key.empty()) key += ';';
+        key += frame.function->name;
+    }
+    folded[key] += count;
+}
+
+void Profiler::finish() {
+    if (finished) return;
+    finished = true;
+    sample();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    sampler.join();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    uint64_t elapsedTicks = ticks.load(std::memory_order_relaxed);
+    // Sleeps overshoot, so a sample stands for its share of the wall time
+    // rather than exactly one interval.
+    double secondsPerSample =
+        elapsedTicks != 0 ? elapsed.count() / elapsedTicks : 0;
+    writeReport(secondsPerSample);
+    writeFolded();
+}
+
+static std::string location(const std::string& file, size_t line) {
+    return (file.empty() ? "?" : file) + ":" + std::to_string(line);
+}
+
+void Profiler::writeReport(double secondsPerSample) const {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Failed to write profile: " + path);
+    auto milliseconds = [secondsPerSample](uint64_t samples) {
+        return samples * secondsPerSample * 1000;
+    };
+    out << std::fixed << std::setprecision(1);
+    out << samples << " samples, " << milliseconds(samples) << " ms\n\n";
+
+    std::vector<const Function*> byTime;
+    for (auto& entry : functions)
+        if (entry.second.calls != 0) byTime.push_back(&entry.second);
+    std::sort(byTime.begin(), byTime.end(),
+              [](const Function* left, const Function* right) {
+                  return std::tie(right->self, right->total, left->name) <
+                         std::tie(left->self, left->total, right->name);
+              });
+    out << std::setw(10) << "self ms" << std::setw(10) << "total ms"
+        << std::setw(12) << "calls" << "  function\n";
+    for (const Function* function : byTime)
+        out << std::setw(10) << milliseconds(function->self) << std::setw(10)
+            << milliseconds(function->total) << std::setw(12)
+            << function->calls << "  " << function->name << " ("
+            << location(function->file, function->line) << ")\n";
+
+    struct LineEntry {
+        const Function* function;
+        size_t line;
+        const Line* stats;
+    };
+    std::vector<LineEntry> lines;
+    for (const Function* function : byTime)
+        for (auto& line : function->lines)
+            lines.push_back({function, line.first, &line.second});
+    std::sort(lines.begin(), lines.end(),
+              [](const LineEntry& left, const LineEntry& right) {
+                  if (left.stats->samples != right.stats->samples)
+                      return left.stats->samples > right.stats->samples;
+                  if (left.function != right.function)
+                      return left.function->name < right.function->name;
+                  return left.line < right.line;
+              });
+    out << '\n'
+        << std::setw(10) << "self ms" << std::setw(12) << "executions"
+        << "  line\n";
+    for (const LineEntry& line : lines)
+        out << std::setw(10) << milliseconds(line.stats->samples)
+            << std::setw(12) << line.stats->executions << "  "
+            << location(line.function->file, line.line) << " ("
+            << line.function->name << ")\n";
+    if (!out) throw std::runtime_error("Failed to write profile: " + path);
+}
+
+void Profiler::writeFolded() const {
+    std::string foldedPath = path + ".folded";
+    std::ofstream out(foldedPath);
+    if (!out)
+        throw std::runtime_error("Failed to write profile: " + foldedPath);
+    std::vector<std::pair<std::string, uint64_t>> stacks(folded.begin(),
+                                                         folded.end());
+    std::sort(stacks.begin(), stacks.end());
+    for (auto& stack : stacks)
+        out << stack.first << ' ' << stack.second << '\n';
+    if (!out)
+        throw std::runtime_error("Failed to write profile: " + foldedPath);
+}
@@ -0,0 +1,582 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/scalar.h"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "runtime/kernels.h"
+#include "runtime/stats.h"
+
+namespace {
+
+// Calls a function takes in the walker before it is compiled.
+constexpr uint32_t HOT_CALLS = 16;
+
+// Serializes compiling, and keeps every function ever compiled alive: code
+// compiled before a bindings change may still be running on another thread.
+std::mutex compileMutex;
+std::vector<std::unique_ptr<ScalarFunction>> compiledFunctions;
+
+// Thrown while compiling at the first thing the tier doesn't handle.
+struct Unsupported {};
+
+// Compiles a function together with every user function it calls that
+// hasn't been compiled yet. Nothing is kept unless all of them compile.
+class ScalarCompiler {
+ public:
+    ScalarCompiler(uint64_t version, const ScalarResolver& resolve)
+        : version(version), resolve(resolve) {}
+
+    const ScalarFunction* compile(const FunctionDefinitionNode& definition);
+    const ScalarFunction* callee(const FunctionCallNode& call);
+
+ private:
+    ScalarFunction* add(const FunctionDefinitionNode& definition);
+
+    uint64_t version;
+    const ScalarResolver& resolve;
+    std::vector<std::unique_ptr<ScalarFunction>> functions;
+    std::unordered_map<const FunctionDefinitionNode*, ScalarFunction*> added;
+};
+
+class FunctionCompiler {
+ public:
+    FunctionCompiler(ScalarCompiler& compiler, ScalarFunction& function)
+        : compiler(compiler), function(function) {}
+
+    void compile() {
+        auto& definition = *function.definition;
+        if (definition.getParams().size() > SCALAR_MAX_PARAMETERS)
+            throw Unsupported();
+        frameSize = static_cast<int32_t>(definition.getFrameSize());
+        nextRegister = frameSize;
+        registers = frameSize;
+        declared.assign(frameSize, false);
+        std::fill(declared.begin(),
+                  declared.begin() + definition.getParams().size(), true);
+        body(*definition.getBody());
+        emit(ScalarOp::GIVE_UP);
+        function.registers = registers;
+    }
+
+ private:
+    size_t emit(ScalarOp op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+        function.code.push_back(ScalarInstruction{op, a, b, c});
+        return function.code.size() - 1;
+    }
+
+    // Points the jump at `jump` to the next instruction.
+    void patch(size_t jump) {
+        function.code[jump].a = static_cast<int32_t>(function.code.size());
+    }
+
+    int32_t temporary() {
+        registers = std::max(registers, nextRegister + 1);
+        return nextRegister++;
+    }
+
+    // Variables become visible where they are declared and stop being so
+    // where their block ends, as they do for the walker, which would fail
+    // on reading them anywhere else.
+    void body(const BodyNode& body) {
+        std::vector<bool> outer = declared;
+        for (auto& statement : body.getStatements()) {
+            this->statement(*statement);
+            nextRegister = frameSize;
+        }
+        declared = std::move(outer);
+    }
+
+    void statement(const StatementNode& statement) {
+        std::visit(
+            [this](auto&& arg) {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVariableBinding =
+                    std::is_same_v<T, std::shared_ptr<VariableBindingNode>>;
+                constexpr bool isWhile =
+                    std::is_same_v<T, std::shared_ptr<WhileNode>>;
+                constexpr bool isIfNode =
+                    std::is_same_v<T, std::shared_ptr<IfNode>>;
+                constexpr bool isFunctionCall =
+                    std::is_same_v<T, std::shared_ptr<FunctionCallNode>>;
+                constexpr bool isReturn =
+                    std::is_same_v<T, std::shared_ptr<ReturnNode>>;
+                if constexpr (isVariableBinding) {
+                    binding(*arg);
+                } else if constexpr (isWhile) {
+                    size_t top = function.code.size();
+                    size_t exit = condition(arg->getCondition());
+                    body(*arg->getBody());
+                    emit(ScalarOp::JUMP, static_cast<int32_t>(top));
+                    patch(exit);
+                } else if constexpr (isIfNode) {
+                    ifChain(*arg);
+                } else if constexpr (isFunctionCall) {
+                    call(*arg, temporary());
+                } else if constexpr (isReturn) {
+                    returnStatement(*arg);
+                } else {
+                    throw Unsupported();
+                }
+            },
+            statement.getValue());
+    }
+
+    void binding(const VariableBindingNode& binding) {
+        if (auto declaration =
+                std::get_if<std::shared_ptr<VariableDeclarationNode>>(
+                    &binding.getValue())) {
+            auto& slot = (*declaration)->getSlot();
+            if (!slot.has_value()) throw Unsupported();
+            auto target = static_cast<int32_t>(slot->index);
+            if (auto& value = (*declaration)->getValue()) {
+                expression(*value.value(), target);
+            } else {
+                auto& descriptor = (*declaration)->getDescriptor();
+                if (descriptor.getCanGrow() || descriptor.getSize() != 1u)
+                    throw Unsupported();
+                emit(ScalarOp::LOAD, target, 0);
+            }
+            declared[target] = true;
+            return;
+        }
+        auto& assignment =
+            *std::get<std::shared_ptr<VariableAssignmentNode>>(
+                binding.getValue());
+        expression(*assignment.getRight(), variable(assignment.getSlot()));
+    }
+
+    void ifChain(const IfNode& ifNode) {
+        std::vector<size_t> exits;
+        for (const IfNode* branch = &ifNode;;) {
+            size_t skip = condition(branch->getCondition());
+            body(*branch->getBody());
+            auto& elseIf = branch->getElseIfBranches();
+            auto& elseBody = branch->getElseBody();
+            if (!elseIf.has_value() && !elseBody.has_value()) {
+                patch(skip);
+                break;
+            }
+            exits.push_back(emit(ScalarOp::JUMP));
+            patch(skip);
+            if (elseIf.has_value()) {
+                branch = elseIf.value().get();
+                continue;
+            }
+            body(*elseBody.value());
+            break;
+        }
+        for (size_t exit : exits) patch(exit);
+    }
+
+    // Emits the jump taken when the condition is false, to be patched.
+    size_t condition(
+        const std::variant<std::shared_ptr<IfCompareNode>,
+                           std::shared_ptr<IfDeclarationNode>>& condition) {
+        auto compare = std::get_if<std::shared_ptr<IfCompareNode>>(&condition);
+        if (compare == nullptr) throw Unsupported();
+        int32_t left = expression(*(*compare)->getLeft());
+        int32_t right = expression(*(*compare)->getRight());
+        ScalarOp op = ScalarOp::JUMP_NE;
+        switch ((*compare)->getType()) {
+            case IfCompareNode::Type::EQ:
+                op = ScalarOp::JUMP_NE;
+                break;
+            case IfCompareNode::Type::NE:
+                op = ScalarOp::JUMP_EQ;
+                break;
+            case IfCompareNode::Type::LT:
+                op = ScalarOp::JUMP_GE;
+                break;
+            case IfCompareNode::Type::LE:
+                op = ScalarOp::JUMP_GT;
+                break;
+            case IfCompareNode::Type::GT:
+                op = ScalarOp::JUMP_LE;
+                break;
+            case IfCompareNode::Type::GE:
+                op = ScalarOp::JUMP_LT;
+                break;
+        }
+        return emit(op, 0, left, right);
+    }
+
+    void returnStatement(const ReturnNode& returnNode) {
+        if (auto tailCall = returnNode.getTailCall()) {
+            auto [callee, arguments] = callArguments(*tailCall);
+            emit(ScalarOp::TAIL_CALL, 0, callee, arguments);
+            return;
+        }
+        emit(ScalarOp::RETURN, expression(*returnNode.getValue()));
+    }
+
+    int32_t variable(const std::optional<VariableSlot>& slot) {
+        if (!slot.has_value() || !declared[slot->index]) throw Unsupported();
+        return static_cast<int32_t>(slot->index);
+    }
+
+    // The register holding the expression's value: `target` when one is
+    // given, and otherwise a variable's own register or a temporary.
+    int32_t expression(const ExpressionNode& expression,
+                       int32_t target = -1) {
+        if (!expression.getPostfix().getValues().empty()) throw Unsupported();
+        if (auto arithmetic = std::get_if<std::shared_ptr<ArithmeticNode>>(
+                &expression.getPrimary())) {
+            int32_t left = this->expression(*(*arithmetic)->left);
+            int32_t right = this->expression(*(*arithmetic)->right);
+            if (target < 0) target = temporary();
+            emit(arithmeticOp((*arithmetic)->type), target, left, right);
+            return target;
+        }
+        auto& array = *std::get<std::shared_ptr<ArrayNode>>(
+            expression.getPrimary());
+        return std::visit(
+            [this, &array, target](auto&& arg) -> int32_t {
+                using T = std::decay_t<decltype(arg)>;
+                constexpr bool isVector =
+                    std::is_same_v<T, std::vector<int>>;
+                constexpr bool isString = std::is_same_v<T, std::string>;
+                if constexpr (isString) {
+                    int32_t source = variable(array.getSlot());
+                    if (target < 0 || target == source) return source;
+                    emit(ScalarOp::MOVE, target, source);
+                    return target;
+                } else {
+                    int32_t result = target < 0 ? temporary() : target;
+                    if constexpr (isVector) {
+                        if (arg.size() != 1) throw Unsupported();
+                        emit(ScalarOp::LOAD, result, arg[0]);
+                        return result;
+                    } else {
+                        return call(*arg, result);
+                    }
+                }
+            },
+            array.getValue());
+    }
+
+    static ScalarOp arithmeticOp(ArithmeticNode::Type type) {
+        switch (type) {
+            case ArithmeticNode::TYPE_ADDITION:
+                return ScalarOp::ADD;
+            case ArithmeticNode::TYPE_SUBTRACTION:
+                return ScalarOp::SUB;
+            case ArithmeticNode::TYPE_MULTIPLICATION:
+                return ScalarOp::MUL;
+            case ArithmeticNode::TYPE_DIVISION:
+                return ScalarOp::DIV;
+            case ArithmeticNode::TYPE_MODULO:
+                return ScalarOp::MOD;
+            case ArithmeticNode::TYPE_AND:
+                return ScalarOp::AND;
+            case ArithmeticNode::TYPE_OR:
+                return ScalarOp::OR;
+            case ArithmeticNode::TYPE_XOR:
+                return ScalarOp::XOR;
+            case ArithmeticNode::TYPE_SHIFT_LEFT:
+                return ScalarOp::SHL;
+            case ArithmeticNode::TYPE_SHIFT_RIGHT:
+                return ScalarOp::SHR;
+            default:
+                throw Unsupported();
+        }
+    }
+
+    int32_t call(const FunctionCallNode& call, int32_t target) {
+        auto [callee, arguments] = callArguments(call);
+        emit(ScalarOp::CALL, target, callee, arguments);
+        return target;
+    }
+
+    // Evaluates a call's arguments, returning where the callee and the
+    // argument registers were recorded.
+    std::pair<int32_t, int32_t> callArguments(const FunctionCallNode& call) {
+        auto callee = static_cast<int32_t>(function.callees.size());
+        function.callees.push_back(compiler.callee(call));
+        std::vector<int32_t> argumentRegisters;
+        for (auto& parameter : call.getParameters())
+            argumentRegisters.push_back(expression(*parameter));
+        auto arguments = static_cast<int32_t>(function.arguments.size());
+        function.arguments.insert(function.arguments.end(),
+                                  argumentRegisters.begin(),
+                                  argumentRegisters.end());
+        return {callee, arguments};
+    }
+
+    ScalarCompiler& compiler;
+    ScalarFunction& function;
+    int32_t frameSize = 0;
+    int32_t nextRegister = 0;
+    int32_t registers = 0;
+    std::vector<bool> declared;
+};
+
+ScalarFunction* ScalarCompiler::add(const FunctionDefinitionNode& definition) {
+    functions.push_back(std::make_unique<ScalarFunction>());
+    ScalarFunction* function = functions.back().get();
+    function->definition = &definition;
+    added[&definition] = function;
+    return function;
+}
+
+const ScalarFunction* ScalarCompiler::callee(const FunctionCallNode& call) {
+    const FunctionDefinitionNode* definition = resolve(call);
+    // Calls to a memo fn go through its cache, which compiled code skips.
+    if (definition == nullptr || definition->isMemoized() ||
+        definition->getParams().size() != call.getParameters().size())
+        throw Unsupported();
+    auto& tier = definition->getTier();
+    if (tier.version.load(std::memory_order_acquire) == version) {
+        if (auto compiled = tier.compiled.load(std::memory_order_acquire))
+            return compiled;
+        if (tier.rejected.load(std::memory_order_relaxed))
+            throw Unsupported();
+    }
+    if (auto found = added.find(definition); found != added.end())
+        return found->second;
+    return add(*definition);
+}
+
+const ScalarFunction* ScalarCompiler::compile(
+    const FunctionDefinitionNode& definition) {
+    add(definition);
+    try {
+        // Callees are added as they are found, so this also compiles them.
+        for (size_t i = 0; i < functions.size(); i++)
+            FunctionCompiler(*this, *functions[i]).compile();
+    } catch (const Unsupported&) {
+        return nullptr;
+    } catch (const std::runtime_error&) {
+        // Such as a call to a name bound to an array, which the walker
+        // reports if the call is ever made.
+        return nullptr;
+    }
+    const ScalarFunction* root = functions.front().get();
+    for (auto& function : functions) {
+        auto& tier = function->definition->getTier();
+        tier.compiled.store(function.get(), std::memory_order_release);
+        tier.rejected.store(false, std::memory_order_relaxed);
+        tier.version.store(version, std::memory_order_release);
+        compiledFunctions.push_back(std::move(function));
+    }
+    return root;
+}
+
+int wrapping(ScalarOp op, int left, int right) {
+    auto a = static_cast<unsigned>(left);
+    auto b = static_cast<unsigned>(right);
+    switch (op) {
+        case ScalarOp::ADD:
+            return static_cast<int>(a + b);
+        case ScalarOp::SUB:
+            return static_cast<int>(a - b);
+        case ScalarOp::AND:
+            return static_cast<int>(a & b);
+        case ScalarOp::OR:
+            return static_cast<int>(a | b);
+        case ScalarOp::XOR:
+            return static_cast<int>(a ^ b);
+        case ScalarOp::SHL:
+            return ShiftLeft()(left, right);
+        case ScalarOp::SHR:
+            return ShiftRight()(left, right);
+        default:
+            return static_cast<int>(a * b);
+    }
+}
+
+// Leaves the function to the walker from now on.
+std::optional<int> giveUp(const ScalarFunction& function) {
+    auto& tier = function.definition->getTier();
+    tier.compiled.store(nullptr, std::memory_order_relaxed);
+    tier.rejected.store(true, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+}  // namespace
+
+const ScalarFunction* scalarTier(const FunctionDefinitionNode& function,
+                                 uint64_t version,
+                                 const ScalarResolver& resolve) {
+    auto& tier = function.getTier();
+    if (tier.version.load(std::memory_order_acquire) != version) {
+        // Anything learned about the function may have changed with the
+        // bindings, so it starts over cold.
+        std::lock_guard<std::mutex> lock(compileMutex);
+        if (tier.version.load(std::memory_order_relaxed) != version) {
+            tier.compiled.store(nullptr, std::memory_order_relaxed);
+            tier.rejected.store(false, std::memory_order_relaxed);
+            tier.calls.store(1, std::memory_order_relaxed);
+            tier.version.store(version, std::memory_order_release);
+        }
+        return nullptr;
+    }
+    if (auto compiled = tier.compiled.load(std::memory_order_acquire))
+        return compiled;
+    if (tier.rejected.load(std::memory_order_relaxed) ||
+        tier.calls.fetch_add(1, std::memory_order_relaxed) + 1 < HOT_CALLS)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(compileMutex);
+    if (auto compiled = tier.compiled.load(std::memory_order_acquire))
+        return compiled;
+    if (tier.rejected.load(std::memory_order_relaxed)) return nullptr;
+    if (auto compiled = ScalarCompiler(version, resolve).compile(function))
+        return compiled;
+    tier.rejected.store(true, std::memory_order_relaxed);
+    return nullptr;
+}
+
+std::optional<int> runScalar(const ScalarFunction& function,
+                             const int* arguments, size_t depth,
+                             size_t maxDepth) {
+    struct Frame {
+        const ScalarFunction* function;
+        const ScalarInstruction* pc;
+        size_t base;
+        int32_t result;
+    };
+    // Compiled code never calls back into the walker, so a thread only ever
+    // runs one of these at a time.
+    thread_local std::vector<int> registers;
+    thread_local std::vector<Frame> frames;
+    frames.clear();
+    if (registers.size() < function.registers)
+        registers.resize(function.registers);
+    std::copy(arguments, arguments + function.definition->getParams().size(),
+              registers.begin());
+
+    const ScalarFunction* current = &function;
+    const ScalarInstruction* pc = current->code.data();
+    size_t base = 0;
+    int* r = registers.data();
+    while (true) {
+        const ScalarInstruction& instruction = *pc++;
+        switch (instruction.op) {
+            case ScalarOp::LOAD:
+                r[instruction.a] = instruction.b;
+                break;
+            case ScalarOp::MOVE:
+                r[instruction.a] = r[instruction.b];
+                break;
+            case ScalarOp::ADD:
+            case ScalarOp::SUB:
+            case ScalarOp::MUL:
+            case ScalarOp::AND:
+            case ScalarOp::OR:
+            case ScalarOp::XOR:
+            case ScalarOp::SHL:
+            case ScalarOp::SHR:
+                r[instruction.a] = wrapping(instruction.op, r[instruction.b],
+                                            r[instruction.c]);
+                break;
+            case ScalarOp::DIV:
+            case ScalarOp::MOD: {
+                int dividend = r[instruction.b];
+                int divisor = r[instruction.c];
+                if (divisor == 0 || (divisor == -1 && dividend == INT_MIN))
+                    return giveUp(function);
+                r[instruction.a] = instruction.op == ScalarOp::DIV
+                                       ? dividend / divisor
+                                       : dividend % divisor;
+                break;
+            }
+            case ScalarOp::JUMP:
+                pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::JUMP_EQ:
+                if (r[instruction.b] == r[instruction.c])
+                    pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::JUMP_NE:
+                if (r[instruction.b] != r[instruction.c])
+                    pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::JUMP_LT:
+                if (r[instruction.b] < r[instruction.c])
+                    pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::JUMP_LE:
+                if (r[instruction.b] <= r[instruction.c])
+                    pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::JUMP_GT:
+                if (r[instruction.b] > r[instruction.c])
+                    pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::JUMP_GE:
+                if (r[instruction.b] >= r[instruction.c])
+                    pc = current->code.data() + instruction.a;
+                break;
+            case ScalarOp::CALL: {
+                // The walker would fail here, so it gets to do that itself.
+                if (depth >= maxDepth) return giveUp(function);
+                const ScalarFunction* callee =
+                    current->callees[instruction.b];
+                size_t calleeBase = base + current->registers;
+                if (registers.size() < calleeBase + callee->registers) {
+                    registers.resize(std::max(calleeBase + callee->registers,
+                                              registers.size() * 2));
+                    r = registers.data() + base;
+                }
+                int* calleeRegisters = registers.data() + calleeBase;
+                const int32_t* argumentRegisters =
+                    current->arguments.data() + instruction.c;
+                size_t count = callee->definition->getParams().size();
+                for (size_t i = 0; i < count; i++)
+                    calleeRegisters[i] = r[argumentRegisters[i]];
+                frames.push_back(Frame{current, pc, base, instruction.a});
+                countCall(++depth);
+                current = callee;
+                pc = callee->code.data();
+                base = calleeBase;
+                r = calleeRegisters;
+                break;
+            }
+            case ScalarOp::TAIL_CALL: {
+                const ScalarFunction* callee =
+                    current->callees[instruction.b];
+                const int32_t* argumentRegisters =
+                    current->arguments.data() + instruction.c;
+                size_t count = callee->definition->getParams().size();
+                int values[SCALAR_MAX_PARAMETERS];
+                for (size_t i = 0; i < count; i++)
+                    values[i] = r[argumentRegisters[i]];
+                if (registers.size() < base + callee->registers) {
+                    registers.resize(std::max(base + callee->registers,
+                                              registers.size() * 2));
+                    r = registers.data() + base;
+                }
+                std::copy(values, values + count, r);
+                countCall(depth);
+                current = callee;
+                pc = callee->code.data();
+                break;
+            }
+            case ScalarOp::RETURN: {
+                int value = r[instruction.a];
+                if (frames.empty()) return value;
+                Frame& caller = frames.back();
+                current = caller.function;
+                pc = caller.pc;
+                base = caller.base;
+                r = registers.data() + base;
+                r[caller.result] = value;
+                frames.pop_back();
+                depth--;
+                break;
+            }
+            case ScalarOp::GIVE_UP:
+                return giveUp(function);
+        }
+    }
+}
@@ -0,0 +1,348 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "runtime/context.h"
+
+#ifndef _WIN32
+
+namespace {
+
+// Requests are small; anything larger is not one.
+constexpr uint32_t MAX_REQUEST_STRINGS = 1 << 16;
+constexpr uint32_t MAX_REQUEST_STRING = 1 << 24;
+
+void putUint32(std::string& out, uint32_t value) {
+    for (size_t i = 0; i < 4; i++)
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+uint32_t getUint32(const char* bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(bytes[i]))
+                 << (8 * i);
+    return value;
+}
+
+void writeAll(int socket, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = send(socket, data, size, 0);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) throw std::runtime_error("Lost the connection");
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+// False when the other end closes the connection first.
+bool readAll(int socket, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t got = recv(socket, data, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+void sendFrame(int socket, char kind, std::string_view payload) {
+    std::string header(1, kind);
+    putUint32(header, static_cast<uint32_t>(payload.size()));
+    writeAll(socket, header.data(), header.size());
+    writeAll(socket, payload.data(), payload.size());
+}
+
+bool readString(int socket, std::string& out) {
+    char length[4];
+    if (!readAll(socket, length, 4)) return false;
+    uint32_t size = getUint32(length);
+    if (size > MAX_REQUEST_STRING) return false;
+    out.assign(size, '\0');
+    return readAll(socket, out.data(), size);
+}
+
+bool readRequest(int socket, std::vector<std::string>& request) {
+    char count[4];
+    if (!readAll(socket, count, 4)) return false;
+    uint32_t strings = getUint32(count);
+    if (strings == 0 || strings > MAX_REQUEST_STRINGS) return false;
+    request.resize(strings);
+    for (std::string& string : request)
+        if (!readString(socket, string)) return false;
+    return true;
+}
+
+std::runtime_error socketError(const std::string& action,
+                               const std::string& path) {
+    return std::runtime_error("Cannot " + action + " " + path + ": " +
+                              std::strerror(errno));
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Socket path is too long: " + path);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+using Stamp = std::filesystem::file_time_type;
+
+// When `path` was last written, or the earliest time there is when it can't
+// be told.
+Stamp lastWritten(const std::string& path) {
+    std::error_code error;
+    Stamp stamp = std::filesystem::last_write_time(path, error);
+    return error ? Stamp::min() : stamp;
+}
+
+// A loaded script, with when each of its files was last written as of the
+// load. Whatever it prints goes to the connection running it.
+struct Loaded {
+    std::unique_ptr<Script> script;
+    std::vector<std::pair<std::string, Stamp>> stamps;
+    int client = -1;
+
+    bool current() const {
+        return std::all_of(stamps.begin(), stamps.end(), [](const auto& file) {
+            return lastWritten(file.first) == file.second;
+        });
+    }
+};
+
+// The loaded scripts not running at the moment, by path. A run takes one
+// that is still current, or loads another when there is none, and gives it
+// back once it ends.
+class ScriptCache {
+ public:
+    explicit ScriptCache(const InterpretOptions& options) : options(options) {}
+
+    std::unique_ptr<Loaded> take(const std::string& filename, int client) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& scripts = idle[filename];
+            while (!scripts.empty()) {
+                std::unique_ptr<Loaded> loaded = std::move(scripts.back());
+                scripts.pop_back();
+                if (!loaded->current()) continue;
+                loaded->client = client;
+                return loaded;
+            }
+        }
+        return load(filename, client);
+    }
+
+    void give(const std::string& filename, std::unique_ptr<Loaded> loaded) {
+        loaded->client = -1;
+        std::lock_guard<std::mutex> lock(mutex);
+        idle[filename].push_back(std::move(loaded));
+    }
+
+ private:
+    std::unique_ptr<Loaded> load(const std::string& filename, int client) {
+        auto loaded = std::make_unique<Loaded>();
+        loaded->client = client;
+        Loaded* target = loaded.get();
+        InterpretOptions scriptOptions = options;
+        scriptOptions.output = [target](std::string_view bytes) {
+            sendFrame(target->client, 'o', bytes);
+        };
+        Stamp stamp = lastWritten(filename);
+        loaded->script = std::make_unique<Script>(filename, scriptOptions);
+        if (loaded->script->uses("graphics"))
+            throw std::runtime_error(
+                "Cannot serve a script that uses <graphics>");
+        loaded->stamps.emplace_back(filename, stamp);
+        for (const std::string& file : loaded->script->getFiles())
+            loaded->stamps.emplace_back(file, lastWritten(file));
+        return loaded;
+    }
+
+    InterpretOptions options;
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<std::unique_ptr<Loaded>>>
+        idle;
+};
+
+// Connections accepted and waiting for a worker.
+class ConnectionQueue {
+ public:
+    void push(int client) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            clients.push_back(client);
+        }
+        ready.notify_one();
+    }
+
+    int pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return !clients.empty(); });
+        int client = clients.front();
+        clients.pop_front();
+        return client;
+    }
+
+ private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> clients;
+};
+
+// A run that fails or exits still gets its status; one whose client has
+// gone away just ends.
+void handle(int client, ScriptCache& cache) {
+    std::vector<std::string> request;
+    if (!readRequest(client, request)) return;
+    const std::string& filename = request[0];
+    std::vector<std::string> args(request.begin() + 1, request.end());
+    int status = 0;
+    std::unique_ptr<Loaded> loaded;
+    try {
+        try {
+            loaded = cache.take(filename, client);
+            loaded->script->reset();
+            loaded->script->callMain(args);
+        } catch (const ScriptExit& scriptExit) {
+            status = scriptExit.code();
+        } catch (const std::exception& e) {
+            status = 1;
+            sendFrame(client, 'e', e.what());
+        }
+        std::string code;
+        putUint32(code, static_cast<uint32_t>(status));
+        sendFrame(client, 'x', code);
+    } catch (const std::runtime_error&) {
+        // Lost the connection.
+    }
+    if (loaded) cache.give(filename, std::move(loaded));
+}
+
+}  // namespace
+
+void serve(const std::string& path, size_t workers,
+           const InterpretOptions& options) {
+    // Writing to a client that has gone away fails instead of ending the
+    // server.
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un address = socketAddress(path);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) throw socketError("open a socket for", path);
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0)
+        throw socketError("listen on", path);
+
+    // Never destroyed, since the workers run until the process ends.
+    auto cache = new ScriptCache(options);
+    auto queue = new ConnectionQueue();
+    size_t count = workers != 0
+                       ? workers
+                       : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < count; i++)
+        std::thread([cache, queue] {
+            while (true) {
+                int client = queue->pop();
+                handle(client, *cache);
+                close(client);
+            }
+        }).detach();
+
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client >= 0) {
+            queue->push(client);
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+            throw socketError("accept connections on", path);
+        }
+    }
+}
+
+int runOnServer(const std::string& path, const std::string& filename,
+                const std::vector<std::string>& args) {
+    sockaddr_un address = socketAddress(path);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) throw socketError("open a socket for", path);
+    if (connect(server, reinterpret_cast<sockaddr*>(&address),
+                sizeof(address)) != 0) {
+        close(server);
+        throw socketError("connect to", path);
+    }
+    std::string request;
+    putUint32(request, static_cast<uint32_t>(args.size() + 1));
+    auto add = [&request](const std::string& string) {
+        putUint32(request, static_cast<uint32_t>(string.size()));
+        request += string;
+    };
+    add(filename);
+    for (const std::string& arg : args) add(arg);
+
+    std::string payload;
+    try {
+        writeAll(server, request.data(), request.size());
+        while (true) {
+            char header[5];
+            if (!readAll(server, header, 5))
+                throw std::runtime_error("The server closed the connection");
+            payload.assign(getUint32(header + 1), '\0');
+            if (!readAll(server, payload.data(), payload.size()))
+                throw std::runtime_error("The server closed the connection");
+            if (header[0] == 'o') {
+                std::fwrite(payload.data(), 1, payload.size(), stdout);
+            } else if (header[0] == 'e') {
+                std::fflush(stdout);
+                std::cerr << "Error: " << payload << '\n';
+            } else if (header[0] == 'x' && payload.size() == 4) {
+                break;
+            }
+        }
+    } catch (...) {
+        close(server);
+        throw;
+    }
+    close(server);
+    std::fflush(stdout);
+    return static_cast<int32_t>(getUint32(payload.data()));
+}
+
+#else
+
+void serve(const std::string&, size_t, const InterpretOptions&) {
+    throw std::runtime_error("--serve needs Unix sockets");
+}
+
+int runOnServer(const std::string&, const std::string&,
+                const std::vector<std::string>&) {
+    throw std::runtime_error("--connect needs Unix sockets");
+}
+
+#endif
@@ -0,0 +1,30 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/stats.h"
+
+#include <iomanip>
+#include <ostream>
+
+#include "util/pool.h"
+
+bool statsEnabled = false;
+RuntimeStats runtimeStats;
+
+void enableStats() {
+    statsEnabled = true;
+    countHeapBytes();
+}
+
+void printStats(std::ostream& out) {
+    auto line = [&out](const char* name, uint64_t value) {
+        out << std::left << std::setw(18) << name << value << '\n';
+    };
+    line("allocations", heapAllocations());
+    line("bytes allocated", heapBytes());
+    line("element copies", runtimeStats.elementCopies.load());
+    line("scopes created", runtimeStats.scopes.load());
+    line("function calls", runtimeStats.calls.load());
+    line("max call depth", runtimeStats.maxCallDepth.load());
+    line("memo hits", runtimeStats.memoHits.load());
+    line("memo misses", runtimeStats.memoMisses.load());
+}
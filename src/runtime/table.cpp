@@ -0,0 +1,88 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/table.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// The finalizer of MurmurHash3, so that runs of consecutive keys spread
+// over the whole table.
+static size_t hashKey(int key) {
+    auto hash = static_cast<uint32_t>(key);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static size_t capacity(const int* table) {
+    return static_cast<size_t>(table[0]);
+}
+
+static const int* slot(const int* table, size_t index) {
+    return table + TABLE_HEADER + index * TABLE_SLOT;
+}
+
+static int* slot(int* table, size_t index) {
+    return table + TABLE_HEADER + index * TABLE_SLOT;
+}
+
+bool isTable(const int* data, size_t size) {
+    if (size < TABLE_HEADER || data[0] <= 0) return false;
+    auto slots = static_cast<size_t>(data[0]);
+    return (slots & (slots - 1)) == 0 && size == tableSize(slots) &&
+           data[1] >= 0 && static_cast<size_t>(data[1]) <= slots;
+}
+
+void initTable(int* data, size_t capacity) {
+    data[0] = static_cast<int>(capacity);
+    data[1] = 0;
+    std::fill(data + TABLE_HEADER, data + tableSize(capacity), 0);
+}
+
+// Tables are only ever 3/4 full, but one built by hand may have no empty
+// slot at all, so the probe stops after visiting every slot once.
+size_t findSlot(const int* table, int key) {
+    size_t mask = capacity(table) - 1;
+    size_t index = hashKey(key) & mask;
+    for (size_t probes = 0; probes <= mask; probes++) {
+        const int* current = slot(table, index);
+        if (current[0] == 0 || current[1] == key) return index;
+        index = (index + 1) & mask;
+    }
+    return capacity(table);
+}
+
+const int* tableValue(const int* table, int key) {
+    size_t index = findSlot(table, key);
+    if (index == capacity(table)) return nullptr;
+    const int* found = slot(table, index);
+    return found[0] == 0 ? nullptr : found + 2;
+}
+
+bool tableFull(const int* table, int key) {
+    size_t index = findSlot(table, key);
+    if (index == capacity(table)) return true;
+    if (slot(table, index)[0] != 0) return false;
+    return (static_cast<size_t>(table[1]) + 1) * 4 > capacity(table) * 3;
+}
+
+void tableInsert(int* table, int key, int value) {
+    int* found = slot(table, findSlot(table, key));
+    if (found[0] == 0) {
+        found[0] = 1;
+        found[1] = key;
+        table[1]++;
+    }
+    found[2] = value;
+}
+
+void rehashTable(const int* from, int* to) {
+    for (size_t i = 0; i < capacity(from); i++) {
+        const int* entry = slot(from, i);
+        if (entry[0] != 0) tableInsert(to, entry[1], entry[2]);
+    }
+}
@@ -2,40 +2,224 @@
 
 #include "runtime/value.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <utility>
-#include <vector>
 
+#include "runtime/fixed.h"
+#include "runtime/gpu.h"
+#include "runtime/kernels.h"
+#include "runtime/stats.h"
+#include "util/file.h"
+#include "util/pool.h"
+
+const int* ArrayView::begin() const { return data; }
+
+const int* ArrayView::end() const { return data + size; }
+
+const int& ArrayView::operator[](size_t i) const { return data[i]; }
+
+static std::string toString(ArrayView array) {
+    std::string result = "[ ";
+    for (size_t i = 0; i < array.size; i++)
+        result += std::to_string(array[i]) + (i + 1 < array.size ? ", " : "");
+
+    result += " ]";
+    return result;
+}
+
+// Copies into storage that is already zero, a page at a time, leaving out
+// pages that are all zeros so that they stay uncommitted in the copy too.
+static void copyIntoZeroed(const int* from, int* to, size_t size) {
+    constexpr size_t PAGE = 4096 / sizeof(int);
+    for (size_t start = 0; start < size; start += PAGE) {
+        size_t end = std::min(size, start + PAGE);
+        int bits = 0;
+        for (size_t i = start; i < end; i++) bits |= from[i];
+        if (bits != 0) std::copy(from + start, from + end, to + start);
+    }
+}
+
+// Only blocks large enough to be mapped on their own start out as pages the
+// system zeroes lazily, so only those are worth skipping zero pages for.
 DynamicArray::DynamicArray(const DynamicArray& dynamicArray)
-    : DynamicArray(dynamicArray.size) {
-    for (size_t i = 0; i < size; i++) data[i] = dynamicArray.data[i];
+    : data(inlineData), size(dynamicArray.size),
+      canGrow(dynamicArray.canGrow) {
+    countElementCopies(size);
+    bool large = size * sizeof(int) >= LARGE_BLOCK;
+    allocate(large);
+    if (large)
+        copyIntoZeroed(dynamicArray.data, data, size);
+    else
+        std::copy(dynamicArray.data, dynamicArray.data + size, data);
+}
+
+// Heap storage is handed over; inline elements have to be copied.
+DynamicArray::DynamicArray(DynamicArray&& dynamicArray) noexcept
+    : data(inlineData), size(0) {
+    *this = std::move(dynamicArray);
+}
+
+DynamicArray& DynamicArray::operator=(DynamicArray&& dynamicArray) noexcept {
+    if (this == &dynamicArray) return *this;
+    size = dynamicArray.size;
+    canGrow = dynamicArray.canGrow;
+    heap = std::move(dynamicArray.heap);
+    if (heap) {
+        data = heap.get();
+    } else {
+        data = inlineData;
+        std::copy(dynamicArray.data, dynamicArray.data + size, inlineData);
+    }
+    dynamicArray.data = dynamicArray.inlineData;
+    dynamicArray.size = 0;
+    return *this;
+}
+
+// Zeroed blocks read as zeros without a pass over them: small ones come from
+// calloc and large ones are fresh pages that the system zeroes when they're
+// first touched. Only pages that are never written stay free; there is no
+// compressed form, so a page written even with zeros is backed by memory
+// until the array is copied.
+DynamicArray::DynamicArray(size_t size) : data(inlineData), size(size) {
+    allocate(true);
 }
 
-DynamicArray::DynamicArray(size_t size)
-    : data(std::make_unique<int[]>(size)), size(size) {}
+DynamicArray DynamicArray::uninitialized(size_t size) {
+    DynamicArray result(0);
+    result.size = size;
+    result.allocate(false);
+    return result;
+}
+
+DynamicArray DynamicArray::growable(size_t capacity) {
+    DynamicArray result(0);
+    result.canGrow = true;
+    result.reserve(capacity);
+    return result;
+}
+
+DynamicArray DynamicArray::copyOf(ArrayView elements, bool canGrow) {
+    auto result = uninitialized(elements.size);
+    result.canGrow = canGrow;
+    countElementCopies(elements.size);
+    std::copy(elements.begin(), elements.end(), result.data);
+    return result;
+}
+
+void DynamicArray::allocate(bool zeroed) {
+    if (size <= INLINE_CAPACITY) return;
+    size_t bytes = size * sizeof(int);
+    auto elements = static_cast<int*>(allocateElements(bytes, zeroed));
+    heap = std::unique_ptr<int[], Storage>(
+        elements, Storage(Storage::Kind::ELEMENTS, bytes));
+    data = elements;
+}
+
+// Takes over a block of `capacity` elements from allocateElements, freeing
+// the storage in use before.
+void DynamicArray::adopt(int* elements, size_t capacity) {
+    heap = std::unique_ptr<int[], Storage>(
+        elements, Storage(Storage::Kind::ELEMENTS, capacity * sizeof(int)));
+    data = elements;
+}
+
+static int* elementBlock(size_t capacity) {
+    return static_cast<int*>(allocateElements(capacity * sizeof(int), false));
+}
+
+size_t DynamicArray::capacity() const {
+    if (!heap) return INLINE_CAPACITY;
+    const Storage& storage = heap.get_deleter();
+    return storage.kind == Storage::Kind::ELEMENTS
+               ? storage.bytes / sizeof(int)
+               : size;
+}
+
+void DynamicArray::reserve(size_t count) {
+    if (count <= capacity()) return;
+    int* block = elementBlock(count);
+    std::copy(data, data + size, block);
+    adopt(block, count);
+}
+
+// New blocks are filled before the old one is freed, so `elements` may
+// point into this array.
+void DynamicArray::assign(const int* elements, size_t count) {
+    if (count > capacity()) {
+        int* block = elementBlock(count);
+        std::copy(elements, elements + count, block);
+        adopt(block, count);
+    } else {
+        std::memmove(data, elements, count * sizeof(int));
+    }
+    size = count;
+}
+
+// Capacity at least doubles, so appending an element at a time copies each
+// one a constant number of times on average.
+void DynamicArray::append(const int* elements, size_t count) {
+    size_t total = size + count;
+    if (total > capacity()) {
+        size_t grown = std::max(total, 2 * capacity());
+        int* block = elementBlock(grown);
+        std::copy(data, data + size, block);
+        std::copy(elements, elements + count, block + size);
+        adopt(block, grown);
+    } else {
+        std::memmove(data + size, elements, count * sizeof(int));
+    }
+    size = total;
+}
 
 DynamicArray::DynamicArray(std::unique_ptr<int[]> data, size_t size)
-    : data(std::move(data)), size(size) {}
+    : data(data.get()), size(size), heap(data.release()) {}
+
+DynamicArray DynamicArray::fromMapping(int* data, size_t size,
+                                       size_t mapped) {
+    DynamicArray result(0);
+    result.heap = std::unique_ptr<int[], Storage>(
+        data, Storage(Storage::Kind::MAPPING, mapped));
+    result.data = data;
+    result.size = size;
+    return result;
+}
 
+bool DynamicArray::isMapped() const {
+    return heap && heap.get_deleter().kind == Storage::Kind::MAPPING;
+}
+
+void DynamicArray::Storage::operator()(int* data) const {
+    switch (kind) {
+        case Kind::ARRAY:
+            delete[] data;
+            break;
+        case Kind::ELEMENTS:
+            freeElements(data, bytes);
+            break;
+        case Kind::MAPPING:
+            unmapFile(data, bytes);
+            break;
+    }
+}
+
+// A fixed copy, whichever form the value takes.
 DynamicArray DynamicArray::fromValue(const Value& value) {
-    return std::visit(
-        [](auto&& value) -> DynamicArray {
-            using T = std::decay_t<decltype(value)>;
-            constexpr bool isVector = std::is_same_v<T, std::vector<int>>;
-            constexpr bool isDynamic = std::is_same_v<T, DynamicArray>;
-            if constexpr (isVector) {
-                DynamicArray result(value.size());
-                for (size_t i = 0; i < value.size(); i++) result[i] = value[i];
-                return result;
-            } else if constexpr (isDynamic) {
-                return DynamicArray(value);
-            }
-        },
-        value.value);
+    if (auto array = std::get_if<DynamicArray>(&value.value)) {
+        DynamicArray result(*array);
+        result.canGrow = false;
+        return result;
+    }
+    return copyOf(value.view());
 }
 
+ArrayView DynamicArray::view() const { return ArrayView{data, size}; }
+
 int& DynamicArray::at(size_t i) {
     if (i >= size) {
         throw std::out_of_range("Index " + std::to_string(i) +
@@ -52,14 +236,7 @@ const int& DynamicArray::at(size_t i) const {
     return data[i];
 }
 
-DynamicArray::operator std::string() const {
-    std::string result = "[ ";
-    for (size_t i = 0; i < size; i++)
-        result += std::to_string(data[i]) + (i + 1 < size ? ", " : "");
-
-    result += " ]";
-    return result;
-}
+DynamicArray::operator std::string() const { return toString(view()); }
 
 int& DynamicArray::operator[](size_t i) { return data[i]; }
 
@@ -68,234 +245,393 @@ const int& DynamicArray::operator[](size_t i) const { return data[i]; }
 DynamicArray DynamicArray::operator+(const DynamicArray& other) {
     if (size != other.size)
         throw std::runtime_error("Cannot add arrays with different sizes");
-    DynamicArray result(size);
-    for (size_t i = 0; i < size; i++) result[i] = data[i] + other[i];
+    auto result = DynamicArray::uninitialized(size);
+    if (!fixedArithmetic(ArithmeticKernel::ADD, data, size, other.data, size,
+                         result.data, size))
+        applyArithmetic(ArithmeticKernel::ADD, data, other.data, result.data,
+                        size);
     return result;
 }
 
 DynamicArray DynamicArray::operator-(const DynamicArray& other) {
     if (size != other.size)
         throw std::runtime_error("Cannot subtract arrays with different sizes");
-    DynamicArray result(size);
-    for (size_t i = 0; i < size; i++) result[i] = data[i] - other[i];
+    auto result = DynamicArray::uninitialized(size);
+    if (!fixedArithmetic(ArithmeticKernel::SUB, data, size, other.data, size,
+                         result.data, size))
+        applyArithmetic(ArithmeticKernel::SUB, data, other.data, result.data,
+                        size);
     return result;
 }
 
 DynamicArray DynamicArray::operator*(const DynamicArray& other) {
     if (size != other.size)
         throw std::runtime_error("Cannot multiply arrays with different sizes");
-    DynamicArray result(size);
-    for (size_t i = 0; i < size; i++) result[i] = data[i] * other[i];
+    auto result = DynamicArray::uninitialized(size);
+    if (!fixedArithmetic(ArithmeticKernel::MUL, data, size, other.data, size,
+                         result.data, size))
+        applyArithmetic(ArithmeticKernel::MUL, data, other.data, result.data,
+                        size);
     return result;
 }
 
 DynamicArray DynamicArray::operator/(const DynamicArray& other) {
     if (size != other.size)
         throw std::runtime_error("Cannot divide arrays with different sizes");
-    DynamicArray result(size);
-    for (size_t i = 0; i < size; i++) result[i] = data[i] / other[i];
+    auto result = DynamicArray::uninitialized(size);
+    if (!fixedArithmetic(ArithmeticKernel::DIV, data, size, other.data, size,
+                         result.data, size))
+        applyArithmetic(ArithmeticKernel::DIV, data, other.data, result.data,
+                        size);
+    return result;
+}
+
+// The operators added after the first four share one body.
+static DynamicArray pairwise(ArithmeticKernel kernel, const DynamicArray& left,
+                             const DynamicArray& right) {
+    size_t size = left.size;
+    if (size != right.size)
+        throw std::runtime_error(std::string("Cannot ") +
+                                 arithmeticVerb(kernel) +
+                                 " arrays with different sizes");
+    auto result = DynamicArray::uninitialized(size);
+    if (!fixedArithmetic(kernel, left.data, size, right.data, size,
+                         result.data, size))
+        applyArithmetic(kernel, left.data, right.data, result.data, size);
     return result;
 }
 
+DynamicArray DynamicArray::operator%(const DynamicArray& other) {
+    return pairwise(ArithmeticKernel::MOD, *this, other);
+}
+
+DynamicArray DynamicArray::operator&(const DynamicArray& other) {
+    return pairwise(ArithmeticKernel::AND, *this, other);
+}
+
+DynamicArray DynamicArray::operator|(const DynamicArray& other) {
+    return pairwise(ArithmeticKernel::OR, *this, other);
+}
+
+DynamicArray DynamicArray::operator^(const DynamicArray& other) {
+    return pairwise(ArithmeticKernel::XOR, *this, other);
+}
+
+DynamicArray DynamicArray::operator<<(const DynamicArray& other) {
+    return pairwise(ArithmeticKernel::SHL, *this, other);
+}
+
+DynamicArray DynamicArray::operator>>(const DynamicArray& other) {
+    return pairwise(ArithmeticKernel::SHR, *this, other);
+}
+
 bool DynamicArray::operator==(const DynamicArray& other) const {
     if (size != other.size) return false;
-    for (size_t i = 0; i < size; i++)
-        if (data[i] != other[i]) return false;
-    return true;
+    return fixedCompare(CompareKernel::EQ, data, other.data, size);
 }
 
 bool DynamicArray::operator!=(const DynamicArray& other) const {
     if (size != other.size) return false;
-    for (size_t i = 0; i < size; i++)
-        if (data[i] == other[i]) return false;
-    return true;
+    return fixedCompare(CompareKernel::NE, data, other.data, size);
 }
 
 bool DynamicArray::operator<(const DynamicArray& other) const {
     if (size != other.size) return false;
-    for (size_t i = 0; i < size; i++)
-        if (data[i] >= other[i]) return false;
-    return true;
+    return fixedCompare(CompareKernel::LT, data, other.data, size);
 }
 
 bool DynamicArray::operator<=(const DynamicArray& other) const {
     if (size != other.size) return false;
-    for (size_t i = 0; i < size; i++)
-        if (data[i] > other[i]) return false;
-    return true;
+    return fixedCompare(CompareKernel::LE, data, other.data, size);
 }
 
 bool DynamicArray::operator>(const DynamicArray& other) const {
     if (size != other.size) return false;
-    for (size_t i = 0; i < size; i++)
-        if (data[i] <= other[i]) return false;
-    return true;
+    return fixedCompare(CompareKernel::GT, data, other.data, size);
 }
 
 bool DynamicArray::operator>=(const DynamicArray& other) const {
     if (size != other.size) return false;
-    for (size_t i = 0; i < size; i++)
-        if (data[i] < other[i]) return false;
-    return true;
+    return fixedCompare(CompareKernel::GE, data, other.data, size);
 }
 
 Value::Value(const Value& value) : value(value.value), minimum(value.minimum) {}
 
-Value::Value(std::variant<std::vector<int>, DynamicArray> value, size_t minimum)
+Value::Value(Value&& value) noexcept
+    : value(std::move(value.value)), minimum(value.minimum) {}
+
+ArrayView ArraySlice::view() const {
+    return ArrayView{source->getData() + offset, size};
+}
+
+Value::Value(std::variant<DynamicArray, ArraySlice> value, size_t minimum)
     : value(std::move(value)), minimum(minimum) {}
 
 Value Value::fromDescriptor(const ArrayDescriptor& descriptor,
                             std::optional<Value> value) {
-    if (descriptor.getCanGrow()) {
-        std::vector<int> dynamicArray;
-        if (descriptor.getSize().has_value()) {
-            dynamicArray.reserve(descriptor.getSize().value());
-        }
-        Value result(dynamicArray, dynamicArray.size());
-        if (value.has_value()) result = value.value();
+    return fromDescriptor(descriptor.getSize(), descriptor.getCanGrow(),
+                          std::move(value));
+}
+
+Value Value::fromDescriptor(std::optional<size_t> size, bool canGrow,
+                            std::optional<Value> value) {
+    // Shared elements stay shared until one side writes to them.
+    bool shared =
+        value.has_value() && std::holds_alternative<ArraySlice>(value->value);
+    if (canGrow) {
+        if (shared) return Value(std::move(value->value), 0);
+        Value result(DynamicArray::growable(size.value_or(0)), 0);
+        if (value.has_value()) result = std::move(value.value());
         return result;
     } else {
-        if (descriptor.getSize().has_value()) {
-            auto size = descriptor.getSize().value();
-            Value result(DynamicArray(size), size);
-            if (value.has_value()) result = value.value();
+        if (size.has_value()) {
+            if (shared && value->getSize() == size.value())
+                return Value(std::move(value->value), size.value());
+            Value result(DynamicArray(size.value()), size.value());
+            if (value.has_value()) result = std::move(value.value());
             return result;
         } else {
-            if (value.has_value()) return Value(value.value());
+            if (value.has_value()) return std::move(value.value());
             throw std::runtime_error(
                 "Static array cannot be defined without a value");
         }
     }
 }
 
-size_t Value::getSize() const { return DynamicArray::fromValue(*this).size; }
+// Slices no longer than the inline capacity are copied, since that costs no
+// more than sharing and does not keep a large source alive.
+Value Value::slice(const std::shared_ptr<const Value>& source, size_t start,
+                   size_t end) {
+    size_t size = end - start;
+    if (size <= DynamicArray::INLINE_CAPACITY) {
+        ArrayView view = source->view();
+        auto result = DynamicArray::uninitialized(size);
+        std::copy(view.begin() + start, view.begin() + end, result.data);
+        return Value(std::move(result), size);
+    }
+    if (auto slice = std::get_if<ArraySlice>(&source->value))
+        return Value(ArraySlice{slice->source, slice->offset + start, size},
+                     size);
+    return Value(ArraySlice{source, start, size}, size);
+}
 
-Value::operator std::string() const {
-    return std::string(DynamicArray::fromValue(*this));
+Value Value::share() {
+    size_t size = getSize();
+    if (size <= DynamicArray::INLINE_CAPACITY ||
+        std::holds_alternative<ArraySlice>(value))
+        return *this;
+    auto buffer =
+        makePooled<const Value>(Value(std::move(value), minimum));
+    value = ArraySlice{buffer, 0, size};
+    return Value(ArraySlice{std::move(buffer), 0, size}, minimum);
 }
 
-Value& Value::operator=(const Value& other) {
+void Value::sliceInPlace(size_t start, size_t end) {
+    size_t size = end - start;
+    if (auto array = std::get_if<DynamicArray>(&value)) {
+        std::copy(array->data + start, array->data + end, array->data);
+        array->size = size;
+    } else {
+        auto& slice = std::get<ArraySlice>(value);
+        slice.offset += start;
+        slice.size = size;
+    }
+    minimum = size;
+}
+
+// Unlike operator=, which is the typed assignment used for declarations,
+// this takes on the other value's representation and size as well.
+void Value::replace(const Value& other) {
     std::visit(
-        [this, &other](auto&& this_arg) {
-            using T = std::decay_t<decltype(this_arg)>;
-            if constexpr (std::is_same_v<T, std::vector<int>>) {
-                std::visit(
-                    [this, &other, &this_arg](auto&& other_arg) {
-                        using T = std::decay_t<decltype(other_arg)>;
-                        if constexpr (std::is_same_v<T, std::vector<int>>) {
-                            if (this->minimum > other_arg.size())
-                                throw std::runtime_error(
-                                    "Cannot set value. Destination minimum is "
-                                    "larger than the sources length");
-                            this_arg = other_arg;
-                        } else if constexpr (std::is_same_v<T, DynamicArray>) {
-                            if (this->minimum > other.minimum)
-                                throw std::runtime_error(
-                                    "Cannot set value. Destination minimum (" +
-                                    std::to_string(this->minimum) +
-                                    ") is larger than the sources length (" +
-                                    std::to_string(other.minimum) + ")");
-                            for (size_t i = 0; i < this_arg.size(); i++) try {
-                                    this_arg[i] = other_arg.at(i);
-                                } catch (const std::out_of_range& e) {
-                                    this_arg[i] = 0;
-                                }
-                            for (size_t i = this_arg.size(); i < other_arg.size;
-                                 i++)
-                                this_arg.push_back(other_arg[i]);
-                        }
-                    },
-                    other.value);
-            } else if constexpr (std::is_same_v<T, DynamicArray>) {
-                std::visit(
-                    [this, &other, &this_arg](auto&& other_arg) {
-                        using T = std::decay_t<decltype(other_arg)>;
-                        if constexpr (std::is_same_v<T, std::vector<int>>) {
-                            if (this->minimum != other_arg.size())
-                                throw std::runtime_error(
-                                    "Cannot set value. Destination length is "
-                                    "not equal to the sources length");
-                            for (size_t i = 0; i < minimum; i++)
-                                this_arg[i] = other_arg[i];
-                        } else if constexpr (std::is_same_v<T, DynamicArray>) {
-                            if (this->minimum != other.minimum)
-                                throw std::runtime_error(
-                                    "Cannot set value. Destination length is "
-                                    "not equal to the sources length");
-                            for (size_t i = 0; i < minimum; i++)
-                                this_arg[i] = other_arg[i];
-                        }
-                    },
-                    other.value);
-            }
+        [this](auto&& array) {
+            value.template emplace<std::decay_t<decltype(array)>>(array);
         },
-        value);
+        other.value);
+    minimum = other.minimum;
+}
+
+void Value::replace(Value&& other) {
+    value = std::move(other.value);
+    minimum = other.minimum;
+}
+
+size_t Value::getSize() const { return view().size; }
+
+const int* Value::getData() const { return view().data; }
+
+ArrayView Value::view() const {
+    if (auto array = std::get_if<DynamicArray>(&value))
+        return ArrayView{array->data, array->size};
+    return std::get<ArraySlice>(value).view();
+}
+
+Value::operator std::string() const { return toString(view()); }
+
+Value& Value::operator=(const Value& other) {
+    // Writing through a slice would change its source, so it is given its own
+    // copy first.
+    if (std::holds_alternative<ArraySlice>(value))
+        value.emplace<DynamicArray>(DynamicArray::fromValue(*this));
+    auto& array = std::get<DynamicArray>(value);
+    if (minimum < array.size) array.canGrow = true;
+    ArrayView source = other.view();
+    auto otherArray = std::get_if<DynamicArray>(&other.value);
+    bool otherGrows = otherArray != nullptr && otherArray->canGrow;
+    if (!array.canGrow) {
+        if (minimum != source.size)
+            throw std::runtime_error(
+                "Cannot set value. Destination length is not equal to the "
+                "sources length");
+        countElementCopies(minimum);
+        std::memmove(array.data, source.data, minimum * sizeof(int));
+        return *this;
+    }
+    if (minimum > source.size) {
+        if (otherGrows)
+            throw std::runtime_error(
+                "Cannot set value. Destination minimum is larger than the "
+                "sources length");
+        throw std::runtime_error(
+            "Cannot set value. Destination minimum (" +
+            std::to_string(minimum) + ") is larger than the sources length (" +
+            std::to_string(source.size) + ")");
+    }
+    countElementCopies(source.size);
+    // A fixed source shorter than the destination leaves the rest of it
+    // zeros.
+    if (otherGrows || source.size >= array.size) {
+        array.assign(source.data, source.size);
+    } else {
+        std::memmove(array.data, source.data, source.size * sizeof(int));
+        std::fill(array.data + source.size, array.data + array.size, 0);
+    }
     return *this;
 }
 
+// Takes the other value's storage whenever copying its elements would leave
+// the same result, and falls back to copying them otherwise.
+Value& Value::operator=(Value&& other) {
+    auto array = std::get_if<DynamicArray>(&value);
+    auto otherArray = std::get_if<DynamicArray>(&other.value);
+    if (array != nullptr && otherArray != nullptr) {
+        bool growable = array->canGrow || minimum < array->size;
+        bool fits =
+            growable ? minimum <= otherArray->size &&
+                           (otherArray->canGrow ||
+                            otherArray->size >= array->size)
+                     : !otherArray->canGrow && minimum == other.minimum &&
+                           array->size == otherArray->size;
+        if (fits) {
+            *array = std::move(*otherArray);
+            array->canGrow = growable;
+            return *this;
+        }
+    }
+    return *this = static_cast<const Value&>(other);
+}
+
 bool Value::sameSize(const Value& other) const {
-    return DynamicArray::fromValue(*this).size ==
-           DynamicArray::fromValue(other).size;
+    return getSize() == other.getSize();
 }
 
-Value Value::operator+(const Value& other) {
-    if (!sameSize(other))
-        throw std::runtime_error("Cannot add arrays with different sizes");
-    DynamicArray left = DynamicArray::fromValue(*this);
-    DynamicArray right = DynamicArray::fromValue(other);
-    return Value(left + right, left.size);
+// A one-element operand is broadcast across the other, straight from its
+// buffer. Results small enough to live inline use the unrolled kernels.
+static Value elementwise(ArithmeticKernel kernel, const Value& left,
+                         const Value& right) {
+    size_t leftSize = left.getSize();
+    size_t rightSize = right.getSize();
+    size_t size = broadcastSize(kernel, leftSize, rightSize);
+    auto result = DynamicArray::uninitialized(size);
+    if (fixedArithmetic(kernel, left.getData(), leftSize, right.getData(),
+                        rightSize, result.data, size))
+        return Value(std::move(result), size);
+    if (gpuEnabled(size) &&
+        gpuArithmetic({GpuStep{std::nullopt, 0}, GpuStep{std::nullopt, 1},
+                       GpuStep{kernel, 0}},
+                      {GpuOperand{left.getData(), leftSize},
+                       GpuOperand{right.getData(), rightSize}},
+                      result.data, size))
+        return Value(std::move(result), size);
+    if (leftSize == rightSize)
+        applyArithmetic(kernel, left.getData(), right.getData(), result.data,
+                        size);
+    else if (leftSize == 1)
+        applyArithmeticScalarLeft(kernel, left.getData()[0], right.getData(),
+                                  result.data, size);
+    else
+        applyArithmeticScalarRight(kernel, left.getData(), right.getData()[0],
+                                   result.data, size);
+    return Value(std::move(result), size);
 }
 
-Value Value::operator-(const Value& other) {
-    if (!sameSize(other))
-        throw std::runtime_error("Cannot subtract arrays with different sizes");
-    DynamicArray left = DynamicArray::fromValue(*this);
-    DynamicArray right = DynamicArray::fromValue(other);
-    return Value(left - right, left.size);
+// Comparisons hold only when they hold for every pair of elements.
+static bool everyElement(CompareKernel kernel, const Value& left,
+                         const Value& right) {
+    if (!left.sameSize(right)) return false;
+    return fixedCompare(kernel, left.getData(), right.getData(),
+                        left.getSize());
 }
 
-Value Value::operator*(const Value& other) {
-    if (!sameSize(other))
-        throw std::runtime_error("Cannot multiply arrays with different sizes");
-    DynamicArray left = DynamicArray::fromValue(*this);
-    DynamicArray right = DynamicArray::fromValue(other);
-    return Value(left * right, left.size);
+Value Value::operator+(const Value& other) const {
+    return elementwise(ArithmeticKernel::ADD, *this, other);
 }
 
-Value Value::operator/(const Value& other) {
-    if (!sameSize(other))
-        throw std::runtime_error("Cannot divide arrays with different sizes");
-    DynamicArray left = DynamicArray::fromValue(*this);
-    DynamicArray right = DynamicArray::fromValue(other);
-    return Value(left / right, left.size);
+Value Value::operator-(const Value& other) const {
+    return elementwise(ArithmeticKernel::SUB, *this, other);
+}
+
+Value Value::operator*(const Value& other) const {
+    return elementwise(ArithmeticKernel::MUL, *this, other);
+}
+
+Value Value::operator/(const Value& other) const {
+    return elementwise(ArithmeticKernel::DIV, *this, other);
+}
+
+Value Value::operator%(const Value& other) const {
+    return elementwise(ArithmeticKernel::MOD, *this, other);
+}
+
+Value Value::operator&(const Value& other) const {
+    return elementwise(ArithmeticKernel::AND, *this, other);
+}
+
+Value Value::operator|(const Value& other) const {
+    return elementwise(ArithmeticKernel::OR, *this, other);
+}
+
+Value Value::operator^(const Value& other) const {
+    return elementwise(ArithmeticKernel::XOR, *this, other);
+}
+
+Value Value::operator<<(const Value& other) const {
+    return elementwise(ArithmeticKernel::SHL, *this, other);
+}
+
+Value Value::operator>>(const Value& other) const {
+    return elementwise(ArithmeticKernel::SHR, *this, other);
 }
 
 bool Value::operator==(const Value& other) const {
-    if (!sameSize(other)) return false;
-    return DynamicArray::fromValue(*this) == DynamicArray::fromValue(other);
+    return everyElement(CompareKernel::EQ, *this, other);
 }
 
 bool Value::operator!=(const Value& other) const {
-    if (!sameSize(other)) return false;
-    return DynamicArray::fromValue(*this) != DynamicArray::fromValue(other);
+    return everyElement(CompareKernel::NE, *this, other);
 }
 
 bool Value::operator<(const Value& other) const {
-    if (!sameSize(other)) return false;
-    return DynamicArray::fromValue(*this) < DynamicArray::fromValue(other);
+    return everyElement(CompareKernel::LT, *this, other);
 }
 
 bool Value::operator<=(const Value& other) const {
-    if (!sameSize(other)) return false;
-    return DynamicArray::fromValue(*this) <= DynamicArray::fromValue(other);
+    return everyElement(CompareKernel::LE, *this, other);
 }
 
 bool Value::operator>(const Value& other) const {
-    if (!sameSize(other)) return false;
-    return DynamicArray::fromValue(*this) > DynamicArray::fromValue(other);
+    return everyElement(CompareKernel::GT, *this, other);
 }
 
 bool Value::operator>=(const Value& other) const {
-    if (!sameSize(other)) return false;
-    return DynamicArray::fromValue(*this) >= DynamicArray::fromValue(other);
+    return everyElement(CompareKernel::GE, *this, other);
 }
@@ -0,0 +1,483 @@
+// Copyright 2025 Caden Crowson
+
+#include "runtime/vm.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "runtime/builtins.h"
+#include "runtime/stats.h"
+
+VirtualMachine::VirtualMachine(const Program& program,
+                               std::shared_ptr<Scope> globals,
+                               size_t maxDepth)
+    : program(program), globals(std::move(globals)), maxDepth(maxDepth) {}
+
+Value VirtualMachine::call(const std::string& name, std::vector<Value> args) {
+    auto slot = program.findFunction(name);
+    if (!slot.has_value())
+        throw std::runtime_error("Undefined function '" + name + "'");
+    depth = 0;
+    push(program.getChunk(program.getFunction(slot.value()).chunk.value()),
+         args, NO_REGISTER);
+    return run();
+}
+
+static Value callBuiltin(const FunctionSlot& function,
+                         std::vector<Value>& args) {
+    if (function.builtin.has_value())
+        return callBuiltinFunction(function.builtin.value(), args);
+    throw std::runtime_error("Undefined function '" + function.name + "'");
+}
+
+void VirtualMachine::enter(Frame& frame, const Chunk& chunk,
+                           std::vector<Value>& args) {
+    if (chunk.params.size() != args.size())
+        throw std::runtime_error(
+            "Function " + chunk.name + " expected " +
+            std::to_string(chunk.params.size()) +
+            " argument(s) but received " + std::to_string(args.size()));
+    frame.chunk = &chunk;
+    countCall(depth);
+    // Value's assignment checks sizes, so the registers are rebuilt rather
+    // than assigned over.
+    frame.registers.clear();
+    frame.registers.resize(chunk.numRegisters, Value(DynamicArray(0), 0));
+    frame.filled.assign(chunk.numRegisters, false);
+    for (size_t i = 0; i < args.size(); i++)
+        frame.registers[i].replace(
+            Value::fromDescriptor(chunk.params[i], std::move(args[i])));
+    frame.pc = 0;
+    frame.flag = false;
+}
+
+void VirtualMachine::push(const Chunk& chunk, std::vector<Value>& args,
+                          uint32_t result) {
+    if (depth >= maxDepth)
+        throw std::runtime_error("Maximum call depth of " +
+                                 std::to_string(maxDepth) + " exceeded");
+    if (depth == frames.size()) frames.emplace_back();
+    Frame& frame = frames[depth++];
+    frame.result = result;
+    frame.memo = nullptr;
+    enter(frame, chunk, args);
+}
+
+static size_t sliceBound(const SliceBound& bound, const Value* registers,
+                         size_t defaultValue) {
+    switch (bound.kind) {
+        case SliceBound::NONE:
+            return defaultValue;
+        case SliceBound::CONSTANT:
+            return bound.value;
+        case SliceBound::REGISTER: {
+            ArrayView result = registers[bound.value].view();
+            if (result.size != 1 || result[0] < 0)
+                throw std::runtime_error(
+                    "Array Bounds value must be an integer or evaluate to "
+                    "an array with 1 positive value");
+            return result[0];
+        }
+    }
+    throw std::runtime_error("Error executing array range");
+}
+
+static std::pair<size_t, size_t> sliceBounds(size_t size, const Slice& range,
+                                             const Value* registers) {
+    size_t start = sliceBound(range.start, registers, 0);
+    size_t end = sliceBound(range.end, registers, size);
+    if (end < start)
+        throw std::runtime_error(
+            "Array Range upper bound must be greater than or equal to the "
+            "lower bound");
+    if (end > size)
+        throw std::runtime_error(
+            "Array range bounds must be smaller than the "
+            "length of the array");
+    return {start, end};
+}
+
+static Value slice(const Value& value, const Slice& range,
+                   const Value* registers) {
+    auto [start, end] = sliceBounds(value.getSize(), range, registers);
+    size_t newSize = end - start;
+    DynamicArray result(newSize);
+    ArrayView source = value.view();
+    std::copy(source.begin() + start, source.begin() + end, result.data);
+    return Value(std::move(result), newSize);
+}
+
+// Comparisons of two single elements skip the array kernels.
+template <typename Operation>
+static bool holds(Operation operation, const Value& left, const Value& right) {
+    ArrayView leftView = left.view();
+    ArrayView rightView = right.view();
+    if (leftView.size == 1 && rightView.size == 1)
+        return operation(leftView.data[0], rightView.data[0]);
+    return operation(left, right);
+}
+
+static bool fitsDescriptor(const ArrayDescriptor& descriptor,
+                           const Value& value) {
+    return descriptor.getSize() == value.getSize() ||
+           (descriptor.getSize() < value.getSize() && descriptor.getCanGrow());
+}
+
+// Arguments share their registers' elements (Value::share), as do copies
+// from one register or global to another.
+static void collect(const Chunk& chunk, uint32_t list, Value* registers,
+                    std::vector<Value>& values, size_t skip = 0) {
+    uint32_t count = chunk.registerLists[list];
+    values.clear();
+    for (uint32_t i = skip; i < count; i++)
+        values.push_back(registers[chunk.registerLists[list + 1 + i]].share());
+}
+
+// Runs until the frame that is on top when it is called returns. Calls and
+// returns change the top frame, after which `resume` reloads the loop's view
+// of it.
+Value VirtualMachine::run() {
+    size_t bottom = depth - 1;
+    Frame* frame;
+    const Chunk* chunk;
+    Value* registers;
+    size_t pc;
+    bool flag;
+    auto resume = [&]() {
+        frame = &frames[depth - 1];
+        chunk = frame->chunk;
+        registers = frame->registers.data();
+        pc = frame->pc;
+        flag = frame->flag;
+    };
+    // Pops the returning frame and hands `result` to its caller; true when
+    // the frame was the one run() started with.
+    auto unwind = [&](Value& result) {
+        uint32_t target = frame->result;
+        if (frame->memo != nullptr)
+            frame->memo->store(std::move(frame->memoKey), result);
+        frame->registers.clear();
+        if (--depth == bottom) return true;
+        resume();
+        registers[target].replace(std::move(result));
+        return false;
+    };
+    resume();
+    while (true) {
+        const Instruction& instruction = chunk->code[pc++];
+        switch (instruction.op) {
+            case OpCode::LOAD_CONST:
+                registers[instruction.a].replace(
+                    chunk->constants[instruction.b]);
+                break;
+            case OpCode::LOAD_GLOBAL: {
+                const std::string& name = chunk->names[instruction.b];
+                auto value =
+                    std::get_if<std::shared_ptr<Value>>(&globals->get(name));
+                if (value == nullptr)
+                    throw std::runtime_error(
+                        "Cannot use " + name +
+                        " as an array, as it is defined as a function");
+                registers[instruction.a].replace(
+                    Value::slice(*value, 0, (*value)->getSize()));
+                registers[instruction.a].minimum = (*value)->minimum;
+                break;
+            }
+            case OpCode::STORE_GLOBAL: {
+                const std::string& name = chunk->names[instruction.b];
+                if (!globals->hasRecursive(name))
+                    throw std::runtime_error(name + " has not been defined");
+                globals->set(name, std::make_shared<Value>(
+                                       registers[instruction.a].share()));
+                break;
+            }
+            case OpCode::MOVE:
+                if (instruction.a != instruction.b)
+                    registers[instruction.a].replace(
+                        registers[instruction.b].share());
+                break;
+            case OpCode::DECLARE: {
+                // Registers above the declared one are temporaries of the
+                // declaration, so their value can be taken rather than
+                // copied.
+                std::optional<Value> value;
+                if (instruction.c == NO_REGISTER)
+                    value = std::nullopt;
+                else if (instruction.c > instruction.a)
+                    value = std::move(registers[instruction.c]);
+                else
+                    value = registers[instruction.c].share();
+                registers[instruction.a].replace(Value::fromDescriptor(
+                    chunk->descriptors[instruction.b], std::move(value)));
+                break;
+            }
+            case OpCode::DECLARE_IF: {
+                const ArrayDescriptor& descriptor =
+                    chunk->descriptors[instruction.b];
+                if (instruction.c == NO_REGISTER) {
+                    registers[instruction.a].replace(
+                        Value::fromDescriptor(descriptor, std::nullopt));
+                    flag = true;
+                } else {
+                    Value& value = registers[instruction.c];
+                    flag = fitsDescriptor(descriptor, value);
+                    if (flag)
+                        registers[instruction.a].replace(
+                            Value::fromDescriptor(descriptor, value.share()));
+                }
+                break;
+            }
+            case OpCode::ADD:
+                registers[instruction.a].replace(registers[instruction.b] +
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::SUB:
+                registers[instruction.a].replace(registers[instruction.b] -
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::MUL:
+                registers[instruction.a].replace(registers[instruction.b] *
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::DIV:
+                registers[instruction.a].replace(registers[instruction.b] /
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::MOD:
+                registers[instruction.a].replace(registers[instruction.b] %
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::AND:
+                registers[instruction.a].replace(registers[instruction.b] &
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::OR:
+                registers[instruction.a].replace(registers[instruction.b] |
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::XOR:
+                registers[instruction.a].replace(registers[instruction.b] ^
+                                                 registers[instruction.c]);
+                break;
+            case OpCode::SHL:
+                registers[instruction.a].replace(registers[instruction.b]
+                                                 << registers[instruction.c]);
+                break;
+            case OpCode::SHR:
+                registers[instruction.a].replace(
+                    registers[instruction.b] >> registers[instruction.c]);
+                break;
+            case OpCode::SLICE:
+                registers[instruction.a].replace(
+                    slice(registers[instruction.b],
+                          chunk->slices[instruction.c], registers));
+                break;
+            case OpCode::CALL: {
+                collect(*chunk, instruction.c, registers, arguments);
+                const FunctionSlot& function =
+                    program.getFunction(instruction.b);
+                if (!function.chunk.has_value()) {
+                    registers[instruction.a].replace(
+                        callBuiltin(function, arguments));
+                    break;
+                }
+                const Chunk& callee = program.getChunk(function.chunk.value());
+                MemoKey key;
+                if (callee.memo != nullptr) {
+                    for (auto& argument : arguments) key.add(argument);
+                    if (auto cached = callee.memo->find(key)) {
+                        registers[instruction.a].replace(
+                            std::move(cached.value()));
+                        break;
+                    }
+                }
+                frame->pc = pc;
+                frame->flag = flag;
+                push(callee, arguments, instruction.a);
+                if (callee.memo != nullptr) {
+                    frames[depth - 1].memo = callee.memo;
+                    frames[depth - 1].memoKey = std::move(key);
+                }
+                resume();
+                break;
+            }
+            case OpCode::SPAWN: {
+                collect(*chunk, instruction.c, registers, arguments);
+                const FunctionSlot& function =
+                    program.getFunction(instruction.b);
+                if (!function.chunk.has_value())
+                    throw std::runtime_error("Undefined function '" +
+                                             function.name + "'");
+                size_t params =
+                    program.getChunk(function.chunk.value()).params.size();
+                if (params != arguments.size())
+                    throw std::runtime_error(
+                        "Function " + function.name + " expected " +
+                        std::to_string(params) + " argument(s) but received " +
+                        std::to_string(arguments.size()));
+                // Each task runs on a machine of its own.
+                registers[instruction.a].replace(spawnTask(
+                    [&program = program, globals = globals,
+                     maxDepth = maxDepth, name = function.name,
+                     args = std::move(arguments)]() mutable {
+                        return VirtualMachine(program, globals, maxDepth)
+                            .call(name, std::move(args));
+                    }));
+                arguments.clear();
+                break;
+            }
+            case OpCode::TAIL_CALL: {
+                collect(*chunk, instruction.c, registers, arguments);
+                const FunctionSlot& function =
+                    program.getFunction(instruction.b);
+                if (function.chunk.has_value()) {
+                    enter(*frame, program.getChunk(function.chunk.value()),
+                          arguments);
+                    resume();
+                    break;
+                }
+                Value result = callBuiltin(function, arguments);
+                if (unwind(result)) return result;
+                break;
+            }
+            case OpCode::CALL_METHOD: {
+                collect(*chunk, instruction.c, registers, arguments, 1);
+                auto method = static_cast<BuiltinMethod>(instruction.b);
+                uint32_t self = chunk->registerLists[instruction.c + 1];
+                if (self == instruction.a)
+                    callBuiltinMethodInPlace(method, registers[self],
+                                             arguments);
+                else
+                    registers[instruction.a].replace(callBuiltinMethod(
+                        method, registers[self], arguments));
+                break;
+            }
+            case OpCode::JUMP:
+                pc = instruction.a;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                if (!flag) pc = instruction.a;
+                break;
+            case OpCode::JUMP_UNLESS_EQ:
+                if (!holds(std::equal_to<>(), registers[instruction.b],
+                           registers[instruction.c]))
+                    pc = instruction.a;
+                break;
+            case OpCode::JUMP_UNLESS_NE:
+                if (!holds(std::not_equal_to<>(), registers[instruction.b],
+                           registers[instruction.c]))
+                    pc = instruction.a;
+                break;
+            case OpCode::JUMP_UNLESS_LT:
+                if (!holds(std::less<>(), registers[instruction.b],
+                           registers[instruction.c]))
+                    pc = instruction.a;
+                break;
+            case OpCode::JUMP_UNLESS_LE:
+                if (!holds(std::less_equal<>(), registers[instruction.b],
+                           registers[instruction.c]))
+                    pc = instruction.a;
+                break;
+            case OpCode::JUMP_UNLESS_GT:
+                if (!holds(std::greater<>(), registers[instruction.b],
+                           registers[instruction.c]))
+                    pc = instruction.a;
+                break;
+            case OpCode::JUMP_UNLESS_GE:
+                if (!holds(std::greater_equal<>(), registers[instruction.b],
+                           registers[instruction.c]))
+                    pc = instruction.a;
+                break;
+            case OpCode::FOR_INIT:
+                registers[instruction.a].replace(Value(DynamicArray(1), 1));
+                break;
+            case OpCode::FOR_RANGE: {
+                collect(*chunk, instruction.c, registers, arguments);
+                const FunctionSlot& function =
+                    program.getFunction(instruction.b);
+                flag = !function.chunk.has_value() &&
+                       function.builtin.has_value() &&
+                       countsAsRange(function.builtin.value());
+                if (flag) {
+                    DynamicArray size(1);
+                    size[0] = static_cast<int>(rangeSize(arguments));
+                    registers[instruction.a].replace(
+                        Value(std::move(size), 1));
+                } else if (!function.chunk.has_value()) {
+                    registers[instruction.a].replace(
+                        callBuiltin(function, arguments));
+                } else {
+                    frame->pc = pc;
+                    frame->flag = flag;
+                    push(program.getChunk(function.chunk.value()), arguments,
+                         instruction.a);
+                    resume();
+                }
+                break;
+            }
+            case OpCode::FOR_COUNT: {
+                size_t size =
+                    static_cast<size_t>(registers[instruction.b].view()[0]);
+                std::pair<size_t, size_t> bounds{0, size};
+                if (instruction.c != NO_REGISTER)
+                    bounds = sliceBounds(size, chunk->slices[instruction.c],
+                                         registers);
+                DynamicArray counter(2);
+                counter[0] = static_cast<int>(bounds.first);
+                counter[1] = static_cast<int>(bounds.second);
+                registers[instruction.a].replace(Value(std::move(counter), 2));
+                break;
+            }
+            case OpCode::FOR_NEXT: {
+                auto& counter =
+                    std::get<DynamicArray>(registers[instruction.c].value);
+                if (counter.size == 2) {
+                    flag = counter[0] < counter[1];
+                    if (flag) {
+                        DynamicArray element(1);
+                        element[0] = counter[0]++;
+                        registers[instruction.a].replace(
+                            Value(std::move(element), 1));
+                    }
+                    break;
+                }
+                ArrayView iterable = registers[instruction.b].view();
+                size_t index = static_cast<size_t>(counter[0]);
+                flag = index < iterable.size;
+                if (flag) {
+                    DynamicArray element(1);
+                    element[0] = iterable[index];
+                    registers[instruction.a].replace(
+                        Value(std::move(element), 1));
+                    counter[0]++;
+                }
+                break;
+            }
+            case OpCode::FORGET:
+                frame->filled[instruction.a] = false;
+                break;
+            case OpCode::JUMP_IF_FILLED:
+                if (frame->filled[instruction.b]) pc = instruction.a;
+                break;
+            case OpCode::FILL:
+                registers[instruction.a].replace(
+                    registers[instruction.b].share());
+                frame->filled[instruction.a] = true;
+                break;
+            case OpCode::RETURN:
+            case OpCode::RETURN_EMPTY: {
+                Value result = instruction.op == OpCode::RETURN
+                                   ? std::move(registers[instruction.a])
+                                   : Value(DynamicArray(0), 0);
+                if (unwind(result)) return result;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+// Copyright 2025 Caden Crowson
+
+#include "util/arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    auto address = reinterpret_cast<uintptr_t>(cursor);
+    size_t padding = (alignment - address % alignment) % alignment;
+    if (cursor == nullptr ||
+        static_cast<size_t>(end - cursor) < padding + size) {
+        // Large blocks get a chunk of their own so the current one keeps
+        // its free space.
+        if (size > CHUNK_SIZE / 4) {
+            chunks.push_back(std::make_unique<char[]>(size));
+            return chunks.back().get();
+        }
+        chunks.push_back(std::make_unique<char[]>(CHUNK_SIZE));
+        cursor = chunks.back().get();
+        end = cursor + CHUNK_SIZE;
+        padding = 0;
+    }
+    void* block = cursor + padding;
+    cursor += padding + size;
+    return block;
+}
@@ -4,11 +4,12 @@
 
 #include <exception>
 #include <string>
+#include <string_view>
 
 UnexpectedTokenError::UnexpectedTokenError(const std::string& source,
-                                           const std::string& unexpected,
+                                           std::string_view unexpected,
                                            const std::string& expected)
-    : message("Unexpected token " + unexpected + " in " + source +
+    : message("Unexpected token " + std::string(unexpected) + " in " + source +
               ". Expected " + expected) {}
 
 const char* UnexpectedTokenError::what() const noexcept {
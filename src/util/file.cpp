@@ -2,25 +2,251 @@
 
 #include "util/file.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-std::string readCode(const std::string &path) {
-    std::ifstream file(path,
-                       std::ios::in            // Read
-                           | std::ios::binary  // Exact byte for byte read
-                           | std::ios::ate);  // Immediately seek to end of file
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("Failed to open file: " + path);
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        throw std::runtime_error("Failed to read file: " + path);
+    }
+    size = static_cast<size_t>(status.st_size);
+    // Empty files can't be mapped, and special files whose size doesn't
+    // describe their contents are read below instead.
+    if (size > 0 && S_ISREG(status.st_mode)) {
+        void* address =
+            mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("Failed to read file: " + path);
+        madvise(address, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(address);
+        mapped = true;
+        return;
+    }
+    close(descriptor);
+#endif
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) throw std::runtime_error("Failed to open file: " + path);
+    buffer.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    if (file.bad()) throw std::runtime_error("Failed to read file: " + path);
+    data = buffer.data();
+    size = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+}
 
+std::string_view MappedFile::contents() const {
+    return std::string_view(data, size);
+}
+
+ChunkReader::ChunkReader(const std::string& path)
+    : path(path), file(path, std::ios::in | std::ios::binary) {
     if (!file) throw std::runtime_error("Failed to open file: " + path);
+    thread = std::thread([this]() { readAhead(); });
+}
 
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
+ChunkReader::~ChunkReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
 
-    std::string result(size, '\0');
-    if (!file.read(&result[0], size))
-        throw std::runtime_error("Failed to read file: " + path);
+void ChunkReader::readAhead() {
+    while (true) {
+        std::string block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]() {
+                return stopping || ready.size() < READ_AHEAD;
+            });
+            if (stopping) return;
+            if (!spare.empty()) {
+                block = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        // The file is only touched by this thread once it has started.
+        block.resize(BLOCK_SIZE);
+        file.read(block.data(), BLOCK_SIZE);
+        block.resize(static_cast<size_t>(file.gcount()));
+        bool bad = file.bad();
+        bool last = bad || file.eof();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!block.empty()) ready.push_back(std::move(block));
+            failed = bad;
+            finished = last;
+        }
+        changed.notify_all();
+        if (last) return;
+    }
+}
 
+std::string_view ChunkReader::next(size_t limit) {
+    if (offset == current.size()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (current.capacity() >= BLOCK_SIZE)
+            spare.push_back(std::move(current));
+        current.clear();
+        offset = 0;
+        changed.wait(lock, [this]() { return !ready.empty() || finished; });
+        if (ready.empty()) {
+            if (failed)
+                throw std::runtime_error("Failed to read file: " + path);
+            return std::string_view();
+        }
+        current = std::move(ready.front());
+        ready.pop_front();
+        lock.unlock();
+        changed.notify_all();
+    }
+    std::string_view result(current);
+    result = result.substr(offset, limit);
+    offset += result.size();
     return result;
 }
+
+std::unique_ptr<BufferedOutput> BufferedOutput::open(const std::string& path,
+                                                     bool append,
+                                                     size_t capacity) {
+    std::FILE* file = std::fopen(path.c_str(), append ? "ab" : "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Failed to open file: " + path);
+    return std::unique_ptr<BufferedOutput>(
+        new BufferedOutput(file, true, capacity, false));
+}
+
+BufferedOutput::BufferedOutput(std::FILE* file, size_t capacity,
+                               bool lineBuffered)
+    : BufferedOutput(file, false, capacity, lineBuffered) {}
+
+BufferedOutput::BufferedOutput(std::function<void(std::string_view)> sink,
+                               size_t capacity)
+    : file(nullptr), sink(std::move(sink)), owned(false), lineBuffered(false),
+      buffer(std::max<size_t>(capacity, 1)) {}
+
+BufferedOutput::BufferedOutput(std::FILE* file, bool owned, size_t capacity,
+                               bool lineBuffered)
+    : file(file), owned(owned), lineBuffered(lineBuffered),
+      buffer(std::max<size_t>(capacity, 1)) {
+    // Writes leave here already batched, so stdio's own buffer would only
+    // add a copy. Streams that may already be in use keep theirs.
+    if (owned) std::setvbuf(file, nullptr, _IONBF, 0);
+}
+
+BufferedOutput::~BufferedOutput() {
+    try {
+        drain();
+    } catch (const std::runtime_error&) {
+        // Nothing is left to report a failed final write to.
+    }
+    if (owned) std::fclose(file);
+}
+
+void BufferedOutput::write(const int* values, size_t size) {
+    append(values, size);
+}
+
+void BufferedOutput::write(std::string_view bytes) {
+    append(bytes.data(), bytes.size());
+}
+
+template <typename Element>
+void BufferedOutput::append(const Element* values, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool newline = false;
+    while (size > 0) {
+        if (used == buffer.size()) drain();
+        size_t count = std::min(size, buffer.size() - used);
+        char* out = buffer.data() + used;
+        for (size_t i = 0; i < count; i++)
+            out[i] = static_cast<char>(values[i]);
+        if (lineBuffered && !newline)
+            newline = std::memchr(out, '\n', count) != nullptr;
+        used += count;
+        values += count;
+        size -= count;
+    }
+    if (newline) drain();
+}
+
+void BufferedOutput::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    drain();
+}
+
+void BufferedOutput::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    drain();
+    buffer.assign(std::max<size_t>(capacity, 1), '\0');
+}
+
+void BufferedOutput::drain() {
+    if (used == 0) return;
+    size_t pending = used;
+    used = 0;
+    if (sink) {
+        sink(std::string_view(buffer.data(), pending));
+        return;
+    }
+    if (std::fwrite(buffer.data(), 1, pending, file) != pending ||
+        std::fflush(file) != 0)
+        throw std::runtime_error("Failed to write output");
+}
+
+char* mapFile(const std::string& path, size_t& size) {
+#ifndef _WIN32
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return nullptr;
+    struct stat status;
+    void* address = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) &&
+        status.st_size > 0) {
+        size = static_cast<size_t>(status.st_size);
+        address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       descriptor, 0);
+    }
+    close(descriptor);
+    if (address != MAP_FAILED) return static_cast<char*>(address);
+#endif
+    return nullptr;
+}
+
+void unmapFile(void* address, size_t mapped) {
+#ifndef _WIN32
+    auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto start = reinterpret_cast<uintptr_t>(address) & ~(page - 1);
+    munmap(reinterpret_cast<void*>(start), mapped);
+#endif
+}
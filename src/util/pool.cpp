@@ -0,0 +1,204 @@
+// Copyright 2025 Caden Crowson
+
+#include "util/pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+constexpr size_t GRANULE = 16;
+constexpr size_t MAX_BLOCK = 512;
+constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct Pool {
+    FreeBlock* free[MAX_BLOCK / GRANULE] = {};
+    char* cursor = nullptr;
+    char* end = nullptr;
+};
+
+// Never destroyed, since blocks from it may still be in use on other threads
+// after this one exits.
+Pool& threadPool() {
+    static thread_local Pool* pool = new Pool();
+    return *pool;
+}
+
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> bytes{0};
+bool countingBytes = false;
+
+void countAllocation(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (countingBytes) bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#ifndef _WIN32
+
+// Freed large blocks kept for reuse, up to these limits.
+constexpr size_t CACHED_BLOCKS = 8;
+constexpr size_t MAX_CACHED_BYTES = 256 << 20;
+
+size_t mappedSize(size_t size) {
+    return (size + LARGE_BLOCK - 1) / LARGE_BLOCK * LARGE_BLOCK;
+}
+
+// Maps `size` bytes, a multiple of LARGE_BLOCK, aligned to LARGE_BLOCK so
+// that the whole block can be made of huge pages.
+void* mapBlock(size_t size, bool hugePages) {
+    size_t span = size + LARGE_BLOCK;
+    void* mapping = mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc();
+    auto start = reinterpret_cast<uintptr_t>(mapping);
+    uintptr_t aligned = (start + LARGE_BLOCK - 1) / LARGE_BLOCK * LARGE_BLOCK;
+    if (aligned > start) munmap(mapping, aligned - start);
+    size_t tail = start + span - (aligned + size);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + size), tail);
+    auto block = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    if (hugePages) madvise(block, size, MADV_HUGEPAGE);
+#else
+    (void)hugePages;
+#endif
+    return block;
+}
+
+// Pages of a reused block already sit on some node, which is only right
+// for every thread when there is just the one.
+bool severalNodes() {
+    static const bool several = [] {
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string nodes;
+        return std::getline(online, nodes) &&
+               nodes.find_first_of("-,") != std::string::npos;
+    }();
+    return several;
+}
+
+struct BlockCache {
+    std::mutex mutex;
+    std::vector<std::pair<void*, size_t>> blocks;
+    size_t bytes = 0;
+};
+
+// Never destroyed, since arrays may be freed while the process exits.
+BlockCache& blockCache() {
+    static BlockCache* cache = new BlockCache();
+    return *cache;
+}
+
+void* takeCached(size_t size) {
+    BlockCache& cache = blockCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto found = std::find_if(
+        cache.blocks.begin(), cache.blocks.end(),
+        [size](const auto& block) { return block.second == size; });
+    if (found == cache.blocks.end()) return nullptr;
+    void* block = found->first;
+    cache.bytes -= size;
+    cache.blocks.erase(found);
+    return block;
+}
+
+bool keep(void* block, size_t size) {
+    if (severalNodes()) return false;
+    BlockCache& cache = blockCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.blocks.size() == CACHED_BLOCKS ||
+        cache.bytes + size > MAX_CACHED_BYTES)
+        return false;
+    cache.blocks.emplace_back(block, size);
+    cache.bytes += size;
+    return true;
+}
+
+#endif
+
+}  // namespace
+
+// Only the heap requests the pool makes are counted: a block too large for
+// it, or a fresh chunk.
+void* poolAllocate(size_t size) {
+    if (size > MAX_BLOCK) {
+        countAllocation(size);
+        return ::operator new(size);
+    }
+    size_t index = size == 0 ? 0 : (size - 1) / GRANULE;
+    Pool& pool = threadPool();
+    if (FreeBlock* block = pool.free[index]) {
+        pool.free[index] = block->next;
+        return block;
+    }
+    size_t blockSize = (index + 1) * GRANULE;
+    if (static_cast<size_t>(pool.end - pool.cursor) < blockSize) {
+        countAllocation(CHUNK_SIZE);
+        pool.cursor = static_cast<char*>(::operator new(CHUNK_SIZE));
+        pool.end = pool.cursor + CHUNK_SIZE;
+    }
+    void* block = pool.cursor;
+    pool.cursor += blockSize;
+    return block;
+}
+
+void poolDeallocate(void* block, size_t size) {
+    if (size > MAX_BLOCK) {
+        ::operator delete(block);
+        return;
+    }
+    size_t index = size == 0 ? 0 : (size - 1) / GRANULE;
+    Pool& pool = threadPool();
+    auto freed = static_cast<FreeBlock*>(block);
+    freed->next = pool.free[index];
+    pool.free[index] = freed;
+}
+
+size_t heapAllocations() { return allocations.load(std::memory_order_relaxed); }
+
+void countHeapBytes() { countingBytes = true; }
+
+size_t heapBytes() { return bytes.load(std::memory_order_relaxed); }
+
+void* allocateElements(size_t size, bool zeroed) {
+#ifndef _WIN32
+    if (size >= LARGE_BLOCK) {
+        size = mappedSize(size);
+        if (!zeroed)
+            if (void* block = takeCached(size)) return block;
+        countAllocation(size);
+        return mapBlock(size, !zeroed);
+    }
+#endif
+    countAllocation(size);
+    size_t request = size == 0 ? 1 : size;
+    if (void* block = zeroed ? std::calloc(request, 1) : std::malloc(request))
+        return block;
+    throw std::bad_alloc();
+}
+
+void freeElements(void* block, size_t size) {
+#ifndef _WIN32
+    if (size >= LARGE_BLOCK) {
+        size = mappedSize(size);
+        if (!keep(block, size)) munmap(block, size);
+        return;
+    }
+#endif
+    std::free(block);
+}
@@ -0,0 +1,216 @@
+// Copyright 2025 Caden Crowson
+
+#include "util/terminal.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#ifdef _WIN32
+#include <conio.h>
+#include <windows.h>
+#else
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+// The console already hands keys over one at a time without echoing them.
+int readKey() { return _getch(); }
+
+std::optional<int> pollKey() {
+    if (!_kbhit()) return std::nullopt;
+    return _getch();
+}
+
+#else
+
+namespace {
+
+struct termios original;
+volatile sig_atomic_t raw = 0;
+unsigned char buffer[256];
+size_t next = 0;
+size_t end = 0;
+
+void restoreTerminal() {
+    if (raw) tcsetattr(STDIN_FILENO, TCSANOW, &original);
+    raw = 0;
+}
+
+// Puts the terminal back before the signal's usual action, which for all of
+// these ends the program without running atexit handlers.
+void restoreAndRaise(int signal) {
+    restoreTerminal();
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+void enterRawMode() {
+    static bool entered = false;
+    if (entered) return;
+    entered = true;
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &original) != 0)
+        return;
+    struct termios settings = original;
+    settings.c_lflag &= ~(ICANON | ECHO);
+    settings.c_cc[VMIN] = 1;
+    settings.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &settings) != 0) return;
+    raw = 1;
+    std::atexit(restoreTerminal);
+    for (int signal : {SIGINT, SIGTERM, SIGHUP, SIGQUIT}) {
+        struct sigaction action = {};
+        action.sa_handler = restoreAndRaise;
+        sigemptyset(&action.sa_mask);
+        sigaction(signal, &action, nullptr);
+    }
+}
+
+// Reads whatever input has arrived into the buffer, waiting for some first
+// when `wait` is set. False when there is none, or at the end of input.
+bool fill(bool wait) {
+    if (next < end) return true;
+    enterRawMode();
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    int ready;
+    do {
+        ready = poll(&input, 1, wait ? -1 : 0);
+    } while (ready < 0 && errno == EINTR);
+    if (ready <= 0) return false;
+    ssize_t count;
+    do {
+        count = read(STDIN_FILENO, buffer, sizeof(buffer));
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) return false;
+    next = 0;
+    end = static_cast<size_t>(count);
+    return true;
+}
+
+// Bytes come back as char does, so keys read agree with files read.
+int take() { return static_cast<signed char>(buffer[next++]); }
+
+}  // namespace
+
+int readKey() {
+    if (!fill(true)) return -1;
+    return take();
+}
+
+std::optional<int> pollKey() {
+    if (!fill(false)) return std::nullopt;
+    return take();
+}
+
+#endif
+
+#ifdef _WIN32
+
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+// Windows 10 and later consoles take escapes once asked to. Output that
+// isn't a console is left to whatever reads it.
+static bool ansiOutput() {
+    static bool ansi = []() {
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode;
+        if (!GetConsoleMode(console, &mode)) return true;
+        return SetConsoleMode(console,
+                              mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+    }();
+    return ansi;
+}
+
+static void writeConsole(std::string& out) {
+    DWORD written;
+    if (!out.empty())
+        WriteConsoleA(GetStdHandle(STD_OUTPUT_HANDLE), out.data(),
+                      static_cast<DWORD>(out.size()), &written, nullptr);
+    out.clear();
+}
+
+#endif
+
+void clearScreen(std::string& out) {
+#ifdef _WIN32
+    if (!ansiOutput()) {
+        writeConsole(out);
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (!GetConsoleScreenBufferInfo(console, &info)) return;
+        DWORD cells = info.dwSize.X * info.dwSize.Y, written;
+        COORD home = {0, 0};
+        FillConsoleOutputCharacterA(console, ' ', cells, home, &written);
+        FillConsoleOutputAttribute(console, info.wAttributes, cells, home,
+                                   &written);
+        SetConsoleCursorPosition(console, home);
+        return;
+    }
+#endif
+    // Home, clear the screen, then the scrollback, as clear(1) does.
+    out += "\x1b[H\x1b[2J\x1b[3J";
+}
+
+void moveCursor(std::string& out, size_t column, size_t row) {
+#ifdef _WIN32
+    if (!ansiOutput()) {
+        writeConsole(out);
+        COORD position = {static_cast<SHORT>(column), static_cast<SHORT>(row)};
+        SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), position);
+        return;
+    }
+#endif
+    out += "\x1b[";
+    out += std::to_string(row + 1);
+    out += ';';
+    out += std::to_string(column + 1);
+    out += 'H';
+}
+
+// Unchanged cells shorter than a cursor move are rewritten rather than
+// skipped.
+static constexpr size_t SHORTEST_SKIP = 8;
+
+void TerminalScreen::draw(std::string& out, const int* cells, size_t count,
+                          size_t width) {
+    if (width != this->width || count != shown.size()) {
+        if (!blank) clearScreen(out);
+        this->width = width;
+        shown.assign(count, ' ');
+    }
+    blank = false;
+    for (size_t row = 0; row * width < count; row++) {
+        const size_t start = row * width;
+        size_t column = 0;
+        while (column < width) {
+            if (static_cast<char>(cells[start + column]) ==
+                shown[start + column]) {
+                column++;
+                continue;
+            }
+            // A run of changes, including gaps too short to skip.
+            size_t end = column + 1, last = column;
+            while (end < width && end - last <= SHORTEST_SKIP) {
+                if (static_cast<char>(cells[start + end]) !=
+                    shown[start + end])
+                    last = end;
+                end++;
+            }
+            moveCursor(out, column, row);
+            for (size_t i = start + column; i <= start + last; i++) {
+                shown[i] = static_cast<char>(cells[i]);
+                out += shown[i];
+            }
+            column = last + 1;
+        }
+    }
+}
+
+void TerminalScreen::cleared() {
+    shown.assign(shown.size(), ' ');
+    blank = true;
+}
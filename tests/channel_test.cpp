@@ -0,0 +1,111 @@
+// Copyright 2025 Caden Crowson
+
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "runtime/channel.h"
+#include "runtime/value.h"
+
+// Sends and receives through Channel in runtime/channel.h, at the smallest
+// capacity and with several threads at once.
+
+static int failures = 0;
+
+static void expect(bool passed, const std::string& what) {
+    if (passed) return;
+    std::cerr << "FAILED: " << what << '\n';
+    failures++;
+}
+
+static Value number(int n) {
+    DynamicArray array(1);
+    array[0] = n;
+    return Value(std::move(array), 1);
+}
+
+static bool receives(Channel& channel, int n) {
+    std::optional<Value> value = channel.tryReceive();
+    return value && value->getSize() == 1 && value->view()[0] == n;
+}
+
+// One cell holds one value: the second send waits for a receive.
+static void capacityOne() {
+    Channel channel(1);
+    expect(!channel.tryReceive(), "capacity 1: empty at first");
+    Value first = number(1);
+    Value second = number(2);
+    expect(channel.trySend(first), "capacity 1: first send");
+    expect(!channel.trySend(second), "capacity 1: second send is refused");
+    expect(second.view()[0] == 2, "capacity 1: a refused value is kept");
+    expect(receives(channel, 1), "capacity 1: receives the first");
+    expect(!channel.tryReceive(), "capacity 1: empty again");
+    for (int i = 2; i < 10; i++) {
+        Value value = number(i);
+        expect(channel.trySend(value), "capacity 1: send on a later lap");
+        Value extra = number(-i);
+        expect(!channel.trySend(extra), "capacity 1: full on a later lap");
+        expect(receives(channel, i), "capacity 1: in order on a later lap");
+    }
+}
+
+static void fifo() {
+    Channel channel(3);
+    for (int lap = 0; lap < 4; lap++) {
+        for (int i = 0; i < 3; i++) {
+            Value value = number(lap * 3 + i);
+            expect(channel.trySend(value), "capacity 3: send");
+        }
+        Value extra = number(-1);
+        expect(!channel.trySend(extra), "capacity 3: full after three");
+        for (int i = 0; i < 3; i++)
+            expect(receives(channel, lap * 3 + i), "capacity 3: in order");
+    }
+}
+
+// Two senders and one receiver: every value arrives once, and each sender's
+// values in the order they were sent.
+static void concurrent(size_t capacity) {
+    constexpr int COUNT = 20000;
+    Channel channel(capacity);
+    auto sender = [&channel](int sign) {
+        for (int i = 1; i <= COUNT; i++) {
+            Value value = number(sign * i);
+            while (!channel.trySend(value)) std::this_thread::yield();
+        }
+    };
+    std::thread positive(sender, 1);
+    std::thread negative(sender, -1);
+    int nextPositive = 1;
+    int nextNegative = -1;
+    bool ordered = true;
+    for (int received = 0; received < 2 * COUNT;) {
+        std::optional<Value> value = channel.tryReceive();
+        if (!value) {
+            std::this_thread::yield();
+            continue;
+        }
+        int n = value->view()[0];
+        if (n > 0) {
+            ordered = ordered && n == nextPositive++;
+        } else {
+            ordered = ordered && n == nextNegative--;
+        }
+        received++;
+    }
+    positive.join();
+    negative.join();
+    std::string name = "capacity " + std::to_string(capacity);
+    expect(ordered, name + ": each sender's values in order");
+    expect(!channel.tryReceive(), name + ": nothing left over");
+}
+
+int main() {
+    capacityOne();
+    fifo();
+    concurrent(1);
+    concurrent(4);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+// Copyright 2025 Caden Crowson
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "runtime/interpreter.h"
+
+// Calls into tests/embed.ints through the Script API in
+// runtime/interpreter.h, on both engines.
+static const std::string SCRIPT = TEST_DIR "/embed.ints";
+
+static int failures = 0;
+
+static void expect(bool passed, const std::string& what) {
+    if (passed) return;
+    std::cerr << "FAILED: " << what << '\n';
+    failures++;
+}
+
+static void run(Engine engine, const std::string& name) {
+    InterpretOptions options;
+    options.engine = engine;
+    Script script(SCRIPT, options);
+
+    // A function without parameters, with and without an empty list.
+    Value answer = script.call("answer", {});
+    expect(answer.getSize() == 1 && answer.view()[0] == 42,
+           name + ": call(\"answer\", {})");
+    expect(script.call("answer").view()[0] == 42,
+           name + ": call(\"answer\")");
+
+    std::vector<int> xs = {1, 2, 3};
+    int by = 10;
+    std::vector<int> scaled = script.callInts(
+        "scale", {ArrayView{xs.data(), xs.size()}, ArrayView{&by, 1}});
+    expect(scaled == std::vector<int>({10, 20, 30}), name + ": callInts");
+
+    bool threw = false;
+    try {
+        script.call("missing");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, name + ": calling an undefined function throws");
+
+    // Dividing by zero throws, and leaves the Script usable.
+    int zero = 0;
+    threw = false;
+    try {
+        script.callInts("divide",
+                        {ArrayView{xs.data(), xs.size()}, ArrayView{&zero, 1}});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, name + ": dividing by zero throws");
+    expect(script.call("answer").view()[0] == 42,
+           name + ": a call after an error");
+
+    // So does a task the call spawned and never awaited.
+    threw = false;
+    try {
+        script.call("spawnsFailing");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, name + ": an unawaited task's error fails the call");
+}
+
+// Settings the whole process shares can't differ between Scripts.
+static void conflictingOptions() {
+    InterpretOptions options;
+    options.memoLimit = 7;
+    bool threw = false;
+    try {
+        Script script(SCRIPT, options);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, "a Script with a different memoLimit throws");
+    expect(Script(SCRIPT).call("answer").view()[0] == 42,
+           "a Script with the same options loads afterwards");
+}
+
+int main() {
+    run(Engine::TREE_WALKER, "walker");
+    run(Engine::VM, "vm");
+    conflictingOptions();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+// Copyright 2025 Caden Crowson
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "runtime/server.h"
+
+// Runs scripts on a server started by this process through
+// runtime/server.h, checking that a failing script ends its run and not the
+// server.
+static const std::string TESTS = TEST_DIR;
+
+static int failures = 0;
+
+static void expect(bool passed, const std::string& what) {
+    if (passed) return;
+    std::cerr << "FAILED: " << what << '\n';
+    failures++;
+}
+
+// Retries while the server is still starting to listen.
+static int run(const std::string& socket, const std::string& script) {
+    for (int attempt = 0;; attempt++) {
+        try {
+            return runOnServer(socket, TESTS + "/" + script, {});
+        } catch (const std::runtime_error&) {
+            if (attempt == 100) throw;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+}
+
+int main() {
+    std::string socket = "/tmp/ints_serve_test_" +
+                         std::to_string(std::chrono::steady_clock::now()
+                                            .time_since_epoch()
+                                            .count());
+    std::thread([socket] { serve(socket, 1, InterpretOptions()); }).detach();
+
+    expect(run(socket, "divide.ints") == 1,
+           "dividing by zero fails the run");
+    expect(run(socket, "divide.ints") == 1,
+           "the server runs the script again");
+    std::remove(socket.c_str());
+    return failures == 0 ? 0 : 1;
+}